@@ -33,12 +33,18 @@
 
 #include "../../librbr/librbr/include/core/policy/policy_alpha_vectors.h"
 
+#include "lpbvi_mixed_policy.h"
+#include "lpomdp_mapped.h"
+
 #include "../../losm/losm/include/losm.h"
 
 #include "losm_state.h"
+#include "losm_road_graph.h"
+#include "losm_state_table.h"
 
 #include <vector>
 #include <unordered_map>
+#include <functional>
 
 #define TO_SECONDS 60.0
 
@@ -134,6 +140,24 @@ public:
 	 */
 	bool save_policy(PolicyAlphaVectors **policy, unsigned int k, double tirednessBelief, std::string filename);
 
+	/**
+	 * Save a LPBVIMixedPolicy object to the custom format required by the visualizer, in the same
+	 * way as the PolicyAlphaVectors version above.
+	 * @param	policy			The mixed observability policy, one for each value function.
+	 * @param	k				The number of value functions.
+	 * @param	tirednessBelief	The belief value for if the driver is fatigued or not.
+	 * @param	filename		The name of the file to save.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	bool save_policy(LPBVIMixedPolicy **policy, unsigned int k, double tirednessBelief, std::string filename);
+
+	/**
+	 * Compile the fully built model to a binary file, which LPOMDPMapped loads without rebuilding it.
+	 * @param	filename	The name of the compiled model file.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	bool save_model(std::string filename);
+
 	/**
 	 * Get the initial state, as defined by the constructor's two UIDs.
 	 * @param	initial1		The first initial node's UID.
@@ -167,12 +191,19 @@ public:
 	 */
 	const std::vector<std::vector<LOSMState *> > &get_tiredness_states() const;
 
+	/**
+	 * Get the locations for the mixed observability solver: the pair of attentive / tired states of
+	 * each physical location and autonomy, which is fully observed.
+	 * @return	The states of each location.
+	 */
+	std::vector<std::vector<State *> > get_locations() const;
+
 private:
 	/**
-	 * Create the helper hash function for edges.
+	 * Create the road graph, contracting the chains of degree-2 nodes between intersections.
 	 * @param	losm	The Light-OSM object.
 	 */
-	void create_edges_hash(LOSM *losm);
+	void create_road_graph(LOSM *losm);
 
 	/**
 	 * Create the LPOMDP's states from the LOSM object provided.
@@ -193,7 +224,7 @@ private:
 	void create_observations(LOSM *losm);
 
 	/**
-	 * Create the LPOMDP's state transitions from the LOSM object provided.
+	 * Create the LPOMDP's state transitions from the LOSM object provided, directly as sparse rows.
 	 * @param	losm	The Light-OSM object.
 	 */
 	void create_state_transitions(LOSM *losm);
@@ -216,20 +247,6 @@ private:
 	 */
 	void create_misc(LOSM *losm);
 
-	/**
-	 * Map directed path on the graph to merge nodes between intersections.
-	 * @param	losm			The LOSM object.
-	 * @param	current			The current node.
-	 * @param	previous		The previous node.
-	 * @param	distance		The distance (mi) traveled so far.
-	 * @param	speedLimit		The weighted average speed limit (mi / h) traveled so far.
-	 * @param	result			The resultant node of this computation.
-	 * @param	resultStep		The previous node away from the resultant node of this computation.
-	 */
-	void map_directed_path(LOSM *losm, const LOSMNode *current, const LOSMNode *previous,
-			float &distance, float &speedLimit,
-			const LOSMNode *&result, const LOSMNode *&resultStep);
-
 	/**
 	 * Distance from a point to a line formed by two points.
 	 * @param	x0	The point's x-axis.
@@ -242,22 +259,34 @@ private:
 	 */
 	float point_to_line_distance(float x0, float y0, float x1, float y1, float x2, float y2);
 
+	/**
+	 * Execute work over contiguous partitions of [0, size), one for each of the host's threads.
+	 * @param	size	The number of items.
+	 * @param	work	The work on the items [first, last).
+	 */
+	void execute_in_parallel(unsigned int size, const std::function<void (unsigned int first, unsigned int last)> &work);
+
 	/**
 	 * The LOSM object which holds the graph structure. All the nodes are managed by this object.
 	 */
 	LOSM *losm;
 
 	/**
-	 * A helper hash which maps the combination of two LOSMNode pointers to an edge.
-	 * This is used to quickly reference the edges from the combination of LOSMNode UIDs.
+	 * The roads between intersections, with their distances and speed limits, used to create the states.
+	 */
+	LOSMRoadGraph roadGraph;
+
+	/**
+	 * The uniqueness index of the states, since multiple roads may lead between the same intersections.
 	 */
-	std::unordered_map<unsigned int, std::unordered_map<unsigned int, const LOSMEdge *> > edgeHash;
+	LOSMUniquenessIndex uniquenessIndex;
 
 	/**
-	 * A map of the successor for taking an action, in which we ignore the tiredness value of
-	 * the successor state. Used to save a policy for the visualizer.
+	 * The compact table of the states, with the successor for taking an action, in which we ignore
+	 * the tiredness value of the successor state. The states are handles into it, so it stores all of
+	 * their values. Also used to save a policy for the visualizer.
 	 */
-	std::unordered_map<LOSMState *, std::unordered_map<unsigned int, LOSMState *> > successors;
+	LOSMStateTable stateTable;
 
 	/**
 	 * One of the two goal node's UID.
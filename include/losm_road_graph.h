@@ -0,0 +1,147 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_ROAD_GRAPH_H
+#define LOSM_ROAD_GRAPH_H
+
+
+#include "../../losm/losm/include/losm.h"
+
+#include <vector>
+
+// The marker for an edge which does not touch an intersection, i.e., it lies inside a chain.
+#define LOSM_NO_SUPER_EDGE 0xFFFFFFFF
+
+/**
+ * A road between two intersections (nodes whose degree is not 2) after contracting the chain of
+ * degree-2 nodes between them.
+ */
+struct LOSMSuperEdge {
+	/**
+	 * The dense index of the first intersection.
+	 */
+	unsigned int node1;
+
+	/**
+	 * The dense index of the second intersection.
+	 */
+	unsigned int node2;
+
+	/**
+	 * One edge step from the first intersection towards the second.
+	 */
+	const LOSMNode *step1;
+
+	/**
+	 * One edge step from the second intersection towards the first.
+	 */
+	const LOSMNode *step2;
+
+	/**
+	 * The distance (mi) along the road.
+	 */
+	float distance;
+
+	/**
+	 * The speed limit (mi / h) along the road, weighted by the distance of each edge.
+	 */
+	float speedLimit;
+};
+
+/**
+ * The compact intersection graph of a LOSM object. Every chain of degree-2 nodes is contracted into
+ * a single super-edge in one iterative pass, and the intersections receive dense 32-bit indexes.
+ */
+class LOSMRoadGraph {
+public:
+	/**
+	 * The default constructor of the LOSMRoadGraph object, which is empty.
+	 */
+	LOSMRoadGraph();
+
+	/**
+	 * The deconstructor of the LOSMRoadGraph object.
+	 */
+	virtual ~LOSMRoadGraph();
+
+	/**
+	 * Contract the chains of the LOSM object, replacing any previous graph.
+	 * @param	losm	The Light-OSM object.
+	 */
+	void create(const LOSM *losm);
+
+	/**
+	 * Get the number of intersections.
+	 * @return	The number of intersections.
+	 */
+	unsigned int get_num_intersections() const;
+
+	/**
+	 * Get an intersection from its dense index.
+	 * @param	index	The dense index of the intersection.
+	 * @return	The intersection's LOSM node.
+	 */
+	const LOSMNode *get_intersection(unsigned int index) const;
+
+	/**
+	 * Get the super-edges.
+	 * @return	The super-edges.
+	 */
+	const std::vector<LOSMSuperEdge> &get_super_edges() const;
+
+	/**
+	 * Get the super-edge which an edge of the LOSM object ends, and the end it touches.
+	 * @param	edge		The index of the edge in the LOSM object's edges.
+	 * @param	superEdge	The index of the super-edge. This will be modified.
+	 * @param	end			The end (1 or 2) of the super-edge which the edge touches, or 0 if the edge
+	 * 						is the whole super-edge. This will be modified.
+	 * @return	Returns true if the edge is inside a chain, and false otherwise.
+	 */
+	bool get_super_edge(unsigned int edge, unsigned int &superEdge, unsigned int &end) const;
+
+private:
+	/**
+	 * The intersections, ordered by their dense index.
+	 */
+	std::vector<const LOSMNode *> intersections;
+
+	/**
+	 * The super-edges.
+	 */
+	std::vector<LOSMSuperEdge> superEdges;
+
+	/**
+	 * For each edge of the LOSM object, the index of the super-edge it ends, or LOSM_NO_SUPER_EDGE.
+	 */
+	std::vector<unsigned int> edgeSuperEdges;
+
+	/**
+	 * For each edge of the LOSM object, the end of the super-edge it touches (see get_super_edge).
+	 */
+	std::vector<unsigned char> edgeEnds;
+
+};
+
+
+#endif // LOSM_ROAD_GRAPH_H
@@ -30,30 +30,78 @@
 
 #include "../../losm/losm/include/losm_node.h"
 
-#include <unordered_map>
+#include <vector>
+
+/**
+ * A flat hash which assigns the uniqueness index of LOSM states. Each key packs the dense indexes of
+ * the previous and current intersections, the tiredness level and the autonomy into 64 bits, and it is
+ * stored by open addressing, so no allocation is made per key. Each model owns its own index.
+ */
+class LOSMUniquenessIndex {
+public:
+	/**
+	 * The default constructor of the LOSMUniquenessIndex object, which is empty.
+	 */
+	LOSMUniquenessIndex();
+
+	/**
+	 * The deconstructor of the LOSMUniquenessIndex object.
+	 */
+	virtual ~LOSMUniquenessIndex();
+
+	/**
+	 * Get the next uniqueness index of a key, which is the number of times it was seen before.
+	 * @param	previous			The dense index of the previous intersection.
+	 * @param	current				The dense index of the current intersection.
+	 * @param	tiredness			The level of tiredness.
+	 * @param	autonomy			If the autonomy is enabled or not.
+	 * @throw	StateException		The intersection index or tiredness level does not fit in the key.
+	 * @return	The uniqueness index.
+	 */
+	unsigned int next(unsigned int previous, unsigned int current, unsigned int tiredness, bool autonomy);
+
+	/**
+	 * Reset the uniqueness counters.
+	 */
+	void reset();
+
+private:
+	/**
+	 * Double the capacity of the table and re-insert every key.
+	 */
+	void grow();
+
+	/**
+	 * The packed keys, or 0 for an empty slot. Keys are offset by one so that 0 is never a key.
+	 */
+	std::vector<unsigned long long> keys;
+
+	/**
+	 * The counter of each slot.
+	 */
+	std::vector<unsigned int> counters;
+
+	/**
+	 * The number of keys stored.
+	 */
+	unsigned int size;
+
+};
+
+class LOSMStateTable;
 
 /**
  * A custom LSOM state class which holds the two LOSM nodes (in order) and other relevant information.
+ * It is a thin handle: all of its values are stored in its model's LOSMStateTable, at its index.
  */
 class LOSMState : public IndexedState {
 public:
 	/**
-	 * The default constructor of the LOSMState object.
-	 * @param	currentNode			The current LOSM node in which a decision must be made (an intersection).
-	 * @param	previousNode		The previous LOSM node from which the agent originated (an intersection).
-	 * @param	tirednessLevel		The level of tiredness from 0 to MAX_TIREDNESS - 1.
-	 * @param	autonomyEnabled		If the autonomy is enabled or not.
-	 * @param	travelDistance		The distance (mi) from the current to previous nodes.
-	 * @param	travelSpeedLimit	The time (h) from the current to previous nodes.
-	 * @param	isGoal				If this is a goal state or not.
-	 * @param	isAutonomyCapable	If this is an autonomy capable state or not.
-	 * @param	currentStepNode		One edge step from the current node towards the previous node. Used for animations later.
-	 * @param	previousStepNode	One edge step from the previous node towards the current node. Used for animations later.
+	 * The default constructor of the LOSMState object. Only LOSMStateTable creates the states.
+	 * @param	stateTable			The table which stores the values of the state, which must outlive it.
+	 * @param	stateIndex			The index of the state within its model, replacing the process-wide one.
 	 */
-	LOSMState(const LOSMNode *currentNode, const LOSMNode *previousNode, unsigned int tirednessLevel,
-			bool autonomyEnabled, float travelDistance, float travelSpeedLimit,
-			bool isGoalState, bool isAutonomyCapableState,
-			const LOSMNode *currentStepNode, const LOSMNode *previousStepNode);
+	LOSMState(const LOSMStateTable *stateTable, unsigned int stateIndex);
 
 	/**
 	 * The copy constructor of the LOSMState object.
@@ -96,11 +144,6 @@ public:
 	 */
 	unsigned int get_uniqueness_index() const;
 
-	/**
-	 * Reset the uniqueness counters.
-	 */
-	static void reset_uniqueness_counters();
-
 	/**
 	 * Get the distance traveled.
 	 * @return	The distance traveled.
@@ -158,69 +201,9 @@ public:
 
 private:
 	/**
-	 * The previous LOSM node from which the agent originated.
-	 */
-	const LOSMNode *previous;
-
-	/**
-	 * The current LOSM node in which a decision must be made (an intersection).
-	 */
-	const LOSMNode *current;
-
-	/**
-	 * The tiredness level from 0 to MAX_TIREDNESS - 1.
-	 */
-	unsigned int tiredness;
-
-	/**
-	 * If autonomy has been enabled or not.
-	 */
-	bool autonomy;
-
-	/**
-	 * The uniqueness index, since the four above values can actually be found in
-	 * multiple parts of a map due to multiple paths which lead between the same
-	 * intersections.
-	 */
-	unsigned int uniquenessIndex;
-
-	/**
-	 * The static variable to keep track of the current uniqueness.
-	 */
-	static std::unordered_map<const LOSMNode *,
-		std::unordered_map<const LOSMNode *,
-			std::unordered_map<unsigned int,
-				std::unordered_map<bool, unsigned int> > > > uniquenessCounter;
-
-	/**
-	 * The distance from the current node to the previous node in miles.
-	 */
-	float distance;
-
-	/**
-	 * The average speed limit along this road.
-	 */
-	float speedLimit;
-
-	/**
-	 * If this is a goal state or not.
-	 */
-	bool isGoal;
-
-	/**
-	 * If this is an autonomy capable state or not.
-	 */
-	bool isAutonomyCapable;
-
-	/**
-	 * One edge step from the current node towards the previous node. Used for animations later.
-	 */
-	const LOSMNode *currentStep;
-
-	/**
-	 * One edge step from the previous node towards the current node. Used for animations later.
+	 * The table which stores the values of this state.
 	 */
-	const LOSMNode *previousStep;
+	const LOSMStateTable *table;
 
 };
 
@@ -0,0 +1,289 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LOSM_STATE_TABLE_H
+#define LOSM_STATE_TABLE_H
+
+
+#include "losm_state.h"
+
+#include "../../losm/losm/include/losm_node.h"
+
+#include <vector>
+#include <unordered_map>
+
+// The marker for a state-action pair without a successor.
+#define LOSM_NO_SUCCESSOR 0xFFFFFFFF
+
+/**
+ * A compact structure-of-arrays table of the LOSM states, indexed by the state's index. Nodes are
+ * stored as dense 32-bit indexes, and the tiredness, autonomy, goal and autonomy capable values of
+ * each state are packed into one byte. It also holds the flat n-m array of the successor of each
+ * state-action pair, which is used to save policies and compute rewards.
+ *
+ * The table is the only storage of the states' values; it creates the LOSMState objects, which the
+ * model's states hold, as handles of their index into it.
+ */
+class LOSMStateTable {
+public:
+	/**
+	 * The default constructor of the LOSMStateTable object, which is empty.
+	 */
+	LOSMStateTable();
+
+	/**
+	 * The deconstructor of the LOSMStateTable object.
+	 */
+	virtual ~LOSMStateTable();
+
+	/**
+	 * Add a state with the next index, and create its handle. The handle is not owned by the table.
+	 * @param	currentNode			The current LOSM node in which a decision must be made (an intersection).
+	 * @param	previousNode		The previous LOSM node from which the agent originated (an intersection).
+	 * @param	tirednessLevel		The level of tiredness from 0 to MAX_TIREDNESS - 1.
+	 * @param	autonomyEnabled		If the autonomy is enabled or not.
+	 * @param	travelDistance		The distance (mi) from the current to previous nodes.
+	 * @param	travelSpeedLimit	The time (h) from the current to previous nodes.
+	 * @param	isGoalState			If this is a goal state or not.
+	 * @param	isAutonomyCapableState	If this is an autonomy capable state or not.
+	 * @param	currentStepNode		One edge step from the current node towards the previous node.
+	 * @param	previousStepNode	One edge step from the previous node towards the current node.
+	 * @param	uniquenessIndex		The uniqueness index, from the model's LOSMUniquenessIndex.
+	 * @throw	StateException		The tiredness level does not fit.
+	 * @return	The new state.
+	 */
+	LOSMState *add(const LOSMNode *currentNode, const LOSMNode *previousNode, unsigned int tirednessLevel,
+			bool autonomyEnabled, float travelDistance, float travelSpeedLimit,
+			bool isGoalState, bool isAutonomyCapableState,
+			const LOSMNode *currentStepNode, const LOSMNode *previousStepNode,
+			unsigned int uniquenessIndex);
+
+	/**
+	 * Remove all the states and successors.
+	 */
+	void clear();
+
+	/**
+	 * Get the number of states.
+	 * @return	The number of states.
+	 */
+	unsigned int get_num_states() const;
+
+	/**
+	 * Get the number of nodes referenced by the states.
+	 * @return	The number of nodes.
+	 */
+	unsigned int get_num_nodes() const;
+
+	/**
+	 * Get a node from its dense index.
+	 * @param	node	The dense index of the node.
+	 * @return	The LOSM node.
+	 */
+	const LOSMNode *get_node(unsigned int node) const;
+
+	/**
+	 * Get a state from its index.
+	 * @param	state	The index of the state.
+	 * @return	The state.
+	 */
+	LOSMState *get_state(unsigned int state) const;
+
+	/**
+	 * Get the dense index of the current node of a state.
+	 * @param	state	The index of the state.
+	 * @return	The dense index of the current node.
+	 */
+	unsigned int get_current(unsigned int state) const;
+
+	/**
+	 * Get the dense index of the previous node of a state.
+	 * @param	state	The index of the state.
+	 * @return	The dense index of the previous node.
+	 */
+	unsigned int get_previous(unsigned int state) const;
+
+	/**
+	 * Get the dense index of the current step node of a state.
+	 * @param	state	The index of the state.
+	 * @return	The dense index of the current step node.
+	 */
+	unsigned int get_current_step(unsigned int state) const;
+
+	/**
+	 * Get the dense index of the previous step node of a state.
+	 * @param	state	The index of the state.
+	 * @return	The dense index of the previous step node.
+	 */
+	unsigned int get_previous_step(unsigned int state) const;
+
+	/**
+	 * Get the level of tiredness of a state.
+	 * @param	state	The index of the state.
+	 * @return	The level of tiredness.
+	 */
+	unsigned int get_tiredness(unsigned int state) const;
+
+	/**
+	 * Get if the autonomy is enabled or not in a state.
+	 * @param	state	The index of the state.
+	 * @return	If the autonomy is enabled or not.
+	 */
+	bool get_autonomy(unsigned int state) const;
+
+	/**
+	 * Return if a state is a goal state or not.
+	 * @param	state	The index of the state.
+	 * @return	Returns if the state is a goal state or not.
+	 */
+	bool is_goal(unsigned int state) const;
+
+	/**
+	 * Return if a state is an autonomy capable state or not.
+	 * @param	state	The index of the state.
+	 * @return	Returns if the state is an autonomy capable state or not.
+	 */
+	bool is_autonomy_capable(unsigned int state) const;
+
+	/**
+	 * Get the uniqueness index of a state.
+	 * @param	state	The index of the state.
+	 * @return	The uniqueness index.
+	 */
+	unsigned int get_uniqueness_index(unsigned int state) const;
+
+	/**
+	 * Get the distance traveled in a state.
+	 * @param	state	The index of the state.
+	 * @return	The distance traveled.
+	 */
+	float get_distance(unsigned int state) const;
+
+	/**
+	 * Get the speed limit traveled in a state.
+	 * @param	state	The index of the state.
+	 * @return	The speed limit traveled.
+	 */
+	float get_speed_limit(unsigned int state) const;
+
+	/**
+	 * Allocate the successors for a number of actions, which are all initially LOSM_NO_SUCCESSOR.
+	 * @param	numActions	The number of actions.
+	 */
+	void initialize_successors(unsigned int numActions);
+
+	/**
+	 * Set the successor of a state-action pair. Each state's row may be set by a different thread.
+	 * @param	state		The index of the state.
+	 * @param	action		The index of the action.
+	 * @param	successor	The index of the successor state.
+	 */
+	void set_successor(unsigned int state, unsigned int action, unsigned int successor);
+
+	/**
+	 * Get the successor of a state-action pair.
+	 * @param	state		The index of the state.
+	 * @param	action		The index of the action.
+	 * @throw	StateException		The state-action pair does not have a successor.
+	 * @return	The index of the successor state.
+	 */
+	unsigned int get_successor(unsigned int state, unsigned int action) const;
+
+private:
+	/**
+	 * Get the dense index of a node, assigning the next one if it is new.
+	 * @param	node	The LOSM node.
+	 * @return	The dense index of the node.
+	 */
+	unsigned int index_node(const LOSMNode *node);
+
+	/**
+	 * The nodes, ordered by their dense index.
+	 */
+	std::vector<const LOSMNode *> nodes;
+
+	/**
+	 * The dense index of each node.
+	 */
+	std::unordered_map<const LOSMNode *, unsigned int> nodeIndexes;
+
+	/**
+	 * The state handles, ordered by their index.
+	 */
+	std::vector<LOSMState *> states;
+
+	/**
+	 * The dense index of the current node of each state.
+	 */
+	std::vector<unsigned int> current;
+
+	/**
+	 * The dense index of the previous node of each state.
+	 */
+	std::vector<unsigned int> previous;
+
+	/**
+	 * The dense index of the current step node of each state.
+	 */
+	std::vector<unsigned int> currentStep;
+
+	/**
+	 * The dense index of the previous step node of each state.
+	 */
+	std::vector<unsigned int> previousStep;
+
+	/**
+	 * The packed tiredness (bits 0-2), autonomy (bit 3), goal (bit 4) and autonomy capable (bit 5) of each state.
+	 */
+	std::vector<unsigned char> flags;
+
+	/**
+	 * The uniqueness index of each state.
+	 */
+	std::vector<unsigned int> uniqueness;
+
+	/**
+	 * The distance of each state.
+	 */
+	std::vector<float> distance;
+
+	/**
+	 * The speed limit of each state.
+	 */
+	std::vector<float> speedLimit;
+
+	/**
+	 * The number of actions of the successors.
+	 */
+	unsigned int m;
+
+	/**
+	 * The flat n-m array of the successor of each state-action pair.
+	 */
+	std::vector<unsigned int> successors;
+
+};
+
+
+#endif // LOSM_STATE_TABLE_H
@@ -0,0 +1,213 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPBPI_H
+#define LPBPI_H
+
+
+#include "lpomdp.h"
+#include "lpbvi.h"
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <atomic>
+
+/**
+ * Solve a Lexicographic Partially Observable Markov Decision Process (LMDP) using point-based policy
+ * iteration. For each value function, the policy is a finite controller: each node has an action, and for
+ * each observation the node to follow. Each improvement step is a point-based backup of the controller's
+ * alpha vectors at the belief points, over the actions left available by the slack of the value functions
+ * before it. As in Hansen's policy iteration, a backup which improves on the controller at its belief point
+ * is added as a new node, the nodes which it pointwise dominates are replaced by it, and the nodes which the
+ * belief points' nodes no longer reach are pruned. Each evaluation then computes the alpha vectors of the
+ * resulting controller. It stops once the controller does not change, which usually takes only a handful of
+ * steps.
+ *
+ * The belief points, expansions, slack, and the rest of the settings are those of LPBVI; the number of
+ * update iterations is not used. Each evaluation stops once the largest change is below the evaluation
+ * tolerance (see set_evaluation_tolerance), or at the maximum number of sweeps (see
+ * set_max_evaluation_sweeps).
+ */
+class LPBPI : public LPBVI {
+public:
+	/**
+	 * The default constructor for the LPBPI class. The default number of improvement iterations is 10, the
+	 * default maximum number of sweeps of each evaluation is 100000, the default evaluation tolerance is
+	 * 0.000001, and the default expansion rule is Random Belief Selection.
+	 */
+	LPBPI();
+
+	/**
+	 * A constructor for the LPBPI class which allows for the specification of the expansion rule, and the
+	 * number of iterations (both updates and expansions) to run for infinite horizon. The defaults are
+	 * otherwise as above.
+	 * @param	expansionRule			The expansion rule to use.
+	 * @param	updateIterations 		The number of update iterations, which policy iteration does not use.
+	 * @param	expansionIterations 	The number of expansion iterations to run for infinite horizon POMDPs.
+	 */
+	LPBPI(POMDPPBVIExpansionRule expansionRule, unsigned int updateIterations, unsigned int expansionIterations);
+
+	/**
+	 * The deconstructor for the LPBPI class.
+	 */
+	virtual ~LPBPI();
+
+	/**
+	 * Set the maximum number of improvement iterations of each value function.
+	 * @param	iterations		The maximum number of improvement iterations. Values of 0 are treated as 1.
+	 */
+	virtual void set_num_improvement_iterations(unsigned int iterations);
+
+	/**
+	 * Get the maximum number of improvement iterations of each value function.
+	 * @return	The maximum number of improvement iterations.
+	 */
+	virtual unsigned int get_num_improvement_iterations() const;
+
+	/**
+	 * Set the maximum number of sweeps of each evaluation. This only bounds an evaluation which does not
+	 * reach the evaluation tolerance, e.g., with a discount factor near 1, and it is logged when reached.
+	 * @param	sweeps		The maximum number of sweeps. Values of 0 are treated as 1.
+	 */
+	virtual void set_max_evaluation_sweeps(unsigned int sweeps);
+
+	/**
+	 * Get the maximum number of sweeps of each evaluation.
+	 * @return	The maximum number of sweeps.
+	 */
+	virtual unsigned int get_max_evaluation_sweeps() const;
+
+protected:
+	/**
+	 * Solve an infinite horizon LMDP using point-based policy iteration.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 * @param	R					The factored state-action rewards.
+	 * @param	h					The horizon.
+	 * @param	delta				The slack vector.
+	 * @throw	PolicyException		An error occurred computing the policy.
+	 * @return	Return the optimal policy.
+	 */
+	virtual PolicyAlphaVectors **solve_infinite_horizon(StatesMap *S, ActionsMap *A,
+			ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+			FactoredRewards *R, Horizon *h, std::vector<float> &delta);
+
+	/**
+	 * Create the model of each action over the states in the order of the belief cache.
+	 * @param	A					The finite actions.
+	 * @param	O					The finite observation transition function.
+	 * @param	R					The factored state-action rewards.
+	 * @param	models				The model of each action. This will be modified.
+	 * @throw	RewardException		A reward was not a SARewards.
+	 */
+	virtual void create_action_models(ActionsMap *A, ObservationTransitions *O, FactoredRewards *R,
+			std::unordered_map<Action *, LPBVIActionModel> &models);
+
+	/**
+	 * Compute one value function by policy iteration over the belief points of B.
+	 * @param	h			The horizon.
+	 * @param	models		The model of each action.
+	 * @param	i			The index of the value function.
+	 * @param	Ai			The actions available at each belief point.
+	 * @param	stopped		Whether the solve must stop; set if the stop is requested during the iterations.
+	 * @return	The alpha vectors of the final controller, one for each node, which the caller must free.
+	 */
+	virtual std::vector<PolicyAlphaVector *> compute_objective_policy_iteration(Horizon *h,
+			const std::unordered_map<Action *, LPBVIActionModel> &models, unsigned int i,
+			const std::map<BeliefState *, std::vector<Action *> > &Ai, bool &stopped);
+
+	/**
+	 * Improve the controller with a point-based backup of its alpha vectors at each belief point, in parallel.
+	 * Each improving backup is a new node, which replaces the nodes it pointwise dominates, and the nodes which
+	 * are no longer reachable from the belief points' nodes are then pruned. A node without an action has the
+	 * zero alpha vector; it is only the controller's initial node.
+	 * @param	h			The horizon.
+	 * @param	models		The model of each action.
+	 * @param	i			The index of the value function.
+	 * @param	Ai			The actions available at each belief point.
+	 * @param	gamma		The N-n array of the alpha vectors of the controller's N nodes. A new node's is its
+	 * 						backup. This will be modified.
+	 * @param	actions		The action of each node. This will be modified.
+	 * @param	nodes		The N-z array of the successor node of each node for each observation. This will be modified.
+	 * @return	Returns true if the controller changed, and false otherwise.
+	 */
+	virtual bool improve_controller(Horizon *h, const std::unordered_map<Action *, LPBVIActionModel> &models,
+			unsigned int i, const std::map<BeliefState *, std::vector<Action *> > &Ai, std::vector<double> &gamma,
+			std::vector<Action *> &actions, std::vector<unsigned int> &nodes);
+
+	/**
+	 * Compute the alpha vector of one node with one sweep over the alpha vectors of the controller.
+	 * @param	h			The horizon.
+	 * @param	models		The model of each action.
+	 * @param	i			The index of the value function.
+	 * @param	action		The action of the node.
+	 * @param	successorNodes	The successor node for each observation.
+	 * @param	gamma		The N-n array of the alpha vectors of the controller.
+	 * @param	alpha		The n array of the node's alpha vector. This will be modified.
+	 */
+	virtual void backup_node(Horizon *h, const std::unordered_map<Action *, LPBVIActionModel> &models,
+			unsigned int i, Action *action, const unsigned int *successorNodes, const std::vector<double> &gamma,
+			double *alpha) const;
+
+	/**
+	 * Evaluate the controller to the evaluation tolerance, starting from its previous alpha vectors, in parallel.
+	 * @param	h			The horizon.
+	 * @param	models		The model of each action.
+	 * @param	i			The index of the value function.
+	 * @param	actions		The action of each node.
+	 * @param	nodes		The N-z array of the successor node of each node for each observation.
+	 * @param	gamma		The N-n array of the alpha vectors of the controller. This will be modified.
+	 * @return	The number of sweeps performed.
+	 */
+	virtual unsigned int evaluate_controller(Horizon *h, const std::unordered_map<Action *, LPBVIActionModel> &models,
+			unsigned int i, const std::vector<Action *> &actions, const std::vector<unsigned int> &nodes,
+			std::vector<double> &gamma);
+
+	/**
+	 * Create the alpha vectors of the controller.
+	 * @param	gamma		The N-n array of the alpha vectors of the controller.
+	 * @param	actions		The action of each node.
+	 * @return	The alpha vectors, one for each node with an action, which the caller must free.
+	 */
+	virtual std::vector<PolicyAlphaVector *> create_alpha_vectors(const std::vector<double> &gamma,
+			const std::vector<Action *> &actions) const;
+
+	/**
+	 * The maximum number of improvement iterations of each value function.
+	 */
+	unsigned int improvements;
+
+	/**
+	 * The maximum number of sweeps of each evaluation.
+	 */
+	unsigned int maxEvaluationSweeps;
+
+};
+
+
+#endif // LPBPI_H
@@ -42,7 +42,29 @@
 #include "../../librbr/librbr/include/core/initial.h"
 #include "../../librbr/librbr/include/core/horizon.h"
 
+#include "numa_topology.h"
+#include "lpbvi_cancellation_token.h"
+#include "lpbvi_belief_cache.h"
+#include "lpbvi_checkpoint.h"
+#include "lpbvi_session.h"
+#include "lpbvi_gamma.h"
+
 #include <unordered_map>
+#include <functional>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <string>
+#include <map>
+
+/**
+ * A callback which receives a snapshot of the policy during a solve: one set of alpha vectors for
+ * each of the k value functions. A partial snapshot has only the first k value functions of the
+ * expansion in progress; otherwise, it has all of them, from a completed expansion. The policy is
+ * still owned by the solver, and is only valid during the call, so copy what must be kept (e.g.,
+ * save it to a file).
+ */
+typedef std::function<void (PolicyAlphaVectors **policy, unsigned int k, bool partial)> LPBVISnapshotCallback;
 
 /**
  * Solve a Lexicographic Partially Observable Markov Decision Process (LMDP).
@@ -99,6 +121,67 @@ public:
 	 */
 	virtual void eta_constraint(bool value);
 
+	/**
+	 * Set the number of worker threads used to compute the backups over the belief points.
+	 * The default is 1, which runs everything on the calling thread.
+	 * @param	threads		The number of worker threads. Values of 0 are treated as 1.
+	 */
+	virtual void set_num_threads(unsigned int threads);
+
+	/**
+	 * Get the number of worker threads used to compute the backups over the belief points.
+	 * @return	The number of worker threads.
+	 */
+	virtual unsigned int get_num_threads() const;
+
+	/**
+	 * Enable or disable the NUMA mode of the multi-threaded solver. When enabled, the belief points
+	 * (and hence their rows of Gamma) are partitioned over the NUMA nodes, each worker is pinned to
+	 * its partition's node, and the read-only model arrays are interleaved over all nodes.
+	 * @param	value	Enable the NUMA mode or not.
+	 */
+	virtual void numa_mode(bool value);
+
+	/**
+	 * Enable or disable the pipelined schedule for expansion rules which do not depend on the value functions
+	 * (random belief selection, and the stochastic simulations with random or exploratory actions). Each
+	 * expansion is performed as soon as its first value function is complete, and the next expansion's first
+	 * value function is computed on some of the threads while the rest compute this expansion's remaining value
+	 * functions. The result is identical to the sequential schedule. It requires multiple threads, expansions,
+	 * and value functions, and is not used in the NUMA mode or with checkpoints.
+	 * @param	value	Enable the pipelined schedule or not.
+	 */
+	virtual void pipelining(bool value);
+
+	/**
+	 * Enable or disable the speculative mode. Instead of computing the value functions in sequence, all of them
+	 * are updated together in rounds, and each one's available actions are restricted by the latest (partially
+	 * converged) Gamma of the one before it, rather than its final one. Whenever those actions change, the value
+	 * function's count of updates starts over; it is finished once its actions come from the final Gamma of the
+	 * one before it, and it has had the full number of updates with them. When the restrictions settle early,
+	 * the wall time for k value functions is close to that of one. The result is not bit-identical to the
+	 * sequential mode, since each value function starts from its speculative Gamma rather than zero. No
+	 * checkpoints are written during a speculative expansion, and the pipelined schedule takes precedence.
+	 * @param	value	Enable the speculative mode or not.
+	 */
+	virtual void speculative_mode(bool value);
+
+	/**
+	 * Set the tolerance for the evaluation of a policy (compute_value). The evaluation stops early once
+	 * the largest change of any alpha-vector value, over all value functions, is below it. The default
+	 * is 0, which always runs the full number of update iterations.
+	 * @param	epsilon		The tolerance.
+	 */
+	virtual void set_evaluation_tolerance(double epsilon);
+
+	/**
+	 * Set the seed of the stochastic simulation expansions. Each candidate belief point draws from its
+	 * own random stream, determined by the seed, the number of belief points, and the candidate's index,
+	 * so an expansion is reproducible regardless of the number of threads. The default is 0.
+	 * @param	seed	The seed.
+	 */
+	virtual void set_expansion_seed(unsigned int seed);
+
 	/**
 	 * Throw an error if they try to solve just a POMDP.
 	 * @param	pomdp				The partially observable Markov decision process to solve.
@@ -123,7 +206,83 @@ public:
 	virtual PolicyAlphaVectors **solve(LPOMDP *lpomdp);
 
 	/**
-	 * Compute the value of the belief states given a policy.
+	 * Solve the LPOMDP provided using lexicographic point-based value iteration, as an anytime algorithm.
+	 * This sets the time limit, cancellation token, and snapshot callback below, then solves.
+	 * @param	pomdp							The LPOMDP to solve.
+	 * @param	seconds							The wall-clock budget in seconds; 0 for none.
+	 * @param	token							The cancellation token; null for none.
+	 * @param	snapshot						The snapshot callback; empty for none.
+	 * @throw	StateException					The LPOMDP did not have a StatesMap states object.
+	 * @throw	ActionException					The LPOMDP did not have a ActionsMap actions object.
+	 * @throw	ObservationException			The LPOMDP did not have a ObservationsMap actions object.
+	 * @throw	StateTransitionsException		The LPOMDP did not have a StateTransitions state transitions object.
+	 * @throw	ObservationTransitionsException	The LPOMDP did not have a ObservationTransitions observation transitions object.
+	 * @throw	RewardException					The LPOMDP did not have a FactoredRewards (elements SARewards) rewards object.
+	 * @throw	CoreException					The LPOMDP was not infinite horizon.
+	 * @throw	PolicyException					An error occurred computing the policy.
+	 * @return	Return the best consistent policy reached, one set of alpha vectors for each value function.
+	 */
+	virtual PolicyAlphaVectors **solve(LPOMDP *lpomdp, double seconds, LPBVICancellationToken *token,
+			LPBVISnapshotCallback snapshot);
+
+	/**
+	 * Set the wall-clock budget of a solve. Once it has passed (checked at each update boundary), the
+	 * solve stops and returns the policy of the last completed expansion. If the first expansion has
+	 * not completed, it is finished with each remaining value function truncated to a single update,
+	 * so that a usable policy is always returned.
+	 * @param	seconds		The wall-clock budget in seconds; 0 (default) for none.
+	 */
+	virtual void set_time_limit(double seconds);
+
+	/**
+	 * Set the cancellation token of a solve. Cancelling behaves exactly as when the time limit passes.
+	 * @param	token	The cancellation token, which must outlive the solve; null (default) for none.
+	 */
+	virtual void set_cancellation_token(LPBVICancellationToken *token);
+
+	/**
+	 * Set the callback which receives a snapshot of the policy after each completed value function.
+	 * Each is consistent: each value function's alpha vectors are over the same belief points, with
+	 * the actions restricted by the value functions before it. Within an expansion, the snapshot is
+	 * partial, with only the value functions completed so far; the last one completes the expansion,
+	 * and its snapshot has all of them. LPBVIDistributed only sends completed expansions.
+	 * @param	snapshot	The snapshot callback; empty (default) for none.
+	 */
+	virtual void set_snapshot_callback(LPBVISnapshotCallback snapshot);
+
+	/**
+	 * Set the checkpoint file of a solve. A checkpoint of the full solver state is written atomically
+	 * to it after every interval updates of each value function, replacing the previous one. Only the
+	 * multi-threaded solver writes checkpoints; LPBVICuda and LPBVIDistributed cannot resume from them.
+	 * @param	filename	The name of the checkpoint file; empty (default) for none.
+	 * @param	interval	The number of updates between checkpoints. Values of 0 are treated as 1.
+	 */
+	virtual void set_checkpoint(std::string filename, unsigned int interval);
+
+	/**
+	 * Resume a solve of the LPOMDP provided from a checkpoint file, continuing exactly where it was written.
+	 * The LPOMDP must be the same model, and the solver should have the same settings (e.g., the number of
+	 * updates and expansions). Checkpoints continue to be written if a checkpoint file is set. Since the
+	 * previous expansion's policy is not stored, stopping before the resumed expansion completes behaves
+	 * as stopping during the first expansion.
+	 * @param	pomdp							The LPOMDP to solve.
+	 * @param	filename						The name of the checkpoint file.
+	 * @throw	StateException					The LPOMDP did not have a StatesMap states object.
+	 * @throw	ActionException					The LPOMDP did not have a ActionsMap actions object.
+	 * @throw	ObservationException			The LPOMDP did not have a ObservationsMap actions object.
+	 * @throw	StateTransitionsException		The LPOMDP did not have a StateTransitions state transitions object.
+	 * @throw	ObservationTransitionsException	The LPOMDP did not have a ObservationTransitions observation transitions object.
+	 * @throw	RewardException					The LPOMDP did not have a FactoredRewards (elements SARewards) rewards object.
+	 * @throw	CoreException					The LPOMDP was not infinite horizon.
+	 * @throw	PolicyException					The checkpoint could not be loaded, or an error occurred computing the policy.
+	 * @return	Return the optimal policy, one set of alpha vectors for each value function.
+	 */
+	virtual PolicyAlphaVectors **resume(LPOMDP *lpomdp, std::string filename);
+
+	/**
+	 * Compute the value of the belief states given a policy. The belief states are those of the last solve
+	 * (including its expansions), or a copy of the initial set if there has not been one; the returned
+	 * alpha vectors are one for each of them, in order.
 	 * @param	pomdp							The LPOMDP to solve.
 	 * @param	policy							The policy mapping beliefs on the simplex to actions via their values.
 	 * @throw	StateException					The LPOMDP did not have a StatesMap states object.
@@ -138,6 +297,36 @@ public:
 	 */
 	virtual PolicyAlphaVectors **compute_value(LPOMDP *lpomdp, PolicyAlphaVectors *policy);
 
+	/**
+	 * Solve the session's LPOMDP using lexicographic point-based value iteration. Everything the session
+	 * keeps from previous calls is reused, so repeated solves (e.g., over different slack) only pay for
+	 * the iterations themselves.
+	 * @param	session				The session, which must have been created for this solver.
+	 * @throw	RewardException		The slack was incorrectly defined.
+	 * @throw	PolicyException		The session is for another solver, or an error occurred computing the policy.
+	 * @return	Return the optimal policy, one set of alpha vectors for each value function.
+	 */
+	virtual PolicyAlphaVectors **solve(LPBVISession *session);
+
+	/**
+	 * Compute the value of the belief states given a policy, for the session's LPOMDP. Everything the
+	 * session keeps from previous calls is reused. As with compute_value for an LPOMDP, the belief states
+	 * are those of the last solve, or a copy of the initial set if there has not been one.
+	 * @param	session				The session, which must have been created for this solver.
+	 * @param	policy				The policy mapping beliefs on the simplex to actions via their values.
+	 * @throw	RewardException		The slack was incorrectly defined.
+	 * @throw	PolicyException		The session is for another solver, or an error occurred computing the policy.
+	 * @return	Return the alpha values for the policy provided.
+	 */
+	virtual PolicyAlphaVectors **compute_value(LPBVISession *session, PolicyAlphaVectors *policy);
+
+	/**
+	 * Free everything kept for a session, by it and by this solver. This is called by the session when it
+	 * is invalidated or destroyed.
+	 * @param	session		The session.
+	 */
+	virtual void release_session(LPBVISession *session);
+
 protected:
 	/**
 	 * Solve an infinite horizon LMDP using value iteration.
@@ -156,7 +345,150 @@ protected:
 			ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
 			FactoredRewards *R, Horizon *h, std::vector<float> &delta);
 	/**
-	 * Compute the value of a policy at the belief points.
+	 * Solve an infinite horizon LMDP using value iteration, with the expansions pipelined with the value functions.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 * @param	R					The factored state-action rewards.
+	 * @param	h					The horizon.
+	 * @param	delta				The slack vector.
+	 * @throw	PolicyException		An error occurred computing the policy.
+	 * @return	Return the optimal policy.
+	 */
+	virtual PolicyAlphaVectors **solve_infinite_horizon_pipelined(StatesMap *S, ActionsMap *A,
+			ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+			FactoredRewards *R, Horizon *h, std::vector<float> &delta);
+
+	/**
+	 * Compute all of the updates of one value function over the first belief points of B.
+	 * @param	S				The finite states.
+	 * @param	O				The finite observation transition function.
+	 * @param	h				The horizon.
+	 * @param	gammaAStar		The cached Gamma_{a, *} of the value function.
+	 * @param	i				The index of the value function.
+	 * @param	numBeliefs		The number of belief points, from the start of B.
+	 * @param	Ai				The actions available at each belief point.
+	 * @param	threads			The number of worker threads.
+	 * @param	stopped			Whether the solve must stop; set if the stop is requested during the updates.
+	 * @return	The alpha vectors, one for each belief point, which the caller must free.
+	 */
+	virtual std::vector<PolicyAlphaVector *> compute_objective(StatesMap *S, ObservationTransitions *O, Horizon *h,
+			std::map<Action *, std::vector<PolicyAlphaVector *> > &gammaAStar, unsigned int i, unsigned int numBeliefs,
+			const std::map<BeliefState *, std::vector<Action *> > &Ai, unsigned int threads, std::atomic<bool> &stopped);
+
+	/**
+	 * Compute one update of a value function: the optimal alpha vector of each belief point, in parallel.
+	 * @param	O				The finite observation transition function.
+	 * @param	h				The horizon.
+	 * @param	gammaAStar		The cached Gamma_{a, *} of the value function.
+	 * @param	Ai				The actions available at each belief point.
+	 * @param	gammaPrevious	The previous alpha vectors.
+	 * @param	gammaNext		The new alpha vectors, one for each of the first belief points of B. This will be modified.
+	 * @param	threads			The number of worker threads.
+	 */
+	virtual void update_belief_points(ObservationTransitions *O, Horizon *h,
+			std::map<Action *, std::vector<PolicyAlphaVector *> > &gammaAStar,
+			const std::map<BeliefState *, std::vector<Action *> > &Ai,
+			std::vector<PolicyAlphaVector *> &gammaPrevious, std::vector<PolicyAlphaVector *> &gammaNext,
+			unsigned int threads);
+
+	/**
+	 * Compute the optimal alpha vector of one belief point over its available actions.
+	 * @param	O				The finite observation transition function.
+	 * @param	h				The horizon.
+	 * @param	gammaAStar		The cached Gamma_{a, *} of the value function.
+	 * @param	actions			The actions available at the belief point.
+	 * @param	gammaPrevious	The previous alpha vectors, read in place.
+	 * @param	beliefIndex		The index of the belief point in B.
+	 * @return	The new alpha vector, which the caller must free.
+	 */
+	virtual PolicyAlphaVector *update_belief_point(ObservationTransitions *O, Horizon *h,
+			std::map<Action *, std::vector<PolicyAlphaVector *> > &gammaAStar, const std::vector<Action *> &actions,
+			const LPBVIGamma &gammaPrevious, unsigned int beliefIndex);
+
+	/**
+	 * Compute all of the value functions of an expansion together, in the speculative mode (see speculative_mode).
+	 * @param	O					The finite observation transition function.
+	 * @param	R					The factored state-action rewards.
+	 * @param	h					The horizon.
+	 * @param	delta				The slack vector.
+	 * @param	gammaAStar			The cached Gamma_{a, *}, one map for each value function.
+	 * @param	deltaB				The density of the belief points.
+	 * @param	Ai					The actions available at each belief point to the first value function.
+	 * @param	expansionPolicy		The policy of the expansion, one for each value function. This will be modified.
+	 * @param	completed			The alpha vectors of each completed value function. This will be modified.
+	 * @param	stopped				Whether the solve must stop; set if the stop is requested during the rounds.
+	 */
+	virtual void compute_objectives_speculative(ObservationTransitions *O, FactoredRewards *R, Horizon *h,
+			std::vector<float> &delta, std::map<Action *, std::vector<PolicyAlphaVector *> > *gammaAStar, double deltaB,
+			const std::map<BeliefState *, std::vector<Action *> > &Ai, PolicyAlphaVectors **expansionPolicy,
+			std::vector<std::vector<PolicyAlphaVector *> > &completed, bool &stopped);
+
+	/**
+	 * Restrict the actions available at each belief point to those within the slack of a value function, in parallel.
+	 * @param	policy			The value function's policy.
+	 * @param	eta				The one-step slack.
+	 * @param	numBeliefs		The number of belief points, from the start of B.
+	 * @param	Ai				The actions available at each belief point. This will be modified.
+	 * @param	threads			The number of worker threads.
+	 */
+	virtual void restrict_actions(PolicyAlphaVectors *policy, double eta, unsigned int numBeliefs,
+			std::map<BeliefState *, std::vector<Action *> > &Ai, unsigned int threads);
+
+	/**
+	 * Compute the one-step slack eta_i of a value function.
+	 * @param	Ri			The value function's rewards.
+	 * @param	h			The horizon.
+	 * @param	deltai		The value function's slack.
+	 * @param	deltaB		The density of the belief points.
+	 * @return	The one-step slack.
+	 */
+	virtual double compute_slack(SARewards *Ri, Horizon *h, double deltai, double deltaB) const;
+
+	/**
+	 * Get the identity of the model of the current solve or evaluation, which keys the belief cache.
+	 * @return	The identity of the active session's model, or 0 if there is none.
+	 */
+	unsigned long long get_model_identity() const;
+
+	/**
+	 * If a belief state is being recorded, record its value for a value function's alpha vectors.
+	 * @param	i		The index of the value function.
+	 * @param	gamma	The alpha vectors.
+	 */
+	virtual void record_value(unsigned int i, const std::vector<PolicyAlphaVector *> &gamma);
+
+	/**
+	 * Create Gamma_{a, *} for all actions, one map for each value function.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 * @param	R					The factored state-action rewards.
+	 * @throw	RewardException		A reward was not a SARewards.
+	 * @return	The maps, which must be freed with free_gamma_a_star_sets.
+	 */
+	virtual std::map<Action *, std::vector<PolicyAlphaVector *> > *create_gamma_a_star_sets(StatesMap *S,
+			ActionsMap *A, ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O, FactoredRewards *R);
+
+	/**
+	 * Free Gamma_{a, *} for all actions and value functions.
+	 * @param	A				The finite actions.
+	 * @param	R				The factored state-action rewards.
+	 * @param	gammaAStar		The maps created by create_gamma_a_star_sets.
+	 */
+	virtual void free_gamma_a_star_sets(ActionsMap *A, FactoredRewards *R,
+			std::map<Action *, std::vector<PolicyAlphaVector *> > *gammaAStar);
+
+	/**
+	 * Compute the value of a policy at the belief points B, which are left from the last solve; if they are
+	 * empty, they are first set to a copy of the initial set. All value functions are evaluated together in
+	 * one pass over the belief points, since the policy's action at each does not depend on the value
+	 * function, and the passes are split among the worker threads. The k-r-n values of Gamma are stored as
+	 * floats to halve its memory, so the result is within float precision of a double evaluation.
 	 * @param	S					The finite states.
 	 * @param	A					The finite actions.
 	 * @param	Z					The finite observations.
@@ -174,6 +506,22 @@ protected:
 			FactoredRewards *R, Horizon *h, std::vector<float> &delta,
 			PolicyAlphaVectors *policy);
 
+	/**
+	 * Compute the Bellman update of a belief point in B for an action, using the belief cache. The maximal
+	 * projection of Gamma for each observation is selected by its dot product with the cached successor
+	 * tau(b, a, z), since its value at b is the discount times Pr(z | b, a) times that product.
+	 * @param	O				The finite observation transition function.
+	 * @param	h				The horizon.
+	 * @param	gammaAStar		The cached Gamma_{a, *} for the action.
+	 * @param	gamma			The previous set of alpha vectors, read in place.
+	 * @param	action			The action taken.
+	 * @param	beliefIndex		The index of the belief point in B.
+	 * @return	The new alpha vector for the belief point and action.
+	 */
+	virtual PolicyAlphaVector *bellman_update_cached_belief_state(ObservationTransitions *O, Horizon *h,
+			std::vector<PolicyAlphaVector *> &gammaAStar, const LPBVIGamma &gamma,
+			Action *action, unsigned int beliefIndex);
+
 	/**
 	 * Compute the approximate density (an upper bound) of the belief points.
 	 * @param	S	The set of states.
@@ -181,6 +529,258 @@ protected:
 	 */
 	virtual double compute_belief_density(StatesMap *S);
 
+	/**
+	 * Expand the set of belief points B following the expansion rule.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 * @param	policy				The policy of the last value function, which is restricted by all of the
+	 * 								others; used by the greedy action rule.
+	 * @throw	PolicyException		The expansion rule is not supported.
+	 */
+	virtual void expand_belief_points(StatesMap *S, ActionsMap *A, ObservationsMap *Z,
+			StateTransitions *T, ObservationTransitions *O, PolicyAlphaVectors *policy);
+
+	/**
+	 * Expand the set of belief points B by simulating a random action from each of them, in parallel.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 */
+	virtual void expand_stochastic_simulation_random_actions(StatesMap *S, ActionsMap *A,
+			ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O);
+
+	/**
+	 * Expand the set of belief points B by simulating a random action from each candidate, in parallel.
+	 * The new belief points are added to B in the order of the candidates.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 * @param	candidates			The sparse belief points to simulate from.
+	 */
+	virtual void expand_stochastic_simulation_random_actions(StatesMap *S, ActionsMap *A,
+			ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+			const std::vector<LPBVISparseBelief> &candidates);
+
+	/**
+	 * Expand the set of belief points B by simulating the action of the policy at each of them, in parallel.
+	 * For LPBVI, the policy is that of the last value function, so the action is lexicographically greedy.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 * @param	policy				The policy which selects the action.
+	 */
+	virtual void expand_stochastic_simulation_greedy_action(StatesMap *S, ActionsMap *A,
+			ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O, PolicyAlphaVectors *policy);
+
+	/**
+	 * Expand the set of belief points B by simulating the action of the policy at each candidate, in
+	 * parallel. The new belief points are added to B in the order of the candidates.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 * @param	policy				The policy which selects the action.
+	 * @param	candidates			The sparse belief points to simulate from.
+	 */
+	virtual void expand_stochastic_simulation_greedy_action(StatesMap *S, ActionsMap *A,
+			ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O, PolicyAlphaVectors *policy,
+			const std::vector<LPBVISparseBelief> &candidates);
+
+	/**
+	 * Expand the set of belief points B by simulating every action from each of them, and keeping the
+	 * successor farthest from B, in parallel.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 */
+	virtual void expand_stochastic_simulation_exploratory_action(StatesMap *S, ActionsMap *A,
+			ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O);
+
+	/**
+	 * Expand the set of belief points B by simulating every action from each candidate, and keeping the
+	 * successor farthest (L1) from all of the candidates, in parallel. The new belief points are added to
+	 * B in the order of the candidates.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 * @param	candidates			The sparse belief points to simulate from.
+	 */
+	virtual void expand_stochastic_simulation_exploratory_action(StatesMap *S, ActionsMap *A,
+			ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+			const std::vector<LPBVISparseBelief> &candidates);
+
+	/**
+	 * Create the sparse versions of the belief points B, in parallel.
+	 * @param	S			The finite states.
+	 * @param	result		The sparse belief points, one for each in B. This will be modified.
+	 */
+	virtual void create_sparse_beliefs(StatesMap *S, std::vector<LPBVISparseBelief> &result);
+
+	/**
+	 * Update the belief cache to match B, and compute the sparse form of each belief point, in parallel.
+	 * Passing the result as the candidates of an expansion lets it use the cached successors.
+	 * @param	S			The finite states.
+	 * @param	Z			The finite observations.
+	 * @param	T			The finite state transition function.
+	 * @param	O			The finite observation transition function.
+	 * @return	The sparse belief points, one for each in B, which are owned by the belief cache.
+	 */
+	virtual const std::vector<LPBVISparseBelief> &create_cached_beliefs(StatesMap *S, ObservationsMap *Z,
+			StateTransitions *T, ObservationTransitions *O);
+
+	/**
+	 * Add the simulated belief points to B, in order.
+	 * @param	successors	The sparse simulated belief points, one for each candidate.
+	 * @param	failed		For each candidate, non-zero if its simulation failed (and it is skipped).
+	 */
+	virtual void add_sparse_beliefs(const std::vector<LPBVISparseBelief> &successors,
+			const std::vector<unsigned char> &failed);
+
+	/**
+	 * Simulate one step from a sparse belief point: sample a state, a successor, and an observation, then
+	 * compute the updated belief point over the successors of the belief's states.
+	 * @param	S				The finite states.
+	 * @param	T				The finite state transition function.
+	 * @param	O				The finite observation transition function.
+	 * @param	observations	The observations, in a fixed order.
+	 * @param	b				The sparse belief point.
+	 * @param	action			The action taken.
+	 * @param	generator		The random stream.
+	 * @param	result			The sparse updated belief point. This will be modified.
+	 * @return	Returns true if the updated belief point could not be computed, and false otherwise.
+	 */
+	virtual bool simulate_sparse_belief(StatesMap *S, StateTransitions *T, ObservationTransitions *O,
+			const std::vector<Observation *> &observations, const LPBVISparseBelief &b, Action *action,
+			std::mt19937 &generator, LPBVISparseBelief &result) const;
+
+	/**
+	 * Simulate one step from a candidate of an expansion. If the candidates are the belief cache's own sparse
+	 * belief points (create_cached_beliefs), the observation is sampled from the cached Pr(z | b, a) and the
+	 * result is the cached tau(b, a, z); otherwise, this is simulate_sparse_belief.
+	 * @param	S				The finite states.
+	 * @param	T				The finite state transition function.
+	 * @param	O				The finite observation transition function.
+	 * @param	observations	The observations, in a fixed order.
+	 * @param	candidates		The sparse belief points to simulate from.
+	 * @param	candidate		The index of the candidate.
+	 * @param	action			The action taken.
+	 * @param	generator		The random stream.
+	 * @param	result			The sparse updated belief point. This will be modified.
+	 * @return	Returns true if the updated belief point could not be computed, and false otherwise.
+	 */
+	virtual bool simulate_candidate(StatesMap *S, StateTransitions *T, ObservationTransitions *O,
+			const std::vector<Observation *> &observations, const std::vector<LPBVISparseBelief> &candidates,
+			unsigned int candidate, Action *action, std::mt19937 &generator, LPBVISparseBelief &result);
+
+	/**
+	 * Compute the L1 distance between two sparse belief points.
+	 * @param	b1	The first sparse belief point.
+	 * @param	b2	The second sparse belief point.
+	 * @return	The L1 distance.
+	 */
+	virtual double compute_sparse_distance(const LPBVISparseBelief &b1, const LPBVISparseBelief &b2) const;
+
+	/**
+	 * Create the random stream of a candidate belief point in the current expansion.
+	 * @param	candidate	The index of the candidate.
+	 * @return	The random stream.
+	 */
+	virtual std::mt19937 create_expansion_generator(unsigned int candidate) const;
+
+	/**
+	 * Execute work over the indexes [0, size) split into one contiguous partition for each worker
+	 * thread. In NUMA mode, each worker is pinned to the node assigned to its partition. Any exception
+	 * thrown by a worker is rethrown on the calling thread after all workers have finished.
+	 * @param	size	The number of indexes, usually the number of belief points.
+	 * @param	work	The work to perform given the worker's index and its range [first, last).
+	 */
+	virtual void execute_in_parallel(unsigned int size,
+			const std::function<void (unsigned int worker, unsigned int first, unsigned int last)> &work);
+
+	/**
+	 * Execute work over the indexes [0, size) with a given number of worker threads, e.g., when two parts of
+	 * a solve run at the same time.
+	 * @param	size	The number of indexes, usually the number of belief points.
+	 * @param	threads	The number of worker threads. Values of 0 are treated as 1.
+	 * @param	work	The work to perform given the worker's index and its range [first, last).
+	 */
+	virtual void execute_in_parallel(unsigned int size, unsigned int threads,
+			const std::function<void (unsigned int worker, unsigned int first, unsigned int last)> &work);
+
+	/**
+	 * In NUMA mode, interleave the read-only model arrays over the nodes, so that no single node
+	 * serves every worker's reads. Only the array-based model objects can be placed; the others are
+	 * left where they were first touched.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 * @param	R					The factored state-action rewards.
+	 */
+	virtual void numa_place_model(StatesMap *S, ActionsMap *A, ObservationsMap *Z,
+			StateTransitions *T, ObservationTransitions *O, FactoredRewards *R);
+
+	/**
+	 * In NUMA mode, copy each belief point added since the last call on the worker which owns its
+	 * partition, so that the memory is first touched on that worker's node. The belief points which
+	 * were already placed, and their cached successors, are left alone.
+	 */
+	virtual void numa_place_belief_points();
+
+	/**
+	 * In NUMA mode, output the per-node counters: the belief points processed by the workers of each
+	 * node, and the change in the kernel's numastat page allocation counters since the solve began.
+	 * The latter are system-wide, so they include the allocations of every other process.
+	 */
+	virtual void numa_print_counters();
+
+	/**
+	 * Write a checkpoint of the solve at an update boundary. A failure is reported, but does not stop the solve.
+	 * @param	S			The finite states.
+	 * @param	A			The finite actions.
+	 * @param	expansion	The index of the expansion.
+	 * @param	objective	The index of the value function.
+	 * @param	update		The number of updates of the value function which are complete.
+	 * @param	Ai			The actions available at each belief point.
+	 * @param	completed	The alpha vectors of each value function before the objective in this expansion.
+	 * @param	gamma		The alpha vectors of the objective after the completed updates.
+	 */
+	virtual void save_checkpoint(StatesMap *S, ActionsMap *A, unsigned int expansion, unsigned int objective,
+			unsigned int update, const std::map<BeliefState *, std::vector<Action *> > &Ai,
+			const std::vector<std::vector<PolicyAlphaVector *> > &completed,
+			const std::vector<PolicyAlphaVector *> &gamma);
+
+	/**
+	 * Check if the solve must stop: the time limit has passed or the token was cancelled.
+	 * @return	Returns true if the solve must stop, and false otherwise.
+	 */
+	virtual bool is_stop_requested() const;
+
+	/**
+	 * Send a partial snapshot of the expansion in progress to the snapshot callback, if there is one. The
+	 * last value function is not sent here, since the snapshot of its completed expansion follows it.
+	 * @param	expansionPolicy		The policy of the expansion in progress.
+	 * @param	numCompleted		The number of its first value functions which are complete.
+	 * @param	k					The number of value functions.
+	 */
+	virtual void snapshot_value_functions(PolicyAlphaVectors **expansionPolicy, unsigned int numCompleted,
+			unsigned int k);
+
 	/**
 	 * Reset the internal variables.
 	 */
@@ -201,6 +801,102 @@ protected:
 	 */
 	bool constrainEta;
 
+	/**
+	 * The tolerance for the evaluation of a policy.
+	 */
+	double evaluationTolerance;
+
+	/**
+	 * The seed of the stochastic simulation expansions.
+	 */
+	unsigned int expansionSeed;
+
+	/**
+	 * The cache of the sparse belief points in B and their successors, shared by the updates of every value
+	 * function and by the expansions.
+	 */
+	LPBVIBeliefCache beliefCache;
+
+	/**
+	 * The session of the current solve or evaluation, which keeps the model-derived precomputation.
+	 */
+	LPBVISession *activeSession;
+
+	/**
+	 * The wall-clock budget of a solve in seconds, or 0 for none.
+	 */
+	double timeLimit;
+
+	/**
+	 * The cancellation token of a solve, or null for none.
+	 */
+	LPBVICancellationToken *cancellationToken;
+
+	/**
+	 * The callback which receives a snapshot of the policy after each completed value function.
+	 */
+	LPBVISnapshotCallback snapshotCallback;
+
+	/**
+	 * The name of the checkpoint file, or empty for none.
+	 */
+	std::string checkpointFilename;
+
+	/**
+	 * The number of updates between checkpoints.
+	 */
+	unsigned int checkpointInterval;
+
+	/**
+	 * The name of the checkpoint file to resume the next solve from, or empty for none.
+	 */
+	std::string resumeFilename;
+
+	/**
+	 * The time at which the current solve began.
+	 */
+	std::chrono::high_resolution_clock::time_point solveStart;
+
+	/**
+	 * The number of worker threads used to compute the backups.
+	 */
+	unsigned int numThreads;
+
+	/**
+	 * Whether or not the NUMA mode is enabled.
+	 */
+	bool numa;
+
+	/**
+	 * Whether or not the pipelined schedule is enabled.
+	 */
+	bool pipelined;
+
+	/**
+	 * Whether or not the speculative mode is enabled.
+	 */
+	bool speculative;
+
+	/**
+	 * The NUMA layout of the machine.
+	 */
+	NUMATopology numaTopology;
+
+	/**
+	 * The number of belief points processed by the workers of each NUMA node.
+	 */
+	std::vector<unsigned long> numaWorkItems;
+
+	/**
+	 * The number of belief points, from the start of B, which were placed on their worker's node.
+	 */
+	unsigned int numaPlacedBeliefs;
+
+	/**
+	 * The page allocation counters of each NUMA node when the solve began.
+	 */
+	std::vector<NUMACounters> numaInitialCounters;
+
 };
 
 
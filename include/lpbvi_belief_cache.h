@@ -0,0 +1,250 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPBVI_BELIEF_CACHE_H
+#define LPBVI_BELIEF_CACHE_H
+
+
+#include "../../librbr/librbr/include/core/states/states_map.h"
+#include "../../librbr/librbr/include/core/states/belief_state.h"
+#include "../../librbr/librbr/include/core/actions/action.h"
+#include "../../librbr/librbr/include/core/observations/observations_map.h"
+#include "../../librbr/librbr/include/core/state_transitions/state_transitions.h"
+#include "../../librbr/librbr/include/core/observation_transitions/observation_transitions.h"
+
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+/**
+ * A sparse belief state: the states with non-zero probability and their probabilities, sorted by
+ * the states' hash values.
+ */
+typedef std::vector<std::pair<State *, double> > LPBVISparseBelief;
+
+/**
+ * The successor of a belief point b for an action a and observation z: the probability Pr(z | b, a)
+ * and the updated belief point tau(b, a, z), which is empty if the probability is zero.
+ */
+struct LPBVIBeliefSuccessor {
+	/**
+	 * The probability of the observation, Pr(z | b, a).
+	 */
+	double probability;
+
+	/**
+	 * The sparse updated belief point, tau(b, a, z).
+	 */
+	LPBVISparseBelief belief;
+};
+
+/**
+ * A cache of the successors of each belief point in B, which only depend on the model and the belief
+ * point. Each belief point's sparse form and its successors for each action are computed the first time
+ * they are requested, then reused by every update of every value function and by the expansions, until
+ * the belief point at that index changes. The successor states of each state are cached for each action.
+ *
+ * The requests for one belief point must come from one thread at a time; requests for different belief
+ * points may come from different threads, which is how each worker fills the slots of its partition.
+ */
+class LPBVIBeliefCache {
+public:
+	/**
+	 * The default constructor for the LPBVIBeliefCache class. It is empty.
+	 */
+	LPBVIBeliefCache();
+
+	/**
+	 * The deconstructor for the LPBVIBeliefCache class.
+	 */
+	virtual ~LPBVIBeliefCache();
+
+	/**
+	 * Update the cache to match the model and the belief points. Everything is invalidated if the model
+	 * has changed; otherwise, only the slots whose belief point has changed. This must be called from
+	 * one thread, whenever B changes, and before any requests.
+	 * @param	model	The identity of the model (LPOMDP::get_identity), or 0 to never keep anything.
+	 * @param	S	The finite states.
+	 * @param	Z	The finite observations.
+	 * @param	T	The finite state transition function.
+	 * @param	O	The finite observation transition function.
+	 * @param	B	The belief points.
+	 */
+	void update(unsigned long long model, StatesMap *S, ObservationsMap *Z, StateTransitions *T,
+			ObservationTransitions *O, const std::vector<BeliefState *> &B);
+
+	/**
+	 * Invalidate everything in the cache.
+	 */
+	void clear();
+
+	/**
+	 * Keep the cache for new belief points which may equal the old ones (e.g., a new solve of the same model,
+	 * which copies the initial belief points again). At the next update, every slot keeps its sparse form and
+	 * successors, even if its belief point changed, but they are only reused if the new belief point has the
+	 * same sparse form; this is checked the first time the slot is requested. A different model still
+	 * invalidates everything.
+	 */
+	void revalidate();
+
+	/**
+	 * Get the sparse form of a belief point, computing it if it is not cached.
+	 * @param	beliefIndex		The index of the belief point in B.
+	 * @return	The sparse belief point.
+	 */
+	const LPBVISparseBelief &get_belief(unsigned int beliefIndex);
+
+	/**
+	 * Get the sparse forms of all belief points. Each is only valid once it has been requested by get_belief.
+	 * @return	The sparse belief points, one for each in B.
+	 */
+	const std::vector<LPBVISparseBelief> &get_beliefs() const;
+
+	/**
+	 * Get the successors of a belief point for an action, computing them if they are not cached.
+	 * @param	beliefIndex		The index of the belief point in B.
+	 * @param	action			The action taken.
+	 * @return	The successors, one for each observation in the order of get_observations.
+	 */
+	const std::vector<LPBVIBeliefSuccessor> &get_successors(unsigned int beliefIndex, Action *action);
+
+	/**
+	 * Get the successor states of every state for an action, computing them if they are not cached.
+	 * This may be called from any thread.
+	 * @param	action		The action taken.
+	 * @return	For each state in the order of get_states, its successors with non-zero probability.
+	 */
+	const std::vector<LPBVISparseBelief> &get_state_successors(Action *action);
+
+	/**
+	 * Get the states, in a fixed order.
+	 * @return	The states.
+	 */
+	const std::vector<State *> &get_states() const;
+
+	/**
+	 * Get the index of a state in the order of get_states.
+	 * @param	state	The state.
+	 * @return	The index of the state.
+	 */
+	unsigned int get_state_index(State *state) const;
+
+	/**
+	 * Get the observations, in a fixed order.
+	 * @return	The observations.
+	 */
+	const std::vector<Observation *> &get_observations() const;
+
+private:
+	/**
+	 * The identity of the cached model, or 0 for none.
+	 */
+	unsigned long long model;
+
+	/**
+	 * The finite states of the cached model.
+	 */
+	StatesMap *S;
+
+	/**
+	 * The finite observations of the cached model.
+	 */
+	ObservationsMap *Z;
+
+	/**
+	 * The finite state transition function of the cached model.
+	 */
+	StateTransitions *T;
+
+	/**
+	 * The finite observation transition function of the cached model.
+	 */
+	ObservationTransitions *O;
+
+	/**
+	 * The states sorted by their hash values.
+	 */
+	std::vector<State *> states;
+
+	/**
+	 * The index of each state in the states above.
+	 */
+	std::unordered_map<State *, unsigned int> stateIndexes;
+
+	/**
+	 * The observations sorted by their hash values.
+	 */
+	std::vector<Observation *> observations;
+
+	/**
+	 * The belief point of each slot.
+	 */
+	std::vector<BeliefState *> keys;
+
+	/**
+	 * The states of a slot: its sparse form has not been computed, it has been computed, or it has been
+	 * computed for a previous belief point and must be compared to the current one before it is used.
+	 */
+	enum LPBVIBeliefCacheSlot {
+		SLOT_EMPTY,
+		SLOT_READY,
+		SLOT_STALE
+	};
+
+	/**
+	 * For each slot, its state above (bytes, not std::vector<bool>, since the slots are written by
+	 * different threads).
+	 */
+	std::vector<unsigned char> ready;
+
+	/**
+	 * If the next update should keep the slots whose belief point changed, marking them stale.
+	 */
+	bool revalidating;
+
+	/**
+	 * The sparse form of each slot's belief point.
+	 */
+	std::vector<LPBVISparseBelief> beliefs;
+
+	/**
+	 * The successors of each slot's belief point for each action requested so far.
+	 */
+	std::vector<std::unordered_map<Action *, std::vector<LPBVIBeliefSuccessor> > > successors;
+
+	/**
+	 * The successor states of each state, for each action requested so far.
+	 */
+	std::unordered_map<Action *, std::vector<LPBVISparseBelief> > stateSuccessors;
+
+	/**
+	 * The mutex which guards the successor states above, since they are shared by all slots. It is only
+	 * held to find or insert an action's successor states, not to compute them.
+	 */
+	std::mutex stateSuccessorsMutex;
+
+};
+
+
+#endif // LPBVI_BELIEF_CACHE_H
@@ -0,0 +1,72 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPBVI_CANCELLATION_TOKEN_H
+#define LPBVI_CANCELLATION_TOKEN_H
+
+
+#include <atomic>
+
+/**
+ * A flag which another thread (or a signal handler) may set to ask a running solve to stop. The
+ * solver checks it at each update boundary, then returns the best consistent policy it has.
+ */
+class LPBVICancellationToken {
+public:
+	/**
+	 * The default constructor for the LPBVICancellationToken class. It is not cancelled.
+	 */
+	LPBVICancellationToken();
+
+	/**
+	 * The deconstructor for the LPBVICancellationToken class.
+	 */
+	virtual ~LPBVICancellationToken();
+
+	/**
+	 * Request that the solve stop.
+	 */
+	void cancel();
+
+	/**
+	 * Clear the request, so that the token may be used for another solve.
+	 */
+	void reset();
+
+	/**
+	 * Check if the solve has been requested to stop.
+	 * @return	Returns true if cancelled, and false otherwise.
+	 */
+	bool is_cancelled() const;
+
+private:
+	/**
+	 * Whether or not the solve has been requested to stop.
+	 */
+	std::atomic<bool> cancelled;
+
+};
+
+
+#endif // LPBVI_CANCELLATION_TOKEN_H
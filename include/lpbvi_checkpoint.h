@@ -0,0 +1,153 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPBVI_CHECKPOINT_H
+#define LPBVI_CHECKPOINT_H
+
+
+#include "../../librbr/librbr/include/core/states/states_map.h"
+#include "../../librbr/librbr/include/core/states/belief_state.h"
+#include "../../librbr/librbr/include/core/actions/actions_map.h"
+#include "../../librbr/librbr/include/core/policy/policy_alpha_vector.h"
+
+#include <vector>
+#include <string>
+
+/**
+ * The state of an LPBVI solve at an update boundary, which is everything the remainder of the solve
+ * depends on. It is written to a binary file atomically: first to a temporary file, which is synced,
+ * then renamed over the checkpoint, so a crash at any point leaves either the old checkpoint or the new.
+ *
+ * The states and actions are stored by their index in the order of their hash values, which must be
+ * unique, so that a checkpoint can be loaded by another process with the same model. The values are
+ * stored as raw doubles, so a resumed solve continues from bit-identical values.
+ *
+ * When saving, the pointers are the solver's and are not owned. After loading, the checkpoint owns the
+ * belief points and alpha vectors it created; the caller takes each by removing it from the vectors, and
+ * any which remain are freed with the checkpoint, so nothing leaks on any path of a resumed solve.
+ */
+class LPBVICheckpoint {
+public:
+	/**
+	 * The default constructor for the LPBVICheckpoint class. It is empty.
+	 */
+	LPBVICheckpoint();
+
+	/**
+	 * The deconstructor for the LPBVICheckpoint class. This frees the belief points and alpha vectors
+	 * created by a load which the caller has not taken.
+	 */
+	virtual ~LPBVICheckpoint();
+
+	/**
+	 * Save the checkpoint, atomically replacing the file.
+	 * @param	filename	The name of the checkpoint file.
+	 * @param	S			The finite states.
+	 * @param	A			The finite actions.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	bool save(std::string filename, StatesMap *S, ActionsMap *A) const;
+
+	/**
+	 * Load the checkpoint, creating new belief points and alpha vectors which this object owns until the
+	 * caller takes them out of B, completed and gamma.
+	 * @param	filename	The name of the checkpoint file.
+	 * @param	S			The finite states, which must be those of the saved solve.
+	 * @param	A			The finite actions, which must be those of the saved solve.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	bool load(std::string filename, StatesMap *S, ActionsMap *A);
+
+	/**
+	 * The index of the expansion.
+	 */
+	unsigned int expansion;
+
+	/**
+	 * The index of the value function (objective) within the expansion.
+	 */
+	unsigned int objective;
+
+	/**
+	 * The number of updates of the value function which are complete.
+	 */
+	unsigned int update;
+
+	/**
+	 * The seed of the stochastic simulation expansions.
+	 */
+	unsigned int expansionSeed;
+
+	/**
+	 * The belief points.
+	 */
+	std::vector<BeliefState *> B;
+
+	/**
+	 * The actions available at each belief point, in order, after the restrictions of the value functions
+	 * before the objective.
+	 */
+	std::vector<std::vector<Action *> > Ai;
+
+	/**
+	 * The alpha vectors of each value function before the objective in this expansion.
+	 */
+	std::vector<std::vector<PolicyAlphaVector *> > completed;
+
+	/**
+	 * The alpha vectors of the objective after the completed updates.
+	 */
+	std::vector<PolicyAlphaVector *> gamma;
+
+	/**
+	 * The recorded values of the belief state to record, one vector for each value function.
+	 */
+	std::vector<std::vector<double> > recordedValues;
+
+private:
+	/**
+	 * Free the belief points and alpha vectors created by a load which remain, and clear everything loaded.
+	 */
+	void free_loaded();
+
+	/**
+	 * Whether the belief points and alpha vectors were created by a load, and so are owned by this object.
+	 */
+	bool loaded;
+
+	/**
+	 * Create the states and actions in the order of their hash values.
+	 * @param	S			The finite states.
+	 * @param	A			The finite actions.
+	 * @param	states		The ordered states. This will be modified.
+	 * @param	actions		The ordered actions. This will be modified.
+	 * @return	Returns true if two states or two actions have the same hash value, and false otherwise.
+	 */
+	bool create_orders(StatesMap *S, ActionsMap *A, std::vector<State *> &states,
+			std::vector<Action *> &actions) const;
+
+};
+
+
+#endif // LPBVI_CHECKPOINT_H
@@ -30,7 +30,22 @@
 #include "lpbvi.h"
 
 /**
- * Solve a Lexicographic Partially Observable Markov Decision Process (LMDP) using CUDA.
+ * The implementations of the lpbvi_cuda.h API which LPBVICuda may use.
+ */
+enum class LPBVICudaBackend {
+	DEVICE,
+	HOST
+};
+
+/**
+ * The functions of one implementation of the lpbvi_cuda.h API.
+ */
+struct LPBVICudaBackendFunctions;
+
+/**
+ * Solve a Lexicographic Partially Observable Markov Decision Process (LMDP) using CUDA. The observation
+ * transitions and rewards must store dense arrays, which are transferred directly: those of librbr, or
+ * the mapped ones of compiled models (LPOMDPMapped) and POMDP files (LPOMDPCassandra).
  */
 class LPBVICuda : public LPBVI {
 public:
@@ -62,6 +77,19 @@ public:
 	 */
 	void set_performance_variables(unsigned int nonZeroBeliefStates, unsigned int successorStates);
 
+	/**
+	 * Set the implementation of the lpbvi_cuda.h API to use: the GPU (default), or the multi-threaded
+	 * host implementation in lpbvi_host.h, which uses the number of threads from set_num_threads.
+	 * @param	newBackend		The new backend.
+	 */
+	void set_backend(LPBVICudaBackend newBackend);
+
+	/**
+	 * Free everything kept for a session, including the model's arrays if they were staged for it.
+	 * @param	session		The session.
+	 */
+	virtual void release_session(LPBVISession *session);
+
 protected:
 	/**
 	 * Solve an infinite horizon LMDP using value iteration.
@@ -81,7 +109,8 @@ protected:
 			FactoredRewards *R, Horizon *h, std::vector<float> &delta);
 
 	/**
-	 * Initialize the variables by creating the device-side memory.
+	 * Initialize the variables by creating the device-side memory. The model's arrays are only created if
+	 * they are not already staged for the active session.
 	 * @param	S					The finite states.
 	 * @param	A					The finite actions.
 	 * @param	Z					The finite observations.
@@ -95,11 +124,41 @@ protected:
 			StateTransitions *T, ObservationTransitions *O, FactoredRewards *R,
 			Horizon *h, std::vector<float> &delta);
 
+	/**
+	 * Initialize the device-side memory of the model: the state transitions, observation transitions,
+	 * rewards, and successor states. Any state transitions may be used, since only the successor states and
+	 * their probabilities are transferred; the rows of LPOMDPSparseStateTransitions are read directly.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 * @param	R					The factored state-action rewards.
+	 */
+	virtual void initialize_model_variables(StatesMap *S, ActionsMap *A, ObservationsMap *Z,
+			StateTransitions *T, ObservationTransitions *O, FactoredRewards *R);
+
+	/**
+	 * Initialize the device-side memory of the belief points: the belief points and their non-zero states.
+	 * @param	S					The finite states.
+	 */
+	virtual void initialize_belief_variables(StatesMap *S);
+
 	/**
 	 * Uninitialize the variables for the device-side memory.
 	 */
 	virtual void uninitialize_variables();
 
+	/**
+	 * Uninitialize the device-side memory of the model.
+	 */
+	virtual void uninitialize_model_variables();
+
+	/**
+	 * Uninitialize the device-side memory of the belief points.
+	 */
+	virtual void uninitialize_belief_variables();
+
 	/**
 	 * A quick helper array of actions arranged by their hash value.
 	 */
@@ -111,7 +170,8 @@ protected:
 	float *d_B;
 
 	/**
-	 * The device-side pointer to the memory location of state transitions.
+	 * The device-side pointer to the memory location of state transitions: the probability of each of the
+	 * successor states, at the same positions as in the successor states (an n-m-maxSuccessorStates array).
 	 */
 	float *d_T;
 
@@ -150,6 +210,21 @@ protected:
 	 */
 	unsigned int maxSuccessorStates;
 
+	/**
+	 * The implementation of the lpbvi_cuda.h API to use.
+	 */
+	LPBVICudaBackend backend;
+
+	/**
+	 * The functions of the backend, through which every call to it is made.
+	 */
+	const LPBVICudaBackendFunctions *functions;
+
+	/**
+	 * The session whose model is staged in the device-side memory, or null if none is.
+	 */
+	LPBVISession *stagedSession;
+
 };
 
 
@@ -0,0 +1,184 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPBVI_DISTRIBUTED_H
+#define LPBVI_DISTRIBUTED_H
+
+
+#include "lpomdp.h"
+#include "lpbvi.h"
+#include "lpbvi_exchange.h"
+
+#include <vector>
+#include <map>
+
+/**
+ * Solve a Lexicographic Partially Observable Markov Decision Process (LMDP) with a coordinator
+ * process and N worker processes. Each worker owns a contiguous shard of the belief points: it
+ * holds only its shard, computes the backups and the action restriction for it, and exchanges its
+ * rows of Gamma with the others after every iteration. If any participant dies, the others notice
+ * it while waiting to synchronize, and the solve fails instead of hanging. The coordinator performs the expansions, records
+ * values, and assembles the policy. The result is identical to the single process LPBVI solve.
+ *
+ * As with LPBVICuda, the states and actions must be indexed, since the rows of Gamma are exchanged
+ * as dense arrays over the state indexes.
+ */
+class LPBVIDistributed : public LPBVI {
+public:
+	/**
+	 * The default constructor for the LPBVIDistributed class. Default number of iterations for infinite
+	 * horizon POMDPs is 1. The default expansion rule is Random Belief Selection. The default exchange
+	 * is through shared memory with 2 workers.
+	 */
+	LPBVIDistributed();
+
+	/**
+	 * A constructor for the LPBVIDistributed class which allows for the specification of the expansion rule,
+	 * and the number of iterations (both updates and expansions) to run for infinite horizon.
+	 * The default is 1 for both.
+	 * @param	expansionRule			The expansion rule to use.
+	 * @param	updateIterations 		The number of update iterations to run for infinite horizon POMDPs.
+	 * @param	expansionIterations 	The number of expansion iterations to run for infinite horizon POMDPs.
+	 */
+	LPBVIDistributed(POMDPPBVIExpansionRule expansionRule, unsigned int updateIterations, unsigned int expansionIterations);
+
+	/**
+	 * The deconstructor for the LPBVIDistributed class. This method frees the exchange.
+	 */
+	virtual ~LPBVIDistributed();
+
+	/**
+	 * Set the number of worker processes. Each worker may itself use multiple threads (set_num_threads).
+	 * @param	workers		The number of worker processes. Values of 0 are treated as 1.
+	 */
+	void set_num_workers(unsigned int workers);
+
+	/**
+	 * Set the exchange used between the coordinator and workers. This transfers the responsibility
+	 * of memory management to this object.
+	 * @param	newExchange		The new exchange.
+	 */
+	void set_exchange(LPBVIExchange *newExchange);
+
+protected:
+	/**
+	 * Solve an infinite horizon LMDP using value iteration distributed over the worker processes.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 * @param	R					The factored state-action rewards.
+	 * @param	h					The horizon.
+	 * @param	delta				The slack vector.
+	 * @throw	PolicyException		An error occurred computing the policy, or a worker failed.
+	 * @return	Return the optimal policy.
+	 */
+	virtual PolicyAlphaVectors **solve_infinite_horizon(StatesMap *S, ActionsMap *A,
+			ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+			FactoredRewards *R, Horizon *h, std::vector<float> &delta);
+
+	/**
+	 * Execute a worker process for one expansion: all iterations of all value functions over its shard.
+	 * @param	worker		The index of the worker.
+	 * @param	S			The finite states.
+	 * @param	A			The finite actions.
+	 * @param	Z			The finite observations.
+	 * @param	T			The finite state transition function.
+	 * @param	O			The finite observation transition function.
+	 * @param	R			The factored state-action rewards.
+	 * @param	h			The horizon.
+	 * @param	delta		The slack vector.
+	 * @param	gammaAStar	The cached Gamma_{a, *}, one map for each value function.
+	 * @param	deltaB		The density of the belief points.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	virtual bool execute_worker(unsigned int worker, StatesMap *S, ActionsMap *A,
+			ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+			FactoredRewards *R, Horizon *h, std::vector<float> &delta,
+			std::map<Action *, std::vector<PolicyAlphaVector *> > *gammaAStar, double deltaB);
+
+	/**
+	 * Execute the coordinator for one expansion, following the workers' synchronizations and
+	 * assembling the policy for each value function.
+	 * @param	A			The finite actions.
+	 * @param	R			The factored state-action rewards.
+	 * @param	policy		The policy, one for each value function. This will be modified.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	virtual bool execute_coordinator(ActionsMap *A, FactoredRewards *R, PolicyAlphaVectors **policy);
+
+	/**
+	 * Create the alpha-vectors from all rows of a buffer in the exchange. Only the coordinator does this, to
+	 * assemble the policy; the workers read the rows directly.
+	 * @param	A			The finite actions.
+	 * @param	buffer		The buffer, either 0 or 1.
+	 * @param	result		The resultant alpha-vectors, one for each belief point. This will be modified.
+	 */
+	virtual void load_alpha_vectors(ActionsMap *A, unsigned int buffer, std::vector<PolicyAlphaVector *> &result);
+
+	/**
+	 * Store an alpha-vector as a row of a buffer in the exchange.
+	 * @param	buffer		The buffer, either 0 or 1.
+	 * @param	beliefIndex	The index of the belief point.
+	 * @param	alpha		The alpha-vector.
+	 */
+	virtual void store_alpha_vector(unsigned int buffer, unsigned int beliefIndex, const PolicyAlphaVector *alpha);
+
+	/**
+	 * Restrict the actions available to each belief point in this worker's shard, to those of the alpha-vectors
+	 * within eta of the optimal one there, over all rows of a buffer in the exchange.
+	 * @param	A			The finite actions.
+	 * @param	buffer		The buffer, either 0 or 1.
+	 * @param	r			The number of rows in the buffer.
+	 * @param	eta			The slack.
+	 * @param	Ai			The actions available to each belief point in the shard. This will be modified.
+	 */
+	virtual void restrict_shard_actions(ActionsMap *A, unsigned int buffer, unsigned int r, double eta,
+			std::map<BeliefState *, std::vector<Action *> > &Ai);
+
+	/**
+	 * The number of worker processes.
+	 */
+	unsigned int numWorkers;
+
+	/**
+	 * The number of worker processes in the current expansion, which is at most the number of belief points.
+	 */
+	unsigned int activeWorkers;
+
+	/**
+	 * The exchange of the rows of Gamma between the coordinator and workers.
+	 */
+	LPBVIExchange *exchange;
+
+	/**
+	 * The states ordered by their index, which is the column of a row in the exchange.
+	 */
+	std::vector<State *> indexedStates;
+
+};
+
+
+#endif // LPBVI_DISTRIBUTED_H
@@ -0,0 +1,236 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPBVI_EXCHANGE_H
+#define LPBVI_EXCHANGE_H
+
+
+#include <pthread.h>
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * The action index stored for an alpha-vector which does not have an action, e.g., the
+ * initial zero alpha-vectors.
+ */
+#define LPBVI_EXCHANGE_NO_ACTION 0xFFFFFFFF
+
+/**
+ * The number of seconds a participant waits to synchronize between checks that the others are alive.
+ */
+#define LPBVI_EXCHANGE_LIVENESS_INTERVAL 1
+
+/**
+ * The exchange of the rows of Gamma between the coordinator and the worker processes of a
+ * distributed LPBVI solve. Each participant has a view of two r-n buffers of alpha-vector values
+ * (the current and previous Gamma), plus the action of each alpha-vector. A worker writes only
+ * the rows of its shard; after synchronizing, every participant's view holds all of the rows.
+ *
+ * The shared memory implementation is for N processes on one machine. An implementation over
+ * sockets (for multiple machines) would send this participant's rows to the others, and receive
+ * theirs, while synchronizing.
+ */
+class LPBVIExchange {
+public:
+	/**
+	 * The deconstructor for the LPBVIExchange class.
+	 */
+	virtual ~LPBVIExchange();
+
+	/**
+	 * Create the buffers for a solve. This must be called by the coordinator before the workers
+	 * are started, since the workers inherit it.
+	 * @param	numWorkers	The number of worker processes.
+	 * @param	r			The number of belief points.
+	 * @param	n			The number of states.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	virtual bool initialize(unsigned int numWorkers, unsigned int r, unsigned int n) = 0;
+
+	/**
+	 * Free the buffers. This must be called by the coordinator after the workers have exited.
+	 */
+	virtual void uninitialize() = 0;
+
+	/**
+	 * Get a row of a buffer in this participant's view. The rows of a buffer are contiguous, so the
+	 * first row is also the buffer's r-n array.
+	 * @param	buffer		The buffer, either 0 or 1.
+	 * @param	beliefIndex	The index of the belief point.
+	 * @return	The n-array of alpha-vector values.
+	 */
+	virtual double *get_alpha_vector(unsigned int buffer, unsigned int beliefIndex) = 0;
+
+	/**
+	 * Get the actions of a buffer in this participant's view.
+	 * @param	buffer		The buffer, either 0 or 1.
+	 * @return	The r-array of action indexes, or LPBVI_EXCHANGE_NO_ACTION.
+	 */
+	virtual unsigned int *get_actions(unsigned int buffer) = 0;
+
+	/**
+	 * Set the check of the other participants which this participant runs periodically while it waits
+	 * to synchronize. If the check finds that one has died, the solve is marked as failed. This must be
+	 * called by each participant after the workers are started, since each has its own check.
+	 * @param	check	Returns true if the other participants are alive, and false otherwise.
+	 */
+	virtual void set_liveness_check(std::function<bool ()> check) = 0;
+
+	/**
+	 * Wait until every participant has reached this point. All rows written before it are visible afterwards.
+	 * @return	Returns true if any participant has failed, and false otherwise.
+	 */
+	virtual bool synchronize() = 0;
+
+	/**
+	 * Mark the solve as failed. Every participant which is waiting to synchronize is released, and every
+	 * synchronization after this one returns true, so none of them waits for the others afterwards.
+	 */
+	virtual void fail() = 0;
+
+};
+
+/**
+ * The exchange of the rows of Gamma through anonymous shared memory inherited by forked worker
+ * processes, which all write directly into the same buffers. Its barrier is a process-shared robust
+ * mutex and condition variable, which is waited on with a timeout, so that a participant which dies
+ * (e.g., from a signal) is noticed by the liveness checks instead of blocking the others forever.
+ */
+class LPBVISharedMemoryExchange : public LPBVIExchange {
+public:
+	/**
+	 * The default constructor for the LPBVISharedMemoryExchange class.
+	 */
+	LPBVISharedMemoryExchange();
+
+	/**
+	 * The deconstructor for the LPBVISharedMemoryExchange class.
+	 */
+	virtual ~LPBVISharedMemoryExchange();
+
+	virtual bool initialize(unsigned int numWorkers, unsigned int r, unsigned int n);
+
+	virtual void uninitialize();
+
+	virtual double *get_alpha_vector(unsigned int buffer, unsigned int beliefIndex);
+
+	virtual unsigned int *get_actions(unsigned int buffer);
+
+	virtual void set_liveness_check(std::function<bool ()> check);
+
+	virtual bool synchronize();
+
+	virtual void fail();
+
+private:
+	/**
+	 * The header at the start of the shared memory.
+	 */
+	struct Header {
+		/**
+		 * The process-shared robust mutex which guards the rest of the header.
+		 */
+		pthread_mutex_t mutex;
+
+		/**
+		 * The process-shared condition variable signalled when a synchronization completes or fails.
+		 */
+		pthread_cond_t condition;
+
+		/**
+		 * The number of participants: the coordinator and all workers.
+		 */
+		unsigned int participants;
+
+		/**
+		 * The number of participants waiting in the current synchronization.
+		 */
+		unsigned int waiting;
+
+		/**
+		 * The number of synchronizations completed.
+		 */
+		unsigned long long generation;
+
+		/**
+		 * Non-zero if any participant has failed.
+		 */
+		int failed;
+	};
+
+	/**
+	 * Lock the header's mutex. If its owner died while holding it, the solve is marked as failed.
+	 */
+	void lock();
+
+	/**
+	 * Mark the solve as failed and release every waiting participant. The header's mutex must be held.
+	 */
+	void fail_locked();
+
+	/**
+	 * The shared memory region.
+	 */
+	void *memory;
+
+	/**
+	 * The size of the shared memory region in bytes.
+	 */
+	size_t size;
+
+	/**
+	 * The header within the shared memory region.
+	 */
+	Header *header;
+
+	/**
+	 * The two r-n buffers of alpha-vector values within the shared memory region.
+	 */
+	double *rows[2];
+
+	/**
+	 * The two r-arrays of action indexes within the shared memory region.
+	 */
+	unsigned int *actions[2];
+
+	/**
+	 * The number of belief points.
+	 */
+	unsigned int r;
+
+	/**
+	 * The number of states.
+	 */
+	unsigned int n;
+
+	/**
+	 * The check of the other participants, run while waiting to synchronize.
+	 */
+	std::function<bool ()> livenessCheck;
+
+};
+
+
+#endif // LPBVI_EXCHANGE_H
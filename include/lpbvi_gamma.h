@@ -0,0 +1,138 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPBVI_GAMMA_H
+#define LPBVI_GAMMA_H
+
+
+#include "../../librbr/librbr/include/core/policy/policy_alpha_vector.h"
+#include "../../librbr/librbr/include/core/states/state.h"
+
+#include "lpbvi_belief_cache.h"
+
+#include <vector>
+
+/**
+ * A read-only view of a set Gamma of alpha vectors, as read by the backups of the belief points. This
+ * lets the backups read Gamma where it is, e.g., as alpha vector objects or as the dense rows of the
+ * exchange of LPBVIDistributed, without copying it.
+ */
+class LPBVIGamma {
+public:
+	/**
+	 * The deconstructor for the LPBVIGamma class.
+	 */
+	virtual ~LPBVIGamma();
+
+	/**
+	 * Get the number of alpha vectors.
+	 * @return	The number of alpha vectors.
+	 */
+	virtual unsigned int size() const = 0;
+
+	/**
+	 * Get the value of an alpha vector at a state.
+	 * @param	alphaIndex	The index of the alpha vector.
+	 * @param	state		The state.
+	 * @return	The value of the alpha vector at the state.
+	 */
+	virtual double get(unsigned int alphaIndex, State *state) const = 0;
+
+};
+
+/**
+ * A view of Gamma as a set of alpha vector objects.
+ */
+class LPBVIAlphaVectorGamma : public LPBVIGamma {
+public:
+	/**
+	 * The constructor for the LPBVIAlphaVectorGamma class.
+	 * @param	gamma	The alpha vectors, which must outlive the view.
+	 */
+	LPBVIAlphaVectorGamma(const std::vector<PolicyAlphaVector *> &gamma);
+
+	/**
+	 * The deconstructor for the LPBVIAlphaVectorGamma class.
+	 */
+	virtual ~LPBVIAlphaVectorGamma();
+
+	virtual unsigned int size() const;
+
+	virtual double get(unsigned int alphaIndex, State *state) const;
+
+private:
+	/**
+	 * The alpha vectors.
+	 */
+	const std::vector<PolicyAlphaVector *> &gamma;
+
+};
+
+/**
+ * A view of Gamma as dense r-n rows of values over the states in the order of a belief cache.
+ */
+class LPBVIDenseGamma : public LPBVIGamma {
+public:
+	/**
+	 * The constructor for the LPBVIDenseGamma class.
+	 * @param	rows	The r-n array of alpha vector values, which must outlive the view.
+	 * @param	r		The number of alpha vectors.
+	 * @param	cache	The belief cache which orders the n states, which must outlive the view.
+	 */
+	LPBVIDenseGamma(const double *rows, unsigned int r, const LPBVIBeliefCache &cache);
+
+	/**
+	 * The deconstructor for the LPBVIDenseGamma class.
+	 */
+	virtual ~LPBVIDenseGamma();
+
+	virtual unsigned int size() const;
+
+	virtual double get(unsigned int alphaIndex, State *state) const;
+
+private:
+	/**
+	 * The r-n array of alpha vector values.
+	 */
+	const double *rows;
+
+	/**
+	 * The number of alpha vectors.
+	 */
+	unsigned int r;
+
+	/**
+	 * The number of states.
+	 */
+	unsigned int n;
+
+	/**
+	 * The belief cache which orders the states.
+	 */
+	const LPBVIBeliefCache &cache;
+
+};
+
+
+#endif // LPBVI_GAMMA_H
@@ -0,0 +1,182 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPBVI_MIXED_POLICY_H
+#define LPBVI_MIXED_POLICY_H
+
+
+#include "../../librbr/librbr/include/core/states/state.h"
+#include "../../librbr/librbr/include/core/states/belief_state.h"
+#include "../../librbr/librbr/include/core/actions/action.h"
+
+#include <vector>
+#include <unordered_map>
+
+/**
+ * A belief point of a mixed observability model: the observed location, and the distribution over the
+ * hidden values of the states at that location (in the order of the location's states).
+ */
+struct LPBVIMixedBelief {
+	/**
+	 * The index of the observed location.
+	 */
+	unsigned int location;
+
+	/**
+	 * The probability of each hidden value at the location.
+	 */
+	std::vector<double> hidden;
+};
+
+/**
+ * An alpha vector of a mixed observability model, which is only over the hidden values of one location.
+ */
+struct LPBVIMixedAlphaVector {
+	/**
+	 * The action of the alpha vector.
+	 */
+	Action *action;
+
+	/**
+	 * The value of each hidden value at the location.
+	 */
+	std::vector<double> values;
+};
+
+/**
+ * A policy of a mixed observability model: a set of alpha vectors for each observed location, each only
+ * over the hidden values of that location. The states are partitioned into the locations; the states of a
+ * location are its hidden values, in order. A belief state may only be over the states of one location.
+ */
+class LPBVIMixedPolicy {
+public:
+	/**
+	 * The constructor for the LPBVIMixedPolicy class.
+	 * @param	locations		The states of each location, one for each hidden value.
+	 * @param	defaultValue	The value of a location without any alpha vectors (e.g., a lower bound).
+	 */
+	LPBVIMixedPolicy(const std::vector<std::vector<State *> > &locations, double defaultValue);
+
+	/**
+	 * The deconstructor for the LPBVIMixedPolicy class.
+	 */
+	virtual ~LPBVIMixedPolicy();
+
+	/**
+	 * Set the alpha vectors of a location.
+	 * @param	location		The index of the location.
+	 * @param	alphaVectors	The alpha vectors, each with one value for each of the location's hidden values.
+	 */
+	void set(unsigned int location, const std::vector<LPBVIMixedAlphaVector> &alphaVectors);
+
+	/**
+	 * Get the alpha vectors of a location.
+	 * @param	location	The index of the location.
+	 * @return	The alpha vectors of the location.
+	 */
+	const std::vector<LPBVIMixedAlphaVector> &get_alpha_vectors(unsigned int location) const;
+
+	/**
+	 * Get the number of locations.
+	 * @return	The number of locations.
+	 */
+	unsigned int get_num_locations() const;
+
+	/**
+	 * Get the value of a location without any alpha vectors.
+	 * @return	The default value.
+	 */
+	double get_default_value() const;
+
+	/**
+	 * Convert a belief state into a mixed belief point.
+	 * @param	b		The belief state.
+	 * @param	result	The mixed belief point. This will be modified.
+	 * @return	Returns true if the belief state was not over the states of exactly one location, and false otherwise.
+	 */
+	bool locate(const BeliefState *b, LPBVIMixedBelief &result) const;
+
+	/**
+	 * Get the action of the maximal alpha vector at a mixed belief point.
+	 * @param	b	The mixed belief point.
+	 * @return	The action, or null if the location has no alpha vectors.
+	 */
+	Action *get(const LPBVIMixedBelief &b) const;
+
+	/**
+	 * Get the actions of the alpha vectors within eta of the maximal one at a mixed belief point.
+	 * @param	b			The mixed belief point.
+	 * @param	eta			The slack.
+	 * @param	actions		The actions, without duplicates. This will be modified.
+	 */
+	void get(const LPBVIMixedBelief &b, double eta, std::vector<Action *> &actions) const;
+
+	/**
+	 * Compute the value of a mixed belief point.
+	 * @param	b	The mixed belief point.
+	 * @return	The value of the maximal alpha vector, or the default value if the location has none.
+	 */
+	double compute_value(const LPBVIMixedBelief &b) const;
+
+	/**
+	 * Get the action of the maximal alpha vector at a belief state.
+	 * @param	b					The belief state.
+	 * @throw	PolicyException		The belief state was not over the states of exactly one location.
+	 * @return	The action, or null if the location has no alpha vectors.
+	 */
+	Action *get(const BeliefState *b) const;
+
+	/**
+	 * Compute the value of a belief state.
+	 * @param	b					The belief state.
+	 * @throw	PolicyException		The belief state was not over the states of exactly one location.
+	 * @return	The value of the maximal alpha vector, or the default value if the location has none.
+	 */
+	double compute_value(const BeliefState *b) const;
+
+private:
+	/**
+	 * The states of each location, one for each hidden value.
+	 */
+	std::vector<std::vector<State *> > locations;
+
+	/**
+	 * The location and hidden value of each state.
+	 */
+	std::unordered_map<const State *, std::pair<unsigned int, unsigned int> > stateLocations;
+
+	/**
+	 * The alpha vectors of each location.
+	 */
+	std::vector<std::vector<LPBVIMixedAlphaVector> > gamma;
+
+	/**
+	 * The value of a location without any alpha vectors.
+	 */
+	double defaultValue;
+
+};
+
+
+#endif // LPBVI_MIXED_POLICY_H
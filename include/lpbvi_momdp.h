@@ -0,0 +1,292 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPBVI_MOMDP_H
+#define LPBVI_MOMDP_H
+
+
+#include "lpomdp.h"
+#include "lpbvi.h"
+#include "lpbvi_mixed_policy.h"
+
+#include <vector>
+#include <unordered_map>
+#include <random>
+
+/**
+ * The model of taking an action at a location, for one location it may lead to: the transitions between
+ * the hidden values of the two locations, and the observations at the successor location.
+ */
+struct LPBVIMixedTransition {
+	/**
+	 * The index of the successor location.
+	 */
+	unsigned int location;
+
+	/**
+	 * The m-m' array of the probability of each successor hidden value, for each hidden value.
+	 */
+	std::vector<double> transitions;
+
+	/**
+	 * The m'-z array of the probability of each observation, for each successor hidden value.
+	 */
+	std::vector<double> observations;
+};
+
+/**
+ * Solve a Lexicographic Partially Observable Markov Decision Process (LMDP) with mixed observability, in
+ * which each state is an observed location (e.g., the road position and autonomy) and a hidden value (e.g.,
+ * the driver's tiredness). The belief points are then a location and a distribution over only its hidden
+ * values, and the alpha vectors are stored for each location over only its hidden values. Each backup only
+ * sums over the hidden values of the locations an action may lead to, and only maximizes over the alpha
+ * vectors of those locations.
+ *
+ * The locations must partition the states, and every belief point (the initial set and the belief to
+ * record) must be over the states of one location. A location without any belief points has the value of
+ * the initial (zero) alpha vectors, as LPBVI, for each value function. The result is a LPBVIMixedPolicy for
+ * each value function, so this solver is used with solve_mixed instead of solve; for the same reason, it
+ * does not write checkpoints or call the snapshot callback. Greedy Error Reduction is not supported.
+ */
+class LPBVIMOMDP : public LPBVI {
+public:
+	/**
+	 * The default constructor for the LPBVIMOMDP class. Default number of iterations for infinite
+	 * horizon POMDPs is 1. The default expansion rule is Random Belief Selection.
+	 */
+	LPBVIMOMDP();
+
+	/**
+	 * A constructor for the LPBVIMOMDP class which allows for the specification of the expansion rule,
+	 * and the number of iterations (both updates and expansions) to run for infinite horizon.
+	 * The default is 1 for both.
+	 * @param	expansionRule			The expansion rule to use.
+	 * @param	updateIterations 		The number of update iterations to run for infinite horizon POMDPs.
+	 * @param	expansionIterations 	The number of expansion iterations to run for infinite horizon POMDPs.
+	 */
+	LPBVIMOMDP(POMDPPBVIExpansionRule expansionRule, unsigned int updateIterations, unsigned int expansionIterations);
+
+	/**
+	 * The deconstructor for the LPBVIMOMDP class.
+	 */
+	virtual ~LPBVIMOMDP();
+
+	/**
+	 * Set the locations, each with its states in the order of its hidden values.
+	 * @param	newLocations	The states of each location.
+	 */
+	virtual void set_locations(const std::vector<std::vector<State *> > &newLocations);
+
+	/**
+	 * Get the locations, each with its states in the order of its hidden values.
+	 * @return	The states of each location.
+	 */
+	virtual const std::vector<std::vector<State *> > &get_locations() const;
+
+	/**
+	 * Solve the LPOMDP provided using the mixed observability of its states.
+	 * @param	lpomdp				The LPOMDP to solve.
+	 * @throw	CoreException		The LPOMDP was null or had a finite horizon.
+	 * @throw	StateException		The LPOMDP did not have a StatesMap states object, or the locations
+	 * 								did not partition the states.
+	 * @throw	ActionException		The LPOMDP did not have a ActionsMap actions object.
+	 * @throw	ObservationException	The LPOMDP did not have a ObservationsMap observations object.
+	 * @throw	StateTransitionsException	The LPOMDP did not have a state transitions object.
+	 * @throw	ObservationTransitionsException		The LPOMDP did not have a observation transitions object.
+	 * @throw	RewardException		The LPOMDP did not have a FactoredRewards object of SARewards.
+	 * @throw	PolicyException		An error occurred computing the policy, or a belief point was not over
+	 * 								the states of one location.
+	 * @return	Return the optimal policy, one for each value function.
+	 */
+	virtual LPBVIMixedPolicy **solve_mixed(LPOMDP *lpomdp);
+
+protected:
+	/**
+	 * The mixed observability solver does not produce PolicyAlphaVectors; use solve_mixed instead.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 * @param	R					The factored state-action rewards.
+	 * @param	h					The horizon.
+	 * @param	delta				The slack vector.
+	 * @throw	PolicyException		Always.
+	 * @return	Never returns.
+	 */
+	virtual PolicyAlphaVectors **solve_infinite_horizon(StatesMap *S, ActionsMap *A,
+			ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+			FactoredRewards *R, Horizon *h, std::vector<float> &delta);
+
+	/**
+	 * Create the factored model over the locations.
+	 * @param	S					The finite states.
+	 * @param	A					The finite actions.
+	 * @param	Z					The finite observations.
+	 * @param	T					The finite state transition function.
+	 * @param	O					The finite observation transition function.
+	 * @param	R					The factored state-action rewards.
+	 * @param	h					The horizon.
+	 * @throw	StateException		The locations did not partition the states.
+	 * @throw	RewardException		A reward was not a SARewards.
+	 */
+	virtual void create_mixed_model(StatesMap *S, ActionsMap *A, ObservationsMap *Z, StateTransitions *T,
+			ObservationTransitions *O, FactoredRewards *R, Horizon *h);
+
+	/**
+	 * Convert a belief state into a mixed belief point.
+	 * @param	b					The belief state.
+	 * @throw	PolicyException		The belief state was not over the states of one location.
+	 * @return	The mixed belief point.
+	 */
+	virtual LPBVIMixedBelief create_mixed_belief(const BeliefState *b) const;
+
+	/**
+	 * Compute one value function over the mixed belief points.
+	 * @param	h			The horizon.
+	 * @param	i			The index of the value function.
+	 * @param	Ai			The actions available at each belief point.
+	 * @param	stopped		Whether the solve must stop; set if the stop is requested during the updates.
+	 * @return	The alpha vectors, one for each belief point.
+	 */
+	virtual std::vector<LPBVIMixedAlphaVector> compute_objective_mixed(Horizon *h, unsigned int i,
+			const std::vector<std::vector<Action *> > &Ai, bool &stopped);
+
+	/**
+	 * Perform a Bellman update at one mixed belief point.
+	 * @param	h				The horizon.
+	 * @param	i				The index of the value function.
+	 * @param	actions			The actions available at the belief point.
+	 * @param	gammaPrevious	The alpha vectors of the previous update, one for each belief point.
+	 * @param	gammaLocations	The indexes of the previous alpha vectors at each location.
+	 * @param	beliefIndex		The index of the belief point.
+	 * @return	The maximal alpha vector at the belief point.
+	 */
+	virtual LPBVIMixedAlphaVector update_mixed_belief_point(Horizon *h, unsigned int i,
+			const std::vector<Action *> &actions, const std::vector<LPBVIMixedAlphaVector> &gammaPrevious,
+			const std::vector<std::vector<unsigned int> > &gammaLocations, unsigned int beliefIndex) const;
+
+	/**
+	 * Create the policy of a value function from its alpha vectors.
+	 * @param	i		The index of the value function.
+	 * @param	gamma	The alpha vectors, one for each belief point.
+	 * @return	The policy, which the caller must free.
+	 */
+	virtual LPBVIMixedPolicy *create_mixed_policy(unsigned int i, const std::vector<LPBVIMixedAlphaVector> &gamma) const;
+
+	/**
+	 * Compute the density of the mixed belief points.
+	 * @return	The largest difference in the probability of a state between any two belief points.
+	 */
+	virtual double compute_mixed_belief_density() const;
+
+	/**
+	 * Expand the mixed belief points following the expansion rule.
+	 * @param	policy				The policy of the last value function.
+	 * @throw	PolicyException		The expansion rule is not supported with mixed observability.
+	 */
+	virtual void expand_mixed_belief_points(const LPBVIMixedPolicy *policy);
+
+	/**
+	 * Simulate an action and an observation from a mixed belief point, and update it.
+	 * @param	b			The mixed belief point.
+	 * @param	action		The index of the action.
+	 * @param	generator	The random number generator.
+	 * @param	result		The successor mixed belief point. This will be modified.
+	 * @return	Returns true if there was no successor, and false otherwise.
+	 */
+	virtual bool simulate_mixed_belief(const LPBVIMixedBelief &b, unsigned int action, std::mt19937 &generator,
+			LPBVIMixedBelief &result) const;
+
+	/**
+	 * Compute the distance between two mixed belief points.
+	 * @param	b1	The first mixed belief point.
+	 * @param	b2	The second mixed belief point.
+	 * @return	The L1 distance between them over all states.
+	 */
+	virtual double compute_mixed_distance(const LPBVIMixedBelief &b1, const LPBVIMixedBelief &b2) const;
+
+	/**
+	 * Record the value of the belief to record for a value function, if any.
+	 * @param	i		The index of the value function.
+	 * @param	gamma	The alpha vectors, one for each belief point.
+	 */
+	virtual void record_mixed_value(unsigned int i, const std::vector<LPBVIMixedAlphaVector> &gamma);
+
+	/**
+	 * Create the random number generator of a candidate in an expansion, over the mixed belief points.
+	 * @param	candidate	The index of the candidate.
+	 * @return	The random number generator.
+	 */
+	virtual std::mt19937 create_expansion_generator(unsigned int candidate) const;
+
+	/**
+	 * The states of each location, in the order of its hidden values.
+	 */
+	std::vector<std::vector<State *> > locations;
+
+	/**
+	 * The location and hidden value of each state.
+	 */
+	std::unordered_map<const State *, std::pair<unsigned int, unsigned int> > stateLocations;
+
+	/**
+	 * The actions in a fixed order.
+	 */
+	std::vector<Action *> mixedActions;
+
+	/**
+	 * The index of each action in the fixed order.
+	 */
+	std::unordered_map<Action *, unsigned int> mixedActionIndexes;
+
+	/**
+	 * The observations in a fixed order.
+	 */
+	std::vector<Observation *> mixedObservations;
+
+	/**
+	 * For each location and action (x * |A| + a), the locations it may lead to.
+	 */
+	std::vector<std::vector<LPBVIMixedTransition> > mixedTransitions;
+
+	/**
+	 * For each value function and location, the a-m array of the rewards.
+	 */
+	std::vector<std::vector<std::vector<double> > > mixedRewards;
+
+	/**
+	 * The mixed belief points.
+	 */
+	std::vector<LPBVIMixedBelief> mixedB;
+
+	/**
+	 * The belief to record as a mixed belief point, if there is one.
+	 */
+	LPBVIMixedBelief mixedBeliefToRecord;
+
+};
+
+
+#endif // LPBVI_MOMDP_H
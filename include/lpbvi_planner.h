@@ -0,0 +1,307 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPBVI_PLANNER_H
+#define LPBVI_PLANNER_H
+
+
+#include "lpomdp.h"
+#include "lpbvi.h"
+#include "lpbvi_cuda.h"
+
+#include <vector>
+#include <string>
+
+/**
+ * The engines which may solve a LPOMDP: LPBVI with multiple threads over the sparse model, or LPBVICuda
+ * over the dense model on the GPU or the host.
+ */
+enum class LPBVIEngine {
+	MULTI_THREADED,
+	CUDA_DEVICE,
+	CUDA_HOST
+};
+
+/**
+ * The measured size of a LPOMDP and its belief points.
+ */
+struct LPBVIModelStatistics {
+	/**
+	 * The number of states.
+	 */
+	unsigned int n;
+
+	/**
+	 * The number of actions.
+	 */
+	unsigned int m;
+
+	/**
+	 * The number of observations.
+	 */
+	unsigned int z;
+
+	/**
+	 * The number of value functions.
+	 */
+	unsigned int k;
+
+	/**
+	 * The number of initial belief points.
+	 */
+	unsigned int initialBeliefs;
+
+	/**
+	 * The estimated number of belief points after all expansions.
+	 */
+	unsigned int beliefs;
+
+	/**
+	 * The number of non-zero state transitions.
+	 */
+	unsigned long long nonZeroT;
+
+	/**
+	 * The number of non-zero observation transitions.
+	 */
+	unsigned long long nonZeroO;
+
+	/**
+	 * The number of non-zero rewards, over all value functions.
+	 */
+	unsigned long long nonZeroR;
+
+	/**
+	 * The maximum number of successors of any state-action pair.
+	 */
+	unsigned int maxSuccessorStates;
+
+	/**
+	 * The maximum number of non-zero states of any initial belief point.
+	 */
+	unsigned int maxInitialNonZeroBeliefStates;
+
+	/**
+	 * The estimated maximum number of non-zero states of any belief point after all expansions.
+	 */
+	unsigned int maxNonZeroBeliefStates;
+
+	/**
+	 * Whether the model has the dense arrays of O and R, and indexed states and actions, which LPBVICuda requires.
+	 */
+	bool dense;
+};
+
+/**
+ * The engine and representation chosen for a LPOMDP, with the estimates used to choose them.
+ */
+struct LPBVIPlan {
+	/**
+	 * The engine to use.
+	 */
+	LPBVIEngine engine;
+
+	/**
+	 * The number of threads to use (the host's, for either LPBVI or the host backend).
+	 */
+	unsigned int threads;
+
+	/**
+	 * Whether the successor arrays of T and the dense m-n-z and n-m arrays of O and R are used, or the sparse
+	 * successors of the belief points.
+	 */
+	bool denseModel;
+
+	/**
+	 * Whether the belief points are a dense r-n array, or sparse with a cache of their successors.
+	 */
+	bool denseBeliefs;
+
+	/**
+	 * Whether the values are single (float) or double precision.
+	 */
+	bool singlePrecision;
+
+	/**
+	 * The maximum number of non-zero belief states, for LPBVICuda::set_performance_variables.
+	 */
+	unsigned int maxNonZeroBeliefStates;
+
+	/**
+	 * The maximum number of successor states, for LPBVICuda::set_performance_variables.
+	 */
+	unsigned int maxSuccessorStates;
+
+	/**
+	 * The estimated bytes of the dense representation.
+	 */
+	unsigned long long denseBytes;
+
+	/**
+	 * The estimated bytes of the sparse representation.
+	 */
+	unsigned long long sparseBytes;
+
+	/**
+	 * The estimated multiply-adds of one update of every belief point, with the dense representation.
+	 */
+	double denseCost;
+
+	/**
+	 * The estimated multiply-adds of one update of every belief point, with the sparse representation.
+	 */
+	double sparseCost;
+
+	/**
+	 * A description of why the engine was chosen.
+	 */
+	std::string reason;
+
+	/**
+	 * The measurements of the model.
+	 */
+	LPBVIModelStatistics statistics;
+};
+
+/**
+ * Choose the engine and representation for a LPOMDP from the number of its states, actions, observations,
+ * and belief points, and the measured number of non-zeros of its T, O, and R. It estimates the memory and
+ * the cost of an update of each representation. The dense arrays of LPBVICuda are only considered if the
+ * model has them and they fit in the device's (or host's) memory; of the engines which fit, the one with
+ * the lowest estimated time of an update is chosen. LPBVI over the sparse model is always possible.
+ */
+class LPBVIPlanner {
+public:
+	/**
+	 * The default constructor for the LPBVIPlanner class. By default, the memory limits are those available
+	 * on the host and device when planning, and all of the host's threads are used.
+	 */
+	LPBVIPlanner();
+
+	/**
+	 * The deconstructor for the LPBVIPlanner class.
+	 */
+	virtual ~LPBVIPlanner();
+
+	/**
+	 * Set the bytes of host memory a solve may use.
+	 * @param	bytes	The number of bytes. A value of 0 uses the available physical memory.
+	 */
+	void set_host_memory(unsigned long long bytes);
+
+	/**
+	 * Set the bytes of device memory a solve may use.
+	 * @param	bytes	The number of bytes. A value of 0 uses the free memory of the device, if there is one.
+	 */
+	void set_device_memory(unsigned long long bytes);
+
+	/**
+	 * Set whether the device may be used at all.
+	 * @param	value	Whether the device may be used.
+	 */
+	void device_mode(bool value);
+
+	/**
+	 * Set the number of threads to use.
+	 * @param	threads		The number of threads. A value of 0 uses all of the host's threads.
+	 */
+	void set_num_threads(unsigned int threads);
+
+	/**
+	 * Measure a LPOMDP and choose the engine and representation to solve it with, and log the decision.
+	 * @param	lpomdp				The LPOMDP to solve.
+	 * @param	initialB			The initial belief points.
+	 * @param	expansions			The number of expansion iterations.
+	 * @throw	CoreException		The LPOMDP was null.
+	 * @throw	StateException		The LPOMDP did not have a StatesMap states object.
+	 * @throw	ActionException		The LPOMDP did not have a ActionsMap actions object.
+	 * @throw	ObservationException	The LPOMDP did not have a ObservationsMap observations object.
+	 * @throw	StateTransitionsException	The LPOMDP did not have a state transitions object.
+	 * @throw	ObservationTransitionsException		The LPOMDP did not have a observation transitions object.
+	 * @throw	RewardException		The LPOMDP did not have a FactoredRewards object of SARewards.
+	 * @return	The plan.
+	 */
+	LPBVIPlan plan(LPOMDP *lpomdp, const std::vector<BeliefState *> &initialB, unsigned int expansions);
+
+	/**
+	 * Create a solver following a plan. The caller must still add the initial belief points.
+	 * @param	plan					The plan.
+	 * @param	expansionRule			The expansion rule to use.
+	 * @param	updateIterations 		The number of update iterations to run for infinite horizon POMDPs.
+	 * @param	expansionIterations 	The number of expansion iterations to run for infinite horizon POMDPs.
+	 * @return	The new solver, which the caller must free.
+	 */
+	LPBVI *create_solver(const LPBVIPlan &plan, POMDPPBVIExpansionRule expansionRule,
+			unsigned int updateIterations, unsigned int expansionIterations) const;
+
+	/**
+	 * Apply a plan's thread count and, for LPBVICuda, its backend and performance variables to a solver.
+	 * @param	plan		The plan.
+	 * @param	solver		The solver.
+	 * @return	Returns true if the solver was not of the plan's engine, and false otherwise.
+	 */
+	bool apply(const LPBVIPlan &plan, LPBVI *solver) const;
+
+private:
+	/**
+	 * Measure the size and non-zeros of a LPOMDP and the belief points.
+	 * @param	lpomdp		The LPOMDP.
+	 * @param	initialB	The initial belief points.
+	 * @param	expansions	The number of expansion iterations.
+	 * @param	result		The measurements. This will be modified.
+	 */
+	void measure(LPOMDP *lpomdp, const std::vector<BeliefState *> &initialB, unsigned int expansions,
+			LPBVIModelStatistics &result) const;
+
+	/**
+	 * Estimate the memory and cost of both representations.
+	 * @param	statistics	The measurements.
+	 * @param	result		The plan, whose estimates will be modified.
+	 */
+	void estimate(const LPBVIModelStatistics &statistics, LPBVIPlan &result) const;
+
+	/**
+	 * The bytes of host memory a solve may use, or 0 for the available physical memory.
+	 */
+	unsigned long long hostMemory;
+
+	/**
+	 * The bytes of device memory a solve may use, or 0 for the free memory of the device.
+	 */
+	unsigned long long deviceMemory;
+
+	/**
+	 * Whether the device may be used.
+	 */
+	bool device;
+
+	/**
+	 * The number of threads to use, or 0 for all of the host's threads.
+	 */
+	unsigned int numThreads;
+
+};
+
+
+#endif // LPBVI_PLANNER_H
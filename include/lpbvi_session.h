@@ -0,0 +1,262 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPBVI_SESSION_H
+#define LPBVI_SESSION_H
+
+
+#include "lpomdp.h"
+
+#include "../../librbr/librbr/include/core/policy/policy_alpha_vectors.h"
+#include "../../librbr/librbr/include/core/policy/policy_alpha_vector.h"
+
+#include "../../librbr/librbr/include/core/states/states_map.h"
+#include "../../librbr/librbr/include/core/actions/actions_map.h"
+#include "../../librbr/librbr/include/core/observations/observations_map.h"
+#include "../../librbr/librbr/include/core/state_transitions/state_transitions.h"
+#include "../../librbr/librbr/include/core/observation_transitions/observation_transitions.h"
+#include "../../librbr/librbr/include/core/rewards/factored_rewards.h"
+#include "../../librbr/librbr/include/core/horizon.h"
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+class LPBVI;
+
+/**
+ * The model of one action as used when evaluating a fixed policy: the successors of each state (with their
+ * transition probabilities), the observation probabilities, and the rewards of every value function. The
+ * states are indexed in a fixed order chosen by its user (e.g., the order in which S iterates over them).
+ */
+struct LPBVIActionModel {
+	/**
+	 * For each state, the indexes and probabilities of its successors.
+	 */
+	std::vector<std::vector<std::pair<unsigned int, double> > > successors;
+
+	/**
+	 * The n-z array of the probabilities of each observation in each successor state.
+	 */
+	std::vector<double> observationProbabilities;
+
+	/**
+	 * The k-n array of the rewards of each value function in each state.
+	 */
+	std::vector<double> rewards;
+};
+
+/**
+ * A solver session bound to one LPOMDP and one LPBVI solver. The LPOMDP is validated once, and everything
+ * derived only from the model (Gamma_{a, *}, the successors of the belief points, the model of each action
+ * used in an evaluation, and the arrays staged by LPBVICuda) is kept across the session's solves and
+ * evaluations. Only the slack is read again each time, so it may be changed between calls, as may the
+ * solver's settings and initial belief points.
+ *
+ * If the model itself is modified in place, call invalidate. The solver must outlive the session, and it
+ * should only be used by one session at a time, since it keeps the belief points' successors for the last.
+ */
+class LPBVISession {
+public:
+	/**
+	 * The constructor for the LPBVISession class, which validates the LPOMDP.
+	 * @param	solver							The solver, which must outlive the session.
+	 * @param	lpomdp							The LPOMDP to solve.
+	 * @throw	StateException					The LPOMDP did not have a StatesMap states object.
+	 * @throw	ActionException					The LPOMDP did not have a ActionsMap actions object.
+	 * @throw	ObservationException			The LPOMDP did not have a ObservationsMap observations object.
+	 * @throw	StateTransitionsException		The LPOMDP did not have a state transitions object.
+	 * @throw	ObservationTransitionsException	The LPOMDP did not have an observation transitions object.
+	 * @throw	RewardException					The LPOMDP did not have a FactoredRewards rewards object.
+	 * @throw	CoreException					The solver or LPOMDP was null, or the horizon was finite.
+	 */
+	LPBVISession(LPBVI *solver, LPOMDP *lpomdp);
+
+	/**
+	 * The deconstructor for the LPBVISession class. This frees everything kept for the session.
+	 */
+	virtual ~LPBVISession();
+
+	/**
+	 * Solve the LPOMDP with the solver, exactly as LPBVI::solve does, reusing the session's precomputation.
+	 * @throw	RewardException		The slack was incorrectly defined.
+	 * @throw	PolicyException		An error occurred computing the policy.
+	 * @return	Return the optimal policy for each value function.
+	 */
+	PolicyAlphaVectors **solve();
+
+	/**
+	 * Compute the value of a policy with the solver, exactly as LPBVI::compute_value does, reusing the
+	 * session's precomputation.
+	 * @param	policy				The policy to evaluate.
+	 * @throw	RewardException		The slack was incorrectly defined.
+	 * @throw	PolicyException		An error occurred computing the value.
+	 * @return	Return the value of the policy for each value function.
+	 */
+	PolicyAlphaVectors **compute_value(PolicyAlphaVectors *policy);
+
+	/**
+	 * Free everything kept for the session, e.g., after the model was modified in place.
+	 */
+	void invalidate();
+
+	/**
+	 * Get the solver.
+	 * @return	The solver.
+	 */
+	LPBVI *get_solver() const;
+
+	/**
+	 * Get the LPOMDP.
+	 * @return	The LPOMDP.
+	 */
+	LPOMDP *get_lpomdp() const;
+
+	/**
+	 * Get the finite states.
+	 * @return	The finite states.
+	 */
+	StatesMap *get_states() const;
+
+	/**
+	 * Get the finite actions.
+	 * @return	The finite actions.
+	 */
+	ActionsMap *get_actions() const;
+
+	/**
+	 * Get the finite observations.
+	 * @return	The finite observations.
+	 */
+	ObservationsMap *get_observations() const;
+
+	/**
+	 * Get the finite state transition function.
+	 * @return	The finite state transition function.
+	 */
+	StateTransitions *get_state_transitions() const;
+
+	/**
+	 * Get the finite observation transition function.
+	 * @return	The finite observation transition function.
+	 */
+	ObservationTransitions *get_observation_transitions() const;
+
+	/**
+	 * Get the factored state-action rewards.
+	 * @return	The factored state-action rewards.
+	 */
+	FactoredRewards *get_rewards() const;
+
+	/**
+	 * Get the horizon.
+	 * @return	The horizon.
+	 */
+	Horizon *get_horizon() const;
+
+	/**
+	 * Get the slack vector, which is read from the LPOMDP each time, since it may change between solves.
+	 * @throw	RewardException		The slack was incorrectly defined.
+	 * @return	The slack vector.
+	 */
+	std::vector<float> &get_slack();
+
+	/**
+	 * Get the cached Gamma_{a, *}, one map for each value function.
+	 * @return	The cached maps, or null if they have not been created.
+	 */
+	std::map<Action *, std::vector<PolicyAlphaVector *> > *get_gamma_a_star() const;
+
+	/**
+	 * Set the cached Gamma_{a, *}. The solver remains responsible for freeing them (see LPBVI::release_session).
+	 * @param	newGammaAStar	The maps, one for each value function, or null for none.
+	 */
+	void set_gamma_a_star(std::map<Action *, std::vector<PolicyAlphaVector *> > *newGammaAStar);
+
+	/**
+	 * Get the model of each action used by an evaluation so far.
+	 * @return	The model of each action.
+	 */
+	std::unordered_map<Action *, LPBVIActionModel> &get_action_models();
+
+private:
+	/**
+	 * The solver.
+	 */
+	LPBVI *solver;
+
+	/**
+	 * The LPOMDP.
+	 */
+	LPOMDP *lpomdp;
+
+	/**
+	 * The finite states.
+	 */
+	StatesMap *S;
+
+	/**
+	 * The finite actions.
+	 */
+	ActionsMap *A;
+
+	/**
+	 * The finite observations.
+	 */
+	ObservationsMap *Z;
+
+	/**
+	 * The finite state transition function.
+	 */
+	StateTransitions *T;
+
+	/**
+	 * The finite observation transition function.
+	 */
+	ObservationTransitions *O;
+
+	/**
+	 * The factored state-action rewards.
+	 */
+	FactoredRewards *R;
+
+	/**
+	 * The horizon.
+	 */
+	Horizon *h;
+
+	/**
+	 * The cached Gamma_{a, *}, one map for each value function, or null if they have not been created.
+	 */
+	std::map<Action *, std::vector<PolicyAlphaVector *> > *gammaAStar;
+
+	/**
+	 * The model of each action used by an evaluation so far.
+	 */
+	std::unordered_map<Action *, LPBVIActionModel> actionModels;
+
+};
+
+
+#endif // LPBVI_SESSION_H
@@ -30,6 +30,10 @@
 
 #include "../../librbr/librbr/include/core/rewards/factored_rewards.h"
 
+#include <vector>
+#include <mutex>
+#include <atomic>
+
 /**
  * A MOPOMDP with lexicographic reward preferences which allows for slack.
  */
@@ -78,12 +82,35 @@ public:
 	 */
 	std::vector<float> &get_slack();
 
+	/**
+	 * Get the identity of this model: a non-zero token which is never reused by another model in this
+	 * process, unlike its address, so anything computed from the model may be kept by it.
+	 * @return	The identity of this model.
+	 */
+	unsigned long long get_identity() const;
+
 protected:
 	/**
 	 * The slack as a k-array; each element must be non-negative.
 	 */
 	std::vector<float> delta;
 
+	/**
+	 * Guards librbr's process-wide counters of indexed states, actions and observations, so that multiple
+	 * models may be constructed at the same time. Everything else used in construction belongs to the model.
+	 */
+	static std::mutex indexerMutex;
+
+	/**
+	 * The identity of this model.
+	 */
+	unsigned long long identity;
+
+	/**
+	 * The identity of the next model.
+	 */
+	static std::atomic<unsigned long long> nextIdentity;
+
 };
 
 
@@ -0,0 +1,127 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPOMDP_CASSANDRA_H
+#define LPOMDP_CASSANDRA_H
+
+
+#include "lpomdp.h"
+#include "lpomdp_mapped.h"
+
+#include <vector>
+#include <string>
+
+/**
+ * An LPOMDP loaded from a Cassandra format .pomdp file, e.g., those in pomdp_files/. The file is
+ * memory-mapped and split into chunks at entry boundaries, which are tokenized and parsed in parallel.
+ * The entries are then applied in file order, so later entries override earlier ones as the format
+ * specifies, directly into the sparse rows of T (LPOMDPSparseStateTransitions) and dense O and R arrays.
+ *
+ * The T, O and R entries support the single entry, row and matrix forms with wildcards. Since the
+ * rewards of an LPOMDP are state-action rewards, the rewards must be of the form "R: a : s : * : * r".
+ * The file has a single value function; its slack is 0.
+ *
+ * Any LPOMDP with indexed states, actions and observations may also be saved in this format, one
+ * reward factor at a time.
+ */
+class LPOMDPCassandra : public LPOMDP {
+public:
+	/**
+	 * The constructor of the LPOMDPCassandra class, which loads a Cassandra format file.
+	 * @param	filename			The name of the .pomdp file.
+	 * @param	numThreads			The number of threads which parse the file, or 0 for the host's number of threads.
+	 * @throw	CoreException		The file could not be mapped, or it is not a valid (supported) .pomdp file.
+	 */
+	LPOMDPCassandra(std::string filename, unsigned int numThreads = 0);
+
+	/**
+	 * The deconstructor of the LPOMDPCassandra class.
+	 */
+	virtual ~LPOMDPCassandra();
+
+	/**
+	 * Save an LPOMDP as a Cassandra format file, with large buffered writes. Only the non-zero entries are
+	 * written. The actions of a state which share a row (e.g., all the invalid actions' self-loops) are
+	 * written once with a wildcard for the action, followed by the rows of the other actions, which override it.
+	 * @param	lpomdp		The LPOMDP, with states, actions and observations indexed from 0.
+	 * @param	start		The start distribution, or nullptr for a uniform one.
+	 * @param	filename	The name of the .pomdp file.
+	 * @param	factor		The index of the reward factor to save, since the format has a single one.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	static bool save(LPOMDP *lpomdp, const BeliefState *start, std::string filename, unsigned int factor = 0);
+
+	/**
+	 * Get the start distribution, over the states by their index.
+	 * @return	The probability of each state at the start.
+	 */
+	const std::vector<double> &get_start() const;
+
+	/**
+	 * Get the number of bytes parsed.
+	 * @return	The size of the file in bytes.
+	 */
+	size_t get_parsed_bytes() const;
+
+	/**
+	 * Get the time spent parsing and building the arrays.
+	 * @return	The time in seconds.
+	 */
+	double get_parse_time() const;
+
+private:
+	/**
+	 * The states, by their index.
+	 */
+	std::vector<State *> orderedStates;
+
+	/**
+	 * The m-n-z array of observation probabilities.
+	 */
+	std::vector<float> observationProbabilities;
+
+	/**
+	 * The n-m array of rewards.
+	 */
+	std::vector<float> rewardValues;
+
+	/**
+	 * The start distribution.
+	 */
+	std::vector<double> start;
+
+	/**
+	 * The number of bytes parsed.
+	 */
+	size_t parsedBytes;
+
+	/**
+	 * The time spent parsing and building the arrays in seconds.
+	 */
+	double parseTime;
+
+};
+
+
+#endif // LPOMDP_CASSANDRA_H
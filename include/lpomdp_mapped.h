@@ -0,0 +1,465 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPOMDP_MAPPED_H
+#define LPOMDP_MAPPED_H
+
+
+#include "lpomdp.h"
+
+#include "../../librbr/librbr/include/core/states/indexed_state.h"
+#include "../../librbr/librbr/include/core/actions/indexed_action.h"
+#include "../../librbr/librbr/include/core/observations/indexed_observation.h"
+#include "../../librbr/librbr/include/core/state_transitions/state_transitions.h"
+#include "../../librbr/librbr/include/core/observation_transitions/observation_transitions.h"
+#include "../../librbr/librbr/include/core/rewards/sa_rewards.h"
+#include "../../librbr/librbr/include/core/states/belief_state.h"
+#include "../../librbr/librbr/include/core/policy/policy_alpha_vectors.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+
+/**
+ * The metadata of one state of a compiled model, as stored in the file. The nodes are stored by
+ * their LOSM UIDs.
+ */
+struct LPOMDPMappedStateInfo {
+	/**
+	 * The UID of the current node.
+	 */
+	unsigned long long current;
+
+	/**
+	 * The UID of the previous node.
+	 */
+	unsigned long long previous;
+
+	/**
+	 * The UID of the node one edge step from the current node towards the previous node.
+	 */
+	unsigned long long currentStep;
+
+	/**
+	 * The UID of the node one edge step from the previous node towards the current node.
+	 */
+	unsigned long long previousStep;
+
+	/**
+	 * The distance (mi) from the current to previous nodes.
+	 */
+	float distance;
+
+	/**
+	 * The speed limit (mi / h) from the current to previous nodes.
+	 */
+	float speedLimit;
+
+	/**
+	 * The uniqueness index.
+	 */
+	unsigned int uniqueness;
+
+	/**
+	 * The level of tiredness.
+	 */
+	unsigned char tiredness;
+
+	/**
+	 * If the autonomy is enabled (1) or not (0).
+	 */
+	unsigned char autonomy;
+
+	/**
+	 * If this is a goal state (1) or not (0).
+	 */
+	unsigned char goal;
+
+	/**
+	 * If this is an autonomy capable state (1) or not (0).
+	 */
+	unsigned char autonomyCapable;
+};
+
+/**
+ * One non-zero entry of a row of the state transitions, as stored in the file.
+ */
+struct LPOMDPMappedTransition {
+	/**
+	 * The index of the successor state.
+	 */
+	unsigned int successor;
+
+	/**
+	 * The probability of the successor state.
+	 */
+	float probability;
+};
+
+/**
+ * The metadata of a compiled model which is not part of the LPOMDP itself: the states' metadata,
+ * the successor of each state-action pair, the goal states and the tiredness states.
+ */
+struct LPOMDPMappedMetadata {
+	/**
+	 * The metadata of each state, by the state's index.
+	 */
+	std::vector<LPOMDPMappedStateInfo> states;
+
+	/**
+	 * The n-m array of the successor of each state-action pair (ignoring tiredness).
+	 */
+	std::vector<unsigned int> successors;
+
+	/**
+	 * The indexes of the goal states.
+	 */
+	std::vector<unsigned int> goals;
+
+	/**
+	 * The indexes of the states in each group of tiredness states.
+	 */
+	std::vector<std::vector<unsigned int> > tirednessStates;
+};
+
+/**
+ * A state of a compiled model, whose index is the one stored in the file.
+ */
+class LPOMDPMappedState : public IndexedState {
+public:
+	/**
+	 * The constructor of the LPOMDPMappedState object.
+	 * @param	stateIndex	The index of the state in the file.
+	 */
+	LPOMDPMappedState(unsigned int stateIndex);
+};
+
+/**
+ * An action of a compiled model, whose index is the one stored in the file.
+ */
+class LPOMDPMappedAction : public IndexedAction {
+public:
+	/**
+	 * The constructor of the LPOMDPMappedAction object.
+	 * @param	actionIndex	The index of the action in the file.
+	 */
+	LPOMDPMappedAction(unsigned int actionIndex);
+};
+
+/**
+ * An observation of a compiled model, whose index is the one stored in the file.
+ */
+class LPOMDPMappedObservation : public IndexedObservation {
+public:
+	/**
+	 * The constructor of the LPOMDPMappedObservation object.
+	 * @param	observationIndex	The index of the observation in the file.
+	 */
+	LPOMDPMappedObservation(unsigned int observationIndex);
+};
+
+/**
+ * The read-only observation transitions of a compiled model, as the dense m-n-z array in the mapped
+ * file. This is the same layout as the observation transitions of the CUDA solvers.
+ */
+class LPOMDPMappedObservationTransitions : public ObservationTransitions {
+public:
+	/**
+	 * The constructor of the LPOMDPMappedObservationTransitions object.
+	 * @param	n	The number of states.
+	 * @param	z	The number of observations.
+	 * @param	O	The m-n-z array of observation probabilities.
+	 */
+	LPOMDPMappedObservationTransitions(unsigned int n, unsigned int z, const float *O);
+
+	/**
+	 * The deconstructor of the LPOMDPMappedObservationTransitions object. The mapped memory is not owned.
+	 */
+	virtual ~LPOMDPMappedObservationTransitions();
+
+	/**
+	 * The observation transitions are read-only, so this always throws.
+	 * @param	a	The action taken.
+	 * @param	sp	The next state.
+	 * @param	z	The observation.
+	 * @param	p	The probability.
+	 * @throw	ObservationTransitionException	Always.
+	 */
+	virtual void set(const Action *a, const State *sp, const Observation *z, double p);
+
+	/**
+	 * Get the probability of an observation.
+	 * @param	a	The action taken.
+	 * @param	sp	The next state.
+	 * @param	z	The observation.
+	 * @return	The probability of the observation.
+	 */
+	virtual double get(const Action *a, const State *sp, const Observation *z) const;
+
+	/**
+	 * Get the m-n-z array of observation probabilities.
+	 * @return	The observation probabilities.
+	 */
+	const float *get_observation_transitions() const;
+
+private:
+	/**
+	 * The number of states.
+	 */
+	unsigned int n;
+
+	/**
+	 * The number of observations.
+	 */
+	unsigned int z;
+
+	/**
+	 * The m-n-z array of observation probabilities.
+	 */
+	const float *O;
+
+};
+
+/**
+ * The read-only state-action rewards of one factor of a compiled model, as the dense n-m array in the
+ * mapped file. This is the same layout as the rewards of the CUDA solvers.
+ */
+class LPOMDPMappedRewards : public SARewards {
+public:
+	/**
+	 * The constructor of the LPOMDPMappedRewards object.
+	 * @param	m			The number of actions.
+	 * @param	R			The n-m array of rewards.
+	 * @param	minReward	The minimum reward.
+	 * @param	maxReward	The maximum reward.
+	 */
+	LPOMDPMappedRewards(unsigned int m, const float *R, double minReward, double maxReward);
+
+	/**
+	 * The deconstructor of the LPOMDPMappedRewards object. The mapped memory is not owned.
+	 */
+	virtual ~LPOMDPMappedRewards();
+
+	/**
+	 * The rewards are read-only, so this always throws.
+	 * @param	s	The current state.
+	 * @param	a	The action taken.
+	 * @param	r	The reward.
+	 * @throw	RewardException		Always.
+	 */
+	virtual void set(const State *s, const Action *a, double r);
+
+	/**
+	 * Get the reward of a state-action pair.
+	 * @param	s	The current state.
+	 * @param	a	The action taken.
+	 * @return	The reward.
+	 */
+	virtual double get(const State *s, const Action *a) const;
+
+	/**
+	 * Get the minimum reward.
+	 * @return	The minimum reward.
+	 */
+	virtual double get_min() const;
+
+	/**
+	 * Get the maximum reward.
+	 * @return	The maximum reward.
+	 */
+	virtual double get_max() const;
+
+	/**
+	 * Get the n-m array of rewards.
+	 * @return	The rewards.
+	 */
+	const float *get_rewards() const;
+
+private:
+	/**
+	 * The number of actions.
+	 */
+	unsigned int m;
+
+	/**
+	 * The n-m array of rewards.
+	 */
+	const float *R;
+
+	/**
+	 * The minimum reward.
+	 */
+	double minReward;
+
+	/**
+	 * The maximum reward.
+	 */
+	double maxReward;
+
+};
+
+/**
+ * A fully built LPOMDP, compiled to a versioned binary file and loaded through a read-only shared
+ * memory map. The sparse state transitions, the observation transitions and the k reward arrays are
+ * used in place in the mapped file, so loading does not copy them, and the pages are shared by every
+ * process which maps the same file. Only the (small) state, action and observation objects are created.
+ *
+ * The file is written in a single streaming pass. Its fixed size header holds the counts, and a trailer
+ * at the end holds the offsets of the sections, which are only known once they are written.
+ */
+class LPOMDPMapped : public LPOMDP {
+public:
+	/**
+	 * The constructor of the LPOMDPMapped class, which maps a compiled model file.
+	 * @param	filename			The name of the compiled model file.
+	 * @throw	CoreException		The file could not be mapped, or it is not a valid compiled model.
+	 */
+	LPOMDPMapped(std::string filename);
+
+	/**
+	 * The deconstructor of the LPOMDPMapped class, which unmaps the file.
+	 */
+	virtual ~LPOMDPMapped();
+
+	/**
+	 * Compile an LPOMDP with indexed states, actions and observations, and SA rewards, to a file.
+	 * @param	lpomdp		The LPOMDP.
+	 * @param	metadata	The metadata of the states.
+	 * @param	filename	The name of the compiled model file.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	static bool save(LPOMDP *lpomdp, const LPOMDPMappedMetadata &metadata, std::string filename);
+
+	/**
+	 * Get the metadata of a state.
+	 * @param	state	The index of the state.
+	 * @return	The metadata of the state.
+	 */
+	const LPOMDPMappedStateInfo &get_state_info(unsigned int state) const;
+
+	/**
+	 * Get the successor of a state-action pair, ignoring tiredness.
+	 * @param	state	The index of the state.
+	 * @param	action	The index of the action.
+	 * @return	The index of the successor state.
+	 */
+	unsigned int get_successor(unsigned int state, unsigned int action) const;
+
+	/**
+	 * Get the goal states.
+	 * @return	The goal states.
+	 */
+	const std::vector<State *> &get_goal_states() const;
+
+	/**
+	 * Get the groups of tiredness states, which are also the locations for the mixed observability solver.
+	 * @return	The groups of tiredness states.
+	 */
+	const std::vector<std::vector<State *> > &get_tiredness_states() const;
+
+	/**
+	 * Get a state between two nodes.
+	 * @param	initial1			The UID of one node.
+	 * @param	initial2			The UID of the other node.
+	 * @throw	CoreException		No state is between the two nodes.
+	 * @return	The first state between the two nodes.
+	 */
+	State *get_initial_state(std::string initial1, std::string initial2);
+
+	/**
+	 * Save the policy to a file, one row for each state, in the same format as LOSMPOMDP.
+	 * @param	policy		The policy, one for each value function.
+	 * @param	k			The number of value functions.
+	 * @param	filename	The name of the file to save.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	bool save_policy(PolicyAlphaVectors **policy, unsigned int k, std::string filename);
+
+	/**
+	 * Save the policy to a file, two rows for each group of tiredness states, in the same format as LOSMPOMDP.
+	 * @param	policy			The policy, one for each value function.
+	 * @param	k				The number of value functions.
+	 * @param	tirednessBelief	The probability of the tired state of each row.
+	 * @param	filename		The name of the file to save.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	bool save_policy(PolicyAlphaVectors **policy, unsigned int k, double tirednessBelief, std::string filename);
+
+private:
+	/**
+	 * Write one row of a saved policy.
+	 * @param	file		The output file.
+	 * @param	policy		The policy, one for each value function.
+	 * @param	k			The number of value functions.
+	 * @param	b			The belief state of the row.
+	 * @param	state		The index of the state of the row.
+	 * @return	Returns true if the policy does not have an action for the belief state, and false otherwise.
+	 */
+	bool write_policy_row(std::ofstream &file, PolicyAlphaVectors **policy, unsigned int k,
+			BeliefState &b, unsigned int state);
+
+	/**
+	 * The mapped file.
+	 */
+	void *memory;
+
+	/**
+	 * The size of the mapped file in bytes.
+	 */
+	size_t size;
+
+	/**
+	 * The number of actions.
+	 */
+	unsigned int m;
+
+	/**
+	 * The states, by their index.
+	 */
+	std::vector<State *> orderedStates;
+
+	/**
+	 * The metadata of each state, in the mapped file.
+	 */
+	const LPOMDPMappedStateInfo *stateInfo;
+
+	/**
+	 * The n-m array of the successor of each state-action pair, in the mapped file.
+	 */
+	const unsigned int *successorStates;
+
+	/**
+	 * The goal states.
+	 */
+	std::vector<State *> goalStates;
+
+	/**
+	 * The groups of tiredness states.
+	 */
+	std::vector<std::vector<State *> > tirednessStates;
+
+};
+
+
+#endif // LPOMDP_MAPPED_H
@@ -0,0 +1,191 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPOMDP_SPARSE_STATE_TRANSITIONS_H
+#define LPOMDP_SPARSE_STATE_TRANSITIONS_H
+
+
+#include "lpomdp_mapped.h"
+
+#include "../../librbr/librbr/include/core/state_transitions/state_transitions.h"
+
+#include <vector>
+
+/**
+ * The state transitions of an LPOMDP in compressed sparse row (CSR) form: the row of each state-action
+ * pair (s * m + a) holds only its non-zero entries, so the memory is bounded by the number of non-zeros
+ * instead of n-m-n, and each row is found in constant time. The states must be indexed, since the rows
+ * and successors refer to the states by their index.
+ *
+ * The rows are built all at once by the model, e.g., LOSMPOMDP or LPOMDPCassandra; afterwards they are
+ * read-only. This is the same layout as a compiled model's state transitions, so it may also be a
+ * non-owning view over rows stored elsewhere, e.g., those mapped by LPOMDPMapped.
+ */
+class LPOMDPSparseStateTransitions : public StateTransitions {
+public:
+	/**
+	 * The constructor of the LPOMDPSparseStateTransitions object, which takes the rows.
+	 * @param	states			The states, by their index.
+	 * @param	m				The number of actions.
+	 * @param	rowOffsets		The (n * m + 1)-array of the offsets of each row in the entries. This will be emptied.
+	 * @param	entries			The entries of all rows. This will be emptied.
+	 * @throw	StateTransitionException	The rows do not match the states and actions.
+	 */
+	LPOMDPSparseStateTransitions(const std::vector<State *> &states, unsigned int m,
+			std::vector<unsigned long long> &rowOffsets, std::vector<LPOMDPMappedTransition> &entries);
+
+	/**
+	 * The constructor of the LPOMDPSparseStateTransitions object, which is a view over rows it does not own.
+	 * The rows must be consistent with the states and actions, and outlive this object.
+	 * @param	states			The states, by their index.
+	 * @param	m				The number of actions.
+	 * @param	rowOffsets		The (n * m + 1)-array of the offsets of each row in the entries.
+	 * @param	entries			The entries of all rows.
+	 */
+	LPOMDPSparseStateTransitions(const std::vector<State *> &states, unsigned int m,
+			const unsigned long long *rowOffsets, const LPOMDPMappedTransition *entries);
+
+	/**
+	 * The deconstructor of the LPOMDPSparseStateTransitions object.
+	 */
+	virtual ~LPOMDPSparseStateTransitions();
+
+	/**
+	 * The state transitions are read-only once built, so this always throws.
+	 * @param	s	The current state.
+	 * @param	a	The action taken.
+	 * @param	sp	The next state.
+	 * @param	p	The probability.
+	 * @throw	StateTransitionException	Always.
+	 */
+	virtual void set(const State *s, const Action *a, const State *sp, double p);
+
+	/**
+	 * Get the probability of a state transition.
+	 * @param	s	The current state.
+	 * @param	a	The action taken.
+	 * @param	sp	The next state.
+	 * @return	The probability of the next state.
+	 */
+	virtual double get(const State *s, const Action *a, const State *sp) const;
+
+	/**
+	 * Get the successors of a state-action pair, in the order of their row.
+	 * @param	S		The states.
+	 * @param	s		The current state.
+	 * @param	a		The action taken.
+	 * @param	result	The successor states. This will be modified.
+	 */
+	virtual void successors(const States *S, const State *s, const Action *a, std::vector<State *> &result) const;
+
+	/**
+	 * Get the row of a state-action pair.
+	 * @param	s		The index of the current state.
+	 * @param	a		The index of the action taken.
+	 * @param	count	The number of entries in the row. This will be modified.
+	 * @return	The first entry of the row.
+	 */
+	const LPOMDPMappedTransition *get_row(unsigned int s, unsigned int a, unsigned int &count) const;
+
+	/**
+	 * Get the (n * m + 1)-array of the offsets of each row in the entries.
+	 * @return	The offsets of the rows.
+	 */
+	const unsigned long long *get_row_offsets() const;
+
+	/**
+	 * Get the entries of all rows.
+	 * @return	The entries.
+	 */
+	const LPOMDPMappedTransition *get_entries() const;
+
+	/**
+	 * Get the number of entries, i.e., the non-zeros of T.
+	 * @return	The number of entries.
+	 */
+	unsigned long long get_num_entries() const;
+
+	/**
+	 * Get the largest number of entries of a row.
+	 * @return	The maximum number of successors of a state-action pair.
+	 */
+	unsigned int get_max_successors() const;
+
+	/**
+	 * Get the number of states.
+	 * @return	The number of states.
+	 */
+	unsigned int get_num_states() const;
+
+	/**
+	 * Get the number of actions.
+	 * @return	The number of actions.
+	 */
+	unsigned int get_num_actions() const;
+
+private:
+	/**
+	 * The states, by their index.
+	 */
+	std::vector<State *> states;
+
+	/**
+	 * The number of actions.
+	 */
+	unsigned int m;
+
+	/**
+	 * Find the largest number of entries of a row.
+	 */
+	void find_max_successors();
+
+	/**
+	 * The offsets of each row in the entries, if they are owned by this object.
+	 */
+	std::vector<unsigned long long> ownedRowOffsets;
+
+	/**
+	 * The entries of all rows, if they are owned by this object.
+	 */
+	std::vector<LPOMDPMappedTransition> ownedEntries;
+
+	/**
+	 * The offsets of each row in the entries, either owned or not.
+	 */
+	const unsigned long long *rowOffsets;
+
+	/**
+	 * The entries of all rows, either owned or not.
+	 */
+	const LPOMDPMappedTransition *entries;
+
+	/**
+	 * The largest number of entries of a row.
+	 */
+	unsigned int maxSuccessors;
+
+};
+
+
+#endif // LPOMDP_SPARSE_STATE_TRANSITIONS_H
@@ -0,0 +1,160 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+/**
+ * The allocation counters of a single NUMA node, as reported by the kernel in numastat.
+ */
+struct NUMACounters {
+	/**
+	 * Pages allocated on this node which were intended for this node.
+	 */
+	unsigned long numaHit;
+
+	/**
+	 * Pages allocated on this node which were intended for another node.
+	 */
+	unsigned long numaMiss;
+
+	/**
+	 * Pages allocated on this node by a process running on this node.
+	 */
+	unsigned long localNode;
+
+	/**
+	 * Pages allocated on this node by a process running on another node.
+	 */
+	unsigned long otherNode;
+};
+
+/**
+ * The NUMA layout of the machine, read from sysfs. This is used to pin the worker threads of
+ * the CPU solver to a node, and to place the read-only model arrays. On a machine without
+ * NUMA support (or without sysfs) this behaves as a single node and every operation is a no-op.
+ */
+class NUMATopology {
+public:
+	/**
+	 * The default constructor for the NUMATopology class, which reads the nodes and their CPUs.
+	 */
+	NUMATopology();
+
+	/**
+	 * The deconstructor for the NUMATopology class.
+	 */
+	virtual ~NUMATopology();
+
+	/**
+	 * Get the number of NUMA nodes. This is always at least one.
+	 * @return	The number of NUMA nodes.
+	 */
+	unsigned int get_num_nodes() const;
+
+	/**
+	 * Get the CPUs which belong to a NUMA node.
+	 * @param	node	The index of the node.
+	 * @return	The CPU identifiers of the node; this is empty if unknown.
+	 */
+	const std::vector<int> &get_cpus(unsigned int node) const;
+
+	/**
+	 * Get the node assigned to a worker, such that workers are spread over the nodes in
+	 * contiguous blocks (i.e., workers 0 to w/2 - 1 on node 0 for two nodes, and so on).
+	 * @param	worker		The index of the worker.
+	 * @param	numWorkers	The total number of workers.
+	 * @return	The node assigned to the worker.
+	 */
+	unsigned int get_worker_node(unsigned int worker, unsigned int numWorkers) const;
+
+	/**
+	 * Pin the calling thread to the CPUs of a NUMA node.
+	 * @param	node	The index of the node.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	bool pin_current_thread(unsigned int node) const;
+
+	/**
+	 * Interleave the pages of a memory region over all NUMA nodes, moving pages which
+	 * have already been touched.
+	 * @param	address		The start of the memory region.
+	 * @param	length		The length of the memory region in bytes.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	bool interleave(const void *address, size_t length) const;
+
+	/**
+	 * Bind the pages of a memory region to a single NUMA node, moving pages which
+	 * have already been touched.
+	 * @param	address		The start of the memory region.
+	 * @param	length		The length of the memory region in bytes.
+	 * @param	node		The index of the node.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	bool bind(const void *address, size_t length, unsigned int node) const;
+
+	/**
+	 * Read the current allocation counters of every node.
+	 * @param	counters	The resultant counters, one for each node. This will be modified.
+	 */
+	void get_counters(std::vector<NUMACounters> &counters) const;
+
+private:
+	/**
+	 * Parse a sysfs CPU list (e.g., "0-7,16-23") into CPU identifiers.
+	 * @param	cpuList		The CPU list.
+	 * @param	cpus		The resultant CPU identifiers. This will be modified.
+	 */
+	void parse_cpu_list(const std::string &cpuList, std::vector<int> &cpus) const;
+
+	/**
+	 * Apply a memory policy to a memory region with the mbind system call.
+	 * @param	address		The start of the memory region.
+	 * @param	length		The length of the memory region in bytes.
+	 * @param	mode		The memory policy mode.
+	 * @param	nodes		The nodes of the memory policy.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	bool apply_policy(const void *address, size_t length, int mode, const std::vector<unsigned int> &nodes) const;
+
+	/**
+	 * The sysfs node identifiers, one for each node index.
+	 */
+	std::vector<unsigned int> nodeIDs;
+
+	/**
+	 * The CPUs of each node.
+	 */
+	std::vector<std::vector<int> > nodeCPUs;
+
+};
+
+
+#endif // NUMA_TOPOLOGY_H
@@ -101,7 +101,7 @@ __global__ void lpbvi_compute_alphaBA(unsigned int n, unsigned int m, unsigned i
 				if (sp < 0) {
 					break;
 				}
-				value += T[s * m * n + action * n + sp] * O[action * n * z + sp * z + observation] * Gamma[alphaIndex * n + sp];
+				value += T[s * m * maxSuccessorStates + action * maxSuccessorStates + j] * O[action * n * z + sp * z + observation] * Gamma[alphaIndex * n + sp];
 
 //				if (Gamma[alphaIndex * n + sp] < 0.0) {
 //					printf("<%i %i>: %f\n", alphaIndex, sp, Gamma[alphaIndex * n + sp]);
@@ -158,7 +158,7 @@ __global__ void lpbvi_compute_alphaBA(unsigned int n, unsigned int m, unsigned i
 				break;
 			}
 			// Note: maxAlphaIndex[0] holds the maximal index value computed from the reduction above.
-			value += T[s * m * n + action * n + sp] * O[action * n * z + sp * z + observation] * Gamma[maxAlphaIndex[0] * n + sp];
+			value += T[s * m * maxSuccessorStates + action * maxSuccessorStates + i] * O[action * n * z + sp * z + observation] * Gamma[maxAlphaIndex[0] * n + sp];
 		}
 
 		__syncthreads();
@@ -216,7 +216,9 @@ __global__ void lpbvi_update_distributed(unsigned int n, unsigned int m, unsigne
 }
 
 __global__ void lpbvi_update_full(unsigned int n, unsigned int m, unsigned int z, unsigned int r,
-		const bool *A, const float *B, const float *T, const float *O, const float *R, float gamma,
+		const bool *A, const float *B, const float *T, const float *O, const float *R,
+		const int *successorStates, unsigned int maxSuccessorStates,
+		float gamma,
 		const float *Gamma, const unsigned int *pi,
 		float *alphaBA,
 		float *GammaPrime, unsigned int *piPrime)
@@ -253,8 +255,12 @@ __global__ void lpbvi_update_full(unsigned int n, unsigned int m, unsigned int z
 						// We compute the value of this state in the alpha-vector, then multiply it by the belief, and add it to
 						// the current dot product value for this alpha-vector.
 						float value = 0.0f;
-						for (unsigned int sp = 0; sp < n; sp++) {
-							value += T[s * m * n + action * n + sp] * O[action * n * z + sp * z + observation] * Gamma[alphaIndex * n + sp];
+						for (unsigned int j = 0; j < maxSuccessorStates; j++) {
+							int sp = successorStates[s * m * maxSuccessorStates + action * maxSuccessorStates + j];
+							if (sp < 0) {
+								break;
+							}
+							value += T[s * m * maxSuccessorStates + action * maxSuccessorStates + j] * O[action * n * z + sp * z + observation] * Gamma[alphaIndex * n + sp];
 						}
 						alphaDotBeta += gamma * value * B[beliefIndex * n + s];
 					}
@@ -273,8 +279,12 @@ __global__ void lpbvi_update_full(unsigned int n, unsigned int m, unsigned int z
 					// We compute the value of this state in the alpha-vector, then multiply it by the belief, and add it to
 					// the current dot product value for this alpha-vector.
 					float value = 0.0f;
-					for (unsigned int sp = 0; sp < n; sp++) {
-						value += T[s * m * n + action * n + sp] * O[action * n * z + sp * z + observation] * Gamma[maxAlphaIndex * n + sp];
+					for (unsigned int j = 0; j < maxSuccessorStates; j++) {
+						int sp = successorStates[s * m * maxSuccessorStates + action * maxSuccessorStates + j];
+						if (sp < 0) {
+							break;
+						}
+						value += T[s * m * maxSuccessorStates + action * maxSuccessorStates + j] * O[action * n * z + sp * z + observation] * Gamma[maxAlphaIndex * n + sp];
 					}
 					alphaBA[beliefIndex * n + s] += gamma * value;
 				}
@@ -588,13 +598,17 @@ int lpbvi_cuda(unsigned int n, unsigned int m, unsigned int z, unsigned int r,
 		// and the 4th stage for-loop over Gamma as the threads.
 		if (t % 2 == 0) {
 			lpbvi_update_full<<< numBlocks, numThreads >>>(n, m, z, r,
-					d_A, d_B, d_T, d_O, d_R, gamma,
+					d_A, d_B, d_T, d_O, d_R,
+					d_SuccessorStates, maxSuccessorStates,
+					gamma,
 					d_Gamma, d_pi,
 					d_AlphaBA,
 					d_GammaPrime, d_piPrime);
 		} else {
 			lpbvi_update_full<<< numBlocks, numThreads >>>(n, m, z, r,
-					d_A, d_B, d_T, d_O, d_R, gamma,
+					d_A, d_B, d_T, d_O, d_R,
+					d_SuccessorStates, maxSuccessorStates,
+					gamma,
 					d_GammaPrime, d_piPrime,
 					d_AlphaBA,
 					d_Gamma, d_pi);
@@ -618,8 +632,9 @@ int lpbvi_cuda(unsigned int n, unsigned int m, unsigned int z, unsigned int r,
 	}
 
 	// Copy the final result of Gamma and pi to the variables. This assumes
-	// that the memory has been allocated.
-	if (horizon % 2 == 1) {
+	// that the memory has been allocated. Note: Even updates write to Gamma (prime), so an
+	// odd number of updates leaves the final result in Gamma (prime).
+	if (horizon % 2 == 0) {
 		if (cudaMemcpy(Gamma, d_Gamma, r * n * sizeof(float), cudaMemcpyDeviceToHost) != cudaSuccess) {
 			fprintf(stderr, "Error[lpbvi_cuda]: %s",
 					"Failed to copy memory from device to host for Gamma.");
@@ -643,12 +658,14 @@ int lpbvi_cuda(unsigned int n, unsigned int m, unsigned int z, unsigned int r,
 		}
 	}
 
-	// Once freed, compute the available actions for the next iteration.
+	// Once freed, compute the available actions for the next iteration, using the final result.
 	lpbvi_restrict_actions<<< numBlocks, numThreads >>>(n, m, z, r,
 					d_B, d_T, d_O, d_R,
 					d_NonZeroBeliefStates, maxNonZeroBeliefStates,
 					eta,
-					d_Gamma, d_pi, d_A);
+					(horizon % 2 == 0) ? d_Gamma : d_GammaPrime,
+					(horizon % 2 == 0) ? d_pi : d_piPrime,
+					d_A);
 
 	// Check if there was an error executing the kernel.
 	if (cudaGetLastError() != cudaSuccess) {
@@ -708,23 +725,24 @@ int lpbvi_initialize_belief_points(unsigned int n, unsigned int r, const float *
 	return 0;
 }
 
-int lpbvi_initialize_state_transitions(unsigned int n, unsigned int m, const float *T, float *&d_T)
+int lpbvi_initialize_state_transitions(unsigned int n, unsigned int m, unsigned int maxSuccessorStates,
+		const float *T, float *&d_T)
 {
 	// Ensure the data is valid.
-	if (n == 0 || m == 0 || T == nullptr) {
+	if (n == 0 || m == 0 || maxSuccessorStates == 0 || T == nullptr) {
 		fprintf(stderr, "Error[lpbvi_initialize_state_transitions]: %s", "Invalid input.");
 		return -1;
 	}
 
 	// Allocate the memory on the device.
-	if (cudaMalloc(&d_T, n * m * n * sizeof(float)) != cudaSuccess) {
+	if (cudaMalloc(&d_T, n * m * maxSuccessorStates * sizeof(float)) != cudaSuccess) {
 		fprintf(stderr, "Error[lpbvi_initialize_state_transitions]: %s",
 				"Failed to allocate device-side memory for the state transitions.");
 		return -3;
 	}
 
 	// Copy the data from the host to the device.
-	if (cudaMemcpy(d_T, T, n * m * n * sizeof(float), cudaMemcpyHostToDevice) != cudaSuccess) {
+	if (cudaMemcpy(d_T, T, n * m * maxSuccessorStates * sizeof(float), cudaMemcpyHostToDevice) != cudaSuccess) {
 		fprintf(stderr, "Error[lpbvi_initialize_state_transitions]: %s",
 				"Failed to copy memory from host to device for the state transitions.");
 		return -3;
@@ -872,3 +890,27 @@ int lpbvi_uninitialize(float *&d_B, float *&d_T, float *&d_O, float **&d_R, unsi
 
 	return 0;
 }
+
+int lpbvi_get_device_memory(unsigned long long &freeBytes, unsigned long long &totalBytes)
+{
+	freeBytes = 0;
+	totalBytes = 0;
+
+	int count = 0;
+	if (cudaGetDeviceCount(&count) != cudaSuccess || count == 0) {
+		fprintf(stderr, "Error[lpbvi_get_device_memory]: %s", "No device is available.");
+		return -3;
+	}
+
+	size_t deviceFree = 0;
+	size_t deviceTotal = 0;
+	if (cudaMemGetInfo(&deviceFree, &deviceTotal) != cudaSuccess) {
+		fprintf(stderr, "Error[lpbvi_get_device_memory]: %s", "Failed to get the device's memory.");
+		return -3;
+	}
+
+	freeBytes = deviceFree;
+	totalBytes = deviceTotal;
+
+	return 0;
+}
@@ -40,8 +40,8 @@
  * 									is available at that belief state or not. This will be modified.
  * @param	d_B						A r-n array, consisting of r sets of n-vector belief distributions.
  *  								(Device-side pointer.)
- * @param	d_T						A mapping of state-action-state triples (n-m-n array) to a
- * 									transition probability. (Device-side pointer.)
+ * @param	d_T						The probability of each successor state of each state-action pair (n-m-maxSuccessorStates
+ * 									array), at the same positions as in d_SuccessorStates. (Device-side pointer.)
  * @param	d_O						A mapping of action-state-observations triples (m-n-z array) to a
  * 									transition probability. (Device-side pointer.)
  * @param	d_R						A mapping of state-action triples (n-m array) to a reward.
@@ -86,16 +86,18 @@ int lpbvi_initialize_belief_points(unsigned int n, unsigned int r, const float *
 
 /**
  * Initialize CUDA by transferring all of the constant LPOMDP model information to the device.
- * @param	n			The number of states.
- * @param	m			The number of actions, in total, that are possible.
- * @param	T			A mapping of state-action-state triples (n-m-n array) to a
- * 						transition probability.
- * @param	d_T			A mapping of state-action-state triples (n-m-n array) to a
- * 						transition probability. (Device-side pointer.)
+ * @param	n					The number of states.
+ * @param	m					The number of actions, in total, that are possible.
+ * @param	maxSuccessorStates	The maximum number of successor states possible.
+ * @param	T					The probability of each successor state of each state-action pair
+ * 								(n-m-maxSuccessorStates array), at the same positions as in the successor states.
+ * @param	d_T					The probability of each successor state of each state-action pair
+ * 								(n-m-maxSuccessorStates array). (Device-side pointer.)
  * @return	Returns 0 upon success; -1 if invalid arguments were passed; -3 if an error with
  * 			the CUDA functions arose.
  */
-int lpbvi_initialize_state_transitions(unsigned int n, unsigned int m, const float *T, float *&d_T);
+int lpbvi_initialize_state_transitions(unsigned int n, unsigned int m, unsigned int maxSuccessorStates,
+		const float *T, float *&d_T);
 
 /**
  * Initialize CUDA by transferring all of the constant LPOMDP model information to the device.
@@ -156,8 +158,8 @@ int lpbvi_initialize_successors(unsigned int n, unsigned int m, unsigned int max
  * Uninitialize CUDA by freeing all of the constant MDP model information on the device.
  * @param	d_B						A r-n array, consisting of r sets of n-vector belief distributions.
  *  								(Device-side pointer.)
- * @param	d_T						A mapping of state-action-state triples (n-m-n array) to a
- * 									transition probability. (Device-side pointer.)
+ * @param	d_T						The probability of each successor state of each state-action pair (n-m-maxSuccessorStates
+ * 									array), at the same positions as in d_SuccessorStates. (Device-side pointer.)
  * @param	d_O						A mapping of action-state-observation triples (m-n-z array) to a
  * 									transition probability. (Device-side pointer.)
  * @param	d_R						A k-array, each mapping of state-action pairs (n-m array) to a reward.
@@ -172,5 +174,13 @@ int lpbvi_initialize_successors(unsigned int n, unsigned int m, unsigned int max
 int lpbvi_uninitialize(float *&d_B, float *&d_T, float *&d_O, float **&d_R, unsigned int k,
 		int *&d_NonZeroBeliefStates, int *&d_SuccessorStates);
 
+/**
+ * Get the free and total memory of the current device, e.g., to decide whether a model fits on it.
+ * @param	freeBytes		The number of free bytes on the device. This will be modified.
+ * @param	totalBytes		The total number of bytes on the device. This will be modified.
+ * @return	Returns 0 upon success; -3 if there is no device or an error with the CUDA functions arose.
+ */
+int lpbvi_get_device_memory(unsigned long long &freeBytes, unsigned long long &totalBytes);
+
 
 #endif // LPBVI_CUDA_EXT_H
@@ -0,0 +1,504 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "lpbvi_host.h"
+#include "lpbvi_cuda.h"
+
+#include <stdio.h>
+
+#include <thread>
+#include <vector>
+#include <new>
+#include <system_error>
+#include <algorithm>
+
+// The same floating point constants as the device version, so that the results match.
+#define LPBVI_HOST_FLT_MIN -1e+35
+#define LPBVI_HOST_FLT_ERR_TOL 1e-9
+
+static unsigned int lpbviHostNumThreads = 1;
+
+void lpbvi_host_set_num_threads(unsigned int numThreads)
+{
+	lpbviHostNumThreads = std::max(1u, numThreads);
+}
+
+/**
+ * Execute a "kernel" over the r belief points, each thread taking a contiguous block of them.
+ * @param	r		The number of belief points.
+ * @param	kernel	The kernel, called with the first and one past the last belief index.
+ * @return	Returns true if a thread could not be created, and false otherwise.
+ */
+template <typename Kernel>
+static bool lpbvi_host_execute(unsigned int r, const Kernel &kernel)
+{
+	unsigned int numWorkers = std::min(lpbviHostNumThreads, r);
+
+	if (numWorkers <= 1) {
+		kernel(0, r);
+		return false;
+	}
+
+	std::vector<std::thread> workers;
+	bool failed = false;
+
+	for (unsigned int w = 0; w < numWorkers; w++) {
+		unsigned int first = (unsigned int)((unsigned long)w * r / numWorkers);
+		unsigned int last = (unsigned int)((unsigned long)(w + 1) * r / numWorkers);
+
+		try {
+			workers.push_back(std::thread(kernel, first, last));
+		} catch (std::system_error &err) {
+			failed = true;
+			break;
+		}
+	}
+
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+
+	return failed;
+}
+
+/**
+ * The "update distributed" kernel, fused with the computation of alphaBA, for the belief points
+ * [first, last). Each alpha-vector is computed into a per-thread buffer, instead of an r-m-n array.
+ */
+static void lpbvi_host_update(unsigned int n, unsigned int m, unsigned int z, unsigned int r,
+		const bool *A, const float *B, const float *T, const float *O, const float *R,
+		const int *nonZeroBeliefStates, unsigned int maxNonZeroBeliefStates,
+		const int *successorStates, unsigned int maxSuccessorStates,
+		float gamma,
+		const float *Gamma,
+		float *GammaPrime, unsigned int *piPrime,
+		unsigned int first, unsigned int last)
+{
+	std::vector<float> alphaBA(n);
+
+	for (unsigned int beliefIndex = first; beliefIndex < last; beliefIndex++) {
+		const int *nonZero = &nonZeroBeliefStates[(size_t)beliefIndex * maxNonZeroBeliefStates];
+		const float *b = &B[(size_t)beliefIndex * n];
+
+		// We want to find the action that maximizes the value, store it in piPrime, as well as its alpha-vector GammaPrime.
+		float maxActionValue = LPBVI_HOST_FLT_MIN;
+		piPrime[beliefIndex] = 0;
+
+		for (unsigned int action = 0; action < m; action++) {
+			// Only execute if the action is available.
+			if (!A[(size_t)beliefIndex * m + action]) {
+				continue;
+			}
+
+			// Compute Gamma_{a,*} and set it to the first value of alphaBA.
+			for (unsigned int s = 0; s < n; s++) {
+				alphaBA[s] = R[(size_t)s * m + action];
+			}
+
+			for (unsigned int observation = 0; observation < z; observation++) {
+				// Compute the max alpha vector from Gamma, given the fixed action and observation.
+				float maxAlphaDotBeta = 0.0f;
+				unsigned int maxAlphaIndex = 0;
+
+				for (unsigned int alphaIndex = 0; alphaIndex < r; alphaIndex++) {
+					float alphaDotBeta = 0.0f;
+
+					for (unsigned int i = 0; i < maxNonZeroBeliefStates; i++) {
+						int s = nonZero[i];
+						if (s < 0) {
+							break;
+						}
+
+						float value = 0.0f;
+						for (unsigned int j = 0; j < maxSuccessorStates; j++) {
+							int sp = successorStates[((size_t)s * m + action) * maxSuccessorStates + j];
+							if (sp < 0) {
+								break;
+							}
+							value += T[((size_t)s * m + action) * maxSuccessorStates + j] * O[((size_t)action * n + sp) * z + observation] * Gamma[(size_t)alphaIndex * n + sp];
+						}
+						alphaDotBeta += gamma * value * b[s];
+					}
+
+					// Store the maximal value and index.
+					if (alphaIndex == 0 || alphaDotBeta > maxAlphaDotBeta) {
+						maxAlphaDotBeta = alphaDotBeta;
+						maxAlphaIndex = alphaIndex;
+					}
+				}
+
+				// Now we can compute the alpha-vector component for this observation, since we have the max.
+				for (unsigned int s = 0; s < n; s++) {
+					float value = 0.0f;
+					for (unsigned int j = 0; j < maxSuccessorStates; j++) {
+						int sp = successorStates[((size_t)s * m + action) * maxSuccessorStates + j];
+						if (sp < 0) {
+							break;
+						}
+						value += T[((size_t)s * m + action) * maxSuccessorStates + j] * O[((size_t)action * n + sp) * z + observation] * Gamma[(size_t)maxAlphaIndex * n + sp];
+					}
+					alphaBA[s] += gamma * value;
+				}
+			}
+
+			// The potential alpha-vector has been computed, so compute the value with respect to the belief state.
+			float actionValue = 0.0f;
+			for (unsigned int i = 0; i < maxNonZeroBeliefStates; i++) {
+				int s = nonZero[i];
+				if (s < 0) {
+					break;
+				}
+				actionValue += alphaBA[s] * b[s];
+			}
+
+			// If this was larger, then overwrite piPrime and GammaPrime's values.
+			if (actionValue > maxActionValue) {
+				maxActionValue = actionValue;
+
+				piPrime[beliefIndex] = action;
+				std::copy(alphaBA.begin(), alphaBA.end(), &GammaPrime[(size_t)beliefIndex * n]);
+			}
+		}
+	}
+}
+
+/**
+ * The "restrict actions" kernel for the belief points [first, last).
+ */
+static void lpbvi_host_restrict_actions(unsigned int n, unsigned int m, unsigned int r,
+		const float *B, const int *nonZeroBeliefStates, unsigned int maxNonZeroBeliefStates,
+		float eta, const float *Gamma, const unsigned int *pi, bool *A,
+		unsigned int first, unsigned int last)
+{
+	std::vector<float> alphaDotBeta(r);
+
+	for (unsigned int beliefIndex = first; beliefIndex < last; beliefIndex++) {
+		const int *nonZero = &nonZeroBeliefStates[(size_t)beliefIndex * maxNonZeroBeliefStates];
+
+		// First, compute the value of every alpha-vector at this belief point, and the optimal one.
+		float maxAlphaDotBeta = 0.0f;
+
+		for (unsigned int alphaIndex = 0; alphaIndex < r; alphaIndex++) {
+			alphaDotBeta[alphaIndex] = 0.0f;
+
+			for (unsigned int i = 0; i < maxNonZeroBeliefStates; i++) {
+				int s = nonZero[i];
+				if (s < 0) {
+					break;
+				}
+				alphaDotBeta[alphaIndex] += Gamma[(size_t)alphaIndex * n + s] * B[(size_t)beliefIndex * n + s];
+			}
+
+			if (alphaIndex == 0 || alphaDotBeta[alphaIndex] > maxAlphaDotBeta) {
+				maxAlphaDotBeta = alphaDotBeta[alphaIndex];
+			}
+		}
+
+		// Now mark the actions of the alpha-vectors within eta as available, and all others as not.
+		for (unsigned int action = 0; action < m; action++) {
+			A[(size_t)beliefIndex * m + action] = false;
+		}
+
+		for (unsigned int alphaIndex = 0; alphaIndex < r; alphaIndex++) {
+			// Note: We allow for a small tolerance based on floating point errors.
+			if (maxAlphaDotBeta - alphaDotBeta[alphaIndex] < eta + LPBVI_HOST_FLT_ERR_TOL) {
+				A[(size_t)beliefIndex * m + pi[alphaIndex]] = true;
+			}
+		}
+	}
+}
+
+int lpbvi_host(unsigned int n, unsigned int m, unsigned int z, unsigned int r,
+		bool *A, const float *d_B,
+		const float *d_T, const float *d_O, const float *d_R,
+		const int *d_NonZeroBeliefStates, unsigned int maxNonZeroBeliefStates,
+		const int *d_SuccessorStates, unsigned int maxSuccessorStates,
+		float gamma, float eta, unsigned int horizon,
+		unsigned int numThreads,
+		float *Gamma, unsigned int *pi)
+{
+	// Ensure the data is valid.
+	if (n == 0 || m == 0 || z == 0 || r == 0 ||
+			A == nullptr || d_B == nullptr ||
+			d_T == nullptr || d_O == nullptr || d_R == nullptr ||
+			d_NonZeroBeliefStates == nullptr || d_SuccessorStates == nullptr ||
+			Gamma == nullptr || pi == nullptr ||
+			gamma < 0.0 || gamma >= 1.0 || horizon < 1) {
+		fprintf(stderr, "Error[lpbvi_host]: %s", "Invalid arguments.");
+		return -1;
+	}
+
+	// Ensure threads are correct, exactly as the device version does.
+	if (numThreads % 32 != 0) {
+		fprintf(stderr, "Error[lpbvi_host]: %s", "Invalid number of threads.");
+		return -2;
+	}
+
+	// The two buffers for the alpha-vectors and their actions, swapped after each update.
+	float *GammaPrime = new (std::nothrow) float[(size_t)r * n];
+	unsigned int *piPrime = new (std::nothrow) unsigned int[r];
+	if (GammaPrime == nullptr || piPrime == nullptr) {
+		fprintf(stderr, "Error[lpbvi_host]: %s", "Failed to allocate memory for Gamma (prime) and pi (prime).");
+		delete [] GammaPrime;
+		delete [] piPrime;
+		return -3;
+	}
+
+	std::copy(Gamma, Gamma + (size_t)r * n, GammaPrime);
+	std::fill(pi, pi + r, 0);
+	std::fill(piPrime, piPrime + r, 0);
+
+	float *current = Gamma;
+	unsigned int *currentPi = pi;
+	float *next = GammaPrime;
+	unsigned int *nextPi = piPrime;
+
+	bool failed = false;
+
+	// For each of the updates, run PBVI.
+	for (unsigned int t = 0; t < horizon && !failed; t++) {
+		failed = lpbvi_host_execute(r, [&](unsigned int first, unsigned int last) {
+			lpbvi_host_update(n, m, z, r, A, d_B, d_T, d_O, d_R,
+					d_NonZeroBeliefStates, maxNonZeroBeliefStates,
+					d_SuccessorStates, maxSuccessorStates,
+					gamma, current, next, nextPi, first, last);
+		});
+
+		std::swap(current, next);
+		std::swap(currentPi, nextPi);
+	}
+
+	// Copy the final result of Gamma and pi to the variables, if it is in the other buffer.
+	if (current != Gamma) {
+		std::copy(current, current + (size_t)r * n, Gamma);
+		std::copy(currentPi, currentPi + r, pi);
+	}
+
+	delete [] GammaPrime;
+	delete [] piPrime;
+
+	// Compute the available actions for the next value function.
+	if (!failed) {
+		failed = lpbvi_host_execute(r, [&](unsigned int first, unsigned int last) {
+			lpbvi_host_restrict_actions(n, m, r, d_B, d_NonZeroBeliefStates, maxNonZeroBeliefStates,
+					eta, Gamma, pi, A, first, last);
+		});
+	}
+
+	if (failed) {
+		fprintf(stderr, "Error[lpbvi_host]: %s", "Failed to create the threads.");
+		return -3;
+	}
+
+	return 0;
+}
+
+/**
+ * Allocate a host buffer and copy an array into it, as the device version does with cudaMalloc and cudaMemcpy.
+ * @param	name	The name of the calling function, for errors.
+ * @param	size	The number of elements.
+ * @param	src		The array to copy.
+ * @param	dst		The resultant buffer. This will be modified.
+ * @return	Returns 0 upon success; -3 if the allocation failed.
+ */
+template <typename T>
+static int lpbvi_host_copy(const char *name, size_t size, const T *src, T *&dst)
+{
+	dst = new (std::nothrow) T[size];
+	if (dst == nullptr) {
+		fprintf(stderr, "Error[%s]: %s", name, "Failed to allocate host-side memory.");
+		return -3;
+	}
+	std::copy(src, src + size, dst);
+	return 0;
+}
+
+int lpbvi_host_initialize_belief_points(unsigned int n, unsigned int r, const float *B, float *&d_B)
+{
+	// Ensure the data is valid.
+	if (n == 0 || r == 0 || B == nullptr) {
+		fprintf(stderr, "Error[lpbvi_host_initialize_belief_points]: %s", "Invalid input.");
+		return -1;
+	}
+
+	return lpbvi_host_copy("lpbvi_host_initialize_belief_points", (size_t)r * n, B, d_B);
+}
+
+int lpbvi_host_initialize_state_transitions(unsigned int n, unsigned int m, unsigned int maxSuccessorStates,
+		const float *T, float *&d_T)
+{
+	// Ensure the data is valid.
+	if (n == 0 || m == 0 || maxSuccessorStates == 0 || T == nullptr) {
+		fprintf(stderr, "Error[lpbvi_host_initialize_state_transitions]: %s", "Invalid input.");
+		return -1;
+	}
+
+	return lpbvi_host_copy("lpbvi_host_initialize_state_transitions", (size_t)n * m * maxSuccessorStates, T, d_T);
+}
+
+int lpbvi_host_initialize_observation_transitions(unsigned int n, unsigned int m, unsigned int z,
+		const float *O, float *&d_O)
+{
+	// Ensure the data is valid.
+	if (n == 0 || m == 0 || z == 0 || O == nullptr) {
+		fprintf(stderr, "Error[lpbvi_host_initialize_observation_transitions]: %s", "Invalid input.");
+		return -1;
+	}
+
+	return lpbvi_host_copy("lpbvi_host_initialize_observation_transitions", (size_t)m * n * z, O, d_O);
+}
+
+int lpbvi_host_initialize_rewards(unsigned int n, unsigned int m, const float *R, float *&d_R)
+{
+	// Ensure the data is valid.
+	if (n == 0 || m == 0 || R == nullptr) {
+		fprintf(stderr, "Error[lpbvi_host_initialize_rewards]: %s", "Invalid input.");
+		return -1;
+	}
+
+	return lpbvi_host_copy("lpbvi_host_initialize_rewards", (size_t)n * m, R, d_R);
+}
+
+int lpbvi_host_initialize_nonzero_beliefs(unsigned int r, unsigned int maxNonZeroBeliefStates,
+		int *nonZeroBeliefStates, int *&d_NonZeroBeliefStates)
+{
+	// Ensure the data is valid.
+	if (r == 0 || maxNonZeroBeliefStates == 0 || nonZeroBeliefStates == nullptr) {
+		fprintf(stderr, "Error[lpbvi_host_initialize_nonzero_beliefs]: %s", "Invalid input.");
+		return -1;
+	}
+
+	return lpbvi_host_copy("lpbvi_host_initialize_nonzero_beliefs", (size_t)r * maxNonZeroBeliefStates,
+			(const int *)nonZeroBeliefStates, d_NonZeroBeliefStates);
+}
+
+int lpbvi_host_initialize_successors(unsigned int n, unsigned int m, unsigned int maxSuccessorStates,
+		int *successorStates, int *&d_SuccessorStates)
+{
+	// Ensure the data is valid.
+	if (n == 0 || m == 0 || maxSuccessorStates == 0 || successorStates == nullptr) {
+		fprintf(stderr, "Error[lpbvi_host_initialize_successors]: %s", "Invalid input.");
+		return -1;
+	}
+
+	return lpbvi_host_copy("lpbvi_host_initialize_successors", (size_t)n * m * maxSuccessorStates,
+			(const int *)successorStates, d_SuccessorStates);
+}
+
+int lpbvi_host_uninitialize(float *&d_B, float *&d_T, float *&d_O, float **&d_R, unsigned int k,
+		int *&d_NonZeroBeliefStates, int *&d_SuccessorStates)
+{
+	delete [] d_B;
+	d_B = nullptr;
+
+	delete [] d_T;
+	d_T = nullptr;
+
+	delete [] d_O;
+	d_O = nullptr;
+
+	if (d_R != nullptr) {
+		for (unsigned int i = 0; i < k; i++) {
+			delete [] d_R[i];
+			d_R[i] = nullptr;
+		}
+	}
+
+	delete [] d_NonZeroBeliefStates;
+	d_NonZeroBeliefStates = nullptr;
+
+	delete [] d_SuccessorStates;
+	d_SuccessorStates = nullptr;
+
+	return 0;
+}
+
+#ifdef LPBVI_HOST_ONLY
+
+// Without a GPU, the lpbvi_cuda.h API itself is provided by the host implementation.
+
+int lpbvi_cuda(unsigned int n, unsigned int m, unsigned int z, unsigned int r,
+		bool *A, const float *d_B,
+		const float *d_T, const float *d_O, const float *d_R,
+		const int *d_NonZeroBeliefStates, unsigned int maxNonZeroBeliefStates,
+		const int *d_SuccessorStates, unsigned int maxSuccessorStates,
+		float gamma, float eta, unsigned int horizon,
+		unsigned int numThreads,
+		float *Gamma, unsigned int *pi)
+{
+	return lpbvi_host(n, m, z, r, A, d_B, d_T, d_O, d_R,
+			d_NonZeroBeliefStates, maxNonZeroBeliefStates,
+			d_SuccessorStates, maxSuccessorStates,
+			gamma, eta, horizon, numThreads, Gamma, pi);
+}
+
+int lpbvi_initialize_belief_points(unsigned int n, unsigned int r, const float *B, float *&d_B)
+{
+	return lpbvi_host_initialize_belief_points(n, r, B, d_B);
+}
+
+int lpbvi_initialize_state_transitions(unsigned int n, unsigned int m, unsigned int maxSuccessorStates,
+		const float *T, float *&d_T)
+{
+	return lpbvi_host_initialize_state_transitions(n, m, maxSuccessorStates, T, d_T);
+}
+
+int lpbvi_initialize_observation_transitions(unsigned int n, unsigned int m, unsigned int z, const float *O, float *&d_O)
+{
+	return lpbvi_host_initialize_observation_transitions(n, m, z, O, d_O);
+}
+
+int lpbvi_initialize_rewards(unsigned int n, unsigned int m, const float *R, float *&d_R)
+{
+	return lpbvi_host_initialize_rewards(n, m, R, d_R);
+}
+
+int lpbvi_initialize_nonzero_beliefs(unsigned int r, unsigned int maxNonZeroBeliefStates,
+		int *nonZeroBeliefStates, int *&d_NonZeroBeliefStates)
+{
+	return lpbvi_host_initialize_nonzero_beliefs(r, maxNonZeroBeliefStates, nonZeroBeliefStates, d_NonZeroBeliefStates);
+}
+
+int lpbvi_initialize_successors(unsigned int n, unsigned int m, unsigned int maxSuccessorStates,
+		int *successorStates, int *&d_SuccessorStates)
+{
+	return lpbvi_host_initialize_successors(n, m, maxSuccessorStates, successorStates, d_SuccessorStates);
+}
+
+int lpbvi_uninitialize(float *&d_B, float *&d_T, float *&d_O, float **&d_R, unsigned int k,
+		int *&d_NonZeroBeliefStates, int *&d_SuccessorStates)
+{
+	return lpbvi_host_uninitialize(d_B, d_T, d_O, d_R, k, d_NonZeroBeliefStates, d_SuccessorStates);
+}
+
+int lpbvi_get_device_memory(unsigned long long &freeBytes, unsigned long long &totalBytes)
+{
+	// There is no device, so there is no device memory.
+	freeBytes = 0;
+	totalBytes = 0;
+
+	return -3;
+}
+
+#endif // LPBVI_HOST_ONLY
@@ -0,0 +1,109 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LPBVI_HOST_H
+#define LPBVI_HOST_H
+
+
+/**
+ * The host (CPU) implementation of the API in lpbvi_cuda.h. The "device-side" pointers are simply
+ * host buffers, and the kernels are loops over the belief points, split among threads. Each function
+ * takes exactly the same arguments and returns the same codes as its counterpart in lpbvi_cuda.h.
+ *
+ * There are two ways to select it. At link time, compile the library with LPBVI_HOST_ONLY defined
+ * (and without lpbvi_cuda.cu), which also defines the lpbvi_cuda.h functions to call these; no CUDA
+ * toolkit or GPU is then required. At runtime, LPBVICuda::set_backend chooses between the two, as
+ * long as the library contains both.
+ */
+
+/**
+ * Set the number of threads used by the host "kernels". The default is 1.
+ * @param	numThreads	The number of threads. Values of 0 are treated as 1.
+ */
+void lpbvi_host_set_num_threads(unsigned int numThreads);
+
+/**
+ * Execute PBVI for the infinite horizon POMDP model specified on the host. See lpbvi_cuda.
+ * @param	numThreads	The number of CUDA threads per block. This is only validated here, for parity
+ * 						with lpbvi_cuda; use lpbvi_host_set_num_threads for the number of host threads.
+ * @return	Returns 0 upon success; -1 if invalid arguments were passed; -2 if the number of
+ * 			threads is invalid; -3 if an error with the threads arose.
+ */
+int lpbvi_host(unsigned int n, unsigned int m, unsigned int z, unsigned int r,
+		bool *A, const float *d_B,
+		const float *d_T, const float *d_O, const float *d_R,
+		const int *d_NonZeroBeliefStates, unsigned int maxNonZeroBeliefStates,
+		const int *d_SuccessorStates, unsigned int maxSuccessorStates,
+		float gamma, float eta, unsigned int horizon,
+		unsigned int numThreads,
+		float *Gamma, unsigned int *pi);
+
+/**
+ * Copy the belief points into a host buffer. See lpbvi_initialize_belief_points.
+ * @return	Returns 0 upon success; -1 if invalid arguments were passed; -3 if the allocation failed.
+ */
+int lpbvi_host_initialize_belief_points(unsigned int n, unsigned int r, const float *B, float *&d_B);
+
+/**
+ * Copy the state transitions into a host buffer. See lpbvi_initialize_state_transitions.
+ * @return	Returns 0 upon success; -1 if invalid arguments were passed; -3 if the allocation failed.
+ */
+int lpbvi_host_initialize_state_transitions(unsigned int n, unsigned int m, unsigned int maxSuccessorStates,
+		const float *T, float *&d_T);
+
+/**
+ * Copy the observation transitions into a host buffer. See lpbvi_initialize_observation_transitions.
+ * @return	Returns 0 upon success; -1 if invalid arguments were passed; -3 if the allocation failed.
+ */
+int lpbvi_host_initialize_observation_transitions(unsigned int n, unsigned int m, unsigned int z, const float *O, float *&d_O);
+
+/**
+ * Copy the rewards into a host buffer. See lpbvi_initialize_rewards.
+ * @return	Returns 0 upon success; -1 if invalid arguments were passed; -3 if the allocation failed.
+ */
+int lpbvi_host_initialize_rewards(unsigned int n, unsigned int m, const float *R, float *&d_R);
+
+/**
+ * Copy the non-zero belief states into a host buffer. See lpbvi_initialize_nonzero_beliefs.
+ * @return	Returns 0 upon success; -1 if invalid arguments were passed; -3 if the allocation failed.
+ */
+int lpbvi_host_initialize_nonzero_beliefs(unsigned int r, unsigned int maxNonZeroBeliefStates,
+		int *nonZeroBeliefStates, int *&d_NonZeroBeliefStates);
+
+/**
+ * Copy the successor states into a host buffer. See lpbvi_initialize_successors.
+ * @return	Returns 0 upon success; -1 if invalid arguments were passed; -3 if the allocation failed.
+ */
+int lpbvi_host_initialize_successors(unsigned int n, unsigned int m, unsigned int maxSuccessorStates,
+		int *successorStates, int *&d_SuccessorStates);
+
+/**
+ * Free all of the host buffers. See lpbvi_uninitialize.
+ * @return	Returns 0 upon success.
+ */
+int lpbvi_host_uninitialize(float *&d_B, float *&d_T, float *&d_O, float **&d_R, unsigned int k,
+		int *&d_NonZeroBeliefStates, int *&d_SuccessorStates);
+
+
+#endif // LPBVI_HOST_H
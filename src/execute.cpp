@@ -24,20 +24,27 @@
 #include "../include/losm_lpomdp.h"
 #include "../include/lpbvi.h"
 #include "../include/lpbvi_cuda.h"
+#include "../include/lpbpi.h"
+#include "../include/lpbvi_momdp.h"
+#include "../include/lpbvi_planner.h"
 
 #include "../../losm/losm/include/losm_exception.h"
 
 #include <iostream>
+#include <string>
+#include <algorithm>
 #include <chrono>
 
 // NOTE: If you want to run the code, change this to "main".
 int main_execute(int argc, char *argv[])
 {
-	// Ensure the correct number of arguments.
-	if (argc != 9) {
-		std::cerr << "Please specify nodes, edges, and landmarks data files, as well as the initial and goal nodes' UIDs, plus the policy output file." << std::endl;
+	// Ensure the correct number of arguments. An optional last argument of "compare" also solves with policy
+	// iteration, and reports its wall time against that of the solver below.
+	if (argc != 9 && !(argc == 10 && std::string(argv[9]) == "compare")) {
+		std::cerr << "Please specify nodes, edges, and landmarks data files, as well as the initial and goal nodes' UIDs, plus the policy output file (and optionally \"compare\")." << std::endl;
 		return -1;
 	}
+	bool compare = (argc == 10);
 
 	// Load the LOSM LPOMDP.
 	LOSMPOMDP *losmLPOMDP = nullptr;
@@ -50,6 +57,14 @@ int main_execute(int argc, char *argv[])
 
 	losmLPOMDP->set_slack(30.0f, 0.0f);
 
+	// Compile the model once; later runs on the same city may map it instead of rebuilding it, and solve
+	// and save the policy of the mapped model in the same way.
+//	losmLPOMDP->save_model(std::string(argv[8]) + ".model");
+//	LPOMDPMapped *mappedLPOMDP = new LPOMDPMapped(std::string(argv[8]) + ".model");
+
+	// Alternatively, a (single value function) model in pomdp_files/ may be loaded and solved directly.
+//	LPOMDPCassandra *cassandraLPOMDP = new LPOMDPCassandra("../pomdp_files/drive_seattle.pomdp");
+
 	// -------------------------------------------------------------------------------------
 	/* CPU Version
 	LPBVI solver;
@@ -58,6 +73,10 @@ int main_execute(int argc, char *argv[])
 //	solver.set_num_update_iterations(6);
 //	solver.set_num_update_iterations(8);
 	solver.set_num_update_iterations(10);
+//	solver.set_num_threads(16);
+//	solver.numa_mode(true);
+//	solver.pipelining(true); // Expand during the later value functions; the rule must not depend on them.
+//	solver.speculative_mode(true); // Update all value functions together, correcting the restrictions as they settle.
 	//*/
 
 	//* GPU Version
@@ -67,6 +86,8 @@ int main_execute(int argc, char *argv[])
 //	solver.set_performance_variables(6, 2); // Complexity (below) = 6. Don't forget to change it.
 //	solver.set_performance_variables(8, 2); // Complexity (below) = 8. Don't forget to change it.
 //	solver.set_performance_variables(10, 2); // Complexity (below) = 10. Don't forget to change it.
+//	solver.set_backend(LPBVICudaBackend::HOST); // Without a GPU.
+//	solver.set_num_threads(16);
 //	solver.set_num_update_iterations(100);
 //	solver.set_num_update_iterations(200);
 //	solver.set_num_update_iterations(300);
@@ -75,8 +96,11 @@ int main_execute(int argc, char *argv[])
 	//*/
 	// -------------------------------------------------------------------------------------
 
+	POMDPPBVIExpansionRule expansionRule = POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_EXPLORATORY_ACTION;
+//	POMDPPBVIExpansionRule expansionRule = POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_GREEDY_ACTION;
+
 	solver.eta_constraint(false);
-	solver.set_expansion_rule(POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_EXPLORATORY_ACTION);
+	solver.set_expansion_rule(expansionRule);
 	solver.set_num_expansion_iterations(1);
 
 
@@ -88,10 +112,6 @@ int main_execute(int argc, char *argv[])
 	// TODO: Once you fix above, also in lpbvi.cpp at the initialization of zeroAlphaVector, use the
 	// R_min / (1 - gamma) instead of 0.
 
-	// TODO: You need to compute the V^\pi value, and plot that. Currently, you are using the V^\eta values,
-	// which are detached from one another, namely the first one. Once you compute the correct value you
-	// will again be able to numerically see the effect of slack.
-
 
 	// Find the belief to record given the two initial UIDs defining the initial state.
 	BeliefState *beliefToRecord = nullptr;
@@ -304,8 +324,31 @@ int main_execute(int argc, char *argv[])
 	}
 	//*/
 
+	// Anytime: Stop within the time window, saving the policy after each completed expansion. The partial
+	// snapshots within an expansion have too few value functions for the policy file, so they are skipped.
+//	solver.set_time_limit(8.0 * 60.0 * 60.0);
+//	solver.set_snapshot_callback([&](PolicyAlphaVectors **snapshot, unsigned int k, bool partial) {
+//		if (!partial) {
+//			losmLPOMDP->save_policy(snapshot, k, 0.20, argv[8]);
+//		}
+//	});
+
+	// Checkpoint: Write the solver state every 50 updates, and resume from it after a crash or preemption.
+//	solver.set_checkpoint(std::string(argv[8]) + ".checkpoint", 50);
+
+	// Planner: Log which engine and representation suit this model, and apply its thread count and performance
+	// variables (this returns true if the solver above is not of the chosen engine; see create_solver).
+//	LPBVIPlanner planner;
+//	LPBVIPlan plan = planner.plan(losmLPOMDP, solver.get_initial_belief_states(), solver.get_num_expansion_iterations());
+//	planner.apply(plan, &solver);
+
 	PolicyAlphaVectors **policy = nullptr;
+	auto viStart = std::chrono::high_resolution_clock::now();
 	policy = solver.solve(losmLPOMDP);
+	auto viEnd = std::chrono::high_resolution_clock::now();
+//	policy = solver.resume(losmLPOMDP, std::string(argv[8]) + ".checkpoint");
+//	LPBVISession session(&solver, losmLPOMDP); // Repeated solves (e.g., over the slack) reuse the model's precomputation.
+//	policy = session.solve();
 //	losmLPOMDP->save_policy(policy, losmLPOMDP->get_rewards()->get_num_rewards(), argv[8]);
 	losmLPOMDP->save_policy(policy, losmLPOMDP->get_rewards()->get_num_rewards(), 0.20, argv[8]);
 
@@ -313,6 +356,72 @@ int main_execute(int argc, char *argv[])
 	std::cout << "V^eta(b^0): [" << policy[0]->compute_value(beliefToRecord) << ", " <<
 			policy[1]->compute_value(beliefToRecord) << "]" << std::endl; std::cout.flush();
 
+	// We take the final collection of alpha vectors as the final policy, hence policy[1]. Evaluating it
+	// computes both value functions in a single pass, at the belief points left from the solve above.
+	solver.set_evaluation_tolerance(0.01);
+	PolicyAlphaVectors **result = nullptr;
+	result = solver.compute_value(losmLPOMDP, policy[1]);
+
+	// Print the V^pi of this belief state.
+	std::cout << "V^pi(b^0): [" << result[0]->compute_value(beliefToRecord) << ", " <<
+			result[1]->compute_value(beliefToRecord) << "]" << std::endl; std::cout.flush();
+
+	// Free the result memory.
+	for (unsigned int i = 0; i < losmLPOMDP->get_rewards()->get_num_rewards(); i++) {
+		delete result[i];
+	}
+	delete [] result;
+
+	// Compare the wall time of value iteration (above) with policy iteration over the same initial belief points,
+	// with the same settings and threads.
+	if (compare) {
+		LPBPI piSolver;
+		piSolver.set_num_threads(solver.get_num_threads());
+		piSolver.eta_constraint(false);
+		piSolver.set_expansion_rule(expansionRule);
+		piSolver.set_num_expansion_iterations(solver.get_num_expansion_iterations());
+		for (BeliefState *b : solver.get_initial_belief_states()) {
+			piSolver.add_initial_belief_state(new BeliefState(*b));
+		}
+
+		auto piStart = std::chrono::high_resolution_clock::now();
+		PolicyAlphaVectors **piPolicy = piSolver.solve(losmLPOMDP);
+		auto piEnd = std::chrono::high_resolution_clock::now();
+
+		double viSeconds = (double)std::chrono::duration_cast<std::chrono::milliseconds>(viEnd - viStart).count() / 1000.0;
+		double piSeconds = (double)std::chrono::duration_cast<std::chrono::milliseconds>(piEnd - piStart).count() / 1000.0;
+		std::cout << "Wall Time: LPBVI " << viSeconds << " s, LPBPI " << piSeconds << " s (" <<
+				(viSeconds / std::max(piSeconds, 0.001)) << "x)" << std::endl; std::cout.flush();
+		std::cout << "V(b^0): LPBVI [" << policy[0]->compute_value(beliefToRecord) << ", " <<
+				policy[1]->compute_value(beliefToRecord) << "], LPBPI [" << piPolicy[0]->compute_value(beliefToRecord) <<
+				", " << piPolicy[1]->compute_value(beliefToRecord) << "]" << std::endl; std::cout.flush();
+
+		for (unsigned int i = 0; i < losmLPOMDP->get_rewards()->get_num_rewards(); i++) {
+			delete piPolicy[i];
+		}
+		delete [] piPolicy;
+	}
+
+	/* Solve with mixed observability, since the road position and autonomy are fully observed.
+	LPBVIMOMDP momdpSolver;
+	momdpSolver.set_num_threads(16);
+	momdpSolver.set_num_expansion_iterations(solver.get_num_expansion_iterations());
+	momdpSolver.set_locations(losmLPOMDP->get_locations());
+	for (BeliefState *b : solver.get_initial_belief_states()) {
+		momdpSolver.add_initial_belief_state(new BeliefState(*b));
+	}
+
+	LPBVIMixedPolicy **mixedPolicy = momdpSolver.solve_mixed(losmLPOMDP);
+	losmLPOMDP->save_policy(mixedPolicy, losmLPOMDP->get_rewards()->get_num_rewards(), 0.20, argv[8]);
+	std::cout << "V(b^0): LPBVI (Mixed Observability) [" << mixedPolicy[0]->compute_value(beliefToRecord) << ", " <<
+			mixedPolicy[1]->compute_value(beliefToRecord) << "]" << std::endl; std::cout.flush();
+
+	for (unsigned int i = 0; i < losmLPOMDP->get_rewards()->get_num_rewards(); i++) {
+		delete mixedPolicy[i];
+	}
+	delete [] mixedPolicy;
+	//*/
+
 	// Free the belief to record value.
 	delete beliefToRecord;
 	beliefToRecord = nullptr;
@@ -327,11 +436,7 @@ int main_execute(int argc, char *argv[])
 	}
 	//*/
 
-	/* We take the final collection of alpha vectors as the final policy, hence policy[1].
-	PolicyAlphaVectors **result = nullptr;
-	result = solver.compute_value(losmLPOMDP, policy[1]);
-
-	// Now compute the actual values following the policy.
+	/* After everything is computed, output the recorded values of V^pi in a csv-like format to the screen.
 	std::cout << "V^pi(b^0):" << std::endl; std::cout.flush();
 	for (auto Vi : solver.get_recorded_values()) {
 		for (double Vit : Vi) {
@@ -339,17 +444,11 @@ int main_execute(int argc, char *argv[])
 		}
 		std::cout << std::endl; std::cout.flush();
 	}
-
-	// Free the result memory.
-	for (unsigned int i = 0; i < losmLPOMDP->get_rewards()->get_num_rewards(); i++) {
-		delete [] result[i];
-	}
-	delete [] result;
 	//*/
 
 	// Free the policy memory.
 	for (unsigned int i = 0; i < losmLPOMDP->get_rewards()->get_num_rewards(); i++) {
-		delete [] policy[i];
+		delete policy[i];
 	}
 	delete [] policy;
 
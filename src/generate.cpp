@@ -22,37 +22,42 @@
  */
 
 #include "../include/losm_lpomdp.h"
-#include "../include/lpbvi.h"
-#include "../include/lpbvi_cuda.h"
-
-#include "../../librbr/librbr/include/management/pomdp_file.h"
+#include "../include/lpomdp_cassandra.h"
 
 #include "../../losm/losm/include/losm_exception.h"
 
 #include <iostream>
 #include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
 
-int main(int argc, char *argv[])
-{
-	// Ensure the correct number of arguments.
-	if (argc != 9) {
-		std::cerr << "Please specify nodes, edges, and landmarks data files, as well as the initial and goal nodes' UIDs, plus the Cassandra POMDP output file." << std::endl;
-		return -1;
-	}
+/**
+ * The number of arguments which describe one export: the nodes, edges, and landmarks data files, the
+ * initial and goal nodes' UIDs, and the Cassandra POMDP output file.
+ */
+#define GENERATE_NUM_ARGUMENTS 8
 
+/**
+ * Load one LOSM LPOMDP and save it as a Cassandra POMDP file.
+ * @param	argv	The arguments of this export.
+ * @return	Returns true if an error arose, and false otherwise.
+ */
+static bool generate(char *argv[])
+{
 	// Load the LOSM LPOMDP.
 	LOSMPOMDP *losmLPOMDP = nullptr;
 	try {
-		losmLPOMDP = new LOSMPOMDP(argv[1], argv[2], argv[3], argv[6], argv[7]);
+		losmLPOMDP = new LOSMPOMDP(argv[0], argv[1], argv[2], argv[5], argv[6]);
 	} catch (LOSMException &err) {
-		std::cerr << "Failed to load the files provided." << std::endl;
-		return -1;
+		std::cerr << "Failed to load the files provided for '" << argv[7] << "'." << std::endl;
+		return true;
 	}
 
 	// Find the belief to record given the two initial UIDs defining the initial state.
 	BeliefState *start = nullptr;
-	unsigned long uid1 = std::stol(argv[4]);
-	unsigned long uid2 = std::stol(argv[5]);
+	unsigned long uid1 = std::stol(argv[3]);
+	unsigned long uid2 = std::stol(argv[4]);
 
 	for (auto statesVector : losmLPOMDP->get_tiredness_states()) {
 		// All the states in a statesVector are constructed with the same pair of UIDs;
@@ -69,11 +74,45 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	std::cout << "Saving..." << std::endl;
+	std::cout << "Saving '" << argv[7] << "'..." << std::endl;
+
+	// Save the Cassandra POMDP file with the path and filename provided. Only the time reward is saved.
+	bool failed = LPOMDPCassandra::save(losmLPOMDP, start, argv[7]);
+
+	if (start != nullptr) {
+		delete start;
+	}
+	delete losmLPOMDP;
+
+	return failed;
+}
+
+int main(int argc, char *argv[])
+{
+	// Ensure the correct number of arguments: one or more groups of them, each of which is exported in parallel.
+	if (argc < 1 + GENERATE_NUM_ARGUMENTS || (argc - 1) % GENERATE_NUM_ARGUMENTS != 0) {
+		std::cerr << "Please specify nodes, edges, and landmarks data files, as well as the initial and goal nodes' UIDs, plus the Cassandra POMDP output file." << std::endl;
+		std::cerr << "Repeat all of these to export multiple cities or goals in parallel." << std::endl;
+		return -1;
+	}
 
-	// Save the Cassandra POMDP file with the path and filename provided.
-	POMDPFile file;
-	file.save_pomdp(losmLPOMDP, argv[8], start);
+	unsigned int numExports = (argc - 1) / GENERATE_NUM_ARGUMENTS;
+	std::vector<char> failed(numExports, 0);
+	std::vector<std::thread> exportThreads;
+
+	for (unsigned int i = 0; i < numExports; i++) {
+		exportThreads.push_back(std::thread([&, i]() {
+			failed[i] = generate(argv + 1 + i * GENERATE_NUM_ARGUMENTS);
+		}));
+	}
+
+	for (std::thread &thread : exportThreads) {
+		thread.join();
+	}
+
+	if (std::count(failed.begin(), failed.end(), 1) > 0) {
+		return -1;
+	}
 
 	std::cout << "Done!" << std::endl;
 
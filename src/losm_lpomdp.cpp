@@ -24,11 +24,11 @@
 
 #include "../include/losm_lpomdp.h"
 #include "../include/losm_state.h"
+#include "../include/lpomdp_sparse_state_transitions.h"
 
 #include "../../librbr/librbr/include/core/states/states_map.h"
 #include "../../librbr/librbr/include/core/actions/actions_map.h"
 #include "../../librbr/librbr/include/core/observations/observations_map.h"
-#include "../../librbr/librbr/include/core/state_transitions/state_transitions_array.h"
 #include "../../librbr/librbr/include/core/observation_transitions/observation_transitions_array.h"
 #include "../../librbr/librbr/include/core/rewards/factored_weighted_rewards.h"
 #include "../../librbr/librbr/include/core/rewards/sa_rewards_array.h"
@@ -48,6 +48,8 @@
 #include <cmath>
 #include <set>
 #include <algorithm>
+#include <thread>
+#include <exception>
 
 LOSMPOMDP::LOSMPOMDP(std::string nodesFilename, std::string edgesFilename, std::string landmarksFilename,
 		std::string goal1, std::string goal2)
@@ -61,7 +63,7 @@ LOSMPOMDP::LOSMPOMDP(std::string nodesFilename, std::string edgesFilename, std::
 
 	losm = new LOSM(nodesFilename, edgesFilename, landmarksFilename);
 
-	create_edges_hash(losm);
+	create_road_graph(losm);
 	create_states(losm);
 	create_actions(losm);
 	create_observations(losm);
@@ -85,29 +87,25 @@ void LOSMPOMDP::set_slack(float d1, float d2)
 
 bool LOSMPOMDP::save_policy(PolicyAlphaVectors **policy, unsigned int k, std::string filename)
 {
-	StatesMap *S = dynamic_cast<StatesMap *>(states);
-
 	std::ofstream file(filename);
 	if (!file.is_open()) {
 		return true;
 	}
 
-	for (auto state : *S) {
-		State *s = resolve(state);
-		LOSMState *ls = dynamic_cast<LOSMState *>(s);
-
+	for (unsigned int s = 0; s < stateTable.get_num_states(); s++) {
 		BeliefState b;
-		b.set(s, 1.0);
+		b.set(stateTable.get_state(s), 1.0);
 
 		Action *a = policy[k - 1]->get(&b);
 		IndexedAction *ia = dynamic_cast<IndexedAction *>(a);
 
-		file << ls->get_current_step()->get_uid() << ",";
-		file << ls->get_current()->get_uid() << ",";
-		file << ls->get_tiredness() << ",";
-		file << ls->get_autonomy() << ",";
-		file << successors.at(ls).at(ia->get_index())->get_previous_step()->get_uid() << ",";
-		file << successors.at(ls).at(ia->get_index())->get_autonomy() << ",";
+		file << stateTable.get_node(stateTable.get_current_step(s))->get_uid() << ",";
+		file << stateTable.get_node(stateTable.get_current(s))->get_uid() << ",";
+		file << stateTable.get_tiredness(s) << ",";
+		file << stateTable.get_autonomy(s) << ",";
+		unsigned int sp = stateTable.get_successor(s, ia->get_index());
+		file << stateTable.get_node(stateTable.get_previous_step(sp))->get_uid() << ",";
+		file << stateTable.get_autonomy(sp) << ",";
 		for (unsigned int i = 0; i < k; i++) {
 			file << policy[i]->compute_value(&b);
 			if (i != k - 1) {
@@ -160,8 +158,9 @@ bool LOSMPOMDP::save_policy(PolicyAlphaVectors **policy, unsigned int k, double
 		file << ls0->get_current()->get_uid() << ",";
 		file << ls0->get_tiredness() << ",";
 		file << ls0->get_autonomy() << ",";
-		file << successors.at(ls0).at(ia->get_index())->get_previous_step()->get_uid() << ",";
-		file << successors.at(ls0).at(ia->get_index())->get_autonomy() << ",";
+		unsigned int sp0 = stateTable.get_successor(ls0->get_index(), ia->get_index());
+		file << stateTable.get_node(stateTable.get_previous_step(sp0))->get_uid() << ",";
+		file << stateTable.get_autonomy(sp0) << ",";
 		for (unsigned int i = 0; i < k; i++) {
 			file << policy[i]->compute_value(&b);
 			if (i != k - 1) {
@@ -191,8 +190,9 @@ bool LOSMPOMDP::save_policy(PolicyAlphaVectors **policy, unsigned int k, double
 		file << ls1->get_current()->get_uid() << ",";
 		file << ls1->get_tiredness() << ",";
 		file << ls1->get_autonomy() << ",";
-		file << successors.at(ls1).at(ia->get_index())->get_previous_step()->get_uid() << ",";
-		file << successors.at(ls1).at(ia->get_index())->get_autonomy() << ",";
+		unsigned int sp1 = stateTable.get_successor(ls1->get_index(), ia->get_index());
+		file << stateTable.get_node(stateTable.get_previous_step(sp1))->get_uid() << ",";
+		file << stateTable.get_autonomy(sp1) << ",";
 		for (unsigned int i = 0; i < k; i++) {
 			file << policy[i]->compute_value(&b);
 			if (i != k - 1) {
@@ -207,6 +207,103 @@ bool LOSMPOMDP::save_policy(PolicyAlphaVectors **policy, unsigned int k, double
 	return false;
 }
 
+bool LOSMPOMDP::save_policy(LPBVIMixedPolicy **policy, unsigned int k, double tirednessBelief, std::string filename)
+{
+	std::ofstream file(filename);
+	if (!file.is_open()) {
+		return true;
+	}
+
+	for (auto tirednessStateElements : tirednessStates) {
+		// As above, write one row for each state of the pair, with the tired one having the probability
+		// "tirednessBelief" for the first and the opposite for the second.
+		for (unsigned int e = 0; e < 2; e++) {
+			LOSMState *ls = dynamic_cast<LOSMState *>(tirednessStateElements[e]);
+			LOSMState *ls0 = dynamic_cast<LOSMState *>(tirednessStateElements[0]);
+
+			double tired = (e == 0) ? tirednessBelief : 1.0 - tirednessBelief;
+
+			BeliefState b;
+			if (ls0->get_tiredness() > 0) {
+				b.set(tirednessStateElements[0], tired);
+				b.set(tirednessStateElements[1], 1.0 - tired);
+			} else {
+				b.set(tirednessStateElements[0], 1.0 - tired);
+				b.set(tirednessStateElements[1], tired);
+			}
+
+			Action *a = policy[k - 1]->get(&b);
+			IndexedAction *ia = dynamic_cast<IndexedAction *>(a);
+
+			// A location without any belief points has no action to save.
+			if (ia == nullptr) {
+				continue;
+			}
+
+			file << ls->get_current_step()->get_uid() << ",";
+			file << ls->get_current()->get_uid() << ",";
+			file << ls->get_tiredness() << ",";
+			file << ls->get_autonomy() << ",";
+			unsigned int sp = stateTable.get_successor(ls->get_index(), ia->get_index());
+			file << stateTable.get_node(stateTable.get_previous_step(sp))->get_uid() << ",";
+			file << stateTable.get_autonomy(sp) << ",";
+			for (unsigned int i = 0; i < k; i++) {
+				file << policy[i]->compute_value(&b);
+				if (i != k - 1) {
+					file << ",";
+				}
+			}
+			file << std::endl;
+		}
+	}
+
+	file.close();
+
+	return false;
+}
+
+bool LOSMPOMDP::save_model(std::string filename)
+{
+	LPOMDPMappedMetadata metadata;
+	metadata.states.resize(stateTable.get_num_states());
+
+	for (unsigned int s = 0; s < stateTable.get_num_states(); s++) {
+		LPOMDPMappedStateInfo &info = metadata.states[s];
+		info.current = stateTable.get_node(stateTable.get_current(s))->get_uid();
+		info.previous = stateTable.get_node(stateTable.get_previous(s))->get_uid();
+		info.currentStep = stateTable.get_node(stateTable.get_current_step(s))->get_uid();
+		info.previousStep = stateTable.get_node(stateTable.get_previous_step(s))->get_uid();
+		info.distance = stateTable.get_distance(s);
+		info.speedLimit = stateTable.get_speed_limit(s);
+		info.uniqueness = stateTable.get_uniqueness_index(s);
+		info.tiredness = stateTable.get_tiredness(s);
+		info.autonomy = stateTable.get_autonomy(s);
+		info.goal = stateTable.is_goal(s);
+		info.autonomyCapable = stateTable.is_autonomy_capable(s);
+	}
+
+	unsigned int m = dynamic_cast<ActionsMap *>(actions)->get_num_actions();
+	metadata.successors.resize((size_t)stateTable.get_num_states() * m);
+	for (unsigned int s = 0; s < stateTable.get_num_states(); s++) {
+		for (unsigned int a = 0; a < m; a++) {
+			metadata.successors[(size_t)s * m + a] = stateTable.get_successor(s, a);
+		}
+	}
+
+	for (LOSMState *s : goalStates) {
+		metadata.goals.push_back(s->get_index());
+	}
+
+	for (const std::vector<LOSMState *> &tirednessStateElements : tirednessStates) {
+		metadata.tirednessStates.push_back(std::vector<unsigned int>());
+		for (LOSMState *s : tirednessStateElements) {
+			metadata.tirednessStates.back().push_back(s->get_index());
+		}
+	}
+
+	return LPOMDPMapped::save(this, metadata, filename);
+}
+
 LOSMState *LOSMPOMDP::get_initial_state(std::string initial1, std::string initial2)
 {
 	unsigned long initialNodeUID1 = 0;
@@ -219,14 +316,23 @@ LOSMState *LOSMPOMDP::get_initial_state(std::string initial1, std::string initia
 		throw CoreException();
 	}
 
-	StatesMap *S = dynamic_cast<StatesMap *>(states);
+	// Find the dense indexes of the two nodes, then the first state between them.
+	unsigned int initialNode1 = stateTable.get_num_nodes();
+	unsigned int initialNode2 = stateTable.get_num_nodes();
 
-	for (auto state : *S) {
-		LOSMState *s = dynamic_cast<LOSMState *>(resolve(state));
+	for (unsigned int i = 0; i < stateTable.get_num_nodes(); i++) {
+		if (stateTable.get_node(i)->get_uid() == initialNodeUID1) {
+			initialNode1 = i;
+		}
+		if (stateTable.get_node(i)->get_uid() == initialNodeUID2) {
+			initialNode2 = i;
+		}
+	}
 
-		if ((s->get_current()->get_uid() == initialNodeUID1 && s->get_previous()->get_uid() == initialNodeUID2) ||
-				(s->get_current()->get_uid() == initialNodeUID2 && s->get_previous()->get_uid() == initialNodeUID1)) {
-			return s;
+	for (unsigned int s = 0; s < stateTable.get_num_states(); s++) {
+		if ((stateTable.get_current(s) == initialNode1 && stateTable.get_previous(s) == initialNode2) ||
+				(stateTable.get_current(s) == initialNode2 && stateTable.get_previous(s) == initialNode1)) {
+			return stateTable.get_state(s);
 		}
 	}
 
@@ -263,17 +369,29 @@ const std::vector<std::vector<LOSMState *> > &LOSMPOMDP::get_tiredness_states()
 	return tirednessStates;
 }
 
-void LOSMPOMDP::create_edges_hash(LOSM *losm)
+std::vector<std::vector<State *> > LOSMPOMDP::get_locations() const
 {
-	for (const LOSMEdge *edge : losm->get_edges()) {
-		edgeHash[edge->get_node_1()->get_uid()][edge->get_node_2()->get_uid()] = edge;
+	std::vector<std::vector<State *> > locations;
+	for (const std::vector<LOSMState *> &tirednessStateElements : tirednessStates) {
+		locations.push_back(std::vector<State *>(tirednessStateElements.begin(), tirednessStateElements.end()));
 	}
-	std::cout << "Done Create Edges Hash!" << std::endl; std::cout.flush();
+	return locations;
+}
+
+void LOSMPOMDP::create_road_graph(LOSM *losm)
+{
+	roadGraph.create(losm);
+
+	std::cout << "Num Intersections: " << roadGraph.get_num_intersections() << std::endl; std::cout.flush();
+	std::cout << "Num Roads: " << roadGraph.get_super_edges().size() << std::endl; std::cout.flush();
+
+	std::cout << "Done Create Road Graph!" << std::endl; std::cout.flush();
 }
 
 void LOSMPOMDP::create_states(LOSM *losm)
 {
-	LOSMState::reset_indexer();
+	uniquenessIndex.reset();
+	stateTable.clear();
 
 	states = new StatesMap();
 	StatesMap *S = dynamic_cast<StatesMap *>(states);
@@ -285,52 +403,47 @@ void LOSMPOMDP::create_states(LOSM *losm)
 	std::cout << "Num Landmarks: " << losm->get_landmarks().size() << std::endl; std::cout.flush();
 
 	// Create the set of states from the LOSM object's edges, making states for
-	// both directions, as well as a tiredness level.
-	for (const LOSMEdge *edge : losm->get_edges()) {
-		const LOSMNode *current = nullptr;
-		const LOSMNode *previous = nullptr;
+	// both directions, as well as a tiredness level. The roads between intersections were
+	// contracted by the road graph, so each edge which ends a road only looks up its road.
+	const std::vector<const LOSMEdge *> &edges = losm->get_edges();
 
-		const LOSMNode *currentStepNode = nullptr;
-		const LOSMNode *previousStepNode = nullptr;
+	// The states are numbered by this model, but IndexedState still increments its shared counter.
+	std::lock_guard<std::mutex> lock(indexerMutex);
 
-		float distance = 0.0f;
-		float speedLimit = 0.0f;
-		bool isGoal = false;
-		bool isAutonomyCapable = false;
+	for (unsigned int e = 0; e < edges.size(); e++) {
+		unsigned int superEdgeIndex = 0;
+		unsigned int end = 0;
 
-		// We must create both if they are both 'interesting' nodes, because there would be no other edge,
-		// that it would iterate over.
-		bool createBoth = false;
+		// Edges inside a road (between two degree-2 nodes) do not create states.
+		if (roadGraph.get_super_edge(e, superEdgeIndex, end)) {
+			continue;
+		}
 
-		if (edge->get_node_1()->get_degree() != 2 && edge->get_node_2()->get_degree() != 2) {
-			// This computes the distance, speed limit, etc.
-			const LOSMNode *nothing = nullptr;
-			const LOSMNode *nothingStep = nullptr;
-			map_directed_path(losm, edge->get_node_1(), edge->get_node_2(), distance, speedLimit, nothing, nothingStep);
+		const LOSMSuperEdge &superEdge = roadGraph.get_super_edges()[superEdgeIndex];
 
-			current = edge->get_node_1();
-			previous = edge->get_node_2();
+		unsigned int currentIndex = superEdge.node1;
+		unsigned int previousIndex = superEdge.node2;
 
-			currentStepNode = edge->get_node_2();
-			previousStepNode = edge->get_node_1();
+		const LOSMNode *currentStepNode = superEdge.step1;
+		const LOSMNode *previousStepNode = superEdge.step2;
 
-			createBoth = true;
+		// The edge ends the road at its second intersection, so the decision is made there.
+		if (end == 2) {
+			std::swap(currentIndex, previousIndex);
+			std::swap(currentStepNode, previousStepNode);
+		}
 
-		} else if (edge->get_node_1()->get_degree() != 2 && edge->get_node_2()->get_degree() == 2) {
-			// Node 1 is interesting, so find the other interesting one for Node 2.
-			current = edge->get_node_1();
-			currentStepNode = edge->get_node_2();
-			map_directed_path(losm, edge->get_node_2(), edge->get_node_1(), distance, speedLimit, previous, previousStepNode);
+		const LOSMNode *current = roadGraph.get_intersection(currentIndex);
+		const LOSMNode *previous = roadGraph.get_intersection(previousIndex);
 
-		} else if (edge->get_node_1()->get_degree() == 2 && edge->get_node_2()->get_degree() != 2) {
-			// Node 2 is interesting, so find the other interesting one for Node 1.
-			current = edge->get_node_2();
-			currentStepNode = edge->get_node_1();
-			map_directed_path(losm, edge->get_node_1(), edge->get_node_2(), distance, speedLimit, previous, previousStepNode);
+		float distance = superEdge.distance;
+		float speedLimit = superEdge.speedLimit;
+		bool isGoal = false;
+		bool isAutonomyCapable = false;
 
-		} else {
-			continue;
-		}
+		// We must create both if they are both 'interesting' nodes, because there would be no other edge,
+		// that it would iterate over.
+		bool createBoth = (end == 0);
 
 		if ((current->get_uid() == goalNodeUID1 && previous->get_uid() == goalNodeUID2) ||
 				(current->get_uid() == goalNodeUID2 && previous->get_uid() == goalNodeUID1)) {
@@ -351,9 +464,10 @@ void LOSMPOMDP::create_states(LOSM *losm)
 		std::vector<LOSMState *> tirednessStatesElements;
 
 		for (unsigned int i = 0; i < NUM_TIREDNESS_LEVELS; i++) {
-			newLOSMState = new LOSMState(current, previous, i, false,
+			newLOSMState = stateTable.add(current, previous, i, false,
 					distance, speedLimit, isGoal, isAutonomyCapable,
-					currentStepNode, previousStepNode);
+					currentStepNode, previousStepNode,
+					uniquenessIndex.next(previousIndex, currentIndex, i, false));
 			S->add(newLOSMState);
 			if (isGoal) {
 				goalStates.push_back(newLOSMState);
@@ -365,9 +479,10 @@ void LOSMPOMDP::create_states(LOSM *losm)
 
 		if (createBoth) {
 			for (unsigned int i = 0; i < NUM_TIREDNESS_LEVELS; i++) {
-				newLOSMState = new LOSMState(previous, current, i, false,
+				newLOSMState = stateTable.add(previous, current, i, false,
 						distance, speedLimit, isGoal, isAutonomyCapable,
-						previousStepNode, currentStepNode);
+						previousStepNode, currentStepNode,
+						uniquenessIndex.next(currentIndex, previousIndex, i, false));
 				S->add(newLOSMState);
 				if (isGoal) {
 					goalStates.push_back(newLOSMState);
@@ -381,9 +496,10 @@ void LOSMPOMDP::create_states(LOSM *losm)
 		// If possible, create the states in which autonomy is enabled. This may or may not exist.
 		if (isAutonomyCapable) {
 			for (unsigned int i = 0; i < NUM_TIREDNESS_LEVELS; i++) {
-				newLOSMState = new LOSMState(current, previous, i, true,
+				newLOSMState = stateTable.add(current, previous, i, true,
 						distance, speedLimit, isGoal, isAutonomyCapable,
-						currentStepNode, previousStepNode);
+						currentStepNode, previousStepNode,
+						uniquenessIndex.next(previousIndex, currentIndex, i, true));
 				S->add(newLOSMState);
 				if (isGoal) {
 					goalStates.push_back(newLOSMState);
@@ -395,9 +511,10 @@ void LOSMPOMDP::create_states(LOSM *losm)
 
 			if (createBoth) {
 				for (unsigned int i = 0; i < NUM_TIREDNESS_LEVELS; i++) {
-					newLOSMState = new LOSMState(previous, current, i, true,
+					newLOSMState = stateTable.add(previous, current, i, true,
 							distance, speedLimit, isGoal, isAutonomyCapable,
-							previousStepNode, currentStepNode);
+							previousStepNode, currentStepNode,
+							uniquenessIndex.next(currentIndex, previousIndex, i, true));
 					S->add(newLOSMState);
 					if (isGoal) {
 						goalStates.push_back(newLOSMState);
@@ -454,16 +571,20 @@ void LOSMPOMDP::create_actions(LOSM *losm)
 		}
 	}
 
-	IndexedAction::reset_indexer();
-
 	// Create a number of indexed actions equal to the max degree times two. The first set of
 	// actions assumes the agent does not wish to enable autonomy, and the second set of actions
 	// assumes the agent wishes to enable autonomy.
 	actions = new ActionsMap();
 	ActionsMap *A = dynamic_cast<ActionsMap *>(actions);
 
-	for (int i = 0; i < maxDegree * 2; i++) {
-		A->add(new IndexedAction());
+	// The actions are indexed by a shared counter, so another model must not create its own meanwhile.
+	{
+		std::lock_guard<std::mutex> lock(indexerMutex);
+
+		IndexedAction::reset_indexer();
+		for (int i = 0; i < maxDegree * 2; i++) {
+			A->add(new IndexedAction());
+		}
 	}
 
 	std::cout << "Num Actions: " << A->get_num_actions() << std::endl; std::cout.flush();
@@ -481,14 +602,18 @@ void LOSMPOMDP::create_observations(LOSM *losm)
 		}
 	}
 
-	IndexedObservation::reset_indexer();
-
 	// Create two observations: attentive (0) and tired (1).
 	observations = new ObservationsMap();
 	ObservationsMap *O = dynamic_cast<ObservationsMap *>(observations);
 
-	for (int i = 0; i < 2; i++) {
-		O->add(new IndexedObservation());
+	// As with the actions, the observations are indexed by a shared counter.
+	{
+		std::lock_guard<std::mutex> lock(indexerMutex);
+
+		IndexedObservation::reset_indexer();
+		for (int i = 0; i < 2; i++) {
+			O->add(new IndexedObservation());
+		}
 	}
 
 	std::cout << "Num Observations: " << O->get_num_observations() << std::endl; std::cout.flush();
@@ -498,77 +623,119 @@ void LOSMPOMDP::create_observations(LOSM *losm)
 
 void LOSMPOMDP::create_state_transitions(LOSM *losm)
 {
-	StateTransitionsArray *T = new StateTransitionsArray(LOSMState::get_num_states(), IndexedAction::get_num_actions());
-	stateTransitions = T;
-
 	StatesMap *S = dynamic_cast<StatesMap *>(states);
 	ActionsMap *A = dynamic_cast<ActionsMap *>(actions);
 
-	for (auto state : *S) {
-		LOSMState *s = dynamic_cast<LOSMState *>(resolve(state));
-
-		// Must store the mapping from a next state (prev, cur, auto) to action taken.
-		std::unordered_map<const LOSMNode *,
-			std::unordered_map<const LOSMNode *,
-				std::unordered_map<bool,
-					std::unordered_map<unsigned int, Action *> > > > map;
-		int index = 0;
-
-		// Only set transitions if this is not a goal state. Goal states will always loop to themselves (handled at the end).
-		if (!s->is_goal()) {
-			for (auto nextState : *S) {
-				LOSMState *sp = dynamic_cast<LOSMState *>(resolve(nextState));
-
-				// If the current intersection node for current state matches the previous node for the next state,
-				// then this possibly a non-zero transition probability. It now depends on the tiredness level.
-				if (s->get_current() != sp->get_previous()) {
-					continue;
-				}
+	// Index the states by their previous node, so that the possible next states of a state are exactly those
+	// indexed by its current node. Each list keeps the order of S, so the actions are assigned as before.
+	std::vector<std::vector<unsigned int> > statesByPrevious(stateTable.get_num_nodes());
+	std::vector<unsigned int> orderedStates;
 
-				// This is a valid node. First check if a mapping already exists for taking an action at this next state.
-				Action *a = nullptr;
-				try {
-					a = map.at(sp->get_previous()).at(sp->get_current()).at(sp->get_autonomy()).at(sp->get_uniqueness_index());
-				} catch (const std::out_of_range &err) {
-					a = A->get(index);
-					map[sp->get_previous()][sp->get_current()][sp->get_autonomy()][sp->get_uniqueness_index()] = a;
-					index++;
-				}
+	for (auto state : *S) {
+		unsigned int s = dynamic_cast<LOSMState *>(resolve(state))->get_index();
+		statesByPrevious[stateTable.get_previous(s)].push_back(s);
+		orderedStates.push_back(s);
+	}
 
-				// Determine the probability, while verifying the state transition makes sense in terms of tiredness level.
-				double p = -1.0;
-				if (s->get_tiredness() == NUM_TIREDNESS_LEVELS - 1 && sp->get_tiredness() == NUM_TIREDNESS_LEVELS - 1) {
-					p = 1.0;
-				} else if (s->get_tiredness() == sp->get_tiredness()) {
-					p = 0.9;
-				} else if (s->get_tiredness() + 1 == sp->get_tiredness()) {
-					p = 0.1;
-				}
+	stateTable.initialize_successors(A->get_num_actions());
+
+	// The successors (and probabilities) of each action at each state, in the order they are found; each is
+	// only written by its own worker, and they form the rows of T at the end. The successor table keeps the
+	// last successor found for each action, and its rows are also only written by their own worker.
+	std::vector<std::vector<std::pair<unsigned int, LPOMDPMappedTransition> > > rows(orderedStates.size());
+
+	execute_in_parallel(orderedStates.size(), [&](unsigned int first, unsigned int last) {
+		for (unsigned int j = first; j < last; j++) {
+			unsigned int s = orderedStates[j];
+
+			// Must store the mapping from a next state (cur, auto, uniqueness) to action taken; its previous node is
+			// always the current node of s. There are only as many as the degree of the node, so a list suffices.
+			std::vector<std::pair<unsigned int, unsigned int> > map;
+			unsigned int index = 0;
+
+			// Only set transitions if this is not a goal state. Goal states will always loop to themselves (handled at the end).
+			if (!stateTable.is_goal(s)) {
+				for (unsigned int sp : statesByPrevious[stateTable.get_current(s)]) {
+					// This is a valid node. First check if a mapping already exists for taking an action at this next state.
+					auto mapped = std::find_if(map.begin(), map.end(), [this, sp](const std::pair<unsigned int, unsigned int> &m) {
+						return stateTable.get_current(m.first) == stateTable.get_current(sp) &&
+								stateTable.get_autonomy(m.first) == stateTable.get_autonomy(sp) &&
+								stateTable.get_uniqueness_index(m.first) == stateTable.get_uniqueness_index(sp);
+					});
+
+					unsigned int a = 0;
+					if (mapped != map.end()) {
+						a = mapped->second;
+					} else {
+						a = index;
+						map.push_back(std::make_pair(sp, a));
+						index++;
+					}
 
-				// If no probability was assigned, it means that while there is an action, it is impossible to transition
-				// from s's level of tiredness to sp's level of tiredness. Otherwise, we can assign a state transition.
-				if (p >= 0.0) {
-					T->set(s, a, sp, p);
-					T->add_successor(s, a, sp);
+					// Determine the probability, while verifying the state transition makes sense in terms of tiredness level.
+					double p = -1.0;
+					if (stateTable.get_tiredness(s) == NUM_TIREDNESS_LEVELS - 1 && stateTable.get_tiredness(sp) == NUM_TIREDNESS_LEVELS - 1) {
+						p = 1.0;
+					} else if (stateTable.get_tiredness(s) == stateTable.get_tiredness(sp)) {
+						p = 0.9;
+					} else if (stateTable.get_tiredness(s) + 1 == stateTable.get_tiredness(sp)) {
+						p = 0.1;
+					}
 
-					IndexedAction *ia = dynamic_cast<IndexedAction *>(a);
-					successors[s][ia->get_index()] = sp;
+					// If no probability was assigned, it means that while there is an action, it is impossible to transition
+					// from s's level of tiredness to sp's level of tiredness. Otherwise, we can assign a state transition.
+					if (p >= 0.0) {
+						stateTable.set_successor(s, a, sp);
+						rows[j].push_back(std::make_pair(a, LPOMDPMappedTransition{sp, (float)p}));
+					}
 				}
 			}
+
+			// Recall that the degree of the node corresponds to how many actions are available. Thus,
+			// we need to fill in the remaining number of actions as a state transition to itself.
+			// The reward for any self-transition will be defined to be the largest negative number
+			// possible. This must be done for both enabled and disabled autonomy.
+			for (unsigned int i = index; i < A->get_num_actions(); i++) {
+				stateTable.set_successor(s, i, s);
+				rows[j].push_back(std::make_pair(i, LPOMDPMappedTransition{s, 1.0f}));
+			}
+		}
+	});
+
+	// Build the rows of T directly: count the entries of each row (s * m + a), compute the offsets, then place
+	// each entry in its row, keeping the order they were found. Only the non-zeros are ever stored.
+	size_t m = A->get_num_actions();
+	std::vector<unsigned long long> rowOffsets(stateTable.get_num_states() * m + 1, 0);
+
+	for (unsigned int j = 0; j < orderedStates.size(); j++) {
+		for (const std::pair<unsigned int, LPOMDPMappedTransition> &successor : rows[j]) {
+			rowOffsets[orderedStates[j] * m + successor.first + 1]++;
 		}
+	}
+	for (size_t row = 0; row + 1 < rowOffsets.size(); row++) {
+		rowOffsets[row + 1] += rowOffsets[row];
+	}
 
-		// Recall that the degree of the node corresponds to how many actions are available. Thus,
-		// we need to fill in the remaining number of actions as a state transition to itself.
-		// The reward for any self-transition will be defined to be the largest negative number
-		// possible. This must be done for both enabled and disabled autonomy.
-		for (int i = index; i < (int)IndexedAction::get_num_actions(); i++) {
-			Action *a = A->get(i);
-			T->set(s, a, s, 1.0);
-			T->add_successor(s, a, s);
-			successors[s][i] = s;
+	std::vector<LPOMDPMappedTransition> entries(rowOffsets.back());
+	std::vector<unsigned long long> next(rowOffsets.begin(), rowOffsets.end() - 1);
+
+	for (unsigned int j = 0; j < orderedStates.size(); j++) {
+		for (const std::pair<unsigned int, LPOMDPMappedTransition> &successor : rows[j]) {
+			entries[next[orderedStates[j] * m + successor.first]++] = successor.second;
 		}
+		std::vector<std::pair<unsigned int, LPOMDPMappedTransition> >().swap(rows[j]);
 	}
 
+	std::vector<State *> statesByIndex(stateTable.get_num_states());
+	for (unsigned int s = 0; s < stateTable.get_num_states(); s++) {
+		statesByIndex[s] = stateTable.get_state(s);
+	}
+
+	LPOMDPSparseStateTransitions *T = new LPOMDPSparseStateTransitions(statesByIndex, m, rowOffsets, entries);
+	stateTransitions = T;
+
+	std::cout << "Num Non-Zero State Transitions: " << T->get_num_entries() << std::endl; std::cout.flush();
+
 	/*
 	// CHECK!!!!!
 	for (auto state : *((StatesMap *)states)) {
@@ -616,41 +783,38 @@ void LOSMPOMDP::create_state_transitions(LOSM *losm)
 
 void LOSMPOMDP::create_observation_transitions(LOSM *losm)
 {
-	ObservationTransitionsArray *O = new ObservationTransitionsArray(LOSMState::get_num_states(),
-			IndexedAction::get_num_actions(),
-			IndexedObservation::get_num_observations());
-	observationTransitions = O;
-
-	StatesMap *S = dynamic_cast<StatesMap *>(states);
 	ActionsMap *A = dynamic_cast<ActionsMap *>(actions);
 	ObservationsMap *Z = dynamic_cast<ObservationsMap *>(observations);
 
-	for (auto action : *A) {
-		Action *a = resolve(action);
-
-		for (auto nextState : *S) {
-			LOSMState *sp = dynamic_cast<LOSMState *>(resolve(nextState));
-
-			Observation *attentive = Z->get(0);
-			Observation *tired = Z->get(1);
-
-			// Note: Setting the "add_available" is pointless, since all observations
-			// are always available.
-			if (sp->get_tiredness() == 0) {
-				O->set(a, sp, attentive, 0.75);
-//				O->add_available(a, sp, attentive);
+	ObservationTransitionsArray *O = new ObservationTransitionsArray(stateTable.get_num_states(),
+			A->get_num_actions(),
+			Z->get_num_observations());
+	observationTransitions = O;
 
-				O->set(a, sp, tired, 0.25);
-//				O->add_available(a, sp, tired);
-			} else if (sp->get_tiredness() == 1) {
-				O->set(a, sp, attentive, 0.25);
-//				O->add_available(a, sp, attentive);
+	std::vector<Action *> orderedActions;
+	for (auto action : *A) {
+		orderedActions.push_back(resolve(action));
+	}
 
-				O->set(a, sp, tired, 0.75);
-//				O->add_available(a, sp, tired);
+	Observation *attentive = Z->get(0);
+	Observation *tired = Z->get(1);
+
+	// Each worker sets the rows of its own partition of next states, which are disjoint in O.
+	execute_in_parallel(stateTable.get_num_states(), [&](unsigned int first, unsigned int last) {
+		for (unsigned int sp = first; sp < last; sp++) {
+			for (Action *a : orderedActions) {
+				// Note: Setting the "add_available" is pointless, since all observations
+				// are always available.
+				if (stateTable.get_tiredness(sp) == 0) {
+					O->set(a, stateTable.get_state(sp), attentive, 0.75);
+					O->set(a, stateTable.get_state(sp), tired, 0.25);
+				} else if (stateTable.get_tiredness(sp) == 1) {
+					O->set(a, stateTable.get_state(sp), attentive, 0.25);
+					O->set(a, stateTable.get_state(sp), tired, 0.75);
+				}
 			}
 		}
-	}
+	});
 
 	std::cout << "Done Observation Transitions!" << std::endl; std::cout.flush();
 }
@@ -660,160 +824,173 @@ void LOSMPOMDP::create_rewards(LOSM *losm)
 	rewards = new FactoredWeightedRewards();
 	FactoredWeightedRewards *R = dynamic_cast<FactoredWeightedRewards *>(rewards);
 
-	StatesMap *S = dynamic_cast<StatesMap *>(states);
 	ActionsMap *A = dynamic_cast<ActionsMap *>(actions);
 
-	SARewardsArray *timeReward = new SARewardsArray(LOSMState::get_num_states(), IndexedAction::get_num_actions());
+	SARewardsArray *timeReward = new SARewardsArray(stateTable.get_num_states(), A->get_num_actions());
 	R->add_factor(timeReward);
 
-	SARewardsArray *autonomyReward = new SARewardsArray(LOSMState::get_num_states(), IndexedAction::get_num_actions());
+	SARewardsArray *autonomyReward = new SARewardsArray(stateTable.get_num_states(), A->get_num_actions());
 	R->add_factor(autonomyReward);
 
-	for (auto state : *S) {
-		LOSMState *s = dynamic_cast<LOSMState *>(resolve(state));
+	std::vector<IndexedAction *> orderedActions;
+	for (auto action : *A) {
+		orderedActions.push_back(dynamic_cast<IndexedAction *>(resolve(action)));
+	}
 
-		for (auto action : *A) {
-			IndexedAction *a = dynamic_cast<IndexedAction *>(resolve(action));
+	unsigned int m = A->get_num_actions();
 
+	unsigned int n = stateTable.get_num_states();
 
-			// -----------------------------------------------------------------------------------------------------------------
-			// -----------------------------------------------------------------------------------------------------------------
-			// -----------------------------------------------------------------------------------------------------------------
+	// Each worker computes the rows of its own partition of states. The rewards are set on this thread at the
+	// end, since setting one may also update the array's minimum and maximum reward.
+	std::vector<double> timeRewards((size_t)n * m, 0.0);
+	std::vector<double> autonomyRewards((size_t)n * m, 0.0);
 
+	execute_in_parallel(n, [&](unsigned int first, unsigned int last) {
+		for (unsigned int j = first; j < last; j++) {
+			unsigned int degree = stateTable.get_node(stateTable.get_current(j))->get_degree();
 
-			//* Streamlined Rewards
+			for (IndexedAction *a : orderedActions) {
 
-			double basePenalty = -s->get_distance() / s->get_speed_limit() * TO_SECONDS - INTERSECTION_WAIT_TIME_IN_SECONDS;
-			double epsilonPenalty = -INTERSECTION_WAIT_TIME_IN_SECONDS;
-			double invalidActionPenalty = -MAXIMUM_POSSIBLE_TIME_SPENT_ON_ROAD_IN_SECONDS;
 
-			// The Best One For Time Reward
-			if (!s->is_goal() && a->get_index() >= s->get_current()->get_degree() * 2) {
-				timeReward->set(s, a, invalidActionPenalty);
-			} else if (s->is_goal()) {
-				timeReward->set(s, a, 0.0);
-			} else {
-				timeReward->set(s, a, basePenalty);
-			}
+				// -----------------------------------------------------------------------------------------------------------------
+				// -----------------------------------------------------------------------------------------------------------------
+				// -----------------------------------------------------------------------------------------------------------------
+
 
-			// The Best One For Autonomy Reward
-			if (!s->is_goal() && a->get_index() >= s->get_current()->get_degree() * 2) {
-				autonomyReward->set(s, a, invalidActionPenalty);
-			} else if (s->is_goal()) {
-				autonomyReward->set(s, a, 0.0);
-			} else if (s->get_tiredness() > 0) {
-				if (s->get_autonomy()) {
-					autonomyReward->set(s, a, epsilonPenalty);
+				//* Streamlined Rewards
+
+				double basePenalty = -stateTable.get_distance(j) / stateTable.get_speed_limit(j) * TO_SECONDS - INTERSECTION_WAIT_TIME_IN_SECONDS;
+				double epsilonPenalty = -INTERSECTION_WAIT_TIME_IN_SECONDS;
+				double invalidActionPenalty = -MAXIMUM_POSSIBLE_TIME_SPENT_ON_ROAD_IN_SECONDS;
+
+				// The Best One For Time Reward
+				if (!stateTable.is_goal(j) && a->get_index() >= degree * 2) {
+					timeRewards[(size_t)j * m + a->get_index()] = invalidActionPenalty;
+				} else if (stateTable.is_goal(j)) {
+					timeRewards[(size_t)j * m + a->get_index()] = 0.0;
 				} else {
-					autonomyReward->set(s, a, basePenalty);
+					timeRewards[(size_t)j * m + a->get_index()] = basePenalty;
 				}
-			} else {
-				if (s->is_autonomy_capable() && !s->get_autonomy()) {
-					autonomyReward->set(s, a, basePenalty);
+
+				// The Best One For Autonomy Reward
+				if (!stateTable.is_goal(j) && a->get_index() >= degree * 2) {
+					autonomyRewards[(size_t)j * m + a->get_index()] = invalidActionPenalty;
+				} else if (stateTable.is_goal(j)) {
+					autonomyRewards[(size_t)j * m + a->get_index()] = 0.0;
+				} else if (stateTable.get_tiredness(j) > 0) {
+					if (stateTable.get_autonomy(j)) {
+						autonomyRewards[(size_t)j * m + a->get_index()] = epsilonPenalty;
+					} else {
+						autonomyRewards[(size_t)j * m + a->get_index()] = basePenalty;
+					}
 				} else {
-					autonomyReward->set(s, a, epsilonPenalty);
+					if (stateTable.is_autonomy_capable(j) && !stateTable.get_autonomy(j)) {
+						autonomyRewards[(size_t)j * m + a->get_index()] = basePenalty;
+					} else {
+						autonomyRewards[(size_t)j * m + a->get_index()] = epsilonPenalty;
+					}
 				}
-			}
 
-			//*/
+				//*/
 
 
-			// -----------------------------------------------------------------------------------------------------------------
-			// -----------------------------------------------------------------------------------------------------------------
-			// -----------------------------------------------------------------------------------------------------------------
+				// -----------------------------------------------------------------------------------------------------------------
+				// -----------------------------------------------------------------------------------------------------------------
+				// -----------------------------------------------------------------------------------------------------------------
 
 
-			/* Original Rewards
+				/* Original Rewards
 
-			// Check if this is a self-transition, which is fine if the agent is in a goal
-			// state, but otherwise yields a large negative reward. This is how I am able to
-			// handle having the same number of actions for each state, even if the degree of
-			// the node is less than the number of actions.
-			if (s->get_current()->get_uid() == successors[s][a->get_index()]->get_current()->get_uid() &&
-					!successors[s][a->get_index()]->is_goal()) {
-				// Goal states always transition to themselves (absorbing), with zero reward.
-				timeReward->set(s, a, floatMinCuda);
-				autonomyReward->set(s, a, floatMinCuda);
+				// Check if this is a self-transition, which is fine if the agent is in a goal
+				// state, but otherwise yields a large negative reward. This is how I am able to
+				// handle having the same number of actions for each state, even if the degree of
+				// the node is less than the number of actions.
+				if (s->get_current()->get_uid() == successors[s][a->get_index()]->get_current()->get_uid() &&
+						!successors[s][a->get_index()]->is_goal()) {
+					// Goal states always transition to themselves (absorbing), with zero reward.
+					timeReward->set(s, a, floatMinCuda);
+					autonomyReward->set(s, a, floatMinCuda);
 
-				continue;
-			}
+					continue;
+				}
 
-			// If this transitions to a goal, then zero penalty. Note: The successor of any action from
-			// any *goal* state is also a goal state, namely itself.
-			if (successors[s][a->get_index()]->is_goal()) {
-				timeReward->set(s, a, 0.0);
-				autonomyReward->set(s, a, 0.0);
+				// If this transitions to a goal, then zero penalty. Note: The successor of any action from
+				// any *goal* state is also a goal state, namely itself.
+				if (successors[s][a->get_index()]->is_goal()) {
+					timeReward->set(s, a, 0.0);
+					autonomyReward->set(s, a, 0.0);
 
-				continue;
-			}
+					continue;
+				}
 
-			// Time is always penalized based on time spent on the road.
-			timeReward->set(s, a, -successors[s][a->get_index()]->get_distance() / successors[s][a->get_index()]->get_speed_limit() * TO_SECONDS - INTERSECTION_WAIT_TIME_IN_SECONDS);
+				// Time is always penalized based on time spent on the road.
+				timeReward->set(s, a, -successors[s][a->get_index()]->get_distance() / successors[s][a->get_index()]->get_speed_limit() * TO_SECONDS - INTERSECTION_WAIT_TIME_IN_SECONDS);
 
-			// The autonomy is always penalized for distance if they fail to correctly move autonomously. Otherwise it is an epsilon penalty.
-			if (!successors[s][a->get_index()]->get_autonomy() && successors[s][a->get_index()]->get_tiredness() > 0) {
+				// The autonomy is always penalized for distance if they fail to correctly move autonomously. Otherwise it is an epsilon penalty.
+				if (!successors[s][a->get_index()]->get_autonomy() && successors[s][a->get_index()]->get_tiredness() > 0) {
 //					if (sp->is_autonomy_capable() && !sp->get_autonomy() && sp->get_tiredness() > 0) {
-				autonomyReward->set(s, a, -successors[s][a->get_index()]->get_distance() / successors[s][a->get_index()]->get_speed_limit() * TO_SECONDS - INTERSECTION_WAIT_TIME_IN_SECONDS);
-			} else {
-				autonomyReward->set(s, a, -INTERSECTION_WAIT_TIME_IN_SECONDS);
-			}
+					autonomyReward->set(s, a, -successors[s][a->get_index()]->get_distance() / successors[s][a->get_index()]->get_speed_limit() * TO_SECONDS - INTERSECTION_WAIT_TIME_IN_SECONDS);
+				} else {
+					autonomyReward->set(s, a, -INTERSECTION_WAIT_TIME_IN_SECONDS);
+				}
 
-			//*/
+				//*/
 
 
-			// -----------------------------------------------------------------------------------------------------------------
-			// -----------------------------------------------------------------------------------------------------------------
-			// -----------------------------------------------------------------------------------------------------------------
+				// -----------------------------------------------------------------------------------------------------------------
+				// -----------------------------------------------------------------------------------------------------------------
+				// -----------------------------------------------------------------------------------------------------------------
 
 
-			/*
-			// If this is not a goal state, and the action taken was greater than the 2 * degree of this node.
-			if (!s->is_goal() && a->get_index() >= s->get_current()->get_degree() * 2) {
-				timeReward->set(s, a, s, floatMinCuda);
-				autonomyReward->set(s, a, s, floatMinCuda);
-				continue;
-			}
-			//*/
-
-			/*
-			// NOTE: The reason this will work is because all actions which are invalid will
-			// self-cycle, and the self-cycling will yield a value (-1) which is less than
-			// the value of the self-cycle at the goal (0).
-			if (!s->is_goal() && a->get_index() >= s->get_current()->get_degree() * 2) {
-				timeReward->set(s, a, s, -1.0f);
-				autonomyReward->set(s, a, s, -1.0f);
-				continue;
-			}
-			//*/
+				/*
+				// If this is not a goal state, and the action taken was greater than the 2 * degree of this node.
+				if (!s->is_goal() && a->get_index() >= s->get_current()->get_degree() * 2) {
+					timeReward->set(s, a, s, floatMinCuda);
+					autonomyReward->set(s, a, s, floatMinCuda);
+					continue;
+				}
+				//*/
+
+				/*
+				// NOTE: The reason this will work is because all actions which are invalid will
+				// self-cycle, and the self-cycling will yield a value (-1) which is less than
+				// the value of the self-cycle at the goal (0).
+				if (!s->is_goal() && a->get_index() >= s->get_current()->get_degree() * 2) {
+					timeReward->set(s, a, s, -1.0f);
+					autonomyReward->set(s, a, s, -1.0f);
+					continue;
+				}
+				//*/
 
 
-			/* ABOVE REPLACES THIS:
-			// Check if this is a self-transition, which is fine if the agent is in a goal
-			// state, but otherwise yields a large negative reward. This is how I am able to
-			// handle having the same number of actions for each state, even if the degree of
-			// the node is less than the number of actions.
-			if (s == sp && !sp->is_goal()) {
-				// Goal states always transition to themselves (absorbing), with zero reward.
-				timeReward->set(s, a, s, floatMinCuda);
-				autonomyReward->set(s, a, s, floatMinCuda);
+				/* ABOVE REPLACES THIS:
+				// Check if this is a self-transition, which is fine if the agent is in a goal
+				// state, but otherwise yields a large negative reward. This is how I am able to
+				// handle having the same number of actions for each state, even if the degree of
+				// the node is less than the number of actions.
+				if (s == sp && !sp->is_goal()) {
+					// Goal states always transition to themselves (absorbing), with zero reward.
+					timeReward->set(s, a, s, floatMinCuda);
+					autonomyReward->set(s, a, s, floatMinCuda);
 
-				continue;
-			}
-			//*/
+					continue;
+				}
+				//*/
 
-			/*
-			// If you got here, then s != sp, so any transition to a goal state is cost of 0 for the time reward.
-			if (s->is_goal()) {
-				timeReward->set(s, a, 0.0);
-				autonomyReward->set(s, a, 0.0);
-				continue;
-			}
-			//*/
+				/*
+				// If you got here, then s != sp, so any transition to a goal state is cost of 0 for the time reward.
+				if (s->is_goal()) {
+					timeReward->set(s, a, 0.0);
+					autonomyReward->set(s, a, 0.0);
+					continue;
+				}
+				//*/
 
 
-			// Enabling or disabling autonomy changes the speed of the car, but provides
-			// a positive reward for safely driving autonomously, regardless of the
-			// tiredness of the driver.
+				// Enabling or disabling autonomy changes the speed of the car, but provides
+				// a positive reward for safely driving autonomously, regardless of the
+				// tiredness of the driver.
 //			if (sp->get_autonomy()) {
 //				timeReward->set(s, a, sp, -sp->get_distance() / (sp->get_speed_limit() * AUTONOMY_SPEED_LIMIT_FACTOR) * TO_SECONDS);
 //			} else {
@@ -821,100 +998,108 @@ void LOSMPOMDP::create_rewards(LOSM *losm)
 //			}
 
 
-			/* The Best One For Autonomy Reward
-			if (!s->is_goal() && a->get_index() >= s->get_current()->get_degree() * 2) {
-				autonomyReward->set(s, a, floatMinCuda);
-			} else if (s->is_goal()) {
-				autonomyReward->set(s, a, 0.0);
-			} else if (s->get_tiredness() > 0) {
-				if (s->get_autonomy()) {
-					autonomyReward->set(s, a, epsilonPenalty);
-				} else {
-					autonomyReward->set(s, a, basePenalty);
-				}
-			} else {
-				if (s->is_autonomy_capable() && !s->get_autonomy()) {
-					autonomyReward->set(s, a, basePenalty);
+				/* The Best One For Autonomy Reward
+				if (!s->is_goal() && a->get_index() >= s->get_current()->get_degree() * 2) {
+					autonomyReward->set(s, a, floatMinCuda);
+				} else if (s->is_goal()) {
+					autonomyReward->set(s, a, 0.0);
+				} else if (s->get_tiredness() > 0) {
+					if (s->get_autonomy()) {
+						autonomyReward->set(s, a, epsilonPenalty);
+					} else {
+						autonomyReward->set(s, a, basePenalty);
+					}
 				} else {
-					autonomyReward->set(s, a, epsilonPenalty);
+					if (s->is_autonomy_capable() && !s->get_autonomy()) {
+						autonomyReward->set(s, a, basePenalty);
+					} else {
+						autonomyReward->set(s, a, epsilonPenalty);
+					}
 				}
-			}
-			//*/
-
-
-			/* Copy-Paste of Time Reward for Autonomy Reward, used for debugging.
-			if (!s->is_goal() && a->get_index() >= s->get_current()->get_degree() * 2) {
-				autonomyReward->set(s, a, floatMinCuda);
-			} else if (s->is_goal()) {
-				autonomyReward->set(s, a, 0.0);
-			} else {
-				autonomyReward->set(s, a, basePenalty);
-			}
-			//*/
+				//*/
 
 
-			/*
-			else if (successors[s][a->get_index()]->get_tiredness() > 0) {
-				if (successors[s][a->get_index()]->is_autonomy_capable()) {
-					// Action produces a state which IS autonomy-capable. So, check if the action enabled it.
-					if (successors[s][a->get_index()]->get_autonomy()) {
-						// It correctly enabled autonomy, so just penalize normally.
-						autonomyReward->set(s, a, basePenalty);
+				/* Copy-Paste of Time Reward for Autonomy Reward, used for debugging.
+				if (!s->is_goal() && a->get_index() >= s->get_current()->get_degree() * 2) {
+					autonomyReward->set(s, a, floatMinCuda);
+				} else if (s->is_goal()) {
+					autonomyReward->set(s, a, 0.0);
+				} else {
+					autonomyReward->set(s, a, basePenalty);
+				}
+				//*/
+
+
+				/*
+				else if (successors[s][a->get_index()]->get_tiredness() > 0) {
+					if (successors[s][a->get_index()]->is_autonomy_capable()) {
+						// Action produces a state which IS autonomy-capable. So, check if the action enabled it.
+						if (successors[s][a->get_index()]->get_autonomy()) {
+							// It correctly enabled autonomy, so just penalize normally.
+							autonomyReward->set(s, a, basePenalty);
+						} else {
+							// It was an idiot and did not enable it, so add an epsilon penalty to the base penalty.
+							autonomyReward->set(s, a, basePenalty + epsilonPenalty);
+						}
 					} else {
-						// It was an idiot and did not enable it, so add an epsilon penalty to the base penalty.
+						// Action produces a state which is NOT autonomy-capable. Thus, base penalty with an epsilon penalty.
 						autonomyReward->set(s, a, basePenalty + epsilonPenalty);
 					}
 				} else {
-					// Action produces a state which is NOT autonomy-capable. Thus, base penalty with an epsilon penalty.
-					autonomyReward->set(s, a, basePenalty + epsilonPenalty);
-				}
-			} else {
-				// 1. A valid action.
-				// 2. Not a goal state.
-				// 3. Next state is attentive.
-				// Therefore, just penalize based on distance, except give an extra penalty if the agent
-				// doesn't choose drive autonomously on an autonomous-capable road, versus the choice to
-				// drive not autonomously. This basically just breaks ties.
-				if (successors[s][a->get_index()]->is_autonomy_capable() && successors[s][a->get_index()]->get_autonomy()) {
-					autonomyReward->set(s, a, basePenalty);
-				} else {
-					autonomyReward->set(s, a, basePenalty + epsilonPenalty);
+					// 1. A valid action.
+					// 2. Not a goal state.
+					// 3. Next state is attentive.
+					// Therefore, just penalize based on distance, except give an extra penalty if the agent
+					// doesn't choose drive autonomously on an autonomous-capable road, versus the choice to
+					// drive not autonomously. This basically just breaks ties.
+					if (successors[s][a->get_index()]->is_autonomy_capable() && successors[s][a->get_index()]->get_autonomy()) {
+						autonomyReward->set(s, a, basePenalty);
+					} else {
+						autonomyReward->set(s, a, basePenalty + epsilonPenalty);
+					}
 				}
-			}
-			*/
-			//*/
+				*/
+				//*/
 
 
-			/* Not quite.
-			if (s->get_autonomy() && successors[s][a->get_index()]->get_autonomy()) {
-				autonomyReward->set(s, a, 1.0);
-			} else if (s->get_tiredness() > 0) {
-				autonomyReward->set(s, a, -1.0);
-			} else {
-				autonomyReward->set(s, a, 0.0);
-			}
-			//*/
-
-			/* Experiment...
-			if (s->get_autonomy() && s->get_tiredness() > 0) {
-//					if (sp->is_autonomy_capable() && !sp->get_autonomy() && sp->get_tiredness() > 0) {
-				autonomyReward->set(s, a, -2.0);
-			} else if (s->get_autonomy() && s->get_tiredness() == 0) {
-				autonomyReward->set(s, a, -1.0);
-			} else if (!s->get_autonomy() && s->get_tiredness() > 0) {
-				if (s->is_autonomy_capable()) {
-					autonomyReward->set(s, a, -5.0);
+				/* Not quite.
+				if (s->get_autonomy() && successors[s][a->get_index()]->get_autonomy()) {
+					autonomyReward->set(s, a, 1.0);
+				} else if (s->get_tiredness() > 0) {
+					autonomyReward->set(s, a, -1.0);
 				} else {
-					autonomyReward->set(s, a, -4.0);
+					autonomyReward->set(s, a, 0.0);
 				}
-			} else if (!s->get_autonomy() && s->get_tiredness() == 0) {
-				if (s->is_autonomy_capable()) {
-					autonomyReward->set(s, a, -3.0);
-				} else {
-					autonomyReward->set(s, a, -3.0);
+				//*/
+
+				/* Experiment...
+				if (s->get_autonomy() && s->get_tiredness() > 0) {
+//					if (sp->is_autonomy_capable() && !sp->get_autonomy() && sp->get_tiredness() > 0) {
+					autonomyReward->set(s, a, -2.0);
+				} else if (s->get_autonomy() && s->get_tiredness() == 0) {
+					autonomyReward->set(s, a, -1.0);
+				} else if (!s->get_autonomy() && s->get_tiredness() > 0) {
+					if (s->is_autonomy_capable()) {
+						autonomyReward->set(s, a, -5.0);
+					} else {
+						autonomyReward->set(s, a, -4.0);
+					}
+				} else if (!s->get_autonomy() && s->get_tiredness() == 0) {
+					if (s->is_autonomy_capable()) {
+						autonomyReward->set(s, a, -3.0);
+					} else {
+						autonomyReward->set(s, a, -3.0);
+					}
 				}
+				//*/
 			}
-			//*/
+		}
+	});
+
+	for (unsigned int j = 0; j < n; j++) {
+		for (IndexedAction *a : orderedActions) {
+			timeReward->set(stateTable.get_state(j), a, timeRewards[(size_t)j * m + a->get_index()]);
+			autonomyReward->set(stateTable.get_state(j), a, autonomyRewards[(size_t)j * m + a->get_index()]);
 		}
 	}
 
@@ -934,42 +1119,47 @@ void LOSMPOMDP::create_misc(LOSM *losm)
 	std::cout << "Done Misc!" << std::endl; std::cout.flush();
 }
 
-void LOSMPOMDP::map_directed_path(LOSM *losm, const LOSMNode *current, const LOSMNode *previous,
-		float &distance, float &speedLimit,
-		const LOSMNode *&result, const LOSMNode *&resultStep)
+float LOSMPOMDP::point_to_line_distance(float x0, float y0, float x1, float y1, float x2, float y2)
 {
-	// Update the distance and time.
-	const LOSMEdge *edge = nullptr;
-	try {
-		edge = edgeHash.at(current->get_uid()).at(previous->get_uid());
-	} catch (const std::out_of_range &err) {
-		edge = edgeHash.at(previous->get_uid()).at(current->get_uid());
-	}
-	speedLimit = (speedLimit * distance + edge->get_speed_limit() * edge->get_distance()) / (distance + edge->get_distance());
-	distance += edge->get_distance();
+	float Dx = x2 - x1;
+	float Dy = y2 - y1;
+
+	return fabs(Dy * x0 - Dx * y0 - x1 * y2 + x2 * y1) / sqrt(Dx * Dx + Dy * Dy);
+}
 
-	// Stop once an intersection or a dead end has been found.
-	if (current->get_degree() != 2) {
-		result = current;
-		resultStep = previous;
+void LOSMPOMDP::execute_in_parallel(unsigned int size, const std::function<void (unsigned int first, unsigned int last)> &work)
+{
+	unsigned int workers = std::max(1u, std::min(std::thread::hardware_concurrency(), size));
+
+	// The single worker case simply runs on the calling thread.
+	if (workers == 1) {
+		work(0, size);
 		return;
 	}
 
-	// Keep going by traversing the neighbor which is not 'previous'.
-	std::vector<const LOSMNode *> neighbors;
-	losm->get_neighbors(current, neighbors);
+	std::vector<std::thread> workerThreads;
+	std::vector<std::exception_ptr> errors(workers, nullptr);
 
-	if (neighbors[0] == previous) {
-		return map_directed_path(losm, neighbors[1], current, distance, speedLimit, result, resultStep);
-	} else {
-		return map_directed_path(losm, neighbors[0], current, distance, speedLimit, result, resultStep);
+	for (unsigned int w = 0; w < workers; w++) {
+		unsigned int first = (unsigned int)((unsigned long)w * size / workers);
+		unsigned int last = (unsigned int)((unsigned long)(w + 1) * size / workers);
+
+		workerThreads.push_back(std::thread([&, w, first, last]() {
+			try {
+				work(first, last);
+			} catch (...) {
+				errors[w] = std::current_exception();
+			}
+		}));
 	}
-}
 
-float LOSMPOMDP::point_to_line_distance(float x0, float y0, float x1, float y1, float x2, float y2)
-{
-	float Dx = x2 - x1;
-	float Dy = y2 - y1;
+	for (std::thread &thread : workerThreads) {
+		thread.join();
+	}
 
-	return fabs(Dy * x0 - Dx * y0 - x1 * y2 + x2 * y1) / sqrt(Dx * Dx + Dy * Dy);
+	for (std::exception_ptr &err : errors) {
+		if (err != nullptr) {
+			std::rethrow_exception(err);
+		}
+	}
 }
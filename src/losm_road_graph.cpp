@@ -0,0 +1,208 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_road_graph.h"
+
+#include <unordered_map>
+
+// The marker for a node which is not an intersection.
+#define LOSM_NOT_INTERSECTION 0xFFFFFFFF
+
+LOSMRoadGraph::LOSMRoadGraph()
+{ }
+
+LOSMRoadGraph::~LOSMRoadGraph()
+{ }
+
+void LOSMRoadGraph::create(const LOSM *losm)
+{
+	const std::vector<const LOSMEdge *> &edges = losm->get_edges();
+
+	intersections.clear();
+	superEdges.clear();
+	edgeSuperEdges.assign(edges.size(), LOSM_NO_SUPER_EDGE);
+	edgeEnds.assign(edges.size(), 0);
+
+	// Assign every node a dense index, and every intersection (or dead end) a dense index among the
+	// intersections. Nodes only referenced by an edge are included as well.
+	std::unordered_map<const LOSMNode *, unsigned int> nodeIndexes;
+	std::vector<unsigned int> intersectionIndexes;
+	nodeIndexes.reserve(losm->get_nodes().size());
+	intersectionIndexes.reserve(losm->get_nodes().size());
+
+	auto index_node = [&](const LOSMNode *node) {
+		auto result = nodeIndexes.emplace(node, (unsigned int)nodeIndexes.size());
+		if (result.second) {
+			if (node->get_degree() != 2) {
+				intersectionIndexes.push_back((unsigned int)intersections.size());
+				intersections.push_back(node);
+			} else {
+				intersectionIndexes.push_back(LOSM_NOT_INTERSECTION);
+			}
+		}
+		return result.first->second;
+	};
+
+	for (const LOSMNode *node : losm->get_nodes()) {
+		index_node(node);
+	}
+
+	std::vector<unsigned int> edgeNodes(2 * edges.size());
+	for (unsigned int e = 0; e < edges.size(); e++) {
+		edgeNodes[2 * e + 0] = index_node(edges[e]->get_node_1());
+		edgeNodes[2 * e + 1] = index_node(edges[e]->get_node_2());
+	}
+
+	// The edges incident to each node, stored contiguously: adjacentEdges[offsets[n], offsets[n + 1]).
+	std::vector<unsigned int> offsets(nodeIndexes.size() + 1, 0);
+	for (unsigned int n : edgeNodes) {
+		offsets[n + 1]++;
+	}
+	for (unsigned int n = 0; n < nodeIndexes.size(); n++) {
+		offsets[n + 1] += offsets[n];
+	}
+
+	std::vector<unsigned int> adjacentEdges(edgeNodes.size());
+	std::vector<unsigned int> position(offsets.begin(), offsets.end() - 1);
+	for (unsigned int i = 0; i < edgeNodes.size(); i++) {
+		adjacentEdges[position[edgeNodes[i]]++] = i / 2;
+	}
+
+	for (unsigned int e = 0; e < edges.size(); e++) {
+		unsigned int n1 = edgeNodes[2 * e + 0];
+		unsigned int n2 = edgeNodes[2 * e + 1];
+
+		// Both ends are intersections, so the edge is the whole road.
+		if (intersectionIndexes[n1] != LOSM_NOT_INTERSECTION && intersectionIndexes[n2] != LOSM_NOT_INTERSECTION) {
+			LOSMSuperEdge superEdge;
+			superEdge.node1 = intersectionIndexes[n1];
+			superEdge.node2 = intersectionIndexes[n2];
+			superEdge.step1 = edges[e]->get_node_2();
+			superEdge.step2 = edges[e]->get_node_1();
+			superEdge.distance = edges[e]->get_distance();
+			superEdge.speedLimit = edges[e]->get_speed_limit();
+
+			edgeSuperEdges[e] = (unsigned int)superEdges.size();
+			edgeEnds[e] = 0;
+			superEdges.push_back(superEdge);
+			continue;
+		}
+
+		// Edges inside a chain, and the far end of a chain which was already walked, are skipped.
+		if ((intersectionIndexes[n1] == LOSM_NOT_INTERSECTION && intersectionIndexes[n2] == LOSM_NOT_INTERSECTION) ||
+				edgeSuperEdges[e] != LOSM_NO_SUPER_EDGE) {
+			continue;
+		}
+
+		unsigned int start = n1;
+		unsigned int current = n2;
+		if (intersectionIndexes[n1] == LOSM_NOT_INTERSECTION) {
+			start = n2;
+			current = n1;
+		}
+
+		// Walk the chain until the next intersection, accumulating the distance and the weighted speed limit.
+		unsigned int previous = start;
+		unsigned int edge = e;
+		float distance = 0.0f;
+		float speedLimit = 0.0f;
+		bool valid = true;
+
+		while (true) {
+			speedLimit = (speedLimit * distance + edges[edge]->get_speed_limit() * edges[edge]->get_distance()) /
+					(distance + edges[edge]->get_distance());
+			distance += edges[edge]->get_distance();
+
+			if (intersectionIndexes[current] != LOSM_NOT_INTERSECTION) {
+				break;
+			}
+
+			// A degree-2 node must have exactly two incident edges; otherwise the LOSM data are inconsistent.
+			if (offsets[current + 1] - offsets[current] != 2) {
+				valid = false;
+				break;
+			}
+
+			unsigned int next = adjacentEdges[offsets[current]];
+			if (next == edge) {
+				next = adjacentEdges[offsets[current] + 1];
+			}
+
+			// A self-loop on a degree-2 node never reaches an intersection.
+			if (next == edge) {
+				valid = false;
+				break;
+			}
+
+			previous = current;
+			edge = next;
+			current = (edgeNodes[2 * edge + 0] == current) ? edgeNodes[2 * edge + 1] : edgeNodes[2 * edge + 0];
+		}
+
+		if (!valid) {
+			continue;
+		}
+
+		LOSMSuperEdge superEdge;
+		superEdge.node1 = intersectionIndexes[start];
+		superEdge.node2 = intersectionIndexes[current];
+		superEdge.step1 = (edgeNodes[2 * e + 0] == start) ? edges[e]->get_node_2() : edges[e]->get_node_1();
+		superEdge.step2 = (edgeNodes[2 * edge + 0] == previous) ? edges[edge]->get_node_1() : edges[edge]->get_node_2();
+		superEdge.distance = distance;
+		superEdge.speedLimit = speedLimit;
+
+		edgeSuperEdges[e] = (unsigned int)superEdges.size();
+		edgeEnds[e] = 1;
+		edgeSuperEdges[edge] = (unsigned int)superEdges.size();
+		edgeEnds[edge] = 2;
+		superEdges.push_back(superEdge);
+	}
+}
+
+unsigned int LOSMRoadGraph::get_num_intersections() const
+{
+	return (unsigned int)intersections.size();
+}
+
+const LOSMNode *LOSMRoadGraph::get_intersection(unsigned int index) const
+{
+	return intersections[index];
+}
+
+const std::vector<LOSMSuperEdge> &LOSMRoadGraph::get_super_edges() const
+{
+	return superEdges;
+}
+
+bool LOSMRoadGraph::get_super_edge(unsigned int edge, unsigned int &superEdge, unsigned int &end) const
+{
+	if (edge >= edgeSuperEdges.size() || edgeSuperEdges[edge] == LOSM_NO_SUPER_EDGE) {
+		return true;
+	}
+
+	superEdge = edgeSuperEdges[edge];
+	end = edgeEnds[edge];
+
+	return false;
+}
@@ -23,37 +23,99 @@
 
 
 #include "../include/losm_state.h"
+#include "../include/losm_state_table.h"
 
 #include "../../librbr/librbr/include/core/states/state_exception.h"
 
 #include <iostream>
+#include <algorithm>
 
-std::unordered_map<const LOSMNode *,
-	std::unordered_map<const LOSMNode *,
-		std::unordered_map<unsigned int,
-			std::unordered_map<bool, unsigned int> > > > LOSMState::uniquenessCounter;
+// The number of bits of each intersection index, and of the tiredness level, in a packed key.
+#define UNIQUENESS_NODE_BITS 30
+#define UNIQUENESS_TIREDNESS_BITS 3
 
-LOSMState::LOSMState(const LOSMNode *currentNode, const LOSMNode *previousNode, unsigned int tirednessLevel,
-		bool autonomyEnabled, float travelDistance, float travelSpeedLimit,
-		bool isGoalState, bool isAutonomyCapableState,
-		const LOSMNode *currentStepNode, const LOSMNode *previousStepNode)
+// The initial number of slots in the uniqueness index; always a power of two.
+#define UNIQUENESS_INITIAL_CAPACITY 1024
+
+LOSMUniquenessIndex::LOSMUniquenessIndex()
+{
+	size = 0;
+}
+
+LOSMUniquenessIndex::~LOSMUniquenessIndex()
+{ }
+
+unsigned int LOSMUniquenessIndex::next(unsigned int previous, unsigned int current, unsigned int tiredness, bool autonomy)
+{
+	if (previous >= (1u << UNIQUENESS_NODE_BITS) || current >= (1u << UNIQUENESS_NODE_BITS) ||
+			tiredness >= (1u << UNIQUENESS_TIREDNESS_BITS)) {
+		std::cerr << "Failed to pack the uniqueness key of a LOSMState." << std::endl;
+		throw StateException();
+	}
+
+	// Grow before the table is half full, so that probes stay short.
+	if (2 * (size + 1) > keys.size()) {
+		grow();
+	}
+
+	unsigned long long key = (((((unsigned long long)previous << UNIQUENESS_NODE_BITS) | current)
+			<< UNIQUENESS_TIREDNESS_BITS | tiredness) << 1 | (autonomy ? 1 : 0)) + 1;
+
+	// Fibonacci hashing, then linear probing over the power of two capacity.
+	size_t mask = keys.size() - 1;
+	size_t slot = (size_t)((key * 11400714819323198485ull) >> 32) & mask;
+
+	while (keys[slot] != 0 && keys[slot] != key) {
+		slot = (slot + 1) & mask;
+	}
+
+	if (keys[slot] == 0) {
+		keys[slot] = key;
+		size++;
+	}
+
+	return counters[slot]++;
+}
+
+void LOSMUniquenessIndex::reset()
 {
-	current = currentNode;
-	previous = previousNode;
-	tiredness = tirednessLevel;
-	autonomy = autonomyEnabled;
+	keys.clear();
+	counters.clear();
+	size = 0;
+}
 
-	// Note: This will assign 0 if the mapping is undefined (for the first time); i.e., it works.
-	uniquenessIndex = uniquenessCounter[previous][current][tiredness][autonomy];
-	uniquenessCounter[previous][current][tiredness][autonomy]++;
+void LOSMUniquenessIndex::grow()
+{
+	std::vector<unsigned long long> oldKeys;
+	std::vector<unsigned int> oldCounters;
+	oldKeys.swap(keys);
+	oldCounters.swap(counters);
 
-	distance = travelDistance;
-	speedLimit = travelSpeedLimit;
-	isGoal = isGoalState;
-	isAutonomyCapable = isAutonomyCapableState;
+	size_t capacity = std::max((size_t)UNIQUENESS_INITIAL_CAPACITY, 2 * oldKeys.size());
+	keys.assign(capacity, 0);
+	counters.assign(capacity, 0);
 
-	currentStep = currentStepNode;
-	previousStep = previousStepNode;
+	size_t mask = capacity - 1;
+	for (size_t i = 0; i < oldKeys.size(); i++) {
+		if (oldKeys[i] == 0) {
+			continue;
+		}
+
+		size_t slot = (size_t)((oldKeys[i] * 11400714819323198485ull) >> 32) & mask;
+		while (keys[slot] != 0) {
+			slot = (slot + 1) & mask;
+		}
+
+		keys[slot] = oldKeys[i];
+		counters[slot] = oldCounters[i];
+	}
+}
+
+LOSMState::LOSMState(const LOSMStateTable *stateTable, unsigned int stateIndex)
+{
+	// Note: Each model numbers its own states, so the index from IndexedState's shared counter is replaced.
+	index = stateIndex;
+	table = stateTable;
 }
 
 LOSMState::LOSMState(const LOSMState &other)
@@ -66,62 +128,57 @@ LOSMState::~LOSMState()
 
 const LOSMNode *LOSMState::get_current() const
 {
-	return current;
+	return table->get_node(table->get_current(index));
 }
 
 const LOSMNode *LOSMState::get_previous() const
 {
-	return previous;
+	return table->get_node(table->get_previous(index));
 }
 
 unsigned int LOSMState::get_tiredness() const
 {
-	return tiredness;
+	return table->get_tiredness(index);
 }
 
 bool LOSMState::get_autonomy() const
 {
-	return autonomy;
+	return table->get_autonomy(index);
 }
 
 unsigned int LOSMState::get_uniqueness_index() const
 {
-	return uniquenessIndex;
-}
-
-void LOSMState::reset_uniqueness_counters()
-{
-	uniquenessCounter.clear();
+	return table->get_uniqueness_index(index);
 }
 
 float LOSMState::get_distance() const
 {
-	return distance;
+	return table->get_distance(index);
 }
 
 float LOSMState::get_speed_limit() const
 {
-	return speedLimit;
+	return table->get_speed_limit(index);
 }
 
 bool LOSMState::is_goal() const
 {
-	return isGoal;
+	return table->is_goal(index);
 }
 
 bool LOSMState::is_autonomy_capable() const
 {
-	return isAutonomyCapable;
+	return table->is_autonomy_capable(index);
 }
 
 const LOSMNode *LOSMState::get_current_step() const
 {
-	return currentStep;
+	return table->get_node(table->get_current_step(index));
 }
 
 const LOSMNode *LOSMState::get_previous_step() const
 {
-	return previousStep;
+	return table->get_node(table->get_previous_step(index));
 }
 
 State &LOSMState::operator=(const State &other)
@@ -133,19 +190,7 @@ State &LOSMState::operator=(const State &other)
 	}
 
 	index = state->index;
-
-	current = state->current;
-	previous = state->previous;
-
-	tiredness = state->tiredness;
-	autonomy = state->autonomy;
-	distance = state->distance;
-	speedLimit = state->speedLimit;
-	isGoal = state->isGoal;
-	isAutonomyCapable = state->isAutonomyCapable;
-
-	currentStep = state->currentStep;
-	previousStep = state->previousStep;
+	table = state->table;
 
 	return *this;
 }
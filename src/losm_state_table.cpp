@@ -0,0 +1,201 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/losm_state_table.h"
+
+#include "../../librbr/librbr/include/core/states/state_exception.h"
+
+#include <iostream>
+
+// The bits of the packed flags of a state.
+#define LOSM_TIREDNESS_MASK 0x07
+#define LOSM_AUTONOMY_FLAG 0x08
+#define LOSM_GOAL_FLAG 0x10
+#define LOSM_AUTONOMY_CAPABLE_FLAG 0x20
+
+LOSMStateTable::LOSMStateTable()
+{
+	m = 0;
+}
+
+LOSMStateTable::~LOSMStateTable()
+{ }
+
+LOSMState *LOSMStateTable::add(const LOSMNode *currentNode, const LOSMNode *previousNode, unsigned int tirednessLevel,
+		bool autonomyEnabled, float travelDistance, float travelSpeedLimit,
+		bool isGoalState, bool isAutonomyCapableState,
+		const LOSMNode *currentStepNode, const LOSMNode *previousStepNode,
+		unsigned int uniquenessIndex)
+{
+	if (tirednessLevel > LOSM_TIREDNESS_MASK) {
+		std::cerr << "Failed to add the state to the LOSM state table." << std::endl;
+		throw StateException();
+	}
+
+	current.push_back(index_node(currentNode));
+	previous.push_back(index_node(previousNode));
+	currentStep.push_back(index_node(currentStepNode));
+	previousStep.push_back(index_node(previousStepNode));
+
+	unsigned char stateFlags = (unsigned char)tirednessLevel;
+	if (autonomyEnabled) {
+		stateFlags |= LOSM_AUTONOMY_FLAG;
+	}
+	if (isGoalState) {
+		stateFlags |= LOSM_GOAL_FLAG;
+	}
+	if (isAutonomyCapableState) {
+		stateFlags |= LOSM_AUTONOMY_CAPABLE_FLAG;
+	}
+	flags.push_back(stateFlags);
+
+	uniqueness.push_back(uniquenessIndex);
+	distance.push_back(travelDistance);
+	speedLimit.push_back(travelSpeedLimit);
+
+	states.push_back(new LOSMState(this, (unsigned int)states.size()));
+
+	return states.back();
+}
+
+void LOSMStateTable::clear()
+{
+	nodes.clear();
+	nodeIndexes.clear();
+	states.clear();
+	current.clear();
+	previous.clear();
+	currentStep.clear();
+	previousStep.clear();
+	flags.clear();
+	uniqueness.clear();
+	distance.clear();
+	speedLimit.clear();
+	m = 0;
+	successors.clear();
+}
+
+unsigned int LOSMStateTable::get_num_states() const
+{
+	return (unsigned int)states.size();
+}
+
+unsigned int LOSMStateTable::get_num_nodes() const
+{
+	return (unsigned int)nodes.size();
+}
+
+const LOSMNode *LOSMStateTable::get_node(unsigned int node) const
+{
+	return nodes[node];
+}
+
+LOSMState *LOSMStateTable::get_state(unsigned int state) const
+{
+	return states[state];
+}
+
+unsigned int LOSMStateTable::get_current(unsigned int state) const
+{
+	return current[state];
+}
+
+unsigned int LOSMStateTable::get_previous(unsigned int state) const
+{
+	return previous[state];
+}
+
+unsigned int LOSMStateTable::get_current_step(unsigned int state) const
+{
+	return currentStep[state];
+}
+
+unsigned int LOSMStateTable::get_previous_step(unsigned int state) const
+{
+	return previousStep[state];
+}
+
+unsigned int LOSMStateTable::get_tiredness(unsigned int state) const
+{
+	return flags[state] & LOSM_TIREDNESS_MASK;
+}
+
+bool LOSMStateTable::get_autonomy(unsigned int state) const
+{
+	return (flags[state] & LOSM_AUTONOMY_FLAG) != 0;
+}
+
+bool LOSMStateTable::is_goal(unsigned int state) const
+{
+	return (flags[state] & LOSM_GOAL_FLAG) != 0;
+}
+
+bool LOSMStateTable::is_autonomy_capable(unsigned int state) const
+{
+	return (flags[state] & LOSM_AUTONOMY_CAPABLE_FLAG) != 0;
+}
+
+unsigned int LOSMStateTable::get_uniqueness_index(unsigned int state) const
+{
+	return uniqueness[state];
+}
+
+float LOSMStateTable::get_distance(unsigned int state) const
+{
+	return distance[state];
+}
+
+float LOSMStateTable::get_speed_limit(unsigned int state) const
+{
+	return speedLimit[state];
+}
+
+void LOSMStateTable::initialize_successors(unsigned int numActions)
+{
+	m = numActions;
+	successors.assign((size_t)states.size() * m, LOSM_NO_SUCCESSOR);
+}
+
+void LOSMStateTable::set_successor(unsigned int state, unsigned int action, unsigned int successor)
+{
+	successors[(size_t)state * m + action] = successor;
+}
+
+unsigned int LOSMStateTable::get_successor(unsigned int state, unsigned int action) const
+{
+	if (state >= states.size() || action >= m || successors[(size_t)state * m + action] == LOSM_NO_SUCCESSOR) {
+		throw StateException();
+	}
+
+	return successors[(size_t)state * m + action];
+}
+
+unsigned int LOSMStateTable::index_node(const LOSMNode *node)
+{
+	auto result = nodeIndexes.emplace(node, (unsigned int)nodes.size());
+	if (result.second) {
+		nodes.push_back(node);
+	}
+	return result.first->second;
+}
@@ -0,0 +1,628 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/lpbpi.h"
+
+#include "../../librbr/librbr/include/core/rewards/sa_rewards.h"
+
+#include "../../librbr/librbr/include/core/rewards/reward_exception.h"
+#include "../../librbr/librbr/include/core/policy/policy_exception.h"
+
+#include "../../librbr/librbr/include/core/actions/action_utilities.h"
+
+#include <iostream>
+
+#include <math.h>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include <chrono>
+
+LPBPI::LPBPI() : LPBVI()
+{
+	improvements = 10;
+	maxEvaluationSweeps = 100000;
+	evaluationTolerance = 0.000001;
+}
+
+LPBPI::LPBPI(POMDPPBVIExpansionRule expansionRule, unsigned int updateIterations,
+		unsigned int expansionIterations) : LPBVI(expansionRule, updateIterations, expansionIterations)
+{
+	improvements = 10;
+	maxEvaluationSweeps = 100000;
+	evaluationTolerance = 0.000001;
+}
+
+LPBPI::~LPBPI()
+{ }
+
+void LPBPI::set_num_improvement_iterations(unsigned int iterations)
+{
+	improvements = std::max(1u, iterations);
+}
+
+unsigned int LPBPI::get_num_improvement_iterations() const
+{
+	return improvements;
+}
+
+void LPBPI::set_max_evaluation_sweeps(unsigned int sweeps)
+{
+	maxEvaluationSweeps = std::max(1u, sweeps);
+}
+
+unsigned int LPBPI::get_max_evaluation_sweeps() const
+{
+	return maxEvaluationSweeps;
+}
+
+PolicyAlphaVectors **LPBPI::solve_infinite_horizon(StatesMap *S, ActionsMap *A,
+		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+		FactoredRewards *R, Horizon *h, std::vector<float> &delta)
+{
+	// Checkpoints are only written and resumed by the value iteration solver.
+	if (!resumeFilename.empty()) {
+		throw PolicyException();
+	}
+
+	unsigned int k = R->get_num_rewards();
+
+	// The final set of alpha vectors, from the last completed expansion.
+	PolicyAlphaVectors **policy = nullptr;
+
+	// Initialize the set of belief points to be the initial set. This must be a copy, since memory is managed
+	// for both objects independently.
+	for (BeliefState *b : initialB) {
+		B.push_back(new BeliefState(*b));
+	}
+	beliefCache.revalidate();
+
+	std::cout << "Initial Num Belief Points: " << initialB.size() << std::endl; std::cout.flush();
+
+	if (beliefToRecord != nullptr) {
+		recordedValues.clear();
+		recordedValues.resize(k);
+	}
+
+	// The model of each action is over the states in the order of the belief cache, so it is created once the
+	// cache has been updated for the first time.
+	std::unordered_map<Action *, LPBVIActionModel> models;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::cout << "Starting (Policy Iteration)...\n"; std::cout.flush();
+
+	// Whether the time limit passed or the solve was cancelled.
+	bool stopped = false;
+
+	for (unsigned int e = 0; e < expansions; e++) {
+		std::cout << "Expansion " << (e + 1) << std::endl;
+
+		beliefCache.update(get_model_identity(), S, Z, T, O, B);
+		if (models.empty()) {
+			create_action_models(A, O, R, models);
+		}
+
+		// All actions are available to start, and are restricted by each value function in turn.
+		std::map<BeliefState *, std::vector<Action *> > Ai;
+		for (BeliefState *b : B) {
+			for (auto a : *A) {
+				Ai[b].push_back(resolve(a));
+			}
+		}
+
+		double deltaB = compute_belief_density(S);
+
+		PolicyAlphaVectors **expansionPolicy = new PolicyAlphaVectors*[k];
+		for (unsigned int i = 0; i < k; i++) {
+			expansionPolicy[i] = new PolicyAlphaVectors(h->get_horizon());
+		}
+
+		for (unsigned int i = 0; i < k; i++) {
+			std::cout << "  R[" << i << "]" << std::endl; std::cout.flush();
+
+			// Note: This transfers the responsibility of memory management to the PolicyAlphaVectors object.
+			expansionPolicy[i]->set(compute_objective_policy_iteration(h, models, i, Ai, stopped));
+
+			// If there is already a consistent policy, then this expansion's partial one is discarded.
+			if (stopped && policy != nullptr) {
+				break;
+			}
+
+			if (!stopped) {
+				snapshot_value_functions(expansionPolicy, i + 1, k);
+			}
+
+			// Restrict the set of actions available to each belief point in the next i+1 value function.
+			if (i < k - 1) {
+				restrict_actions(expansionPolicy[i], compute_slack(dynamic_cast<SARewards *>(R->get(i)), h, delta[i], deltaB),
+						B.size(), Ai, numThreads);
+			}
+		}
+
+		if (stopped && policy != nullptr) {
+			for (unsigned int i = 0; i < k; i++) {
+				delete expansionPolicy[i];
+			}
+			delete [] expansionPolicy;
+			break;
+		}
+
+		// This expansion is complete, so its policy replaces the last one.
+		if (policy != nullptr) {
+			for (unsigned int i = 0; i < k; i++) {
+				delete policy[i];
+			}
+			delete [] policy;
+		}
+		policy = expansionPolicy;
+
+		if (snapshotCallback) {
+			snapshotCallback(policy, k, false);
+		}
+
+		if (stopped || is_stop_requested()) {
+			break;
+		}
+
+		if (e < expansions - 1) {
+			if (rule == POMDPPBVIExpansionRule::NONE) {
+				break;
+			}
+			expand_belief_points(S, A, Z, T, O, policy[k - 1]);
+		}
+	}
+
+	// Handle the trivial case in which there were no expansions.
+	if (policy == nullptr) {
+		policy = new PolicyAlphaVectors*[k];
+		for (unsigned int i = 0; i < k; i++) {
+			policy[i] = new PolicyAlphaVectors(h->get_horizon());
+		}
+	}
+
+	std::cout << "Complete LPBPI." << std::endl; std::cout.flush();
+
+	// After the main loop is complete, end timing. Also, output the result of the computation time.
+	auto end = std::chrono::high_resolution_clock::now();
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+	std::cout << "Total Elapsed Time (Policy Iteration Version): " << ((double)elapsed.count() / 1000.0) << std::endl; std::cout.flush();
+
+	return policy;
+}
+
+void LPBPI::create_action_models(ActionsMap *A, ObservationTransitions *O, FactoredRewards *R,
+		std::unordered_map<Action *, LPBVIActionModel> &models)
+{
+	const std::vector<State *> &states = beliefCache.get_states();
+	const std::vector<Observation *> &observations = beliefCache.get_observations();
+
+	unsigned int k = R->get_num_rewards();
+	unsigned int n = states.size();
+	unsigned int z = observations.size();
+
+	std::vector<SARewards *> Rs;
+	for (unsigned int i = 0; i < k; i++) {
+		SARewards *Ri = dynamic_cast<SARewards *>(R->get(i));
+		if (Ri == nullptr) {
+			throw RewardException();
+		}
+		Rs.push_back(Ri);
+	}
+
+	for (auto a : *A) {
+		Action *action = resolve(a);
+		LPBVIActionModel &model = models[action];
+
+		const std::vector<LPBVISparseBelief> &next = beliefCache.get_state_successors(action);
+		model.successors.resize(n);
+		for (unsigned int s = 0; s < n; s++) {
+			for (const std::pair<State *, double> &sp : next[s]) {
+				model.successors[s].push_back(std::make_pair(beliefCache.get_state_index(sp.first), sp.second));
+			}
+		}
+
+		model.observationProbabilities.resize((size_t)n * z);
+		for (unsigned int sp = 0; sp < n; sp++) {
+			for (unsigned int o = 0; o < z; o++) {
+				model.observationProbabilities[sp * z + o] = O->get(action, states[sp], observations[o]);
+			}
+		}
+
+		model.rewards.resize((size_t)k * n);
+		for (unsigned int i = 0; i < k; i++) {
+			for (unsigned int s = 0; s < n; s++) {
+				model.rewards[i * n + s] = Rs[i]->get(states[s], action);
+			}
+		}
+	}
+}
+
+std::vector<PolicyAlphaVector *> LPBPI::compute_objective_policy_iteration(Horizon *h,
+		const std::unordered_map<Action *, LPBVIActionModel> &models, unsigned int i,
+		const std::map<BeliefState *, std::vector<Action *> > &Ai, bool &stopped)
+{
+	unsigned int n = beliefCache.get_states().size();
+	unsigned int z = beliefCache.get_observations().size();
+
+	// The controller starts with a single node without an action, which has the zero alpha vector, as in value
+	// iteration. The first improvement adds the nodes of the belief points, which follow it.
+	std::vector<double> gamma(n, 0.0);
+	std::vector<Action *> actions(1, nullptr);
+	std::vector<unsigned int> nodes(z, 0);
+
+	for (unsigned int u = 0; u < improvements; u++) {
+		// Check for a stop at each improvement boundary, always allowing one so that the controller is usable.
+		if (u > 0 && (stopped || is_stop_requested())) {
+			if (!stopped) {
+				std::cout << "Stopping early." << std::endl; std::cout.flush();
+			}
+			stopped = true;
+			break;
+		}
+
+		if (!improve_controller(h, models, i, Ai, gamma, actions, nodes)) {
+			std::cout << "    Converged after " << u << " Improvements" << std::endl; std::cout.flush();
+			break;
+		}
+
+		unsigned int sweeps = evaluate_controller(h, models, i, actions, nodes, gamma);
+
+		std::cout << "    " << (u + 1) << " / " << improvements << " (" << actions.size() << " Nodes, " <<
+				sweeps << " Evaluation Sweeps)" << std::endl; std::cout.flush();
+
+		// If we are recording values, compute the belief value here.
+		if (beliefToRecord != nullptr) {
+			std::vector<PolicyAlphaVector *> gammaRecord = create_alpha_vectors(gamma, actions);
+			record_value(i, gammaRecord);
+			for (PolicyAlphaVector *alpha : gammaRecord) {
+				delete alpha;
+			}
+		}
+	}
+
+	return create_alpha_vectors(gamma, actions);
+}
+
+bool LPBPI::improve_controller(Horizon *h, const std::unordered_map<Action *, LPBVIActionModel> &models,
+		unsigned int i, const std::map<BeliefState *, std::vector<Action *> > &Ai, std::vector<double> &gamma,
+		std::vector<Action *> &actions, std::vector<unsigned int> &nodes)
+{
+	unsigned int r = B.size();
+	unsigned int n = beliefCache.get_states().size();
+	unsigned int z = beliefCache.get_observations().size();
+	unsigned int numNodes = actions.size();
+	double discount = h->get_discount_factor();
+
+	// For each belief point: its best available node, and its backup if that improves on it (otherwise, the
+	// backup's action is null).
+	std::vector<unsigned int> beliefNodes(r, 0);
+	std::vector<Action *> backupActions(r, nullptr);
+	std::vector<unsigned int> backupNodes((size_t)r * z, 0);
+
+	// Each worker only writes the backups of its own partition of belief points, but they all read the controller.
+	execute_in_parallel(r, [&](unsigned int worker, unsigned int first, unsigned int last) {
+		std::vector<unsigned int> successorNodes(z, 0);
+		std::vector<unsigned int> maxSuccessorNodes(z, 0);
+		std::vector<std::pair<unsigned int, double> > tau;
+
+		for (unsigned int j = first; j < last; j++) {
+			const LPBVISparseBelief &b = beliefCache.get_belief(j);
+			const std::vector<Action *> &available = Ai.at(B[j]);
+
+			bool found = false;
+			double currentValue = 0.0;
+			for (unsigned int l = 0; l < numNodes; l++) {
+				if (std::find(available.begin(), available.end(), actions[l]) == available.end()) {
+					continue;
+				}
+
+				double nodeValue = 0.0;
+				for (const std::pair<State *, double> &s : b) {
+					nodeValue += s.second * gamma[(size_t)l * n + beliefCache.get_state_index(s.first)];
+				}
+
+				if (!found || nodeValue > currentValue) {
+					beliefNodes[j] = l;
+					currentValue = nodeValue;
+					found = true;
+				}
+			}
+
+			Action *maxAction = nullptr;
+			double maxValue = 0.0;
+
+			for (Action *action : available) {
+				const LPBVIActionModel &model = models.at(action);
+				const std::vector<LPBVIBeliefSuccessor> &successors = beliefCache.get_successors(j, action);
+
+				double value = 0.0;
+				for (const std::pair<State *, double> &s : b) {
+					value += s.second * model.rewards[i * n + beliefCache.get_state_index(s.first)];
+				}
+
+				// For each observation, follow the node whose alpha vector is maximal at tau(b, a, z). If the
+				// observation is impossible, the first node is followed, since it does not matter.
+				for (unsigned int o = 0; o < z; o++) {
+					successorNodes[o] = 0;
+					if (successors[o].probability <= 0.0) {
+						continue;
+					}
+
+					tau.clear();
+					for (const std::pair<State *, double> &sp : successors[o].belief) {
+						tau.push_back(std::make_pair(beliefCache.get_state_index(sp.first), sp.second));
+					}
+
+					double maxNodeValue = 0.0;
+					for (unsigned int l = 0; l < numNodes; l++) {
+						double nodeValue = 0.0;
+						for (const std::pair<unsigned int, double> &sp : tau) {
+							nodeValue += sp.second * gamma[(size_t)l * n + sp.first];
+						}
+
+						if (l == 0 || nodeValue > maxNodeValue) {
+							successorNodes[o] = l;
+							maxNodeValue = nodeValue;
+						}
+					}
+
+					value += discount * successors[o].probability * maxNodeValue;
+				}
+
+				if (maxAction == nullptr || value > maxValue) {
+					maxAction = action;
+					maxValue = value;
+					maxSuccessorNodes.swap(successorNodes);
+				}
+			}
+
+			// An improvement within the evaluation tolerance is only its error, and ties keep the current node, so
+			// that the iteration terminates once no node can be improved.
+			if (maxAction == nullptr || (found && maxValue <= currentValue + evaluationTolerance)) {
+				continue;
+			}
+
+			backupActions[j] = maxAction;
+			for (unsigned int o = 0; o < z; o++) {
+				backupNodes[(size_t)j * z + o] = maxSuccessorNodes[o];
+			}
+		}
+	});
+
+	// Add each backup as a new node, unless it already is one. Its alpha vector is the backup over the current
+	// alpha vectors, which both starts its evaluation and finds the current nodes it pointwise dominates. Each of
+	// those is replaced by it: their links follow the new node instead, which can only improve their values.
+	std::vector<unsigned int> replacements(numNodes, 0);
+	for (unsigned int l = 0; l < numNodes; l++) {
+		replacements[l] = l;
+	}
+
+	bool changed = false;
+
+	for (unsigned int j = 0; j < r; j++) {
+		if (backupActions[j] == nullptr) {
+			continue;
+		}
+
+		const unsigned int *successorNodes = &backupNodes[(size_t)j * z];
+
+		unsigned int node = 0;
+		while (node < actions.size() && (actions[node] != backupActions[j] ||
+				!std::equal(successorNodes, successorNodes + z, nodes.begin() + (size_t)node * z))) {
+			node++;
+		}
+
+		if (node == actions.size()) {
+			actions.push_back(backupActions[j]);
+			nodes.insert(nodes.end(), successorNodes, successorNodes + z);
+			gamma.resize(gamma.size() + n, 0.0);
+			backup_node(h, models, i, backupActions[j], successorNodes, gamma, &gamma[(size_t)node * n]);
+			changed = true;
+
+			for (unsigned int l = 0; l < numNodes; l++) {
+				if (replacements[l] != l) {
+					continue;
+				}
+
+				bool dominated = true;
+				for (unsigned int s = 0; s < n && dominated; s++) {
+					dominated = (gamma[(size_t)node * n + s] >= gamma[(size_t)l * n + s]);
+				}
+				if (dominated) {
+					replacements[l] = node;
+				}
+			}
+		}
+
+		beliefNodes[j] = node;
+	}
+
+	if (!changed) {
+		return false;
+	}
+
+	// Every link is to a current node, since the new nodes' links are from the backups over them.
+	for (unsigned int &successor : nodes) {
+		successor = replacements[successor];
+	}
+	for (unsigned int &node : beliefNodes) {
+		if (node < numNodes) {
+			node = replacements[node];
+		}
+	}
+
+	// Prune the nodes which the belief points' nodes no longer reach, and keep the rest in order.
+	std::vector<unsigned char> reached(actions.size(), 0);
+	std::vector<unsigned int> frontier;
+	for (unsigned int node : beliefNodes) {
+		if (!reached[node]) {
+			reached[node] = 1;
+			frontier.push_back(node);
+		}
+	}
+	while (!frontier.empty()) {
+		unsigned int node = frontier.back();
+		frontier.pop_back();
+
+		for (unsigned int o = 0; o < z; o++) {
+			unsigned int successor = nodes[(size_t)node * z + o];
+			if (!reached[successor]) {
+				reached[successor] = 1;
+				frontier.push_back(successor);
+			}
+		}
+	}
+
+	std::vector<unsigned int> indexes(actions.size(), 0);
+	unsigned int numReached = 0;
+	for (unsigned int l = 0; l < actions.size(); l++) {
+		if (!reached[l]) {
+			continue;
+		}
+
+		indexes[l] = numReached;
+		actions[numReached] = actions[l];
+		std::copy(gamma.begin() + (size_t)l * n, gamma.begin() + (size_t)(l + 1) * n, gamma.begin() + (size_t)numReached * n);
+		std::copy(nodes.begin() + (size_t)l * z, nodes.begin() + (size_t)(l + 1) * z, nodes.begin() + (size_t)numReached * z);
+		numReached++;
+	}
+
+	actions.resize(numReached);
+	gamma.resize((size_t)numReached * n);
+	nodes.resize((size_t)numReached * z);
+
+	for (unsigned int &successor : nodes) {
+		successor = indexes[successor];
+	}
+
+	return true;
+}
+
+void LPBPI::backup_node(Horizon *h, const std::unordered_map<Action *, LPBVIActionModel> &models,
+		unsigned int i, Action *action, const unsigned int *successorNodes, const std::vector<double> &gamma,
+		double *alpha) const
+{
+	unsigned int n = beliefCache.get_states().size();
+	unsigned int z = beliefCache.get_observations().size();
+	double discount = h->get_discount_factor();
+
+	// The controller is fixed, so this is linear: alpha(s) = R(s, a) + gamma sum_{s'} T(s, a, s') sum_{z}
+	// O(a, s', z) alpha_{eta(z)}(s').
+	const LPBVIActionModel &model = models.at(action);
+
+	for (unsigned int s = 0; s < n; s++) {
+		double value = model.rewards[i * n + s];
+
+		for (const std::pair<unsigned int, double> &sp : model.successors[s]) {
+			double future = 0.0;
+			for (unsigned int o = 0; o < z; o++) {
+				double probability = model.observationProbabilities[(size_t)sp.first * z + o];
+				if (probability > 0.0) {
+					future += probability * gamma[(size_t)successorNodes[o] * n + sp.first];
+				}
+			}
+			value += discount * sp.second * future;
+		}
+
+		alpha[s] = value;
+	}
+}
+
+unsigned int LPBPI::evaluate_controller(Horizon *h, const std::unordered_map<Action *, LPBVIActionModel> &models,
+		unsigned int i, const std::vector<Action *> &actions, const std::vector<unsigned int> &nodes,
+		std::vector<double> &gamma)
+{
+	unsigned int numNodes = actions.size();
+	unsigned int n = beliefCache.get_states().size();
+	unsigned int z = beliefCache.get_observations().size();
+
+	// Each sweep backs up every node over the previous sweep's alpha vectors. It starts from the previous
+	// controller's, which are close to the new ones; a new node starts from its backup.
+	std::vector<double> next(gamma.size(), 0.0);
+
+	// The largest change of any value, for each worker.
+	std::vector<double> residuals(std::max(1u, numThreads), 0.0);
+	double residual = 0.0;
+
+	unsigned int sweeps = 0;
+	while (sweeps < maxEvaluationSweeps) {
+		std::fill(residuals.begin(), residuals.end(), 0.0);
+
+		execute_in_parallel(numNodes, [&](unsigned int worker, unsigned int first, unsigned int last) {
+			for (unsigned int l = first; l < last; l++) {
+				double *alpha = &next[(size_t)l * n];
+
+				// The node without an action keeps the zero alpha vector.
+				if (actions[l] == nullptr) {
+					std::fill(alpha, alpha + n, 0.0);
+					continue;
+				}
+
+				backup_node(h, models, i, actions[l], &nodes[(size_t)l * z], gamma, alpha);
+
+				for (unsigned int s = 0; s < n; s++) {
+					residuals[worker] = std::max(residuals[worker], fabs(alpha[s] - gamma[(size_t)l * n + s]));
+				}
+			}
+		});
+
+		gamma.swap(next);
+		sweeps++;
+
+		residual = *std::max_element(residuals.begin(), residuals.end());
+		if (residual < evaluationTolerance) {
+			return sweeps;
+		}
+	}
+
+	std::cout << "    Evaluation stopped at the maximum of " << maxEvaluationSweeps << " sweeps (Residual: " <<
+			residual << ")" << std::endl; std::cout.flush();
+
+	return sweeps;
+}
+
+std::vector<PolicyAlphaVector *> LPBPI::create_alpha_vectors(const std::vector<double> &gamma,
+		const std::vector<Action *> &actions) const
+{
+	const std::vector<State *> &states = beliefCache.get_states();
+	unsigned int n = states.size();
+
+	std::vector<PolicyAlphaVector *> result;
+	for (unsigned int l = 0; l < actions.size(); l++) {
+		// The node without an action is not part of the policy; each belief point's node has one.
+		if (actions[l] == nullptr) {
+			continue;
+		}
+
+		PolicyAlphaVector *alpha = new PolicyAlphaVector(actions[l]);
+		for (unsigned int s = 0; s < n; s++) {
+			alpha->set(states[s], gamma[(size_t)l * n + s]);
+		}
+		result.push_back(alpha);
+	}
+
+	return result;
+}
@@ -25,13 +25,16 @@
 #include <unistd.h>
 
 #include "../include/lpbvi.h"
+#include "../include/lpomdp_sparse_state_transitions.h"
 
 #include "../../librbr/librbr/include/pomdp/pomdp_utilities.h"
 
 #include "../../librbr/librbr/include/management/conversion.h"
 
 #include "../../librbr/librbr/include/core/state_transitions/state_transitions_array.h"
+#include "../../librbr/librbr/include/core/observation_transitions/observation_transitions_array.h"
 #include "../../librbr/librbr/include/core/rewards/sas_rewards_array.h"
+#include "../../librbr/librbr/include/core/rewards/sa_rewards_array.h"
 
 #include "../../librbr/librbr/include/core/core_exception.h"
 #include "../../librbr/librbr/include/core/states/state_exception.h"
@@ -52,11 +55,24 @@
 #include <algorithm>
 
 #include <chrono>
+#include <thread>
+#include <exception>
 
 LPBVI::LPBVI() : POMDPPBVI()
 {
 	beliefToRecord = nullptr;
 	constrainEta = false;
+	numThreads = 1;
+	numa = false;
+	numaPlacedBeliefs = 0;
+	evaluationTolerance = 0.0;
+	timeLimit = 0.0;
+	cancellationToken = nullptr;
+	expansionSeed = 0;
+	checkpointInterval = 1;
+	pipelined = false;
+	speculative = false;
+	activeSession = nullptr;
 }
 
 LPBVI::LPBVI(POMDPPBVIExpansionRule expansionRule, unsigned int updateIterations,
@@ -64,6 +80,17 @@ LPBVI::LPBVI(POMDPPBVIExpansionRule expansionRule, unsigned int updateIterations
 {
 	beliefToRecord = nullptr;
 	constrainEta = false;
+	numThreads = 1;
+	numa = false;
+	numaPlacedBeliefs = 0;
+	evaluationTolerance = 0.0;
+	timeLimit = 0.0;
+	cancellationToken = nullptr;
+	expansionSeed = 0;
+	checkpointInterval = 1;
+	pipelined = false;
+	speculative = false;
+	activeSession = nullptr;
 }
 
 LPBVI::~LPBVI()
@@ -123,6 +150,62 @@ void LPBVI::eta_constraint(bool value)
 	constrainEta = value;
 }
 
+void LPBVI::set_num_threads(unsigned int threads)
+{
+	numThreads = std::max(1u, threads);
+}
+
+unsigned int LPBVI::get_num_threads() const
+{
+	return numThreads;
+}
+
+void LPBVI::numa_mode(bool value)
+{
+	numa = value;
+}
+
+void LPBVI::set_evaluation_tolerance(double epsilon)
+{
+	evaluationTolerance = std::max(0.0, epsilon);
+}
+
+void LPBVI::set_expansion_seed(unsigned int seed)
+{
+	expansionSeed = seed;
+}
+
+void LPBVI::pipelining(bool value)
+{
+	pipelined = value;
+}
+
+void LPBVI::speculative_mode(bool value)
+{
+	speculative = value;
+}
+
+void LPBVI::set_time_limit(double seconds)
+{
+	timeLimit = std::max(0.0, seconds);
+}
+
+void LPBVI::set_cancellation_token(LPBVICancellationToken *token)
+{
+	cancellationToken = token;
+}
+
+void LPBVI::set_snapshot_callback(LPBVISnapshotCallback snapshot)
+{
+	snapshotCallback = snapshot;
+}
+
+void LPBVI::set_checkpoint(std::string filename, unsigned int interval)
+{
+	checkpointFilename = filename;
+	checkpointInterval = std::max(1u, interval);
+}
+
 PolicyAlphaVectors *LPBVI::solve(POMDP *pomdp)
 {
 	throw CoreException();
@@ -135,68 +218,76 @@ PolicyAlphaVectors **LPBVI::solve(LPOMDP *lpomdp)
 		return nullptr;
 	}
 
-	// Attempt to convert the states object into FiniteStates.
-	StatesMap *S = dynamic_cast<StatesMap *>(lpomdp->get_states());
-	if (S == nullptr) {
-		throw StateException();
-	}
+	// A single solve is a session of one call, so nothing it precomputes outlives it.
+	LPBVISession session(this, lpomdp);
+	return solve(&session);
+}
 
-	// Attempt to convert the actions object into FiniteActions.
-	ActionsMap *A = dynamic_cast<ActionsMap *>(lpomdp->get_actions());
-	if (A == nullptr) {
-		throw ActionException();
+PolicyAlphaVectors **LPBVI::solve(LPBVISession *session)
+{
+	// Handle the trivial case.
+	if (session == nullptr) {
+		return nullptr;
 	}
-
-	// Attempt to convert the observations object into FiniteObservations.
-	ObservationsMap *Z = dynamic_cast<ObservationsMap *>(lpomdp->get_observations());
-	if (Z == nullptr) {
-		throw ObservationException();
+	if (session->get_solver() != this) {
+		throw PolicyException();
 	}
 
-	// Attempt to get the state transitions.
-	StateTransitions *T = lpomdp->get_state_transitions();
-	if (T == nullptr) {
-		throw StateTransitionException();
-	}
+	// The time limit includes all of the setup within the solve, but not the session's.
+	solveStart = std::chrono::high_resolution_clock::now();
 
-	// Attempt to get the observations transitions.
-	ObservationTransitions *O = lpomdp->get_observation_transitions();
-	if (O == nullptr) {
-		throw ObservationTransitionException();
-	}
+	// The slack is the only part of the LPOMDP which is read again for each solve.
+	std::vector<float> &delta = session->get_slack();
 
-	// Attempt to convert the rewards object into FactoredRewards. Also, ensure that the
-	// type of each element is SASRewards.
-	FactoredRewards *R = dynamic_cast<FactoredRewards *>(lpomdp->get_rewards());
-	if (R == nullptr) {
-		throw RewardException();
+	// The belief points of a previous solve are replaced by the initial set (or the checkpoint's).
+	for (BeliefState *b : B) {
+		delete b;
 	}
-	/*
-	for (int i = 0; i < R->get_num_rewards(); i++) {
-		SARewards *Ri = dynamic_cast<SARewards *>(R->get(i));
-		if (Ri == nullptr) {
-			throw RewardException();
-		}
+	B.clear();
+
+	activeSession = session;
+
+	PolicyAlphaVectors **policy = nullptr;
+	try {
+		policy = solve_infinite_horizon(session->get_states(), session->get_actions(), session->get_observations(),
+				session->get_state_transitions(), session->get_observation_transitions(), session->get_rewards(),
+				session->get_horizon(), delta);
+	} catch (...) {
+		activeSession = nullptr;
+		throw;
 	}
-	*/
 
-	// Handle the other trivial case in which the slack variables were incorrectly defined.
-	if (lpomdp->get_slack().size() != R->get_num_rewards()) {
-		throw RewardException();
-	}
-	for (int i = 0; i < (int)lpomdp->get_slack().size(); i++) {
-		if (lpomdp->get_slack().at(i) < 0.0) {
-			throw RewardException();
-		}
-	}
+	activeSession = nullptr;
 
-	// Obtain the horizon and return the correct value iteration.
-	Horizon *h = lpomdp->get_horizon();
-	if (h->is_finite()) {
-		throw CoreException();
+	return policy;
+}
+
+PolicyAlphaVectors **LPBVI::solve(LPOMDP *lpomdp, double seconds, LPBVICancellationToken *token,
+		LPBVISnapshotCallback snapshot)
+{
+	set_time_limit(seconds);
+	set_cancellation_token(token);
+	set_snapshot_callback(snapshot);
+
+	return solve(lpomdp);
+}
+
+PolicyAlphaVectors **LPBVI::resume(LPOMDP *lpomdp, std::string filename)
+{
+	// The file is only used by this solve, even if it fails.
+	resumeFilename = filename;
+
+	PolicyAlphaVectors **policy = nullptr;
+	try {
+		policy = solve(lpomdp);
+	} catch (...) {
+		resumeFilename.clear();
+		throw;
 	}
 
-	return solve_infinite_horizon(S, A, Z, T, O, R, h, lpomdp->get_slack());
+	resumeFilename.clear();
+
+	return policy;
 }
 
 PolicyAlphaVectors **LPBVI::compute_value(LPOMDP *lpomdp, PolicyAlphaVectors *policy)
@@ -206,110 +297,129 @@ PolicyAlphaVectors **LPBVI::compute_value(LPOMDP *lpomdp, PolicyAlphaVectors *po
 		return nullptr;
 	}
 
-	// Attempt to convert the states object into FiniteStates.
-	StatesMap *S = dynamic_cast<StatesMap *>(lpomdp->get_states());
-	if (S == nullptr) {
-		throw StateException();
-	}
+	LPBVISession session(this, lpomdp);
+	return compute_value(&session, policy);
+}
 
-	// Attempt to convert the actions object into FiniteActions.
-	ActionsMap *A = dynamic_cast<ActionsMap *>(lpomdp->get_actions());
-	if (A == nullptr) {
-		throw ActionException();
+PolicyAlphaVectors **LPBVI::compute_value(LPBVISession *session, PolicyAlphaVectors *policy)
+{
+	// Handle the trivial case.
+	if (session == nullptr) {
+		return nullptr;
 	}
-
-	// Attempt to convert the observations object into FiniteObservations.
-	ObservationsMap *Z = dynamic_cast<ObservationsMap *>(lpomdp->get_observations());
-	if (Z == nullptr) {
-		throw ObservationException();
+	if (session->get_solver() != this) {
+		throw PolicyException();
 	}
 
-	// Attempt to get the state transitions.
-	StateTransitions *T = lpomdp->get_state_transitions();
-	if (T == nullptr) {
-		throw StateTransitionException();
-	}
+	std::vector<float> &delta = session->get_slack();
 
-	// Attempt to get the observations transitions.
-	ObservationTransitions *O = lpomdp->get_observation_transitions();
-	if (O == nullptr) {
-		throw ObservationTransitionException();
-	}
+	activeSession = session;
 
-	// Attempt to convert the rewards object into FactoredRewards. Also, ensure that the
-	// type of each element is SASRewards.
-	FactoredRewards *R = dynamic_cast<FactoredRewards *>(lpomdp->get_rewards());
-	if (R == nullptr) {
-		throw RewardException();
-	}
-	/*
-	for (int i = 0; i < R->get_num_rewards(); i++) {
-		SARewards *Ri = dynamic_cast<SARewards *>(R->get(i));
-		if (Ri == nullptr) {
-			throw RewardException();
-		}
+	PolicyAlphaVectors **result = nullptr;
+	try {
+		result = compute_value_execute(session->get_states(), session->get_actions(), session->get_observations(),
+				session->get_state_transitions(), session->get_observation_transitions(), session->get_rewards(),
+				session->get_horizon(), delta, policy);
+	} catch (...) {
+		activeSession = nullptr;
+		throw;
 	}
-	*/
 
-	// Handle the other trivial case in which the slack variables were incorrectly defined.
-	if (lpomdp->get_slack().size() != R->get_num_rewards()) {
-		throw RewardException();
-	}
-	for (int i = 0; i < (int)lpomdp->get_slack().size(); i++) {
-		if (lpomdp->get_slack().at(i) < 0.0) {
-			throw RewardException();
-		}
-	}
+	activeSession = nullptr;
 
-	// Obtain the horizon and return the correct value iteration.
-	Horizon *h = lpomdp->get_horizon();
-	if (h->is_finite()) {
-		throw CoreException();
+	return result;
+}
+
+void LPBVI::release_session(LPBVISession *session)
+{
+	if (session->get_gamma_a_star() != nullptr) {
+		std::map<Action *, std::vector<PolicyAlphaVector *> > *gammaAStar = session->get_gamma_a_star();
+		session->set_gamma_a_star(nullptr);
+		free_gamma_a_star_sets(session->get_actions(), session->get_rewards(), gammaAStar);
 	}
 
-	return compute_value_execute(S, A, Z, T, O, R, h, lpomdp->get_slack(), policy);
+	session->get_action_models().clear();
+
+	// The belief points' successors are kept for the last session's model, whichever it was.
+	beliefCache.clear();
+
+	if (activeSession == session) {
+		activeSession = nullptr;
+	}
 }
 
 PolicyAlphaVectors **LPBVI::solve_infinite_horizon(StatesMap *S, ActionsMap *A,
 		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
 		FactoredRewards *R, Horizon *h, std::vector<float> &delta)
 {
-	// The final set of alpha vectors.
-	PolicyAlphaVectors **policy = new PolicyAlphaVectors*[R->get_num_rewards()];
-	for (int i = 0; i < (int)R->get_num_rewards(); i++) {
-		policy[i] = new PolicyAlphaVectors(h->get_horizon());
+	// If the expansions do not depend on the value functions, they may be pipelined with them. Checkpoints and
+	// the NUMA placement assume the sequential schedule below.
+	bool valueIndependent = (rule == POMDPPBVIExpansionRule::RANDOM_BELIEF_SELECTION ||
+			rule == POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_RANDOM_ACTION ||
+			rule == POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_EXPLORATORY_ACTION);
+	if (pipelined && valueIndependent && numThreads > 1 && !numa && expansions > 1 && R->get_num_rewards() > 1 &&
+			checkpointFilename.empty() && resumeFilename.empty()) {
+		return solve_infinite_horizon_pipelined(S, A, Z, T, O, R, h, delta);
 	}
 
-	// Initialize the set of belief points to be the initial set. This must be a copy, since memory is managed
-	// for both objects independently.
-	for (BeliefState *b : initialB) {
-		B.push_back(new BeliefState(*b));
-	}
+	// The final set of alpha vectors, from the last completed expansion. Each expansion computes a new set,
+	// which replaces it once all value functions are complete, so a stopped solve returns a consistent policy.
+	PolicyAlphaVectors **policy = nullptr;
 
-	std::cout << "Initial Num Belief Points: " << initialB.size() << std::endl; std::cout.flush();
+	// When resuming, the checkpoint's belief points replace the initial set, and it determines where each of
+	// the loops below begins.
+	LPBVICheckpoint checkpoint;
+	bool resuming = !resumeFilename.empty();
 
-	// Before anything, cache Gamma_{a, *} for all actions, but one for each R[i] now. This is used in every
-	// cross-sum computation, but it's alright that this doesn't depend on b and is over all actions, since we
-	// only ever use the ones with the action specified in the map. Since the inner loop only iterates over Ai[b]
-	// actions, it naturally restricts the actions.
-	std::map<Action *, std::vector<PolicyAlphaVector *> > *gammaAStar =
-			new std::map<Action *, std::vector<PolicyAlphaVector *> >[R->get_num_rewards()];
-	for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
-		SARewards *Ri = dynamic_cast<SARewards *>(R->get(i));
-		if (Ri == nullptr) {
-			throw RewardException();
+	if (resuming) {
+		if (checkpoint.load(resumeFilename, S, A)) {
+			throw PolicyException();
+		}
+		if (checkpoint.objective >= R->get_num_rewards()) {
+			std::cerr << "The checkpoint has more value functions than the LPOMDP." << std::endl;
+			throw PolicyException();
 		}
 
-		for (auto a : *A) {
-			Action *action = resolve(a);
-			gammaAStar[i][action].push_back(create_gamma_a_star(S, Z, T, O, Ri, action));
+		// The belief points are taken from the checkpoint; anything it still holds is freed with it, on any path.
+		B.insert(B.end(), checkpoint.B.begin(), checkpoint.B.end());
+		checkpoint.B.clear();
+		expansionSeed = checkpoint.expansionSeed;
+
+		std::cout << "Resuming Expansion " << (checkpoint.expansion + 1) << ", R[" << checkpoint.objective <<
+				"], Update " << checkpoint.update << std::endl; std::cout.flush();
+	} else {
+		// Initialize the set of belief points to be the initial set. This must be a copy, since memory is managed
+		// for both objects independently.
+		for (BeliefState *b : initialB) {
+			B.push_back(new BeliefState(*b));
 		}
 	}
 
+	// The successors cached by a previous solve of this session's model are reused for the belief points
+	// which are the same; anything else is invalidated by the first update of the cache.
+	beliefCache.revalidate();
+
+	std::cout << "Initial Num Belief Points: " << B.size() << std::endl; std::cout.flush();
+
+	// In NUMA mode, spread the model over the nodes and record the counters before any work is done.
+	if (numa) {
+		numa_place_model(S, A, Z, T, O, R);
+		numaWorkItems.assign(numaTopology.get_num_nodes(), 0);
+		numaPlacedBeliefs = 0;
+		numaTopology.get_counters(numaInitialCounters);
+	}
+
+	// Before anything, cache Gamma_{a, *} for all actions, but one for each R[i] now.
+	std::map<Action *, std::vector<PolicyAlphaVector *> > *gammaAStar = create_gamma_a_star_sets(S, A, Z, T, O, R);
+
 	// If we are recording a belief point's values, create the empty vector for each R[i].
 	if (beliefToRecord != nullptr) {
 		recordedValues.clear();
 		recordedValues.resize(R->get_num_rewards());
+
+		if (resuming && checkpoint.recordedValues.size() == R->get_num_rewards()) {
+			recordedValues = checkpoint.recordedValues;
+		}
 	}
 
 	// After setting up everything, begin timing.
@@ -317,23 +427,61 @@ PolicyAlphaVectors **LPBVI::solve_infinite_horizon(StatesMap *S, ActionsMap *A,
 
 	std::cout << "Starting...\n"; std::cout.flush();
 
+	// Whether the time limit passed or the solve was cancelled.
+	bool stopped = false;
+
 	// Perform a predefined number of expansions. Each update adds more belief points to the set B.
-	for (unsigned int e = 0; e < expansions; e++) {
+	for (unsigned int e = (resuming ? checkpoint.expansion : 0); e < expansions; e++) {
 		std::cout << "Expansion " << (e + 1) << std::endl;
 
+		// The set of alpha vectors computed by this expansion.
+		PolicyAlphaVectors **expansionPolicy = new PolicyAlphaVectors*[R->get_num_rewards()];
+		for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
+			expansionPolicy[i] = new PolicyAlphaVectors(h->get_horizon());
+		}
+
+		// The belief points may have changed, so place each partition on its node again.
+		numa_place_belief_points();
+
+		// Invalidate the cached successors of any belief points which changed. Each worker fills the slots of
+		// its partition during the first update, and the rest reuse them.
+		beliefCache.update(get_model_identity(), S, Z, T, O, B);
+
 		// Create the set of actions available, one for each belief point; it starts with all actions available.
+		// When resuming, it is the checkpoint's, which is already restricted by the completed value functions.
 		std::map<BeliefState *, std::vector<Action *> > Ai;
-		for (BeliefState *b : B) {
+		for (unsigned int j = 0; j < B.size(); j++) {
+			if (resuming) {
+				Ai[B[j]] = checkpoint.Ai[j];
+				continue;
+			}
 			for (auto a : *A) {
-				Ai[b].push_back(resolve(a));
+				Ai[B[j]].push_back(resolve(a));
+			}
+		}
+
+		// The alpha vectors of each completed value function in this expansion, which are kept for the
+		// checkpoints. These are owned by expansionPolicy.
+		std::vector<std::vector<PolicyAlphaVector *> > completed;
+		if (resuming) {
+			completed.swap(checkpoint.completed);
+			for (unsigned int i = 0; i < completed.size(); i++) {
+				expansionPolicy[i]->set(completed[i]);
 			}
 		}
 
 		// Compute the density of the belief points.
 		double deltaB = compute_belief_density(S);
 
+		// In the speculative mode, all of the value functions are computed together, and are completed here. A
+		// checkpoint is never written during a speculative expansion, so a resumed one continues sequentially.
+		if (speculative && !resuming && completed.empty() && R->get_num_rewards() > 1) {
+			std::cout << "  R[0] to R[" << (R->get_num_rewards() - 1) << "] (Speculative)" << std::endl; std::cout.flush();
+			compute_objectives_speculative(O, R, h, delta, gammaAStar, deltaB, Ai, expansionPolicy, completed, stopped);
+		}
+
 		// Actually run the bellman updates for each reward in sequence.
-		for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
+		for (unsigned int i = completed.size(); i < R->get_num_rewards(); i++) {
 			std::cout << "  R[" << i << "]" << std::endl; std::cout.flush();
 
 			SARewards *Ri = dynamic_cast<SARewards *>(R->get(i));
@@ -342,66 +490,43 @@ PolicyAlphaVectors **LPBVI::solve_infinite_horizon(StatesMap *S, ActionsMap *A,
 			std::vector<PolicyAlphaVector *> gamma[2];
 			bool current = false;
 
-			// Initialize the first set Gamma to be a set of zero alpha vectors.
-			for (unsigned int j = 0; j < B.size(); j++) {
-				PolicyAlphaVector *zeroAlphaVector = new PolicyAlphaVector();
-				for (auto s : *S) {
-//					zeroAlphaVector->set(resolve(s), Ri->get_min() / (1.0 - h->get_discount_factor()));
-					zeroAlphaVector->set(resolve(s), 0.0);
+			// Initialize the first set Gamma to be a set of zero alpha vectors, or the checkpoint's when resuming.
+			unsigned int firstUpdate = 0;
+
+			if (resuming) {
+				gamma[!current].swap(checkpoint.gamma);
+				firstUpdate = checkpoint.update;
+				resuming = false;
+			} else {
+				for (unsigned int j = 0; j < B.size(); j++) {
+					PolicyAlphaVector *zeroAlphaVector = new PolicyAlphaVector();
+					for (auto s : *S) {
+//						zeroAlphaVector->set(resolve(s), Ri->get_min() / (1.0 - h->get_discount_factor()));
+						zeroAlphaVector->set(resolve(s), 0.0);
+					}
+					gamma[!current].push_back(zeroAlphaVector);
 				}
-				gamma[!current].push_back(zeroAlphaVector);
 			}
 
 			// Perform a predefined number of updates. Each update improves the value function estimate.
-			for (unsigned int u = 0; u < updates; u++) {
+			for (unsigned int u = firstUpdate; u < updates; u++) {
+				// Check for a stop at each update boundary, always allowing one update so that Gamma is usable.
+				if (u > 0 && (stopped || is_stop_requested())) {
+					if (!stopped) {
+						std::cout << "Stopping early." << std::endl; std::cout.flush();
+					}
+					stopped = true;
+					break;
+				}
+
 				std::cout << "    " << (u + 1) << " / " << updates << std::endl; std::cout.flush();
 
 				// For each of the belief points, we must compute the optimal alpha vector.
-//				int beliefCounter = 0;
-				for (BeliefState *belief : B) {
-//					std::cout << "      " << (beliefCounter + 1) << " / " << B.size() << std::endl; std::cout.flush();
-//					beliefCounter++;
-
-					PolicyAlphaVector *maxAlphaB = nullptr;
-					double maxAlphaDotBeta = 0.0;
-
-					// Compute the optimal alpha vector for this belief state.
-//					int actionCounter = 0;
-					for (Action *action : Ai[belief]) {
-//						std::cout << "        " << (actionCounter + 1) << " / " << Ai[belief].size() << std::endl; std::cout.flush();
-//						actionCounter++;
-
-						PolicyAlphaVector *alphaBA = bellman_update_belief_state(S, Z, T, O, h,
-								gammaAStar[i][action], gamma[!current], action, belief);
-
-						double alphaDotBeta = alphaBA->compute_value(belief);
-						if (maxAlphaB == nullptr || alphaDotBeta > maxAlphaDotBeta) {
-							// This is the maximal alpha vector, so delete the old one.
-							if (maxAlphaB != nullptr) {
-								delete maxAlphaB;
-							}
-							maxAlphaB = alphaBA;
-							maxAlphaDotBeta = alphaDotBeta;
-						} else {
-							// This was not the maximal alpha vector, so delete it.
-							delete alphaBA;
-						}
-					}
-
-					gamma[current].push_back(maxAlphaB);
-				}
+				gamma[current].resize(B.size(), nullptr);
+				update_belief_points(O, h, gammaAStar[i], Ai, gamma[!current], gamma[current], numThreads);
 
 				// If we are recording values, compute the belief value here.
-				if (beliefToRecord != nullptr) {
-					double maxRecordedValue = std::numeric_limits<double>::lowest();
-					for (PolicyAlphaVector *alphaRecord : gamma[current]) {
-						double recordedValue = alphaRecord->compute_value(beliefToRecord);
-						if (recordedValue > maxRecordedValue) {
-							maxRecordedValue = recordedValue;
-						}
-					}
-					recordedValues[i].push_back(maxRecordedValue);
-				}
+				record_value(i, gamma[current]);
 
 				// Prepare the next time step's gamma by clearing it. Remember again, we don't free the memory
 				// because policy manages the previous time step's gamma (above). If this is the first horizon,
@@ -411,29 +536,29 @@ PolicyAlphaVectors **LPBVI::solve_infinite_horizon(StatesMap *S, ActionsMap *A,
 				}
 				gamma[!current].clear();
 				current = !current;
+
+				if (!checkpointFilename.empty() && (u + 1) % checkpointInterval == 0) {
+					save_checkpoint(S, A, e, i, u + 1, Ai, completed, gamma[!current]);
+				}
 			}
 
 			// Set the current gamma to the policy object. Note: This transfers the responsibility of
 			// memory management to the PolicyAlphaVectors object.
-			policy[i]->set(gamma[!current]);
+			expansionPolicy[i]->set(gamma[!current]);
+			completed.push_back(gamma[!current]);
 
-			// Setup the one-step slack eta_i value.
-			double etai = delta[i];
+			// If there is already a consistent policy, then this expansion's partial one is discarded.
+			if (stopped && policy != nullptr) {
+				break;
+			}
 
-			if (constrainEta) {
-				double epsiloni = (Ri->get_max() - Ri->get_min()) / (1.0 - h->get_discount_factor()) * deltaB;
-				etai = std::max(0.0, (1.0 - h->get_discount_factor()) * delta[i] - epsiloni);
+			if (!stopped) {
+				snapshot_value_functions(expansionPolicy, i + 1, R->get_num_rewards());
 			}
 
 			// Restrict the set of actions available to each belief point in the next i+1 value function.
 			if (i < R->get_num_rewards() - 1) {
-				for (BeliefState *b : B) {
-//					std::cout << "Ai[b].size(): " << Ai[b].size();
-
-					policy[i]->get(b, etai, Ai[b]);
-
-//					std::cout << " -> " << Ai[b].size() << std::endl; std::cout.flush();
-				}
+				restrict_actions(expansionPolicy[i], compute_slack(Ri, h, delta[i], deltaB), B.size(), Ai, numThreads);
 			}
 
 //			std::cout << "delta[i] = " << delta[i] << std::endl; std::cout.flush();
@@ -441,33 +566,46 @@ PolicyAlphaVectors **LPBVI::solve_infinite_horizon(StatesMap *S, ActionsMap *A,
 //			std::cout << "epsiloni = " << epsiloni << std::endl; std::cout.flush();
 		}
 
-		// Perform an expansion based on the rule the user wishes to use.
+		if (stopped && policy != nullptr) {
+			for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
+				delete expansionPolicy[i];
+			}
+			delete [] expansionPolicy;
+			break;
+		}
+
+		// This expansion is complete, so its policy replaces the last one.
+		if (policy != nullptr) {
+			for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
+				delete policy[i];
+			}
+			delete [] policy;
+		}
+		policy = expansionPolicy;
+
+		if (snapshotCallback) {
+			snapshotCallback(policy, R->get_num_rewards(), false);
+		}
+
+		if (stopped || is_stop_requested()) {
+			break;
+		}
+
+		// Perform an expansion based on the rule the user wishes to use. Stop immediately if the user
+		// does not want to expand.
 		if (e < expansions - 1) {
-			switch (rule) {
-			case POMDPPBVIExpansionRule::NONE:
-				e = expansions; // Stop immediately if the user does not want to expand.
-				break;
-			case POMDPPBVIExpansionRule::RANDOM_BELIEF_SELECTION:
-				expand_random_belief_selection(S);
-				break;
-			case POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_RANDOM_ACTION:
-				expand_stochastic_simulation_random_actions(S, A, Z, T, O);
+			if (rule == POMDPPBVIExpansionRule::NONE) {
 				break;
-	//		case POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_GREEDY_ACTION:
-				// NOTE: This one is a bit harder, since gamma is inside another loop now, but this is outside
-				// that loop... Just ignore it for now, and use the one below.
-	//			expand_stochastic_simulation_greedy_action(S, A, Z, T, O, gamma[!current]);
-	//			break;
-			case POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_EXPLORATORY_ACTION:
-				expand_stochastic_simulation_exploratory_action(S, A, Z, T, O);
-				break;
-			case POMDPPBVIExpansionRule::GREEDY_ERROR_REDUCTION:
-				expand_greedy_error_reduction();
-				break;
-			default:
-				throw PolicyException();
-				break;
-			};
+			}
+			expand_belief_points(S, A, Z, T, O, policy[R->get_num_rewards() - 1]);
+		}
+	}
+
+	// Handle the trivial case in which there were no expansions.
+	if (policy == nullptr) {
+		policy = new PolicyAlphaVectors*[R->get_num_rewards()];
+		for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
+			policy[i] = new PolicyAlphaVectors(h->get_horizon());
 		}
 	}
 
@@ -485,157 +623,1515 @@ PolicyAlphaVectors **LPBVI::solve_infinite_horizon(StatesMap *S, ActionsMap *A,
 	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 	std::cout << "Total Elapsed Time (CPU Version): " << ((double)elapsed.count() / 1000.0) << std::endl; std::cout.flush();
 
-	// Free the memory of Gamma_{a, *}.
-	for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
-		for (auto a : *A) {
-			Action *action = resolve(a);
-			for (PolicyAlphaVector *alphaVector : gammaAStar[i][action]) {
-				delete alphaVector;
-			}
-			gammaAStar[i][action].clear();
-		}
-		gammaAStar[i].clear();
-	}
-	delete [] gammaAStar;
+	// In NUMA mode, confirm the placement with the per-node counters.
+	numa_print_counters();
 
+	// Free the memory of Gamma_{a, *}.
+	free_gamma_a_star_sets(A, R, gammaAStar);
 
 	return policy;
 }
 
-PolicyAlphaVectors **LPBVI::compute_value_execute(StatesMap *S, ActionsMap *A,
-		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
-		FactoredRewards *R, Horizon *h, std::vector<float> &delta,
-		PolicyAlphaVectors *policy)
+void LPBVI::compute_objectives_speculative(ObservationTransitions *O, FactoredRewards *R, Horizon *h,
+		std::vector<float> &delta, std::map<Action *, std::vector<PolicyAlphaVector *> > *gammaAStar, double deltaB,
+		const std::map<BeliefState *, std::vector<Action *> > &Ai, PolicyAlphaVectors **expansionPolicy,
+		std::vector<std::vector<PolicyAlphaVector *> > &completed, bool &stopped)
 {
-	// The final set of alpha vectors.
-	PolicyAlphaVectors **result = new PolicyAlphaVectors*[R->get_num_rewards()];
-	for (int i = 0; i < (int)R->get_num_rewards(); i++) {
-		result[i] = new PolicyAlphaVectors(h->get_horizon());
-	}
+	unsigned int k = R->get_num_rewards();
+	unsigned int r = B.size();
+
+	// For each value function: its latest Gamma, its available actions, whether those are from the final Gamma
+	// of the value function before it, and the number of updates since they last changed.
+	std::vector<std::vector<PolicyAlphaVector *> > gamma(k);
+	std::vector<std::map<BeliefState *, std::vector<Action *> > > speculativeAi(k, Ai);
+	std::vector<unsigned char> finalActions(k, false);
+	std::vector<unsigned int> stableUpdates(k, 0);
+	std::vector<unsigned char> finished(k, false);
+	std::vector<double> eta(k, 0.0);
+
+	// The number of value functions, from the first, which were sent to the snapshot callback.
+	unsigned int numSnapshotted = 0;
+
+	// The first value function's actions are never restricted.
+	finalActions[0] = true;
+
+	for (unsigned int i = 0; i < k; i++) {
+		for (unsigned int j = 0; j < r; j++) {
+			PolicyAlphaVector *zeroAlphaVector = new PolicyAlphaVector();
+			for (unsigned int s = 0; s < beliefCache.get_states().size(); s++) {
+				zeroAlphaVector->set(beliefCache.get_states()[s], 0.0);
+			}
+			gamma[i].push_back(zeroAlphaVector);
+		}
 
-	// Initialize the set of belief points to be the initial set. This must be a copy, since memory is managed
-	// for both objects independently.
-	for (BeliefState *b : initialB) {
-		B.push_back(new BeliefState(*b));
+		eta[i] = compute_slack(dynamic_cast<SARewards *>(R->get(i)), h, delta[i], deltaB);
 	}
 
-	// Before anything, cache Gamma_{a, *} for all actions, but one for each R[i] now. This is used in every
-	// cross-sum computation, but it's alright that this doesn't depend on b and is over all actions, since we
-	// only ever use the ones with the action specified in the map. Since the inner loop only iterates over Ai[b]
-	// actions, it naturally restricts the actions.
-	std::map<Action *, std::vector<PolicyAlphaVector *> > *gammaAStar =
-			new std::map<Action *, std::vector<PolicyAlphaVector *> >[R->get_num_rewards()];
-	for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
-		SARewards *Ri = dynamic_cast<SARewards *>(R->get(i));
-		if (Ri == nullptr) {
-			throw RewardException();
+	// Cache every belief point's successors before the first round. The cache fills its slots lazily without a
+	// lock, and below the work of one belief point is split over the value functions, so they would share them.
+	// Every value function's actions are a subset of Ai, which starts with all of the actions.
+	execute_in_parallel(r, [&](unsigned int worker, unsigned int first, unsigned int last) {
+		for (unsigned int j = first; j < last; j++) {
+			for (Action *action : Ai.at(B[j])) {
+				beliefCache.get_successors(j, action);
+			}
 		}
+	});
 
-		for (auto a : *A) {
-			Action *action = resolve(a);
-			gammaAStar[i][action].push_back(create_gamma_a_star(S, Z, T, O, Ri, action));
+	for (unsigned int round = 0; std::find(finished.begin(), finished.end(), false) != finished.end(); round++) {
+		// Check for a stop at each round, always allowing one update of every value function so that Gamma is usable.
+		if (round > 0 && (stopped || is_stop_requested())) {
+			if (!stopped) {
+				std::cout << "Stopping early." << std::endl; std::cout.flush();
+			}
+			stopped = true;
+			break;
 		}
-	}
-
-	// If we are recording a belief point's values, create the empty vector for each R[i].
-	if (beliefToRecord != nullptr) {
-		recordedValues.clear();
-		recordedValues.resize(R->get_num_rewards());
-	}
 
-	// Actually run the bellman updates for each reward in sequence.
-	for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
-		std::cout << "  R[" << i << "]" << std::endl; std::cout.flush();
+		std::vector<unsigned int> active;
+		for (unsigned int i = 0; i < k; i++) {
+			if (!finished[i]) {
+				active.push_back(i);
+			}
+		}
 
-		// Create the set of alpha vectors, which we call Gamma. As well as the previous Gamma set.
-		std::vector<PolicyAlphaVector *> gamma[2];
-		bool current = false;
+		std::cout << "    Round " << (round + 1) << ": R[" << active.front() << "] to R[" << active.back() << "]" << std::endl;
+		std::cout.flush();
 
-		// Initialize the first set Gamma to be a set of zero alpha vectors.
-		for (unsigned int j = 0; j < B.size(); j++) {
-			PolicyAlphaVector *zeroAlphaVector = new PolicyAlphaVector();
-			for (auto s : *S) {
-//				zeroAlphaVector->set(resolve(s), Ri->get_min() / (1.0 - h->get_discount_factor()));
-				zeroAlphaVector->set(resolve(s), 0.0);
-			}
-			gamma[!current].push_back(zeroAlphaVector);
+		// One update of every unfinished value function. The work is split over all of the (value function,
+		// belief point) pairs together, so that all of the threads are busy even with few belief points.
+		std::vector<std::vector<PolicyAlphaVector *> > next(k);
+		for (unsigned int i : active) {
+			next[i].resize(r, nullptr);
 		}
 
-		// Perform a predefined number of updates. Each update improves the value function estimate.
-		for (unsigned int u = 0; u < updates; u++) {
-			std::cout << "    " << (u + 1) << " / " << updates << std::endl; std::cout.flush();
+		execute_in_parallel(active.size() * r, [&](unsigned int worker, unsigned int first, unsigned int last) {
+			for (unsigned int t = first; t < last; t++) {
+				unsigned int i = active[t / r];
+				unsigned int j = t % r;
+				next[i][j] = update_belief_point(O, h, gammaAStar[i], speculativeAi[i].at(B[j]),
+						LPBVIAlphaVectorGamma(gamma[i]), j);
+			}
+		});
 
-			// For each of the belief points, we must compute the optimal alpha vector.
-//			int beliefCounter = 0;
-			for (BeliefState *belief : B) {
-//				std::cout << "      " << (beliefCounter + 1) << " / " << B.size() << std::endl; std::cout.flush();
-//				beliefCounter++;
+		for (unsigned int i : active) {
+			record_value(i, next[i]);
 
-				// Compute the alpha vector for this belief state's action following the policy.
-				Action *action = policy->get(belief);
-				PolicyAlphaVector *alphaBA = bellman_update_belief_state(S, Z, T, O, h,
-						gammaAStar[i][action], gamma[!current], action, belief);
+			for (PolicyAlphaVector *alpha : gamma[i]) {
+				delete alpha;
+			}
+			gamma[i] = next[i];
+			stableUpdates[i]++;
+		}
 
-				gamma[current].push_back(alphaBA);
+		// A value function is finished once its actions are final and it has had all of its updates with them.
+		for (unsigned int i : active) {
+			if (finalActions[i] && stableUpdates[i] >= updates) {
+				finished[i] = true;
 			}
+		}
 
-			// If we are recording values, compute the belief value here.
-			if (beliefToRecord != nullptr) {
-				double maxRecordedValue = std::numeric_limits<double>::lowest();
-				for (PolicyAlphaVector *alphaRecord : gamma[current]) {
-					double recordedValue = alphaRecord->compute_value(beliefToRecord);
-					if (recordedValue > maxRecordedValue) {
-						maxRecordedValue = recordedValue;
-					}
+		// Send a snapshot once more of the first value functions have finished. These are copies, since Gamma is
+		// only given to the expansion's policy at the end.
+		unsigned int numFinished = (unsigned int)(std::find(finished.begin(), finished.end(), false) - finished.begin());
+		if (snapshotCallback && numFinished > numSnapshotted && numFinished < k) {
+			std::vector<PolicyAlphaVectors *> partial;
+			for (unsigned int i = 0; i < numFinished; i++) {
+				std::vector<PolicyAlphaVector *> copies;
+				for (PolicyAlphaVector *alpha : gamma[i]) {
+					copies.push_back(new PolicyAlphaVector(*alpha));
 				}
-				recordedValues[i].push_back(maxRecordedValue);
+				partial.push_back(new PolicyAlphaVectors(h->get_horizon()));
+				partial.back()->set(copies);
 			}
 
-			// Prepare the next time step's gamma by clearing it. Remember again, we don't free the memory
-			// because policy manages the previous time step's gamma (above). If this is the first horizon,
-			// however, we actually do need to clear the set of zero alpha vectors.
-			for (PolicyAlphaVector *zeroAlphaVector : gamma[!current]) {
-				delete zeroAlphaVector;
+			snapshot_value_functions(partial.data(), numFinished, k);
+
+			for (PolicyAlphaVectors *p : partial) {
+				delete p;
 			}
-			gamma[!current].clear();
-			current = !current;
 		}
+		numSnapshotted = std::max(numSnapshotted, numFinished);
+
+		// Correct the actions of each unfinished value function from the latest Gamma of the one before it, which
+		// is final once that one has finished. Only a value function whose actions changed starts its count of
+		// updates over; this is the verification against the final restriction.
+		for (unsigned int i = 1; i < k; i++) {
+			if (finished[i] || finalActions[i]) {
+				continue;
+			}
 
-		// Set the current gamma to the policy object. Note: This transfers the responsibility of
-		// memory management to the PolicyAlphaVectors object.
-		result[i]->set(gamma[!current]);
-	}
+			// Note: The policy owns (and frees) its alpha vectors, so it is given copies.
+			std::vector<PolicyAlphaVector *> copies;
+			for (PolicyAlphaVector *alpha : gamma[i - 1]) {
+				copies.push_back(new PolicyAlphaVector(*alpha));
+			}
+			PolicyAlphaVectors previous(h->get_horizon());
+			previous.set(copies);
 
-	// Free the memory of Gamma_{a, *}.
-	for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
-		for (auto a : *A) {
-			Action *action = resolve(a);
-			for (PolicyAlphaVector *alphaVector : gammaAStar[i][action]) {
-				delete alphaVector;
+			std::map<BeliefState *, std::vector<Action *> > restricted = speculativeAi[i - 1];
+			restrict_actions(&previous, eta[i - 1], r, restricted, numThreads);
+
+			if (restricted != speculativeAi[i]) {
+				speculativeAi[i] = restricted;
+				stableUpdates[i] = 0;
 			}
-			gammaAStar[i][action].clear();
+			finalActions[i] = finished[i - 1];
 		}
-		gammaAStar[i].clear();
 	}
-	delete [] gammaAStar;
 
-	return result;
+	// Note: This transfers the responsibility of memory management to the PolicyAlphaVectors objects.
+	for (unsigned int i = 0; i < k; i++) {
+		expansionPolicy[i]->set(gamma[i]);
+		completed.push_back(gamma[i]);
+	}
 }
 
-double LPBVI::compute_belief_density(StatesMap *S)
+PolicyAlphaVectors **LPBVI::solve_infinite_horizon_pipelined(StatesMap *S, ActionsMap *A,
+		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+		FactoredRewards *R, Horizon *h, std::vector<float> &delta)
 {
-	double density = 0.0;
+	unsigned int k = R->get_num_rewards();
 
-	for (BeliefState *bPrime : B) {
-		for (BeliefState *b : B) {
-			for (auto s : *S) {
-				State *state = resolve(s);
-				density = std::max(density, std::fabs(b->get(state) - bPrime->get(state)));
-			}
-		}
+	// The final set of alpha vectors, from the last completed expansion, exactly as in the sequential schedule.
+	PolicyAlphaVectors **policy = nullptr;
+
+	for (BeliefState *b : initialB) {
+		B.push_back(new BeliefState(*b));
 	}
+	beliefCache.revalidate();
 
-	return density;
+	std::cout << "Initial Num Belief Points: " << initialB.size() << std::endl; std::cout.flush();
+
+	std::map<Action *, std::vector<PolicyAlphaVector *> > *gammaAStar = create_gamma_a_star_sets(S, A, Z, T, O, R);
+
+	if (beliefToRecord != nullptr) {
+		recordedValues.clear();
+		recordedValues.resize(k);
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::cout << "Starting (Pipelined)...\n"; std::cout.flush();
+
+	// Whether the time limit passed or the solve was cancelled. Both value functions in flight check it.
+	std::atomic<bool> stopped(false);
+
+	// The first value function of the next expansion, computed ahead, and the actions it leaves available.
+	PolicyAlphaVectors *nextPolicy = nullptr;
+	std::map<BeliefState *, std::vector<Action *> > nextAi;
+	double nextDeltaB = 0.0;
+
+	for (unsigned int e = 0; e < expansions; e++) {
+		std::cout << "Expansion " << (e + 1) << std::endl;
+
+		// This expansion's belief points are the first numBeliefs of B, since the expansions only append to it.
+		unsigned int numBeliefs = B.size();
+
+		PolicyAlphaVectors **expansionPolicy = new PolicyAlphaVectors*[k];
+		for (unsigned int i = 0; i < k; i++) {
+			expansionPolicy[i] = nullptr;
+		}
+
+		std::map<BeliefState *, std::vector<Action *> > Ai;
+		double deltaB = 0.0;
+
+		if (nextPolicy == nullptr) {
+			// Only the first expansion has nothing ahead, so its first value function uses all of the threads.
+			beliefCache.update(get_model_identity(), S, Z, T, O, B);
+
+			deltaB = compute_belief_density(S);
+			for (BeliefState *b : B) {
+				for (auto a : *A) {
+					Ai[b].push_back(resolve(a));
+				}
+			}
+
+			std::cout << "  R[0]" << std::endl; std::cout.flush();
+
+			expansionPolicy[0] = new PolicyAlphaVectors(h->get_horizon());
+			expansionPolicy[0]->set(compute_objective(S, O, h, gammaAStar[0], 0, numBeliefs, Ai, numThreads, stopped));
+			restrict_actions(expansionPolicy[0], compute_slack(dynamic_cast<SARewards *>(R->get(0)), h, delta[0], deltaB),
+					numBeliefs, Ai, numThreads);
+		} else {
+			expansionPolicy[0] = nextPolicy;
+			Ai = std::move(nextAi);
+			deltaB = nextDeltaB;
+			nextPolicy = nullptr;
+			nextAi.clear();
+		}
+
+		if (!stopped) {
+			snapshot_value_functions(expansionPolicy, 1, k);
+		}
+
+		for (unsigned int i = 1; i < k; i++) {
+			expansionPolicy[i] = new PolicyAlphaVectors(h->get_horizon());
+		}
+
+		// Expand now, rather than after the remaining value functions; the result is the same, since the rule does
+		// not depend on them. Every belief point's successors are cached before the two value functions below
+		// begin, since the cache's slots are then shared between them.
+		bool ahead = (e < expansions - 1 && !stopped && !is_stop_requested());
+		if (ahead) {
+			expand_belief_points(S, A, Z, T, O, nullptr);
+
+			beliefCache.update(get_model_identity(), S, Z, T, O, B);
+			execute_in_parallel(B.size(), [&](unsigned int worker, unsigned int first, unsigned int last) {
+				for (unsigned int j = first; j < last; j++) {
+					for (auto a : *A) {
+						beliefCache.get_successors(j, resolve(a));
+					}
+				}
+			});
+
+			nextDeltaB = compute_belief_density(S);
+			for (BeliefState *b : B) {
+				for (auto a : *A) {
+					nextAi[b].push_back(resolve(a));
+				}
+			}
+		}
+
+		// Split the threads in proportion to the work: the k - 1 remaining value functions over this expansion's
+		// belief points, and the next expansion's first value function over all of them.
+		unsigned int aheadThreads = 0;
+		if (ahead) {
+			double aheadWork = (double)B.size();
+			double remainingWork = (double)(k - 1) * numBeliefs;
+			aheadThreads = (unsigned int)(numThreads * aheadWork / (aheadWork + remainingWork) + 0.5);
+			aheadThreads = std::max(1u, std::min(numThreads - 1, aheadThreads));
+		}
+
+		std::exception_ptr aheadError = nullptr;
+		std::thread aheadThread;
+
+		if (ahead) {
+			std::cout << "  R[0] of Expansion " << (e + 2) << " (Ahead, " << aheadThreads << " Threads)" << std::endl;
+			std::cout.flush();
+
+			aheadThread = std::thread([&]() {
+				try {
+					PolicyAlphaVectors *firstPolicy = new PolicyAlphaVectors(h->get_horizon());
+					nextPolicy = firstPolicy;
+					firstPolicy->set(compute_objective(S, O, h, gammaAStar[0], 0, B.size(), nextAi, aheadThreads, stopped));
+					restrict_actions(firstPolicy, compute_slack(dynamic_cast<SARewards *>(R->get(0)), h, delta[0], nextDeltaB),
+							B.size(), nextAi, aheadThreads);
+				} catch (...) {
+					aheadError = std::current_exception();
+				}
+			});
+		}
+
+		// The remaining value functions of this expansion, as in the sequential schedule.
+		for (unsigned int i = 1; i < k; i++) {
+			std::cout << "  R[" << i << "]" << std::endl; std::cout.flush();
+
+			expansionPolicy[i]->set(compute_objective(S, O, h, gammaAStar[i], i, numBeliefs, Ai,
+					numThreads - aheadThreads, stopped));
+
+			if (stopped && policy != nullptr) {
+				break;
+			}
+
+			if (!stopped) {
+				snapshot_value_functions(expansionPolicy, i + 1, k);
+			}
+
+			if (i < k - 1) {
+				restrict_actions(expansionPolicy[i], compute_slack(dynamic_cast<SARewards *>(R->get(i)), h, delta[i], deltaB),
+						numBeliefs, Ai, numThreads - aheadThreads);
+			}
+		}
+
+		if (aheadThread.joinable()) {
+			aheadThread.join();
+		}
+		if (aheadError != nullptr) {
+			std::rethrow_exception(aheadError);
+		}
+
+		if (stopped && policy != nullptr) {
+			for (unsigned int i = 0; i < k; i++) {
+				delete expansionPolicy[i];
+			}
+			delete [] expansionPolicy;
+			break;
+		}
+
+		if (policy != nullptr) {
+			for (unsigned int i = 0; i < k; i++) {
+				delete policy[i];
+			}
+			delete [] policy;
+		}
+		policy = expansionPolicy;
+
+		if (snapshotCallback) {
+			snapshotCallback(policy, k, false);
+		}
+
+		if (stopped || is_stop_requested()) {
+			break;
+		}
+	}
+
+	// The next expansion's first value function is discarded if the solve stopped before it.
+	if (nextPolicy != nullptr) {
+		delete nextPolicy;
+	}
+
+	if (policy == nullptr) {
+		policy = new PolicyAlphaVectors*[k];
+		for (unsigned int i = 0; i < k; i++) {
+			policy[i] = new PolicyAlphaVectors(h->get_horizon());
+		}
+	}
+
+	std::cout << "Complete LPBVI." << std::endl; std::cout.flush();
+
+	auto end = std::chrono::high_resolution_clock::now();
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+	std::cout << "Total Elapsed Time (CPU Version): " << ((double)elapsed.count() / 1000.0) << std::endl; std::cout.flush();
+
+	free_gamma_a_star_sets(A, R, gammaAStar);
+
+	return policy;
+}
+
+std::vector<PolicyAlphaVector *> LPBVI::compute_objective(StatesMap *S, ObservationTransitions *O, Horizon *h,
+		std::map<Action *, std::vector<PolicyAlphaVector *> > &gammaAStar, unsigned int i, unsigned int numBeliefs,
+		const std::map<BeliefState *, std::vector<Action *> > &Ai, unsigned int threads, std::atomic<bool> &stopped)
+{
+	std::vector<PolicyAlphaVector *> gamma[2];
+	bool current = false;
+
+	for (unsigned int j = 0; j < numBeliefs; j++) {
+		PolicyAlphaVector *zeroAlphaVector = new PolicyAlphaVector();
+		for (auto s : *S) {
+			zeroAlphaVector->set(resolve(s), 0.0);
+		}
+		gamma[!current].push_back(zeroAlphaVector);
+	}
+
+	for (unsigned int u = 0; u < updates; u++) {
+		// Check for a stop at each update boundary, always allowing one update so that Gamma is usable.
+		if (u > 0 && (stopped || is_stop_requested())) {
+			if (!stopped.exchange(true)) {
+				std::cout << "Stopping early." << std::endl; std::cout.flush();
+			}
+			break;
+		}
+
+		gamma[current].resize(numBeliefs, nullptr);
+		update_belief_points(O, h, gammaAStar, Ai, gamma[!current], gamma[current], threads);
+
+		record_value(i, gamma[current]);
+
+		for (PolicyAlphaVector *alpha : gamma[!current]) {
+			delete alpha;
+		}
+		gamma[!current].clear();
+		current = !current;
+	}
+
+	return gamma[!current];
+}
+
+void LPBVI::update_belief_points(ObservationTransitions *O, Horizon *h,
+		std::map<Action *, std::vector<PolicyAlphaVector *> > &gammaAStar,
+		const std::map<BeliefState *, std::vector<Action *> > &Ai,
+		std::vector<PolicyAlphaVector *> &gammaPrevious, std::vector<PolicyAlphaVector *> &gammaNext,
+		unsigned int threads)
+{
+	// Each worker computes a contiguous partition of the belief points, and only writes to that partition's
+	// slots of the next Gamma.
+	LPBVIAlphaVectorGamma previous(gammaPrevious);
+
+	execute_in_parallel(gammaNext.size(), threads, [&](unsigned int worker, unsigned int first, unsigned int last) {
+		for (unsigned int j = first; j < last; j++) {
+			gammaNext[j] = update_belief_point(O, h, gammaAStar, Ai.at(B[j]), previous, j);
+		}
+	});
+}
+
+PolicyAlphaVector *LPBVI::update_belief_point(ObservationTransitions *O, Horizon *h,
+		std::map<Action *, std::vector<PolicyAlphaVector *> > &gammaAStar, const std::vector<Action *> &actions,
+		const LPBVIGamma &gammaPrevious, unsigned int beliefIndex)
+{
+	BeliefState *belief = B[beliefIndex];
+
+	PolicyAlphaVector *maxAlphaB = nullptr;
+	double maxAlphaDotBeta = 0.0;
+
+	// Compute the optimal alpha vector for this belief state.
+	for (Action *action : actions) {
+		PolicyAlphaVector *alphaBA = bellman_update_cached_belief_state(O, h,
+				gammaAStar.at(action), gammaPrevious, action, beliefIndex);
+
+		double alphaDotBeta = alphaBA->compute_value(belief);
+		if (maxAlphaB == nullptr || alphaDotBeta > maxAlphaDotBeta) {
+			// This is the maximal alpha vector, so delete the old one.
+			if (maxAlphaB != nullptr) {
+				delete maxAlphaB;
+			}
+			maxAlphaB = alphaBA;
+			maxAlphaDotBeta = alphaDotBeta;
+		} else {
+			// This was not the maximal alpha vector, so delete it.
+			delete alphaBA;
+		}
+	}
+
+	return maxAlphaB;
+}
+
+void LPBVI::restrict_actions(PolicyAlphaVectors *policy, double eta, unsigned int numBeliefs,
+		std::map<BeliefState *, std::vector<Action *> > &Ai, unsigned int threads)
+{
+	// Each worker only modifies the action sets of its own partition of belief points.
+	execute_in_parallel(numBeliefs, threads, [&](unsigned int worker, unsigned int first, unsigned int last) {
+		for (unsigned int j = first; j < last; j++) {
+			policy->get(B[j], eta, Ai.at(B[j]));
+		}
+	});
+}
+
+double LPBVI::compute_slack(SARewards *Ri, Horizon *h, double deltai, double deltaB) const
+{
+	double etai = deltai;
+
+	if (constrainEta) {
+		double epsiloni = (Ri->get_max() - Ri->get_min()) / (1.0 - h->get_discount_factor()) * deltaB;
+		etai = std::max(0.0, (1.0 - h->get_discount_factor()) * deltai - epsiloni);
+	}
+
+	return etai;
+}
+
+unsigned long long LPBVI::get_model_identity() const
+{
+	if (activeSession == nullptr) {
+		return 0;
+	}
+	return activeSession->get_lpomdp()->get_identity();
+}
+
+void LPBVI::record_value(unsigned int i, const std::vector<PolicyAlphaVector *> &gamma)
+{
+	if (beliefToRecord == nullptr) {
+		return;
+	}
+
+	double maxRecordedValue = std::numeric_limits<double>::lowest();
+	for (PolicyAlphaVector *alphaRecord : gamma) {
+		double recordedValue = alphaRecord->compute_value(beliefToRecord);
+		if (recordedValue > maxRecordedValue) {
+			maxRecordedValue = recordedValue;
+		}
+	}
+	recordedValues[i].push_back(maxRecordedValue);
+}
+
+std::map<Action *, std::vector<PolicyAlphaVector *> > *LPBVI::create_gamma_a_star_sets(StatesMap *S, ActionsMap *A,
+		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O, FactoredRewards *R)
+{
+	// These only depend on the model, so a session keeps them for all of its solves.
+	if (activeSession != nullptr && activeSession->get_gamma_a_star() != nullptr) {
+		return activeSession->get_gamma_a_star();
+	}
+
+	// This is used in every cross-sum computation, but it's alright that this doesn't depend on b and is over all
+	// actions, since we only ever use the ones with the action specified in the map. Since the inner loop only
+	// iterates over Ai[b] actions, it naturally restricts the actions.
+	std::map<Action *, std::vector<PolicyAlphaVector *> > *gammaAStar =
+			new std::map<Action *, std::vector<PolicyAlphaVector *> >[R->get_num_rewards()];
+	for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
+		SARewards *Ri = dynamic_cast<SARewards *>(R->get(i));
+		if (Ri == nullptr) {
+			delete [] gammaAStar;
+			throw RewardException();
+		}
+
+		for (auto a : *A) {
+			Action *action = resolve(a);
+			gammaAStar[i][action].push_back(create_gamma_a_star(S, Z, T, O, Ri, action));
+		}
+	}
+
+	if (activeSession != nullptr) {
+		activeSession->set_gamma_a_star(gammaAStar);
+	}
+
+	return gammaAStar;
+}
+
+void LPBVI::free_gamma_a_star_sets(ActionsMap *A, FactoredRewards *R,
+		std::map<Action *, std::vector<PolicyAlphaVector *> > *gammaAStar)
+{
+	// The session's are freed when it is released.
+	if (activeSession != nullptr && activeSession->get_gamma_a_star() == gammaAStar) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
+		for (auto a : *A) {
+			Action *action = resolve(a);
+			for (PolicyAlphaVector *alphaVector : gammaAStar[i][action]) {
+				delete alphaVector;
+			}
+			gammaAStar[i][action].clear();
+		}
+		gammaAStar[i].clear();
+	}
+	delete [] gammaAStar;
+}
+
+PolicyAlphaVectors **LPBVI::compute_value_execute(StatesMap *S, ActionsMap *A,
+		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+		FactoredRewards *R, Horizon *h, std::vector<float> &delta,
+		PolicyAlphaVectors *policy)
+{
+	unsigned int k = R->get_num_rewards();
+	double discount = h->get_discount_factor();
+
+	// The final set of alpha vectors.
+	PolicyAlphaVectors **result = new PolicyAlphaVectors*[k];
+	for (unsigned int i = 0; i < k; i++) {
+		result[i] = new PolicyAlphaVectors(h->get_horizon());
+	}
+
+	// Evaluate at the belief points of the last solve, if there was one. Otherwise, initialize the set of belief
+	// points to be the initial set. This must be a copy, since memory is managed for both objects independently.
+	if (B.empty()) {
+		for (BeliefState *b : initialB) {
+			B.push_back(new BeliefState(*b));
+		}
+	}
+
+	std::vector<SARewards *> Rs;
+	for (unsigned int i = 0; i < k; i++) {
+		SARewards *Ri = dynamic_cast<SARewards *>(R->get(i));
+		if (Ri == nullptr) {
+			throw RewardException();
+		}
+		Rs.push_back(Ri);
+	}
+
+	// The policy's alpha-vectors are stored as dense rows over this ordering of the states.
+	std::vector<State *> states;
+	std::unordered_map<const State *, unsigned int> stateIndexes;
+	for (auto s : *S) {
+		stateIndexes[resolve(s)] = states.size();
+		states.push_back(resolve(s));
+	}
+
+	std::vector<Observation *> observations;
+	for (auto z : *Z) {
+		observations.push_back(resolve(z));
+	}
+
+	unsigned int n = states.size();
+	unsigned int z = observations.size();
+	unsigned int r = B.size();
+
+	// The policy is fixed, so the action at each belief point never changes. For each action which the policy
+	// uses, cache the successors (with their transition probabilities), the observation probabilities, and
+	// the rewards of every value function. The k value functions then share these in a single pass. These only
+	// depend on the model, so a session keeps them for all of its evaluations.
+	std::vector<Action *> actions(r, nullptr);
+	std::unordered_map<Action *, LPBVIActionModel> evaluationModels;
+	std::unordered_map<Action *, LPBVIActionModel> &models =
+			(activeSession != nullptr ? activeSession->get_action_models() : evaluationModels);
+
+	for (unsigned int j = 0; j < r; j++) {
+		Action *action = policy->get(B[j]);
+		actions[j] = action;
+
+		if (models.find(action) != models.end()) {
+			continue;
+		}
+
+		LPBVIActionModel &model = models[action];
+
+		model.successors.resize(n);
+		std::vector<State *> successorStates;
+		for (unsigned int s = 0; s < n; s++) {
+			successorStates.clear();
+			T->successors(S, states[s], action, successorStates);
+			for (State *sp : successorStates) {
+				double probability = T->get(states[s], action, sp);
+				if (probability > 0.0) {
+					model.successors[s].push_back(std::make_pair(stateIndexes.at(sp), probability));
+				}
+			}
+		}
+
+		model.observationProbabilities.resize((size_t)n * z);
+		for (unsigned int sp = 0; sp < n; sp++) {
+			for (unsigned int o = 0; o < z; o++) {
+				model.observationProbabilities[sp * z + o] = O->get(action, states[sp], observations[o]);
+			}
+		}
+
+		model.rewards.resize((size_t)k * n);
+		for (unsigned int i = 0; i < k; i++) {
+			for (unsigned int s = 0; s < n; s++) {
+				model.rewards[i * n + s] = Rs[i]->get(states[s], action);
+			}
+		}
+	}
+
+	// Since both the belief points and their actions are fixed, so are the projections used to select the
+	// alpha-vector for each observation: w(s') = gamma * sum_s b(s) T(s, a, s') O(a, s', z). Compute them
+	// once, as sparse vectors, instead of once per value function per update.
+	std::vector<std::vector<std::vector<std::pair<unsigned int, double> > > > projections(r);
+
+	execute_in_parallel(r, [&](unsigned int worker, unsigned int first, unsigned int last) {
+		std::vector<double> projection((size_t)z * n);
+
+		for (unsigned int j = first; j < last; j++) {
+			const std::vector<std::vector<std::pair<unsigned int, double> > > &successorsA = models.at(actions[j]).successors;
+			const std::vector<double> &observationProbabilitiesA = models.at(actions[j]).observationProbabilities;
+
+			std::fill(projection.begin(), projection.end(), 0.0);
+
+			for (unsigned int s = 0; s < n; s++) {
+				double b = B[j]->get(states[s]);
+				if (b <= 0.0) {
+					continue;
+				}
+
+				for (const std::pair<unsigned int, double> &successor : successorsA[s]) {
+					for (unsigned int o = 0; o < z; o++) {
+						projection[o * n + successor.first] += discount * b * successor.second *
+								observationProbabilitiesA[successor.first * z + o];
+					}
+				}
+			}
+
+			projections[j].resize(z);
+			for (unsigned int o = 0; o < z; o++) {
+				for (unsigned int sp = 0; sp < n; sp++) {
+					if (projection[o * n + sp] != 0.0) {
+						projections[j][o].push_back(std::make_pair(sp, projection[o * n + sp]));
+					}
+				}
+			}
+		}
+	});
+
+	// The dense belief to record, if any.
+	std::vector<double> record;
+	if (beliefToRecord != nullptr) {
+		recordedValues.clear();
+		recordedValues.resize(k);
+
+		for (State *state : states) {
+			record.push_back(beliefToRecord->get(state));
+		}
+	}
+
+	// Create the set of alpha vectors for all value functions at once, which we call Gamma, as well as the
+	// previous Gamma set. Each is a k-r-n array, initialized to zero alpha vectors. These are the bulk of the
+	// memory for large models, so the values are stored as floats; each new alpha vector is accumulated in
+	// doubles, and only rounded when it is stored.
+	std::vector<float> gamma[2];
+	gamma[0].assign((size_t)k * r * n, 0.0f);
+	gamma[1].assign((size_t)k * r * n, 0.0f);
+	bool current = false;
+
+	// The largest change of any value, for each worker.
+	std::vector<double> residuals(std::max(1u, numThreads), 0.0);
+
+	// Perform a predefined number of updates, or until the values have converged.
+	for (unsigned int u = 0; u < updates; u++) {
+		const std::vector<float> &previous = gamma[!current];
+		std::vector<float> &next = gamma[current];
+
+		std::fill(residuals.begin(), residuals.end(), 0.0);
+
+		// For each of the belief points, compute the alpha vector of every value function following the policy.
+		execute_in_parallel(r, [&](unsigned int worker, unsigned int first, unsigned int last) {
+			std::vector<unsigned int> maxAlphaIndexes((size_t)k * z);
+			std::vector<double> alphas((size_t)k * n);
+
+			for (unsigned int j = first; j < last; j++) {
+				const std::vector<std::vector<std::pair<unsigned int, double> > > &successorsA = models.at(actions[j]).successors;
+				const std::vector<double> &observationProbabilitiesA = models.at(actions[j]).observationProbabilities;
+				const std::vector<double> &rewardsA = models.at(actions[j]).rewards;
+
+				// Select the maximal alpha-vector of the previous Gamma for each observation and value function.
+				for (unsigned int i = 0; i < k; i++) {
+					for (unsigned int o = 0; o < z; o++) {
+						double maxAlphaDotBeta = 0.0;
+						unsigned int maxAlphaIndex = 0;
+
+						for (unsigned int alphaIndex = 0; alphaIndex < r; alphaIndex++) {
+							const float *alpha = &previous[((size_t)i * r + alphaIndex) * n];
+
+							double alphaDotBeta = 0.0;
+							for (const std::pair<unsigned int, double> &weight : projections[j][o]) {
+								alphaDotBeta += weight.second * alpha[weight.first];
+							}
+
+							if (alphaIndex == 0 || alphaDotBeta > maxAlphaDotBeta) {
+								maxAlphaDotBeta = alphaDotBeta;
+								maxAlphaIndex = alphaIndex;
+							}
+						}
+
+						maxAlphaIndexes[i * z + o] = maxAlphaIndex;
+					}
+				}
+
+				// Compute the new alpha-vectors. The walk over T and O is shared by all k value functions.
+				std::copy(rewardsA.begin(), rewardsA.end(), alphas.begin());
+
+				for (unsigned int s = 0; s < n; s++) {
+					for (const std::pair<unsigned int, double> &successor : successorsA[s]) {
+						for (unsigned int o = 0; o < z; o++) {
+							double weight = discount * successor.second * observationProbabilitiesA[successor.first * z + o];
+							if (weight == 0.0) {
+								continue;
+							}
+
+							for (unsigned int i = 0; i < k; i++) {
+								alphas[i * n + s] += weight *
+										previous[((size_t)i * r + maxAlphaIndexes[i * z + o]) * n + successor.first];
+							}
+						}
+					}
+				}
+
+				for (unsigned int i = 0; i < k; i++) {
+					for (unsigned int s = 0; s < n; s++) {
+						size_t index = ((size_t)i * r + j) * n + s;
+						next[index] = (float)alphas[i * n + s];
+						residuals[worker] = std::max(residuals[worker], (double)std::fabs(next[index] - previous[index]));
+					}
+				}
+			}
+		});
+
+		double residual = *std::max_element(residuals.begin(), residuals.end());
+
+		std::cout << "    " << (u + 1) << " / " << updates << " (Residual: " << residual << ")" << std::endl; std::cout.flush();
+
+		// If we are recording values, compute the belief value here.
+		if (beliefToRecord != nullptr) {
+			for (unsigned int i = 0; i < k; i++) {
+				double maxRecordedValue = std::numeric_limits<double>::lowest();
+				for (unsigned int j = 0; j < r; j++) {
+					double recordedValue = 0.0;
+					for (unsigned int s = 0; s < n; s++) {
+						recordedValue += record[s] * next[((size_t)i * r + j) * n + s];
+					}
+					if (recordedValue > maxRecordedValue) {
+						maxRecordedValue = recordedValue;
+					}
+				}
+				recordedValues[i].push_back(maxRecordedValue);
+			}
+		}
+
+		current = !current;
+
+		if (residual < evaluationTolerance) {
+			break;
+		}
+	}
+
+	// Set the final Gamma of each value function to its policy object. Note: This transfers the responsibility of
+	// memory management to the PolicyAlphaVectors object.
+	for (unsigned int i = 0; i < k; i++) {
+		std::vector<PolicyAlphaVector *> gammaFinal;
+		for (unsigned int j = 0; j < r; j++) {
+			PolicyAlphaVector *alpha = new PolicyAlphaVector(actions[j]);
+			for (unsigned int s = 0; s < n; s++) {
+				alpha->set(states[s], gamma[!current][((size_t)i * r + j) * n + s]);
+			}
+			gammaFinal.push_back(alpha);
+		}
+		result[i]->set(gammaFinal);
+	}
+
+	return result;
+}
+
+PolicyAlphaVector *LPBVI::bellman_update_cached_belief_state(ObservationTransitions *O, Horizon *h,
+		std::vector<PolicyAlphaVector *> &gammaAStar, const LPBVIGamma &gamma,
+		Action *action, unsigned int beliefIndex)
+{
+	const std::vector<State *> &states = beliefCache.get_states();
+	const std::vector<Observation *> &observations = beliefCache.get_observations();
+	const std::vector<LPBVIBeliefSuccessor> &successors = beliefCache.get_successors(beliefIndex, action);
+	const std::vector<LPBVISparseBelief> &next = beliefCache.get_state_successors(action);
+
+	// Start with Gamma_{a, *}, then add the maximal projection of Gamma for each observation.
+	std::vector<double> values(states.size(), 0.0);
+	for (PolicyAlphaVector *alpha : gammaAStar) {
+		for (unsigned int s = 0; s < states.size(); s++) {
+			values[s] += alpha->get(states[s]);
+		}
+	}
+
+	for (unsigned int k = 0; k < observations.size(); k++) {
+		// Only the sign of the dot product with tau(b, a, z) matters for the maximum. If the observation is
+		// impossible, every projection has value 0 at b, so the first is selected.
+		if (gamma.size() == 0) {
+			continue;
+		}
+
+		unsigned int maxAlpha = 0;
+		double maxValue = 0.0;
+
+		for (unsigned int l = 0; l < gamma.size(); l++) {
+			double value = 0.0;
+			for (const std::pair<State *, double> &sp : successors[k].belief) {
+				value += sp.second * gamma.get(l, sp.first);
+			}
+
+			if (l == 0 || value > maxValue) {
+				maxAlpha = l;
+				maxValue = value;
+			}
+
+			if (successors[k].probability <= 0.0) {
+				break;
+			}
+		}
+
+		// The projection itself is over all states: gamma sum_{s'} T(s, a, s') O(a, s', z) alpha(s').
+		for (unsigned int s = 0; s < states.size(); s++) {
+			for (const std::pair<State *, double> &sp : next[s]) {
+				values[s] += h->get_discount_factor() * sp.second *
+						O->get(action, sp.first, observations[k]) * gamma.get(maxAlpha, sp.first);
+			}
+		}
+	}
+
+	PolicyAlphaVector *result = new PolicyAlphaVector(action);
+	for (unsigned int s = 0; s < states.size(); s++) {
+		result->set(states[s], values[s]);
+	}
+
+	return result;
+}
+
+double LPBVI::compute_belief_density(StatesMap *S)
+{
+	double density = 0.0;
+
+	for (BeliefState *bPrime : B) {
+		for (BeliefState *b : B) {
+			for (auto s : *S) {
+				State *state = resolve(s);
+				density = std::max(density, std::fabs(b->get(state) - bPrime->get(state)));
+			}
+		}
+	}
+
+	return density;
+}
+
+void LPBVI::expand_belief_points(StatesMap *S, ActionsMap *A, ObservationsMap *Z,
+		StateTransitions *T, ObservationTransitions *O, PolicyAlphaVectors *policy)
+{
+	switch (rule) {
+	case POMDPPBVIExpansionRule::NONE:
+		break;
+	case POMDPPBVIExpansionRule::RANDOM_BELIEF_SELECTION:
+		expand_random_belief_selection(S);
+		break;
+	case POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_RANDOM_ACTION:
+		expand_stochastic_simulation_random_actions(S, A, Z, T, O);
+		break;
+	case POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_GREEDY_ACTION:
+		expand_stochastic_simulation_greedy_action(S, A, Z, T, O, policy);
+		break;
+	case POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_EXPLORATORY_ACTION:
+		expand_stochastic_simulation_exploratory_action(S, A, Z, T, O);
+		break;
+	case POMDPPBVIExpansionRule::GREEDY_ERROR_REDUCTION:
+		expand_greedy_error_reduction();
+		break;
+	default:
+		throw PolicyException();
+		break;
+	};
+}
+
+void LPBVI::expand_stochastic_simulation_random_actions(StatesMap *S, ActionsMap *A,
+		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O)
+{
+	expand_stochastic_simulation_random_actions(S, A, Z, T, O, create_cached_beliefs(S, Z, T, O));
+}
+
+void LPBVI::expand_stochastic_simulation_random_actions(StatesMap *S, ActionsMap *A,
+		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+		const std::vector<LPBVISparseBelief> &candidates)
+{
+	// The actions and observations in a fixed order, so that the random streams select the same ones.
+	std::vector<Action *> actions;
+	for (auto a : *A) {
+		actions.push_back(resolve(a));
+	}
+	std::sort(actions.begin(), actions.end(), [](Action *a1, Action *a2) {
+		return a1->hash_value() < a2->hash_value();
+	});
+
+	std::vector<Observation *> observations;
+	for (auto z : *Z) {
+		observations.push_back(resolve(z));
+	}
+	std::sort(observations.begin(), observations.end(), [](Observation *z1, Observation *z2) {
+		return z1->hash_value() < z2->hash_value();
+	});
+
+	if (actions.empty() || observations.empty()) {
+		return;
+	}
+
+	// Each candidate only writes its own slots (bytes, not std::vector<bool>, which would share them between
+	// threads), so the merge below is in the order of the candidates.
+	std::vector<LPBVISparseBelief> successors(candidates.size());
+	std::vector<unsigned char> failed(candidates.size(), true);
+
+	execute_in_parallel(candidates.size(), [&](unsigned int worker, unsigned int first, unsigned int last) {
+		for (unsigned int j = first; j < last; j++) {
+			std::mt19937 generator = create_expansion_generator(j);
+			std::uniform_int_distribution<unsigned int> randomAction(0, actions.size() - 1);
+
+			Action *action = actions[randomAction(generator)];
+			failed[j] = simulate_candidate(S, T, O, observations, candidates, j, action, generator, successors[j]);
+		}
+	});
+
+	add_sparse_beliefs(successors, failed);
+}
+
+void LPBVI::expand_stochastic_simulation_greedy_action(StatesMap *S, ActionsMap *A,
+		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O, PolicyAlphaVectors *policy)
+{
+	expand_stochastic_simulation_greedy_action(S, A, Z, T, O, policy, create_cached_beliefs(S, Z, T, O));
+}
+
+void LPBVI::expand_stochastic_simulation_greedy_action(StatesMap *S, ActionsMap *A,
+		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O, PolicyAlphaVectors *policy,
+		const std::vector<LPBVISparseBelief> &candidates)
+{
+	if (policy == nullptr) {
+		throw PolicyException();
+	}
+
+	// The observations in a fixed order, so that the random streams select the same ones.
+	std::vector<Observation *> observations;
+	for (auto z : *Z) {
+		observations.push_back(resolve(z));
+	}
+	std::sort(observations.begin(), observations.end(), [](Observation *z1, Observation *z2) {
+		return z1->hash_value() < z2->hash_value();
+	});
+
+	// Each candidate only writes its own slots (bytes, not std::vector<bool>, which would share them between
+	// threads), so the merge below is in the order of the candidates.
+	std::vector<LPBVISparseBelief> successors(candidates.size());
+	std::vector<unsigned char> failed(candidates.size(), true);
+
+	execute_in_parallel(candidates.size(), [&](unsigned int worker, unsigned int first, unsigned int last) {
+		for (unsigned int j = first; j < last; j++) {
+			std::mt19937 generator = create_expansion_generator(j);
+
+			// The policy's action at this candidate. Since the policy was computed with the actions restricted
+			// by each of the previous value functions, this is the lexicographically greedy action.
+			BeliefState b;
+			for (const std::pair<State *, double> &s : candidates[j]) {
+				b.set(s.first, s.second);
+			}
+
+			Action *action = policy->get(&b);
+			if (action == nullptr) {
+				continue;
+			}
+
+			failed[j] = simulate_candidate(S, T, O, observations, candidates, j, action, generator, successors[j]);
+		}
+	});
+
+	add_sparse_beliefs(successors, failed);
+}
+
+void LPBVI::expand_stochastic_simulation_exploratory_action(StatesMap *S, ActionsMap *A,
+		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O)
+{
+	expand_stochastic_simulation_exploratory_action(S, A, Z, T, O, create_cached_beliefs(S, Z, T, O));
+}
+
+void LPBVI::expand_stochastic_simulation_exploratory_action(StatesMap *S, ActionsMap *A,
+		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+		const std::vector<LPBVISparseBelief> &candidates)
+{
+	// The actions and observations in a fixed order, so that the random streams select the same ones.
+	std::vector<Action *> actions;
+	for (auto a : *A) {
+		actions.push_back(resolve(a));
+	}
+	std::sort(actions.begin(), actions.end(), [](Action *a1, Action *a2) {
+		return a1->hash_value() < a2->hash_value();
+	});
+
+	std::vector<Observation *> observations;
+	for (auto z : *Z) {
+		observations.push_back(resolve(z));
+	}
+	std::sort(observations.begin(), observations.end(), [](Observation *z1, Observation *z2) {
+		return z1->hash_value() < z2->hash_value();
+	});
+
+	// Each candidate only writes its own slots (bytes, not std::vector<bool>, which would share them between
+	// threads), so the merge below is in the order of the candidates.
+	std::vector<LPBVISparseBelief> successors(candidates.size());
+	std::vector<unsigned char> failed(candidates.size(), true);
+
+	execute_in_parallel(candidates.size(), [&](unsigned int worker, unsigned int first, unsigned int last) {
+		LPBVISparseBelief successor;
+
+		for (unsigned int j = first; j < last; j++) {
+			std::mt19937 generator = create_expansion_generator(j);
+			double maxDistance = 0.0;
+
+			// Simulate each action, and keep the successor which is farthest from its nearest candidate.
+			for (Action *action : actions) {
+				if (simulate_candidate(S, T, O, observations, candidates, j, action, generator, successor)) {
+					continue;
+				}
+
+				double minDistance = std::numeric_limits<double>::max();
+				for (const LPBVISparseBelief &candidate : candidates) {
+					minDistance = std::min(minDistance, compute_sparse_distance(successor, candidate));
+				}
+
+				if (failed[j] || minDistance > maxDistance) {
+					maxDistance = minDistance;
+					successors[j] = successor;
+					failed[j] = false;
+				}
+			}
+		}
+	});
+
+	add_sparse_beliefs(successors, failed);
+}
+
+void LPBVI::create_sparse_beliefs(StatesMap *S, std::vector<LPBVISparseBelief> &result)
+{
+	std::vector<State *> states;
+	for (auto s : *S) {
+		states.push_back(resolve(s));
+	}
+	std::sort(states.begin(), states.end(), [](State *s1, State *s2) {
+		return s1->hash_value() < s2->hash_value();
+	});
+
+	result.clear();
+	result.resize(B.size());
+
+	execute_in_parallel(B.size(), [&](unsigned int worker, unsigned int first, unsigned int last) {
+		for (unsigned int j = first; j < last; j++) {
+			for (State *state : states) {
+				double probability = B[j]->get(state);
+				if (probability > 0.0) {
+					result[j].push_back(std::make_pair(state, probability));
+				}
+			}
+		}
+	});
+}
+
+const std::vector<LPBVISparseBelief> &LPBVI::create_cached_beliefs(StatesMap *S, ObservationsMap *Z,
+		StateTransitions *T, ObservationTransitions *O)
+{
+	beliefCache.update(get_model_identity(), S, Z, T, O, B);
+
+	execute_in_parallel(B.size(), [&](unsigned int worker, unsigned int first, unsigned int last) {
+		for (unsigned int j = first; j < last; j++) {
+			beliefCache.get_belief(j);
+		}
+	});
+
+	return beliefCache.get_beliefs();
+}
+
+void LPBVI::add_sparse_beliefs(const std::vector<LPBVISparseBelief> &successors,
+		const std::vector<unsigned char> &failed)
+{
+	for (unsigned int j = 0; j < successors.size(); j++) {
+		if (failed[j]) {
+			continue;
+		}
+
+		BeliefState *b = new BeliefState();
+		for (const std::pair<State *, double> &sp : successors[j]) {
+			b->set(sp.first, sp.second);
+		}
+		B.push_back(b);
+	}
+}
+
+bool LPBVI::simulate_sparse_belief(StatesMap *S, StateTransitions *T, ObservationTransitions *O,
+		const std::vector<Observation *> &observations, const LPBVISparseBelief &b, Action *action,
+		std::mt19937 &generator, LPBVISparseBelief &result) const
+{
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	std::vector<State *> successors;
+
+	result.clear();
+
+	if (b.empty()) {
+		return true;
+	}
+
+	// Randomly select a state following the belief.
+	double target = uniform(generator);
+	double current = 0.0;
+	State *state = b.back().first;
+	for (const std::pair<State *, double> &s : b) {
+		current += s.second;
+		if (current >= target) {
+			state = s.first;
+			break;
+		}
+	}
+
+	// Randomly select a successor state following the state transitions.
+	T->successors(S, state, action, successors);
+
+	target = uniform(generator);
+	current = 0.0;
+	State *nextState = nullptr;
+	for (State *sp : successors) {
+		double probability = T->get(state, action, sp);
+		if (probability <= 0.0) {
+			continue;
+		}
+		nextState = sp;
+		current += probability;
+		if (current >= target) {
+			break;
+		}
+	}
+	if (nextState == nullptr) {
+		return true;
+	}
+
+	// Randomly select an observation following the observation transitions.
+	target = uniform(generator);
+	current = 0.0;
+	Observation *observation = nullptr;
+	for (Observation *z : observations) {
+		double probability = O->get(action, nextState, z);
+		if (probability <= 0.0) {
+			continue;
+		}
+		observation = z;
+		current += probability;
+		if (current >= target) {
+			break;
+		}
+	}
+	if (observation == nullptr) {
+		return true;
+	}
+
+	// Compute the belief update, which is only non-zero over the successors of the belief's states.
+	std::unordered_map<State *, double> updated;
+	for (const std::pair<State *, double> &s : b) {
+		successors.clear();
+		T->successors(S, s.first, action, successors);
+
+		for (State *sp : successors) {
+			double probability = T->get(s.first, action, sp) * s.second;
+			if (probability > 0.0) {
+				updated[sp] += probability;
+			}
+		}
+	}
+
+	double normalizer = 0.0;
+	for (const auto &sp : updated) {
+		double probability = sp.second * O->get(action, sp.first, observation);
+		if (probability > 0.0) {
+			result.push_back(std::make_pair(sp.first, probability));
+			normalizer += probability;
+		}
+	}
+
+	if (normalizer <= 0.0) {
+		result.clear();
+		return true;
+	}
+
+	for (std::pair<State *, double> &sp : result) {
+		sp.second /= normalizer;
+	}
+	std::sort(result.begin(), result.end(), [](const std::pair<State *, double> &s1, const std::pair<State *, double> &s2) {
+		return s1.first->hash_value() < s2.first->hash_value();
+	});
+
+	return false;
+}
+
+bool LPBVI::simulate_candidate(StatesMap *S, StateTransitions *T, ObservationTransitions *O,
+		const std::vector<Observation *> &observations, const std::vector<LPBVISparseBelief> &candidates,
+		unsigned int candidate, Action *action, std::mt19937 &generator, LPBVISparseBelief &result)
+{
+	// Note: The candidates are B itself only if they are the belief cache's own vector, since the index of a
+	// candidate must be the index of its belief point in B.
+	if (&candidates != &beliefCache.get_beliefs()) {
+		return simulate_sparse_belief(S, T, O, observations, candidates[candidate], action, generator, result);
+	}
+
+	const std::vector<LPBVIBeliefSuccessor> &successors = beliefCache.get_successors(candidate, action);
+
+	// Randomly select an observation following Pr(z | b, a), which is the same distribution as sampling a
+	// state, a successor, and then an observation.
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	double target = uniform(generator);
+	double current = 0.0;
+	const LPBVIBeliefSuccessor *observed = nullptr;
+	for (const LPBVIBeliefSuccessor &successor : successors) {
+		if (successor.probability <= 0.0) {
+			continue;
+		}
+		observed = &successor;
+		current += successor.probability;
+		if (current >= target) {
+			break;
+		}
+	}
+
+	result.clear();
+	if (observed == nullptr) {
+		return true;
+	}
+
+	result = observed->belief;
+
+	return false;
+}
+
+double LPBVI::compute_sparse_distance(const LPBVISparseBelief &b1, const LPBVISparseBelief &b2) const
+{
+	double distance = 0.0;
+
+	// Both are sorted by the states' hash values, so merge them.
+	auto i1 = b1.begin();
+	auto i2 = b2.begin();
+	while (i1 != b1.end() || i2 != b2.end()) {
+		if (i2 == b2.end() || (i1 != b1.end() && i1->first->hash_value() < i2->first->hash_value())) {
+			distance += std::fabs(i1->second);
+			i1++;
+		} else if (i1 == b1.end() || i2->first->hash_value() < i1->first->hash_value()) {
+			distance += std::fabs(i2->second);
+			i2++;
+		} else {
+			distance += std::fabs(i1->second - i2->second);
+			i1++;
+			i2++;
+		}
+	}
+
+	return distance;
+}
+
+std::mt19937 LPBVI::create_expansion_generator(unsigned int candidate) const
+{
+	std::seed_seq sequence{expansionSeed, (unsigned int)B.size(), candidate};
+	return std::mt19937(sequence);
+}
+
+void LPBVI::execute_in_parallel(unsigned int size,
+		const std::function<void (unsigned int worker, unsigned int first, unsigned int last)> &work)
+{
+	execute_in_parallel(size, numThreads, work);
+}
+
+void LPBVI::execute_in_parallel(unsigned int size, unsigned int threads,
+		const std::function<void (unsigned int worker, unsigned int first, unsigned int last)> &work)
+{
+	unsigned int workers = std::max(1u, std::min(threads, size));
+
+	// The single worker case simply runs on the calling thread.
+	if (workers == 1 && !numa) {
+		work(0, 0, size);
+		return;
+	}
+
+	std::vector<std::thread> workerThreads;
+	std::vector<std::exception_ptr> errors(workers, nullptr);
+
+	for (unsigned int w = 0; w < workers; w++) {
+		unsigned int first = (unsigned int)((unsigned long)w * size / workers);
+		unsigned int last = (unsigned int)((unsigned long)(w + 1) * size / workers);
+		unsigned int node = numaTopology.get_worker_node(w, workers);
+
+		workerThreads.push_back(std::thread([&, w, first, last, node]() {
+			try {
+				if (numa) {
+					numaTopology.pin_current_thread(node);
+				}
+				work(w, first, last);
+			} catch (...) {
+				errors[w] = std::current_exception();
+			}
+		}));
+
+		if (numa && node < numaWorkItems.size()) {
+			numaWorkItems[node] += last - first;
+		}
+	}
+
+	for (std::thread &thread : workerThreads) {
+		thread.join();
+	}
+
+	for (std::exception_ptr &err : errors) {
+		if (err != nullptr) {
+			std::rethrow_exception(err);
+		}
+	}
+}
+
+void LPBVI::numa_place_model(StatesMap *S, ActionsMap *A, ObservationsMap *Z,
+		StateTransitions *T, ObservationTransitions *O, FactoredRewards *R)
+{
+	if (!numa) {
+		return;
+	}
+
+	size_t n = S->get_num_states();
+	size_t m = A->get_num_actions();
+	size_t z = Z->get_num_observations();
+
+	StateTransitionsArray *Tarray = dynamic_cast<StateTransitionsArray *>(T);
+	if (Tarray != nullptr) {
+		numaTopology.interleave(Tarray->get_state_transitions(), n * m * n * sizeof(float));
+	}
+
+	LPOMDPSparseStateTransitions *Tsparse = dynamic_cast<LPOMDPSparseStateTransitions *>(T);
+	if (Tsparse != nullptr) {
+		numaTopology.interleave(Tsparse->get_row_offsets(), (n * m + 1) * sizeof(unsigned long long));
+		numaTopology.interleave(Tsparse->get_entries(), Tsparse->get_num_entries() * sizeof(LPOMDPMappedTransition));
+	}
+
+	ObservationTransitionsArray *Oarray = dynamic_cast<ObservationTransitionsArray *>(O);
+	if (Oarray != nullptr) {
+		numaTopology.interleave(Oarray->get_observation_transitions(), m * n * z * sizeof(float));
+	}
+
+	for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
+		SARewardsArray *Ri = dynamic_cast<SARewardsArray *>(R->get(i));
+		if (Ri != nullptr) {
+			numaTopology.interleave(Ri->get_rewards(), n * m * sizeof(float));
+		}
+	}
+
+	std::cout << "Interleaved the model over " << numaTopology.get_num_nodes() << " NUMA node(s)." << std::endl; std::cout.flush();
+}
+
+void LPBVI::numa_place_belief_points()
+{
+	if (!numa) {
+		return;
+	}
+
+	// Note: The worker's new copy is first touched on the worker's node. This must be done before
+	// the sets of available actions are created, since they are keyed by the belief point. Expansions
+	// only append to B, so only the new belief points are copied; these are not yet in the cache.
+	execute_in_parallel(B.size(), [&](unsigned int worker, unsigned int first, unsigned int last) {
+		for (unsigned int j = std::max(first, numaPlacedBeliefs); j < last; j++) {
+			BeliefState *b = new BeliefState(*B[j]);
+			delete B[j];
+			B[j] = b;
+		}
+	});
+
+	numaPlacedBeliefs = B.size();
+}
+
+void LPBVI::numa_print_counters()
+{
+	if (!numa) {
+		return;
+	}
+
+	std::vector<NUMACounters> counters;
+	numaTopology.get_counters(counters);
+
+	for (unsigned int node = 0; node < numaTopology.get_num_nodes(); node++) {
+		std::cout << "NUMA Node " << node << ": Belief Points Processed " << numaWorkItems[node];
+
+		// Note: These are the kernel's counters for the whole system, not only this solve's memory.
+		if (node < counters.size() && node < numaInitialCounters.size()) {
+			std::cout << ", System-Wide numastat: local_node +" <<
+					(counters[node].localNode - numaInitialCounters[node].localNode);
+			std::cout << ", other_node +" << (counters[node].otherNode - numaInitialCounters[node].otherNode);
+			std::cout << ", numa_miss +" << (counters[node].numaMiss - numaInitialCounters[node].numaMiss);
+		}
+
+		std::cout << std::endl;
+	}
+	std::cout.flush();
+}
+
+void LPBVI::save_checkpoint(StatesMap *S, ActionsMap *A, unsigned int expansion, unsigned int objective,
+		unsigned int update, const std::map<BeliefState *, std::vector<Action *> > &Ai,
+		const std::vector<std::vector<PolicyAlphaVector *> > &completed,
+		const std::vector<PolicyAlphaVector *> &gamma)
+{
+	LPBVICheckpoint checkpoint;
+	checkpoint.expansion = expansion;
+	checkpoint.objective = objective;
+	checkpoint.update = update;
+	checkpoint.expansionSeed = expansionSeed;
+	checkpoint.B = B;
+	for (BeliefState *b : B) {
+		checkpoint.Ai.push_back(Ai.at(b));
+	}
+	checkpoint.completed = completed;
+	checkpoint.gamma = gamma;
+	checkpoint.recordedValues = recordedValues;
+
+	// Note: A checkpoint is only a safeguard, so failing to write one does not stop the solve.
+	if (checkpoint.save(checkpointFilename, S, A)) {
+		std::cerr << "Failed to write a checkpoint; continuing without it." << std::endl;
+	}
+}
+
+bool LPBVI::is_stop_requested() const
+{
+	if (cancellationToken != nullptr && cancellationToken->is_cancelled()) {
+		return true;
+	}
+
+	if (timeLimit > 0.0) {
+		auto now = std::chrono::high_resolution_clock::now();
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - solveStart);
+		if ((double)elapsed.count() / 1000.0 >= timeLimit) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void LPBVI::snapshot_value_functions(PolicyAlphaVectors **expansionPolicy, unsigned int numCompleted,
+		unsigned int k)
+{
+	if (snapshotCallback && numCompleted > 0 && numCompleted < k) {
+		snapshotCallback(expansionPolicy, numCompleted, true);
+	}
 }
 
 void LPBVI::reset()
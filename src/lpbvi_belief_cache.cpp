@@ -0,0 +1,258 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/lpbvi_belief_cache.h"
+
+#include <algorithm>
+
+LPBVIBeliefCache::LPBVIBeliefCache()
+{
+	model = 0;
+	S = nullptr;
+	Z = nullptr;
+	T = nullptr;
+	O = nullptr;
+	revalidating = false;
+}
+
+LPBVIBeliefCache::~LPBVIBeliefCache()
+{ }
+
+void LPBVIBeliefCache::update(unsigned long long model, StatesMap *S, ObservationsMap *Z, StateTransitions *T,
+		ObservationTransitions *O, const std::vector<BeliefState *> &B)
+{
+	// A different model invalidates everything, including the fixed orders of the states and observations.
+	// Note: The model is compared by its identity, since a new model may be allocated at the same addresses.
+	if (model == 0 || model != this->model) {
+		clear();
+
+		this->model = model;
+		this->S = S;
+		this->Z = Z;
+		this->T = T;
+		this->O = O;
+
+		for (auto s : *S) {
+			states.push_back(resolve(s));
+		}
+		std::sort(states.begin(), states.end(), [](State *s1, State *s2) {
+			return s1->hash_value() < s2->hash_value();
+		});
+		for (unsigned int i = 0; i < states.size(); i++) {
+			stateIndexes[states[i]] = i;
+		}
+
+		for (auto z : *Z) {
+			observations.push_back(resolve(z));
+		}
+		std::sort(observations.begin(), observations.end(), [](Observation *z1, Observation *z2) {
+			return z1->hash_value() < z2->hash_value();
+		});
+	}
+
+	keys.resize(B.size(), nullptr);
+	ready.resize(B.size(), SLOT_EMPTY);
+	beliefs.resize(B.size());
+	successors.resize(B.size());
+
+	// Only the slots whose belief point changed are invalidated. Since expansions only append to B, all of
+	// the previous belief points keep their successors. When revalidating, every computed slot is kept, but
+	// stale, even if the pointer is the same, since the old belief point's memory may have been reused.
+	for (unsigned int j = 0; j < B.size(); j++) {
+		if (revalidating && ready[j] != SLOT_EMPTY) {
+			keys[j] = B[j];
+			ready[j] = SLOT_STALE;
+		} else if (keys[j] != B[j]) {
+			keys[j] = B[j];
+			ready[j] = SLOT_EMPTY;
+			beliefs[j].clear();
+			successors[j].clear();
+		}
+	}
+
+	revalidating = false;
+}
+
+void LPBVIBeliefCache::clear()
+{
+	model = 0;
+	S = nullptr;
+	Z = nullptr;
+	T = nullptr;
+	O = nullptr;
+
+	states.clear();
+	stateIndexes.clear();
+	observations.clear();
+
+	keys.clear();
+	ready.clear();
+	beliefs.clear();
+	successors.clear();
+
+	revalidating = false;
+
+	std::lock_guard<std::mutex> lock(stateSuccessorsMutex);
+	stateSuccessors.clear();
+}
+
+void LPBVIBeliefCache::revalidate()
+{
+	revalidating = true;
+}
+
+const LPBVISparseBelief &LPBVIBeliefCache::get_belief(unsigned int beliefIndex)
+{
+	if (ready[beliefIndex] == SLOT_READY) {
+		return beliefs[beliefIndex];
+	}
+
+	LPBVISparseBelief b;
+	for (State *state : states) {
+		double probability = keys[beliefIndex]->get(state);
+		if (probability > 0.0) {
+			b.push_back(std::make_pair(state, probability));
+		}
+	}
+
+	// A stale slot keeps its successors only if its belief point is exactly the same as before.
+	if (ready[beliefIndex] == SLOT_EMPTY || b != beliefs[beliefIndex]) {
+		beliefs[beliefIndex].swap(b);
+		successors[beliefIndex].clear();
+	}
+	ready[beliefIndex] = SLOT_READY;
+
+	return beliefs[beliefIndex];
+}
+
+const std::vector<LPBVISparseBelief> &LPBVIBeliefCache::get_beliefs() const
+{
+	return beliefs;
+}
+
+const std::vector<LPBVIBeliefSuccessor> &LPBVIBeliefCache::get_successors(unsigned int beliefIndex, Action *action)
+{
+	const LPBVISparseBelief &b = get_belief(beliefIndex);
+
+	auto cached = successors[beliefIndex].find(action);
+	if (cached != successors[beliefIndex].end()) {
+		return cached->second;
+	}
+
+	const std::vector<LPBVISparseBelief> &next = get_state_successors(action);
+
+	// The predicted belief point, sum_{s} T(s, a, s') b(s), which is only non-zero over the successors
+	// of the belief's states. It is shared by all of the observations.
+	std::unordered_map<State *, double> prediction;
+	for (const std::pair<State *, double> &s : b) {
+		for (const std::pair<State *, double> &sp : next[stateIndexes.at(s.first)]) {
+			prediction[sp.first] += sp.second * s.second;
+		}
+	}
+
+	// Note: The sums below are in the order of the states' hash values, not of the map (i.e., of the
+	// pointers), so that they are the same in every process; a resumed solve relies on this.
+	LPBVISparseBelief predicted(prediction.begin(), prediction.end());
+	std::sort(predicted.begin(), predicted.end(),
+			[](const std::pair<State *, double> &s1, const std::pair<State *, double> &s2) {
+		return s1.first->hash_value() < s2.first->hash_value();
+	});
+
+	std::vector<LPBVIBeliefSuccessor> &result = successors[beliefIndex][action];
+	result.resize(observations.size());
+
+	for (unsigned int k = 0; k < observations.size(); k++) {
+		LPBVIBeliefSuccessor &successor = result[k];
+		successor.probability = 0.0;
+
+		for (const auto &sp : predicted) {
+			double probability = sp.second * O->get(action, sp.first, observations[k]);
+			if (probability > 0.0) {
+				successor.belief.push_back(std::make_pair(sp.first, probability));
+				successor.probability += probability;
+			}
+		}
+
+		if (successor.probability <= 0.0) {
+			successor.probability = 0.0;
+			successor.belief.clear();
+			continue;
+		}
+
+		for (std::pair<State *, double> &sp : successor.belief) {
+			sp.second /= successor.probability;
+		}
+	}
+
+	return result;
+}
+
+const std::vector<LPBVISparseBelief> &LPBVIBeliefCache::get_state_successors(Action *action)
+{
+	// Note: The references to the elements of an unordered_map remain valid as others are inserted, so the
+	// result may be used after the lock is released.
+	{
+		std::lock_guard<std::mutex> lock(stateSuccessorsMutex);
+
+		auto cached = stateSuccessors.find(action);
+		if (cached != stateSuccessors.end()) {
+			return cached->second;
+		}
+	}
+
+	// The successor states are computed without the lock, so that other actions' are not blocked. If another
+	// thread computed the same action's first, its result is kept and this one is discarded.
+	std::vector<LPBVISparseBelief> result(states.size());
+
+	std::vector<State *> next;
+	for (unsigned int i = 0; i < states.size(); i++) {
+		next.clear();
+		T->successors(S, states[i], action, next);
+
+		for (State *sp : next) {
+			double probability = T->get(states[i], action, sp);
+			if (probability > 0.0) {
+				result[i].push_back(std::make_pair(sp, probability));
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(stateSuccessorsMutex);
+	return stateSuccessors.emplace(action, std::move(result)).first->second;
+}
+
+const std::vector<State *> &LPBVIBeliefCache::get_states() const
+{
+	return states;
+}
+
+unsigned int LPBVIBeliefCache::get_state_index(State *state) const
+{
+	return stateIndexes.at(state);
+}
+
+const std::vector<Observation *> &LPBVIBeliefCache::get_observations() const
+{
+	return observations;
+}
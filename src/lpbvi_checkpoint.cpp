@@ -0,0 +1,442 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "../include/lpbvi_checkpoint.h"
+
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+/**
+ * The magic bytes at the start and end of a checkpoint file, which include the format's version.
+ */
+#define LPBVI_CHECKPOINT_MAGIC "LPBVICK1"
+#define LPBVI_CHECKPOINT_MAGIC_SIZE 8
+
+/**
+ * The action index stored for an alpha vector which does not have an action.
+ */
+#define LPBVI_CHECKPOINT_NO_ACTION 0xFFFFFFFF
+
+/**
+ * Write the raw bytes of a value.
+ * @param	file	The output file.
+ * @param	value	The value.
+ */
+template <typename T>
+static void write_value(std::ofstream &file, const T &value)
+{
+	file.write((const char *)&value, sizeof(T));
+}
+
+/**
+ * Read the raw bytes of a value.
+ * @param	file	The input file.
+ * @param	value	The value. This will be modified.
+ * @return	Returns true if an error arose, and false otherwise.
+ */
+template <typename T>
+static bool read_value(std::ifstream &file, T &value)
+{
+	file.read((char *)&value, sizeof(T));
+	return !file;
+}
+
+/**
+ * Sync a file's contents to the disk.
+ * @param	filename	The name of the file, or directory.
+ * @return	Returns true if an error arose, and false otherwise.
+ */
+static bool sync_file(std::string filename)
+{
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return true;
+	}
+
+	bool failed = (fsync(fd) != 0);
+	close(fd);
+
+	return failed;
+}
+
+LPBVICheckpoint::LPBVICheckpoint()
+{
+	expansion = 0;
+	objective = 0;
+	update = 0;
+	expansionSeed = 0;
+	loaded = false;
+}
+
+LPBVICheckpoint::~LPBVICheckpoint()
+{
+	free_loaded();
+}
+
+bool LPBVICheckpoint::save(std::string filename, StatesMap *S, ActionsMap *A) const
+{
+	std::vector<State *> states;
+	std::vector<Action *> actions;
+	if (create_orders(S, A, states, actions)) {
+		std::cerr << "Failed to save the checkpoint: the states and actions must have unique hash values." << std::endl;
+		return true;
+	}
+
+	std::unordered_map<const Action *, unsigned int> actionIndexes;
+	for (unsigned int a = 0; a < actions.size(); a++) {
+		actionIndexes[actions[a]] = a;
+	}
+
+	auto writeAlphaVectors = [&](std::ofstream &file, const std::vector<PolicyAlphaVector *> &alphas) {
+		write_value(file, (unsigned int)alphas.size());
+		for (const PolicyAlphaVector *alpha : alphas) {
+			const Action *action = alpha->get_action();
+			write_value(file, (action == nullptr) ? LPBVI_CHECKPOINT_NO_ACTION : actionIndexes.at(action));
+			for (State *state : states) {
+				write_value(file, alpha->get(state));
+			}
+		}
+	};
+
+	std::string temporaryFilename = filename + ".tmp";
+
+	std::ofstream file(temporaryFilename, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cerr << "Failed to open the checkpoint file '" << temporaryFilename << "'." << std::endl;
+		return true;
+	}
+
+	file.write(LPBVI_CHECKPOINT_MAGIC, LPBVI_CHECKPOINT_MAGIC_SIZE);
+
+	// The model, by the hash values of its states and actions, so that loading can verify it.
+	write_value(file, (unsigned int)states.size());
+	for (State *state : states) {
+		write_value(file, state->hash_value());
+	}
+	write_value(file, (unsigned int)actions.size());
+	for (Action *action : actions) {
+		write_value(file, action->hash_value());
+	}
+
+	write_value(file, expansion);
+	write_value(file, objective);
+	write_value(file, update);
+	write_value(file, expansionSeed);
+
+	// The belief points, sparsely, and then the ordered actions available at each.
+	write_value(file, (unsigned int)B.size());
+	for (BeliefState *b : B) {
+		std::vector<std::pair<unsigned int, double> > nonZero;
+		for (unsigned int s = 0; s < states.size(); s++) {
+			double probability = b->get(states[s]);
+			if (probability != 0.0) {
+				nonZero.push_back(std::make_pair(s, probability));
+			}
+		}
+
+		write_value(file, (unsigned int)nonZero.size());
+		for (const std::pair<unsigned int, double> &s : nonZero) {
+			write_value(file, s.first);
+			write_value(file, s.second);
+		}
+	}
+
+	for (unsigned int j = 0; j < B.size(); j++) {
+		write_value(file, (unsigned int)Ai[j].size());
+		for (Action *action : Ai[j]) {
+			write_value(file, actionIndexes.at(action));
+		}
+	}
+
+	write_value(file, (unsigned int)completed.size());
+	for (const std::vector<PolicyAlphaVector *> &alphas : completed) {
+		writeAlphaVectors(file, alphas);
+	}
+	writeAlphaVectors(file, gamma);
+
+	write_value(file, (unsigned int)recordedValues.size());
+	for (const std::vector<double> &values : recordedValues) {
+		write_value(file, (unsigned int)values.size());
+		for (double value : values) {
+			write_value(file, value);
+		}
+	}
+
+	file.write(LPBVI_CHECKPOINT_MAGIC, LPBVI_CHECKPOINT_MAGIC_SIZE);
+
+	file.close();
+	if (file.fail()) {
+		std::cerr << "Failed to write the checkpoint file '" << temporaryFilename << "'." << std::endl;
+		std::remove(temporaryFilename.c_str());
+		return true;
+	}
+
+	// Note: The contents must be on the disk before the rename, or a crash could leave an empty file in
+	// place of the last checkpoint. The directory is synced afterwards so that the rename itself persists.
+	if (sync_file(temporaryFilename) || std::rename(temporaryFilename.c_str(), filename.c_str()) != 0) {
+		std::cerr << "Failed to replace the checkpoint file '" << filename << "'." << std::endl;
+		std::remove(temporaryFilename.c_str());
+		return true;
+	}
+
+	size_t slash = filename.find_last_of('/');
+	sync_file((slash == std::string::npos) ? "." : filename.substr(0, std::max((size_t)1, slash)));
+
+	return false;
+}
+
+bool LPBVICheckpoint::load(std::string filename, StatesMap *S, ActionsMap *A)
+{
+	std::vector<State *> states;
+	std::vector<Action *> actions;
+	if (create_orders(S, A, states, actions)) {
+		std::cerr << "Failed to load the checkpoint: the states and actions must have unique hash values." << std::endl;
+		return true;
+	}
+
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open()) {
+		std::cerr << "Failed to open the checkpoint file '" << filename << "'." << std::endl;
+		return true;
+	}
+
+	// Anything loaded before is freed, and everything created from here on is owned by this object.
+	free_loaded();
+	loaded = true;
+
+	// Everything created so far is freed if the file is invalid, so that nothing is returned partially.
+	auto fail = [&](std::string reason) {
+		std::cerr << "Failed to load the checkpoint file '" << filename << "': " << reason << "." << std::endl;
+		free_loaded();
+		return true;
+	};
+
+	auto readAlphaVectors = [&](std::vector<PolicyAlphaVector *> &alphas) {
+		unsigned int count = 0;
+		if (read_value(file, count)) {
+			return true;
+		}
+
+		for (unsigned int j = 0; j < count; j++) {
+			unsigned int a = 0;
+			if (read_value(file, a) || (a != LPBVI_CHECKPOINT_NO_ACTION && a >= actions.size())) {
+				return true;
+			}
+
+			PolicyAlphaVector *alpha = (a == LPBVI_CHECKPOINT_NO_ACTION) ?
+					new PolicyAlphaVector() : new PolicyAlphaVector(actions[a]);
+			alphas.push_back(alpha);
+
+			for (State *state : states) {
+				double value = 0.0;
+				if (read_value(file, value)) {
+					return true;
+				}
+				alpha->set(state, value);
+			}
+		}
+
+		return false;
+	};
+
+	char magic[LPBVI_CHECKPOINT_MAGIC_SIZE];
+	file.read(magic, LPBVI_CHECKPOINT_MAGIC_SIZE);
+	if (!file || std::memcmp(magic, LPBVI_CHECKPOINT_MAGIC, LPBVI_CHECKPOINT_MAGIC_SIZE) != 0) {
+		return fail("not a checkpoint of this version");
+	}
+
+	unsigned int n = 0;
+	if (read_value(file, n) || n != states.size()) {
+		return fail("the number of states differs");
+	}
+	for (State *state : states) {
+		unsigned int hash = 0;
+		if (read_value(file, hash) || hash != state->hash_value()) {
+			return fail("the states differ");
+		}
+	}
+
+	unsigned int m = 0;
+	if (read_value(file, m) || m != actions.size()) {
+		return fail("the number of actions differs");
+	}
+	for (Action *action : actions) {
+		unsigned int hash = 0;
+		if (read_value(file, hash) || hash != action->hash_value()) {
+			return fail("the actions differ");
+		}
+	}
+
+	if (read_value(file, expansion) || read_value(file, objective) || read_value(file, update) ||
+			read_value(file, expansionSeed)) {
+		return fail("it is truncated");
+	}
+
+	unsigned int r = 0;
+	if (read_value(file, r)) {
+		return fail("it is truncated");
+	}
+
+	for (unsigned int j = 0; j < r; j++) {
+		BeliefState *b = new BeliefState();
+		B.push_back(b);
+
+		unsigned int count = 0;
+		if (read_value(file, count)) {
+			return fail("it is truncated");
+		}
+
+		for (unsigned int k = 0; k < count; k++) {
+			unsigned int s = 0;
+			double probability = 0.0;
+			if (read_value(file, s) || read_value(file, probability) || s >= states.size()) {
+				return fail("a belief point is invalid");
+			}
+			b->set(states[s], probability);
+		}
+	}
+
+	Ai.resize(r);
+	for (unsigned int j = 0; j < r; j++) {
+		unsigned int count = 0;
+		if (read_value(file, count)) {
+			return fail("it is truncated");
+		}
+
+		for (unsigned int k = 0; k < count; k++) {
+			unsigned int a = 0;
+			if (read_value(file, a) || a >= actions.size()) {
+				return fail("an available action is invalid");
+			}
+			Ai[j].push_back(actions[a]);
+		}
+	}
+
+	unsigned int numCompleted = 0;
+	if (read_value(file, numCompleted) || numCompleted != objective) {
+		return fail("the completed value functions are invalid");
+	}
+
+	completed.resize(numCompleted);
+	for (std::vector<PolicyAlphaVector *> &alphas : completed) {
+		if (readAlphaVectors(alphas)) {
+			return fail("an alpha vector is invalid");
+		}
+	}
+	if (readAlphaVectors(gamma) || gamma.size() != B.size()) {
+		return fail("an alpha vector is invalid");
+	}
+
+	unsigned int k = 0;
+	if (read_value(file, k)) {
+		return fail("it is truncated");
+	}
+
+	recordedValues.resize(k);
+	for (std::vector<double> &values : recordedValues) {
+		unsigned int count = 0;
+		if (read_value(file, count)) {
+			return fail("it is truncated");
+		}
+
+		values.resize(count);
+		for (double &value : values) {
+			if (read_value(file, value)) {
+				return fail("it is truncated");
+			}
+		}
+	}
+
+	file.read(magic, LPBVI_CHECKPOINT_MAGIC_SIZE);
+	if (!file || std::memcmp(magic, LPBVI_CHECKPOINT_MAGIC, LPBVI_CHECKPOINT_MAGIC_SIZE) != 0) {
+		return fail("it is truncated");
+	}
+
+	return false;
+}
+
+void LPBVICheckpoint::free_loaded()
+{
+	if (!loaded) {
+		return;
+	}
+
+	for (BeliefState *b : B) {
+		delete b;
+	}
+	for (std::vector<PolicyAlphaVector *> &alphas : completed) {
+		for (PolicyAlphaVector *alpha : alphas) {
+			delete alpha;
+		}
+	}
+	for (PolicyAlphaVector *alpha : gamma) {
+		delete alpha;
+	}
+
+	B.clear();
+	Ai.clear();
+	completed.clear();
+	gamma.clear();
+	recordedValues.clear();
+
+	loaded = false;
+}
+
+bool LPBVICheckpoint::create_orders(StatesMap *S, ActionsMap *A, std::vector<State *> &states,
+		std::vector<Action *> &actions) const
+{
+	for (auto s : *S) {
+		states.push_back(resolve(s));
+	}
+	std::sort(states.begin(), states.end(), [](State *s1, State *s2) {
+		return s1->hash_value() < s2->hash_value();
+	});
+
+	for (auto a : *A) {
+		actions.push_back(resolve(a));
+	}
+	std::sort(actions.begin(), actions.end(), [](Action *a1, Action *a2) {
+		return a1->hash_value() < a2->hash_value();
+	});
+
+	for (unsigned int s = 1; s < states.size(); s++) {
+		if (states[s - 1]->hash_value() == states[s]->hash_value()) {
+			return true;
+		}
+	}
+	for (unsigned int a = 1; a < actions.size(); a++) {
+		if (actions[a - 1]->hash_value() == actions[a]->hash_value()) {
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -25,8 +25,11 @@
 
 #include "../include/lpbvi_cuda.h"
 #include "../include/lpomdp.h"
+#include "../include/lpomdp_sparse_state_transitions.h"
+#include "../include/lpomdp_mapped.h"
 
 #include "../lpbvi_cuda/lpbvi_cuda.h"
+#include "../lpbvi_cuda/lpbvi_host.h"
 
 #include "../../librbr/librbr/include/pomdp/pomdp_utilities.h"
 
@@ -36,7 +39,6 @@
 #include "../../librbr/librbr/include/core/actions/indexed_action.h"
 #include "../../librbr/librbr/include/core/observations/indexed_observation.h"
 
-#include "../../librbr/librbr/include/core/state_transitions/state_transitions_array.h"
 #include "../../librbr/librbr/include/core/observation_transitions/observation_transitions_array.h"
 #include "../../librbr/librbr/include/core/rewards/sa_rewards_array.h"
 
@@ -60,6 +62,84 @@
 
 #include <chrono>
 
+/**
+ * The functions of one implementation of the lpbvi_cuda.h API. The host implementation takes exactly
+ * the same arguments as the device one.
+ */
+struct LPBVICudaBackendFunctions {
+	decltype(&lpbvi_cuda) execute;
+	decltype(&lpbvi_initialize_belief_points) initialize_belief_points;
+	decltype(&lpbvi_initialize_state_transitions) initialize_state_transitions;
+	decltype(&lpbvi_initialize_observation_transitions) initialize_observation_transitions;
+	decltype(&lpbvi_initialize_rewards) initialize_rewards;
+	decltype(&lpbvi_initialize_nonzero_beliefs) initialize_nonzero_beliefs;
+	decltype(&lpbvi_initialize_successors) initialize_successors;
+	decltype(&lpbvi_uninitialize) uninitialize;
+};
+
+static const LPBVICudaBackendFunctions LPBVI_CUDA_DEVICE_FUNCTIONS = {
+	lpbvi_cuda,
+	lpbvi_initialize_belief_points,
+	lpbvi_initialize_state_transitions,
+	lpbvi_initialize_observation_transitions,
+	lpbvi_initialize_rewards,
+	lpbvi_initialize_nonzero_beliefs,
+	lpbvi_initialize_successors,
+	lpbvi_uninitialize
+};
+
+static const LPBVICudaBackendFunctions LPBVI_CUDA_HOST_FUNCTIONS = {
+	lpbvi_host,
+	lpbvi_host_initialize_belief_points,
+	lpbvi_host_initialize_state_transitions,
+	lpbvi_host_initialize_observation_transitions,
+	lpbvi_host_initialize_rewards,
+	lpbvi_host_initialize_nonzero_beliefs,
+	lpbvi_host_initialize_successors,
+	lpbvi_host_uninitialize
+};
+
+/**
+ * Get the dense m-n-z array of the observation transitions, for the types which store one: the arrays of
+ * librbr, and the mapped ones of compiled models and POMDP files.
+ * @param	O	The observation transitions.
+ * @return	The array, or null if they do not store one.
+ */
+static const float *get_observation_transitions_array(ObservationTransitions *O)
+{
+	ObservationTransitionsArray *Oarray = dynamic_cast<ObservationTransitionsArray *>(O);
+	if (Oarray != nullptr) {
+		return Oarray->get_observation_transitions();
+	}
+
+	LPOMDPMappedObservationTransitions *Omapped = dynamic_cast<LPOMDPMappedObservationTransitions *>(O);
+	if (Omapped != nullptr) {
+		return Omapped->get_observation_transitions();
+	}
+
+	return nullptr;
+}
+
+/**
+ * Get the dense n-m array of a reward, for the types which store one, as above.
+ * @param	Ri	The reward.
+ * @return	The array, or null if it does not store one.
+ */
+static const float *get_rewards_array(Rewards *Ri)
+{
+	SARewardsArray *Rarray = dynamic_cast<SARewardsArray *>(Ri);
+	if (Rarray != nullptr) {
+		return Rarray->get_rewards();
+	}
+
+	LPOMDPMappedRewards *Rmapped = dynamic_cast<LPOMDPMappedRewards *>(Ri);
+	if (Rmapped != nullptr) {
+		return Rmapped->get_rewards();
+	}
+
+	return nullptr;
+}
+
 LPBVICuda::LPBVICuda() : LPBVI()
 {
 	d_B = nullptr;
@@ -71,6 +151,9 @@ LPBVICuda::LPBVICuda() : LPBVI()
 	d_SuccessorStates = nullptr;
 	maxNonZeroBeliefStates = 1;
 	maxSuccessorStates = 1;
+	backend = LPBVICudaBackend::DEVICE;
+	functions = &LPBVI_CUDA_DEVICE_FUNCTIONS;
+	stagedSession = nullptr;
 }
 
 LPBVICuda::~LPBVICuda()
@@ -80,14 +163,35 @@ LPBVICuda::~LPBVICuda()
 
 void LPBVICuda::set_performance_variables(unsigned int nonZeroBeliefStates, unsigned int successorStates)
 {
+	// The staged successor states depend on the maximum number of them.
+	if (successorStates != maxSuccessorStates) {
+		uninitialize_model_variables();
+	}
+
 	maxNonZeroBeliefStates = nonZeroBeliefStates;
 	maxSuccessorStates = successorStates;
 }
 
+void LPBVICuda::set_backend(LPBVICudaBackend newBackend)
+{
+	// The staged arrays must be freed by the backend which created them.
+	if (newBackend != backend) {
+		uninitialize_variables();
+	}
+
+	backend = newBackend;
+	functions = (backend == LPBVICudaBackend::HOST ? &LPBVI_CUDA_HOST_FUNCTIONS : &LPBVI_CUDA_DEVICE_FUNCTIONS);
+}
+
 PolicyAlphaVectors **LPBVICuda::solve_infinite_horizon(StatesMap *S, ActionsMap *A,
 		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
 		FactoredRewards *R, Horizon *h, std::vector<float> &delta)
 {
+	// Checkpoints are only written and resumed by the multi-threaded solver.
+	if (!resumeFilename.empty()) {
+		throw PolicyException();
+	}
+
 	// Ensure states, actions, and observations are indexed.
 	for (auto s : *S) {
 		IndexedState *state = dynamic_cast<IndexedState *>(resolve(s));
@@ -160,8 +264,12 @@ PolicyAlphaVectors **LPBVICuda::solve_infinite_horizon(StatesMap *S, ActionsMap
 		}
 		unsigned int *pi = new unsigned int[B.size()];
 
-		// Execute CUDA!
-		lpbvi_cuda(S->get_num_states(),
+		// Execute CUDA! The host backend also uses the number of threads.
+		if (backend == LPBVICudaBackend::HOST) {
+			lpbvi_host_set_num_threads(numThreads);
+		}
+
+		int result = functions->execute(S->get_num_states(),
 				A->get_num_actions(),
 				Z->get_num_observations(),
 				B.size(),
@@ -180,6 +288,13 @@ PolicyAlphaVectors **LPBVICuda::solve_infinite_horizon(StatesMap *S, ActionsMap
 				1024, // Number of Threads
 				Gamma,
 				pi);
+		if (result != 0) {
+			delete [] Gamma;
+			delete [] pi;
+			delete [] available;
+			uninitialize_variables();
+			throw PolicyException();
+		}
 
 //		// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
 //		// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
@@ -228,10 +343,14 @@ PolicyAlphaVectors **LPBVICuda::solve_infinite_horizon(StatesMap *S, ActionsMap
 	// After the main loop is complete, end timing. Also, output the result of the computation time.
 	auto end = std::chrono::high_resolution_clock::now();
 	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-	std::cout << "Total Elapsed Time (GPU Version): " << ((double)elapsed.count() / 1000.0) << std::endl; std::cout.flush();
+	std::cout << "Total Elapsed Time (" << (backend == LPBVICudaBackend::HOST ? "Host" : "GPU") << " Version): " <<
+			((double)elapsed.count() / 1000.0) << std::endl; std::cout.flush();
 
-	// Uninitialize the CUDA variables.
-	uninitialize_variables();
+	// Uninitialize the CUDA variables of the belief points. The model's are kept for the session.
+	uninitialize_belief_variables();
+	if (activeSession == nullptr) {
+		uninitialize_model_variables();
+	}
 
 	// Free the available array.
 	delete [] available;
@@ -244,23 +363,88 @@ void LPBVICuda::initialize_variables(StatesMap *S, ActionsMap *A, ObservationsMa
 		StateTransitions *T, ObservationTransitions *O, FactoredRewards *R,
 		Horizon *h, std::vector<float> &delta)
 {
-	std::cout << "Creating B... "; std::cout.flush();
+	// The model's arrays only depend on the model (and the performance variables and backend, which release
+	// them when changed), so they are kept for all of a session's solves.
+	if (activeSession == nullptr || stagedSession != activeSession || d_T == nullptr) {
+		uninitialize_model_variables();
+		initialize_model_variables(S, A, Z, T, O, R);
+		stagedSession = activeSession;
+	} else {
+		std::cout << "Reusing the staged T, O, R, and Successor States.\n"; std::cout.flush();
+	}
 
-	float *Barray = new float[B.size() * S->get_num_states()];
-	unsigned int counter = 0;
-	for (BeliefState *b : B) {
-		for (unsigned int i = 0; i < S->get_num_states(); i++) {
-			Barray[counter * S->get_num_states() + i] = b->get(S->get(i));
+	initialize_belief_variables(S);
+
+	std::cout << "Completed Variable Initialization " << std::endl; std::cout.flush();
+}
+
+void LPBVICuda::initialize_model_variables(StatesMap *S, ActionsMap *A, ObservationsMap *Z,
+		StateTransitions *T, ObservationTransitions *O, FactoredRewards *R)
+{
+	std::cout << "Creating Successor States... "; std::cout.flush();
+
+	// This holds the successor state hash values (which in our case are indexes) for each state-action pair,
+	// and their probabilities at the same positions; only these are transferred for T, not the n-m-n array.
+	unsigned int n = S->get_num_states();
+	unsigned int m = A->get_num_actions();
+	std::vector<int> successorStates((size_t)n * m * maxSuccessorStates);
+	std::vector<float> successorProbabilities((size_t)n * m * maxSuccessorStates);
+
+	LPOMDPSparseStateTransitions *Tsparse = dynamic_cast<LPOMDPSparseStateTransitions *>(T);
+	std::vector<State *> successors;
+
+	for (auto state : *S) {
+		State *s = resolve(state);
+
+		for (auto action : *A) {
+			Action *a = resolve(action);
+			size_t offset = ((size_t)s->hash_value() * m + a->hash_value()) * maxSuccessorStates;
+			unsigned int counterOverNextStates = 0;
+
+			// The sparse rows are read directly; otherwise, the successors are found through T.
+			if (Tsparse != nullptr) {
+				unsigned int count = 0;
+				const LPOMDPMappedTransition *row = Tsparse->get_row(s->hash_value(), a->hash_value(), count);
+
+				for (unsigned int i = 0; i < count && counterOverNextStates < maxSuccessorStates; i++) {
+					if (row[i].probability > 0.0f) {
+						successorStates[offset + counterOverNextStates] = row[i].successor;
+						successorProbabilities[offset + counterOverNextStates] = row[i].probability;
+						counterOverNextStates++;
+					}
+				}
+			} else {
+				successors.clear();
+				T->successors(S, s, a, successors);
+
+				for (unsigned int i = 0; i < successors.size() && counterOverNextStates < maxSuccessorStates; i++) {
+					double probability = T->get(s, a, successors[i]);
+					if (probability > 0.0) {
+						successorStates[offset + counterOverNextStates] = successors[i]->hash_value();
+						successorProbabilities[offset + counterOverNextStates] = (float)probability;
+						counterOverNextStates++;
+					}
+				}
+			}
+
+			if (counterOverNextStates < maxSuccessorStates) {
+				successorStates[offset + counterOverNextStates] = -1;
+				successorProbabilities[offset + counterOverNextStates] = 0.0f;
+			}
 		}
-		counter++;
 	}
 
 //	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
 //	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
 //	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
-//	for (unsigned int i = 0; i < B.size(); i++) {
-//		for (unsigned int j = 0; j < S->get_num_states(); j++) {
-//			std::cout << Barray[i * S->get_num_states() + j] << " ";
+//	for (unsigned int i = 0; i < S->get_num_states(); i++) {
+//		std::cout << "S = " << i << ":\n";
+//		for (unsigned int j = 0; j < A->get_num_actions(); j++) {
+//			std::cout << "<" << successorStates[i * A->get_num_actions() * maxSuccessorStates +
+//										 j * maxSuccessorStates + 0]
+//						<< ", "
+//						<< successorStates[i * A->get_num_actions() * maxSuccessorStates +
+//										 j * maxSuccessorStates + 1] << "> ";
 //		}
 //		std::cout << std::endl;
 //	}
@@ -269,24 +453,12 @@ void LPBVICuda::initialize_variables(StatesMap *S, ActionsMap *A, ObservationsMa
 //	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
 //	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
 
-	std::cout << "Transferring B... "; std::cout.flush();
+	std::cout << "Transferring T... "; std::cout.flush();
 
-	int result = lpbvi_initialize_belief_points(S->get_num_states(), B.size(), Barray, d_B);
-	delete [] Barray;
-	if (result != 0) {
-		throw PolicyException();
-	}
-
-	std::cout << "Done.\nTransferring T... "; std::cout.flush();
-
-	StateTransitionsArray *Tarray = dynamic_cast<StateTransitionsArray *>(T);
-	if (Tarray == nullptr) {
-		throw PolicyException();
-	}
-
-	result = lpbvi_initialize_state_transitions(S->get_num_states(),
-			A->get_num_actions(),
-			Tarray->get_state_transitions(),
+	int result = functions->initialize_state_transitions(n,
+			m,
+			maxSuccessorStates,
+			successorProbabilities.data(),
 			d_T);
 	if (result != 0) {
 		throw PolicyException();
@@ -294,15 +466,16 @@ void LPBVICuda::initialize_variables(StatesMap *S, ActionsMap *A, ObservationsMa
 
 	std::cout << "Done.\nTransferring O... "; std::cout.flush();
 
-	ObservationTransitionsArray *Oarray = dynamic_cast<ObservationTransitionsArray *>(O);
+	// The dense arrays are passed directly, without a copy, since they have the same layout.
+	const float *Oarray = get_observation_transitions_array(O);
 	if (Oarray == nullptr) {
 		throw PolicyException();
 	}
 
-	result = lpbvi_initialize_observation_transitions(S->get_num_states(),
+	result = functions->initialize_observation_transitions(S->get_num_states(),
 			A->get_num_actions(),
 			Z->get_num_observations(),
-			Oarray->get_observation_transitions(),
+			Oarray,
 			d_O);
 	if (result != 0) {
 		throw PolicyException();
@@ -313,23 +486,73 @@ void LPBVICuda::initialize_variables(StatesMap *S, ActionsMap *A, ObservationsMa
 	k = R->get_num_rewards();
 	d_R = new float*[k];
 	for (unsigned int i = 0; i < k; i++) {
-		SARewardsArray *Ri = dynamic_cast<SARewardsArray *>(R->get(i));
+		const float *Ri = get_rewards_array(R->get(i));
 		if (Ri == nullptr) {
 			throw PolicyException();
 		}
 
 		std::cout << (i + 1) << " "; std::cout.flush();
 
-		result = lpbvi_initialize_rewards(S->get_num_states(),
+		result = functions->initialize_rewards(S->get_num_states(),
 				A->get_num_actions(),
-				Ri->get_rewards(),
+				Ri,
 				d_R[i]);
 		if (result != 0) {
 			throw PolicyException();
 		}
 	}
 
-	std::cout << ". Done.\nCreating Non-Zero Belief States... "; std::cout.flush();
+	std::cout << ". Done.\n"; std::cout.flush();
+
+	std::cout << "Transferring Successor States... "; std::cout.flush();
+
+	result = functions->initialize_successors(S->get_num_states(), A->get_num_actions(), maxSuccessorStates,
+			successorStates.data(), d_SuccessorStates);
+	if (result != 0) {
+		throw PolicyException();
+	}
+
+	std::cout << "Done.\n"; std::cout.flush();
+}
+
+void LPBVICuda::initialize_belief_variables(StatesMap *S)
+{
+	std::cout << "Creating B... "; std::cout.flush();
+
+	float *Barray = new float[B.size() * S->get_num_states()];
+	unsigned int counter = 0;
+	for (BeliefState *b : B) {
+		for (unsigned int i = 0; i < S->get_num_states(); i++) {
+			Barray[counter * S->get_num_states() + i] = b->get(S->get(i));
+		}
+		counter++;
+	}
+
+//	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
+//	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
+//	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
+//	for (unsigned int i = 0; i < B.size(); i++) {
+//		for (unsigned int j = 0; j < S->get_num_states(); j++) {
+//			std::cout << Barray[i * S->get_num_states() + j] << " ";
+//		}
+//		std::cout << std::endl;
+//	}
+//	std::cout.flush();
+//	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
+//	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
+//	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
+
+	std::cout << "Transferring B... "; std::cout.flush();
+
+	int result = functions->initialize_belief_points(S->get_num_states(), B.size(), Barray, d_B);
+	delete [] Barray;
+	if (result != 0) {
+		throw PolicyException();
+	}
+
+	std::cout << "Done.\n"; std::cout.flush();
+
+	std::cout << "Creating Non-Zero Belief States... "; std::cout.flush();
 
 	// Purposefully an int for having the sign bit store the termination point in the array's row.
 	// This stores the hash values of the states (which in our case will be indexes).
@@ -377,90 +600,52 @@ void LPBVICuda::initialize_variables(StatesMap *S, ActionsMap *A, ObservationsMa
 
 	std::cout << "Transferring Non-Zero Belief States... "; std::cout.flush();
 
-	result = lpbvi_initialize_nonzero_beliefs(B.size(), maxNonZeroBeliefStates,
+	result = functions->initialize_nonzero_beliefs(B.size(), maxNonZeroBeliefStates,
 			nonZeroBeliefStates, d_NonZeroBeliefStates);
 	delete [] nonZeroBeliefStates;
 	if (result != 0) {
 		throw PolicyException();
 	}
 
-	std::cout << "Done.\nCreating Successor States... "; std::cout.flush();
-
-	// Similarly, this holds the successor state hash values (which in our case are indexes) for
-	// each state-action pair.
-	int *successorStates = new int[S->get_num_states() * A->get_num_actions() * maxSuccessorStates];
-	counter = 0;
-
-	for (auto state : *S) {
-		State *s = resolve(state);
-		unsigned int counterOverActions = 0;
-
-		for (auto action : *A) {
-			Action *a = resolve(action);
-			unsigned int counterOverNextStates = 0;
-
-			for (auto statePrime : *S) {
-				State *sp = resolve(statePrime);
-
-				if (T->get(s, a, sp) > 0.0) {
-					successorStates[s->hash_value() * A->get_num_actions() * maxSuccessorStates +
-									a->hash_value() * maxSuccessorStates +
-									counterOverNextStates] = sp->hash_value();
-					counterOverNextStates++;
-				}
-
-				if (counterOverNextStates == maxSuccessorStates) {
-					break;
-				}
-			}
+	std::cout << "Done.\n"; std::cout.flush();
+}
 
-			if (counterOverNextStates < maxSuccessorStates) {
-				successorStates[s->hash_value() * A->get_num_actions() * maxSuccessorStates +
-							a->hash_value() * maxSuccessorStates +
-							counterOverNextStates] = -1;
-			}
+void LPBVICuda::uninitialize_variables()
+{
+	uninitialize_belief_variables();
+	uninitialize_model_variables();
+}
 
-			counterOverActions++;
-		}
+void LPBVICuda::uninitialize_model_variables()
+{
+	// Only the model's arrays are freed; the others are passed as null.
+	float *noB = nullptr;
+	int *noNonZeroBeliefStates = nullptr;
 
-		counter++;
-	}
+	functions->uninitialize(noB, d_T, d_O, d_R, k, noNonZeroBeliefStates, d_SuccessorStates);
 
-//	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
-//	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
-//	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
-//	for (unsigned int i = 0; i < S->get_num_states(); i++) {
-//		std::cout << "S = " << i << ":\n";
-//		for (unsigned int j = 0; j < A->get_num_actions(); j++) {
-//			std::cout << "<" << successorStates[i * A->get_num_actions() * maxSuccessorStates +
-//										 j * maxSuccessorStates + 0]
-//						<< ", "
-//						<< successorStates[i * A->get_num_actions() * maxSuccessorStates +
-//										 j * maxSuccessorStates + 1] << "> ";
-//		}
-//		std::cout << std::endl;
-//	}
-//	std::cout.flush();
-//	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
-//	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
-//	// DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
+	delete [] d_R;
+	d_R = nullptr;
 
-	std::cout << "Transferring Successor States... "; std::cout.flush();
+	stagedSession = nullptr;
+}
 
-	result = lpbvi_initialize_successors(S->get_num_states(), A->get_num_actions(), maxSuccessorStates,
-			successorStates, d_SuccessorStates);
-	delete [] successorStates;
-	if (result != 0) {
-		throw PolicyException();
-	}
+void LPBVICuda::uninitialize_belief_variables()
+{
+	// Only the belief points' arrays are freed; the others are passed as null.
+	float *noT = nullptr;
+	float *noO = nullptr;
+	float **noR = nullptr;
+	int *noSuccessorStates = nullptr;
 
-	std::cout << "Done.\nCompleted Variable Initialization " << std::endl; std::cout.flush();
+	functions->uninitialize(d_B, noT, noO, noR, 0, d_NonZeroBeliefStates, noSuccessorStates);
 }
 
-void LPBVICuda::uninitialize_variables()
+void LPBVICuda::release_session(LPBVISession *session)
 {
-	lpbvi_uninitialize(d_B, d_T, d_O, d_R, k, d_NonZeroBeliefStates, d_SuccessorStates);
+	if (stagedSession == session) {
+		uninitialize_model_variables();
+	}
 
-	delete [] d_R;
-	d_R = nullptr;
+	LPBVI::release_session(session);
 }
@@ -0,0 +1,508 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "../include/lpbvi_distributed.h"
+
+#include "../../librbr/librbr/include/pomdp/pomdp_utilities.h"
+
+#include "../../librbr/librbr/include/core/states/indexed_state.h"
+#include "../../librbr/librbr/include/core/actions/indexed_action.h"
+
+#include "../../librbr/librbr/include/core/rewards/reward_exception.h"
+#include "../../librbr/librbr/include/core/policy/policy_exception.h"
+
+#include <iostream>
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#include <chrono>
+
+LPBVIDistributed::LPBVIDistributed() : LPBVI()
+{
+	numWorkers = 2;
+	activeWorkers = 0;
+	exchange = new LPBVISharedMemoryExchange();
+}
+
+LPBVIDistributed::LPBVIDistributed(POMDPPBVIExpansionRule expansionRule, unsigned int updateIterations,
+		unsigned int expansionIterations) : LPBVI(expansionRule, updateIterations, expansionIterations)
+{
+	numWorkers = 2;
+	activeWorkers = 0;
+	exchange = new LPBVISharedMemoryExchange();
+}
+
+LPBVIDistributed::~LPBVIDistributed()
+{
+	delete exchange;
+}
+
+void LPBVIDistributed::set_num_workers(unsigned int workers)
+{
+	numWorkers = std::max(1u, workers);
+}
+
+void LPBVIDistributed::set_exchange(LPBVIExchange *newExchange)
+{
+	if (newExchange == nullptr) {
+		return;
+	}
+
+	delete exchange;
+	exchange = newExchange;
+}
+
+PolicyAlphaVectors **LPBVIDistributed::solve_infinite_horizon(StatesMap *S, ActionsMap *A,
+		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+		FactoredRewards *R, Horizon *h, std::vector<float> &delta)
+{
+	// Checkpoints are only written and resumed by the multi-threaded solver.
+	if (!resumeFilename.empty()) {
+		throw PolicyException();
+	}
+
+	// Ensure states and actions are indexed, and order the states by their index.
+	indexedStates.assign(S->get_num_states(), nullptr);
+	for (auto s : *S) {
+		IndexedState *state = dynamic_cast<IndexedState *>(resolve(s));
+		if (state == nullptr || state->get_index() >= S->get_num_states()) {
+			throw PolicyException();
+		}
+		indexedStates[state->get_index()] = state;
+	}
+	for (auto a : *A) {
+		IndexedAction *action = dynamic_cast<IndexedAction *>(resolve(a));
+		if (action == nullptr) {
+			throw PolicyException();
+		}
+	}
+
+	// The final set of alpha vectors.
+	PolicyAlphaVectors **policy = new PolicyAlphaVectors*[R->get_num_rewards()];
+	for (int i = 0; i < (int)R->get_num_rewards(); i++) {
+		policy[i] = new PolicyAlphaVectors(h->get_horizon());
+	}
+
+	// Initialize the set of belief points to be the initial set. This must be a copy, since memory is managed
+	// for both objects independently.
+	for (BeliefState *b : initialB) {
+		B.push_back(new BeliefState(*b));
+	}
+
+	// The successors cached by a previous solve of this session's model are reused for the belief points
+	// which are the same; anything else is invalidated by the first update of the cache.
+	beliefCache.revalidate();
+
+	std::cout << "Initial Num Belief Points: " << initialB.size() << std::endl; std::cout.flush();
+
+	// Cache Gamma_{a, *} for all actions, one for each R[i]. The workers inherit this (and the rest of the
+	// model) when they are forked, so it is only ever computed once per session.
+	std::map<Action *, std::vector<PolicyAlphaVector *> > *gammaAStar = create_gamma_a_star_sets(S, A, Z, T, O, R);
+
+	// If we are recording a belief point's values, create the empty vector for each R[i].
+	if (beliefToRecord != nullptr) {
+		recordedValues.clear();
+		recordedValues.resize(R->get_num_rewards());
+	}
+
+	// After setting up everything, begin timing.
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::cout << "Starting...\n"; std::cout.flush();
+
+	bool failed = false;
+
+	// Perform a predefined number of expansions. Each expansion forks a new set of workers over the new B.
+	for (unsigned int e = 0; e < expansions && !failed; e++) {
+		std::cout << "Expansion " << (e + 1) << std::endl;
+
+		double deltaB = compute_belief_density(S);
+
+		// The workers inherit the cache when they are forked, and narrow it to their own shard, whose slots are
+		// discarded when they exit. Only the coordinator's expansions keep theirs over expansions.
+		beliefCache.update(get_model_identity(), S, Z, T, O, B);
+
+		activeWorkers = std::max(1u, std::min(numWorkers, (unsigned int)B.size()));
+		if (exchange->initialize(activeWorkers, B.size(), S->get_num_states())) {
+			failed = true;
+			break;
+		}
+
+		// Flush before forking, so that buffered output is not written again by every worker.
+		std::cout.flush();
+		std::cerr.flush();
+
+		pid_t coordinator = getpid();
+
+		std::vector<pid_t> workers;
+		for (unsigned int w = 0; w < activeWorkers; w++) {
+			pid_t pid = fork();
+
+			if (pid < 0) {
+				std::cerr << "Failed to fork worker " << w << "." << std::endl;
+				failed = true;
+				break;
+			} else if (pid == 0) {
+				// A worker is orphaned (and re-parented) if the coordinator dies.
+				exchange->set_liveness_check([coordinator]() {
+					return getppid() == coordinator;
+				});
+
+				bool workerFailed = true;
+				try {
+					workerFailed = execute_worker(w, S, A, Z, T, O, R, h, delta, gammaAStar, deltaB);
+				} catch (...) {
+					workerFailed = true;
+				}
+				std::cout.flush();
+				std::cerr.flush();
+				_exit(workerFailed ? 1 : 0);
+			}
+
+			workers.push_back(pid);
+		}
+
+		if (failed) {
+			// The workers which did start would wait forever for the missing ones.
+			for (pid_t pid : workers) {
+				kill(pid, SIGKILL);
+			}
+		} else {
+			// Note: The check does not reap the workers, so that their statuses are reported below.
+			exchange->set_liveness_check([&workers]() {
+				for (pid_t pid : workers) {
+					siginfo_t info;
+					info.si_pid = 0;
+					if (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) != 0 || info.si_pid != 0) {
+						return false;
+					}
+				}
+				return true;
+			});
+
+			failed = execute_coordinator(A, R, policy);
+		}
+
+		// Every worker stops once the exchange has failed, so this does not wait for long.
+		for (unsigned int w = 0; w < workers.size(); w++) {
+			int status = 0;
+			if (waitpid(workers[w], &status, 0) < 0) {
+				std::cerr << "Failed to wait for worker " << w << "." << std::endl;
+				failed = true;
+			} else if (WIFSIGNALED(status)) {
+				std::cerr << "Worker " << w << " was killed by signal " << WTERMSIG(status) << "." << std::endl;
+				failed = true;
+			} else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+				failed = true;
+			}
+		}
+
+		exchange->uninitialize();
+
+		if (failed) {
+			break;
+		}
+
+		// The expansion is complete, so the policy is consistent. Note: The distributed solve only checks for
+		// a stop between expansions, since the workers must stay synchronized with the coordinator.
+		if (snapshotCallback) {
+			snapshotCallback(policy, R->get_num_rewards(), false);
+		}
+
+		if (is_stop_requested()) {
+			std::cout << "Stopping early." << std::endl; std::cout.flush();
+			break;
+		}
+
+		// Perform an expansion based on the rule the user wishes to use. Stop immediately if the user
+		// does not want to expand.
+		if (e < expansions - 1) {
+			if (rule == POMDPPBVIExpansionRule::NONE) {
+				break;
+			}
+			expand_belief_points(S, A, Z, T, O, policy[R->get_num_rewards() - 1]);
+		}
+	}
+
+	// Free the memory of Gamma_{a, *}, unless the session keeps it.
+	free_gamma_a_star_sets(A, R, gammaAStar);
+
+	if (failed) {
+		std::cerr << "A worker failed during the distributed LPBVI." << std::endl;
+		throw PolicyException();
+	}
+
+	std::cout << "Complete LPBVI." << std::endl; std::cout.flush();
+
+	// After the main loop is complete, end timing. Also, output the result of the computation time.
+	auto end = std::chrono::high_resolution_clock::now();
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+	std::cout << "Total Elapsed Time (Distributed Version, " << numWorkers << " Workers): " <<
+			((double)elapsed.count() / 1000.0) << std::endl; std::cout.flush();
+
+	return policy;
+}
+
+bool LPBVIDistributed::execute_worker(unsigned int worker, StatesMap *S, ActionsMap *A,
+		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+		FactoredRewards *R, Horizon *h, std::vector<float> &delta,
+		std::map<Action *, std::vector<PolicyAlphaVector *> > *gammaAStar, double deltaB)
+{
+	// This worker's shard of the belief points, which are rows [first, last) of the exchange.
+	unsigned int r = B.size();
+	unsigned int first = (unsigned int)((unsigned long)worker * r / activeWorkers);
+	unsigned int last = (unsigned int)((unsigned long)(worker + 1) * r / activeWorkers);
+	unsigned int n = S->get_num_states();
+
+	// From here on, this process only holds its shard in B (and so in the belief cache), so the local index
+	// of a belief point is its row minus first. Note: The other belief points are not freed, since they are
+	// still the coordinator's, and this process exits after the expansion.
+	std::vector<BeliefState *> shard(B.begin() + first, B.begin() + last);
+	B.swap(shard);
+	beliefCache.update(get_model_identity(), S, Z, T, O, B);
+
+	// Create the set of actions available, only for the belief points in this shard.
+	std::map<BeliefState *, std::vector<Action *> > Ai;
+	for (BeliefState *b : B) {
+		for (auto a : *A) {
+			Ai[b].push_back(resolve(a));
+		}
+	}
+
+	// The backups read the previous Gamma directly from the exchange. Its columns are the state indexes,
+	// which are also the order of the states in the belief cache, since they are sorted by hash value.
+	LPBVIDenseGamma gammaPrevious[2] = {
+		LPBVIDenseGamma(exchange->get_alpha_vector(0, 0), r, beliefCache),
+		LPBVIDenseGamma(exchange->get_alpha_vector(1, 0), r, beliefCache)
+	};
+
+	// Note: Every participant must reach every synchronization, so errors within the work are only
+	// reported to the exchange, which stops all participants at the next synchronization.
+	for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
+		bool current = false;
+
+		// Initialize this shard's rows of the first Gamma to be zero alpha vectors.
+		for (unsigned int j = first; j < last; j++) {
+			double *row = exchange->get_alpha_vector(!current, j);
+			std::fill(row, row + n, 0.0);
+			exchange->get_actions(!current)[j] = LPBVI_EXCHANGE_NO_ACTION;
+		}
+
+		if (exchange->synchronize()) {
+			return true;
+		}
+
+		// Perform a predefined number of updates, exchanging the rows of Gamma after each one.
+		for (unsigned int u = 0; u < updates; u++) {
+			try {
+				execute_in_parallel(B.size(), [&](unsigned int thread, unsigned int f, unsigned int l) {
+					for (unsigned int j = f; j < l; j++) {
+						PolicyAlphaVector *alpha = update_belief_point(O, h, gammaAStar[i], Ai.at(B[j]),
+								gammaPrevious[!current], j);
+						store_alpha_vector(current, first + j, alpha);
+						delete alpha;
+					}
+				});
+			} catch (...) {
+				exchange->fail();
+			}
+
+			if (exchange->synchronize()) {
+				return true;
+			}
+
+			current = !current;
+		}
+
+		// Restrict the set of actions available to each belief point in this shard for the next value
+		// function. This requires all of the final rows, but only modifies this shard's actions.
+		if (i < R->get_num_rewards() - 1) {
+			try {
+				restrict_shard_actions(A, !current, r,
+						compute_slack(dynamic_cast<SARewards *>(R->get(i)), h, delta[i], deltaB), Ai);
+			} catch (...) {
+				exchange->fail();
+			}
+		}
+
+		// Wait for the coordinator to assemble the policy from the final rows, before they are overwritten.
+		if (exchange->synchronize()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool LPBVIDistributed::execute_coordinator(ActionsMap *A, FactoredRewards *R, PolicyAlphaVectors **policy)
+{
+	// The belief to record as a dense array over the state indexes, so it can be applied to the rows directly.
+	std::vector<double> record;
+	if (beliefToRecord != nullptr) {
+		for (State *state : indexedStates) {
+			record.push_back(beliefToRecord->get(state));
+		}
+	}
+
+	for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
+		std::cout << "  R[" << i << "]" << std::endl; std::cout.flush();
+
+		bool current = false;
+
+		// Wait for the workers to initialize the first Gamma.
+		if (exchange->synchronize()) {
+			return true;
+		}
+
+		for (unsigned int u = 0; u < updates; u++) {
+			std::cout << "    " << (u + 1) << " / " << updates << std::endl; std::cout.flush();
+
+			if (exchange->synchronize()) {
+				return true;
+			}
+
+			// If we are recording values, compute the belief value here. The workers only write to the other
+			// buffer until the next synchronization, so this buffer can be read safely.
+			if (beliefToRecord != nullptr) {
+				double maxRecordedValue = std::numeric_limits<double>::lowest();
+				for (unsigned int j = 0; j < B.size(); j++) {
+					const double *row = exchange->get_alpha_vector(current, j);
+					double recordedValue = 0.0;
+					for (unsigned int s = 0; s < record.size(); s++) {
+						recordedValue += record[s] * row[s];
+					}
+					if (recordedValue > maxRecordedValue) {
+						maxRecordedValue = recordedValue;
+					}
+				}
+				recordedValues[i].push_back(maxRecordedValue);
+			}
+
+			current = !current;
+		}
+
+		// Set the final rows to the policy object. Note: This transfers the responsibility of
+		// memory management to the PolicyAlphaVectors object.
+		std::vector<PolicyAlphaVector *> gammaFinal;
+		load_alpha_vectors(A, !current, gammaFinal);
+		policy[i]->set(gammaFinal);
+
+		// Release the workers to the next value function.
+		if (exchange->synchronize()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void LPBVIDistributed::load_alpha_vectors(ActionsMap *A, unsigned int buffer, std::vector<PolicyAlphaVector *> &result)
+{
+	const unsigned int *actions = exchange->get_actions(buffer);
+
+	result.clear();
+	result.reserve(B.size());
+
+	for (unsigned int j = 0; j < B.size(); j++) {
+		PolicyAlphaVector *alpha = nullptr;
+		if (actions[j] == LPBVI_EXCHANGE_NO_ACTION) {
+			alpha = new PolicyAlphaVector();
+		} else {
+			alpha = new PolicyAlphaVector(A->get(actions[j]));
+		}
+
+		const double *row = exchange->get_alpha_vector(buffer, j);
+		for (unsigned int s = 0; s < indexedStates.size(); s++) {
+			alpha->set(indexedStates[s], row[s]);
+		}
+
+		result.push_back(alpha);
+	}
+}
+
+void LPBVIDistributed::store_alpha_vector(unsigned int buffer, unsigned int beliefIndex, const PolicyAlphaVector *alpha)
+{
+	double *row = exchange->get_alpha_vector(buffer, beliefIndex);
+	for (unsigned int s = 0; s < indexedStates.size(); s++) {
+		row[s] = alpha->get(indexedStates[s]);
+	}
+
+	const IndexedAction *action = dynamic_cast<const IndexedAction *>(alpha->get_action());
+	if (action == nullptr) {
+		exchange->get_actions(buffer)[beliefIndex] = LPBVI_EXCHANGE_NO_ACTION;
+	} else {
+		exchange->get_actions(buffer)[beliefIndex] = action->get_index();
+	}
+}
+
+void LPBVIDistributed::restrict_shard_actions(ActionsMap *A, unsigned int buffer, unsigned int r, double eta,
+		std::map<BeliefState *, std::vector<Action *> > &Ai)
+{
+	const double *rows = exchange->get_alpha_vector(buffer, 0);
+	const unsigned int *actions = exchange->get_actions(buffer);
+	unsigned int n = indexedStates.size();
+
+	// As with PolicyAlphaVectors, the actions available at a belief point are those of the alpha vectors
+	// within eta of the optimal one there, but the values are computed over the rows in the exchange.
+	execute_in_parallel(B.size(), [&](unsigned int thread, unsigned int first, unsigned int last) {
+		std::vector<double> alphaDotBeta(r, 0.0);
+
+		for (unsigned int j = first; j < last; j++) {
+			const LPBVISparseBelief &b = beliefCache.get_belief(j);
+			double maxAlphaDotBeta = 0.0;
+
+			for (unsigned int l = 0; l < r; l++) {
+				alphaDotBeta[l] = 0.0;
+				for (const std::pair<State *, double> &sp : b) {
+					alphaDotBeta[l] += sp.second * rows[(size_t)l * n + beliefCache.get_state_index(sp.first)];
+				}
+				if (l == 0 || alphaDotBeta[l] > maxAlphaDotBeta) {
+					maxAlphaDotBeta = alphaDotBeta[l];
+				}
+			}
+
+			std::vector<Action *> &available = Ai.at(B[j]);
+			available.clear();
+
+			for (unsigned int l = 0; l < r; l++) {
+				if (actions[l] == LPBVI_EXCHANGE_NO_ACTION || maxAlphaDotBeta - alphaDotBeta[l] > eta) {
+					continue;
+				}
+
+				Action *action = A->get(actions[l]);
+				if (std::find(available.begin(), available.end(), action) == available.end()) {
+					available.push_back(action);
+				}
+			}
+		}
+	});
+}
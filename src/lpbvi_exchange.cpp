@@ -0,0 +1,224 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "../include/lpbvi_exchange.h"
+
+#include <iostream>
+#include <cerrno>
+
+LPBVIExchange::~LPBVIExchange()
+{ }
+
+LPBVISharedMemoryExchange::LPBVISharedMemoryExchange()
+{
+	memory = nullptr;
+	size = 0;
+	header = nullptr;
+	rows[0] = rows[1] = nullptr;
+	actions[0] = actions[1] = nullptr;
+	r = 0;
+	n = 0;
+}
+
+LPBVISharedMemoryExchange::~LPBVISharedMemoryExchange()
+{
+	uninitialize();
+}
+
+bool LPBVISharedMemoryExchange::initialize(unsigned int numWorkers, unsigned int numBeliefs, unsigned int numStates)
+{
+	uninitialize();
+
+	if (numWorkers == 0 || numBeliefs == 0 || numStates == 0) {
+		return true;
+	}
+
+	r = numBeliefs;
+	n = numStates;
+
+	// Layout: the header, then both buffers of rows, then both arrays of actions. The header's size
+	// is rounded up so that the rows are aligned for doubles.
+	size_t headerSize = (sizeof(Header) + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+	size_t rowsSize = (size_t)r * n * sizeof(double);
+	size_t actionsSize = (size_t)r * sizeof(unsigned int);
+	size = headerSize + 2 * rowsSize + 2 * actionsSize;
+
+	memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) {
+		std::cerr << "Failed to map " << size << " bytes of shared memory for the exchange." << std::endl;
+		memory = nullptr;
+		size = 0;
+		return true;
+	}
+
+	char *base = (char *)memory;
+	header = (Header *)base;
+	rows[0] = (double *)(base + headerSize);
+	rows[1] = (double *)(base + headerSize + rowsSize);
+	actions[0] = (unsigned int *)(base + headerSize + 2 * rowsSize);
+	actions[1] = (unsigned int *)(base + headerSize + 2 * rowsSize + actionsSize);
+
+	header->participants = numWorkers + 1;
+	header->waiting = 0;
+	header->generation = 0;
+	header->failed = 0;
+
+	// Note: The mutex is robust, so that a participant which dies while holding it does not block the
+	// others. The condition variable uses the monotonic clock for its timed waits.
+	pthread_mutexattr_t mutexAttributes;
+	pthread_mutexattr_init(&mutexAttributes);
+	pthread_mutexattr_setpshared(&mutexAttributes, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust(&mutexAttributes, PTHREAD_MUTEX_ROBUST);
+	int result = pthread_mutex_init(&header->mutex, &mutexAttributes);
+	pthread_mutexattr_destroy(&mutexAttributes);
+
+	if (result == 0) {
+		pthread_condattr_t conditionAttributes;
+		pthread_condattr_init(&conditionAttributes);
+		pthread_condattr_setpshared(&conditionAttributes, PTHREAD_PROCESS_SHARED);
+		pthread_condattr_setclock(&conditionAttributes, CLOCK_MONOTONIC);
+		result = pthread_cond_init(&header->condition, &conditionAttributes);
+		pthread_condattr_destroy(&conditionAttributes);
+
+		if (result != 0) {
+			pthread_mutex_destroy(&header->mutex);
+		}
+	}
+
+	if (result != 0) {
+		munmap(memory, size);
+		memory = nullptr;
+		header = nullptr;
+		size = 0;
+		return true;
+	}
+
+	return false;
+}
+
+void LPBVISharedMemoryExchange::uninitialize()
+{
+	if (memory != nullptr) {
+		pthread_cond_destroy(&header->condition);
+		pthread_mutex_destroy(&header->mutex);
+		munmap(memory, size);
+	}
+
+	memory = nullptr;
+	size = 0;
+	header = nullptr;
+	rows[0] = rows[1] = nullptr;
+	actions[0] = actions[1] = nullptr;
+	livenessCheck = nullptr;
+}
+
+double *LPBVISharedMemoryExchange::get_alpha_vector(unsigned int buffer, unsigned int beliefIndex)
+{
+	return &rows[buffer][(size_t)beliefIndex * n];
+}
+
+unsigned int *LPBVISharedMemoryExchange::get_actions(unsigned int buffer)
+{
+	return actions[buffer];
+}
+
+void LPBVISharedMemoryExchange::set_liveness_check(std::function<bool ()> check)
+{
+	livenessCheck = check;
+}
+
+bool LPBVISharedMemoryExchange::synchronize()
+{
+	lock();
+
+	if (header->failed != 0) {
+		pthread_mutex_unlock(&header->mutex);
+		return true;
+	}
+
+	// The last participant to arrive completes this synchronization and releases the others. Note: The
+	// mutex is a full memory barrier, so all writes before it are visible after it.
+	header->waiting++;
+	if (header->waiting == header->participants) {
+		header->waiting = 0;
+		header->generation++;
+		pthread_cond_broadcast(&header->condition);
+		pthread_mutex_unlock(&header->mutex);
+		return false;
+	}
+
+	// Otherwise, wait until it completes or any participant fails, checking that the others are still
+	// alive every second. A participant released by a failure returns true, even if the others arrive.
+	unsigned long long generation = header->generation;
+
+	while (header->generation == generation && header->failed == 0) {
+		timespec timeout;
+		clock_gettime(CLOCK_MONOTONIC, &timeout);
+		timeout.tv_sec += LPBVI_EXCHANGE_LIVENESS_INTERVAL;
+
+		int result = pthread_cond_timedwait(&header->condition, &header->mutex, &timeout);
+
+		if (result == EOWNERDEAD) {
+			pthread_mutex_consistent(&header->mutex);
+			fail_locked();
+		} else if (result == ETIMEDOUT && livenessCheck) {
+			pthread_mutex_unlock(&header->mutex);
+			bool alive = livenessCheck();
+			lock();
+
+			if (!alive) {
+				fail_locked();
+			}
+		}
+	}
+
+	bool failed = (header->generation == generation);
+	pthread_mutex_unlock(&header->mutex);
+	return failed;
+}
+
+void LPBVISharedMemoryExchange::fail()
+{
+	lock();
+	fail_locked();
+	pthread_mutex_unlock(&header->mutex);
+}
+
+void LPBVISharedMemoryExchange::lock()
+{
+	if (pthread_mutex_lock(&header->mutex) == EOWNERDEAD) {
+		pthread_mutex_consistent(&header->mutex);
+		fail_locked();
+	}
+}
+
+void LPBVISharedMemoryExchange::fail_locked()
+{
+	header->failed = 1;
+	pthread_cond_broadcast(&header->condition);
+}
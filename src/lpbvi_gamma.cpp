@@ -0,0 +1,61 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/lpbvi_gamma.h"
+
+LPBVIGamma::~LPBVIGamma()
+{ }
+
+LPBVIAlphaVectorGamma::LPBVIAlphaVectorGamma(const std::vector<PolicyAlphaVector *> &gammaVectors) : gamma(gammaVectors)
+{ }
+
+LPBVIAlphaVectorGamma::~LPBVIAlphaVectorGamma()
+{ }
+
+unsigned int LPBVIAlphaVectorGamma::size() const
+{
+	return gamma.size();
+}
+
+double LPBVIAlphaVectorGamma::get(unsigned int alphaIndex, State *state) const
+{
+	return gamma[alphaIndex]->get(state);
+}
+
+LPBVIDenseGamma::LPBVIDenseGamma(const double *gammaRows, unsigned int numRows, const LPBVIBeliefCache &beliefCache) :
+		rows(gammaRows), r(numRows), n(beliefCache.get_states().size()), cache(beliefCache)
+{ }
+
+LPBVIDenseGamma::~LPBVIDenseGamma()
+{ }
+
+unsigned int LPBVIDenseGamma::size() const
+{
+	return r;
+}
+
+double LPBVIDenseGamma::get(unsigned int alphaIndex, State *state) const
+{
+	return rows[(size_t)alphaIndex * n + cache.get_state_index(state)];
+}
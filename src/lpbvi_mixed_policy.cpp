@@ -0,0 +1,175 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/lpbvi_mixed_policy.h"
+
+#include "../../librbr/librbr/include/core/policy/policy_exception.h"
+
+#include <math.h>
+#include <algorithm>
+
+LPBVIMixedPolicy::LPBVIMixedPolicy(const std::vector<std::vector<State *> > &locations, double defaultValue)
+{
+	this->locations = locations;
+	this->defaultValue = defaultValue;
+
+	gamma.resize(locations.size());
+
+	for (unsigned int x = 0; x < locations.size(); x++) {
+		for (unsigned int y = 0; y < locations[x].size(); y++) {
+			stateLocations[locations[x][y]] = std::pair<unsigned int, unsigned int>(x, y);
+		}
+	}
+}
+
+LPBVIMixedPolicy::~LPBVIMixedPolicy()
+{ }
+
+void LPBVIMixedPolicy::set(unsigned int location, const std::vector<LPBVIMixedAlphaVector> &alphaVectors)
+{
+	gamma.at(location) = alphaVectors;
+}
+
+const std::vector<LPBVIMixedAlphaVector> &LPBVIMixedPolicy::get_alpha_vectors(unsigned int location) const
+{
+	return gamma.at(location);
+}
+
+unsigned int LPBVIMixedPolicy::get_num_locations() const
+{
+	return locations.size();
+}
+
+double LPBVIMixedPolicy::get_default_value() const
+{
+	return defaultValue;
+}
+
+bool LPBVIMixedPolicy::locate(const BeliefState *b, LPBVIMixedBelief &result) const
+{
+	bool found = false;
+
+	for (auto state : stateLocations) {
+		double p = b->get(state.first);
+		if (p <= 0.0) {
+			continue;
+		}
+
+		// All of the probability must be on the states of one location, since it is observed.
+		if (!found) {
+			result.location = state.second.first;
+			result.hidden.assign(locations[result.location].size(), 0.0);
+			found = true;
+		} else if (result.location != state.second.first) {
+			return true;
+		}
+
+		result.hidden[state.second.second] = p;
+	}
+
+	return !found;
+}
+
+Action *LPBVIMixedPolicy::get(const LPBVIMixedBelief &b) const
+{
+	Action *action = nullptr;
+	double maxValue = 0.0;
+
+	for (const LPBVIMixedAlphaVector &alpha : gamma.at(b.location)) {
+		double value = 0.0;
+		for (unsigned int y = 0; y < b.hidden.size(); y++) {
+			value += alpha.values[y] * b.hidden[y];
+		}
+
+		if (action == nullptr || value > maxValue) {
+			action = alpha.action;
+			maxValue = value;
+		}
+	}
+
+	return action;
+}
+
+void LPBVIMixedPolicy::get(const LPBVIMixedBelief &b, double eta, std::vector<Action *> &actions) const
+{
+	const std::vector<LPBVIMixedAlphaVector> &alphas = gamma.at(b.location);
+
+	std::vector<double> values(alphas.size(), 0.0);
+	double maxValue = -INFINITY;
+
+	for (unsigned int i = 0; i < alphas.size(); i++) {
+		for (unsigned int y = 0; y < b.hidden.size(); y++) {
+			values[i] += alphas[i].values[y] * b.hidden[y];
+		}
+		maxValue = std::max(maxValue, values[i]);
+	}
+
+	actions.clear();
+
+	for (unsigned int i = 0; i < alphas.size(); i++) {
+		if (alphas[i].action != nullptr && values[i] >= maxValue - eta &&
+				std::find(actions.begin(), actions.end(), alphas[i].action) == actions.end()) {
+			actions.push_back(alphas[i].action);
+		}
+	}
+}
+
+double LPBVIMixedPolicy::compute_value(const LPBVIMixedBelief &b) const
+{
+	const std::vector<LPBVIMixedAlphaVector> &alphas = gamma.at(b.location);
+
+	if (alphas.empty()) {
+		return defaultValue;
+	}
+
+	double maxValue = -INFINITY;
+
+	for (const LPBVIMixedAlphaVector &alpha : alphas) {
+		double value = 0.0;
+		for (unsigned int y = 0; y < b.hidden.size(); y++) {
+			value += alpha.values[y] * b.hidden[y];
+		}
+		maxValue = std::max(maxValue, value);
+	}
+
+	return maxValue;
+}
+
+Action *LPBVIMixedPolicy::get(const BeliefState *b) const
+{
+	LPBVIMixedBelief mixed;
+	if (locate(b, mixed)) {
+		throw PolicyException();
+	}
+	return get(mixed);
+}
+
+double LPBVIMixedPolicy::compute_value(const BeliefState *b) const
+{
+	LPBVIMixedBelief mixed;
+	if (locate(b, mixed)) {
+		throw PolicyException();
+	}
+	return compute_value(mixed);
+}
@@ -0,0 +1,784 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/lpbvi_momdp.h"
+#include "../include/lpbvi_session.h"
+
+#include "../../librbr/librbr/include/core/rewards/sa_rewards.h"
+
+#include "../../librbr/librbr/include/core/states/state_exception.h"
+#include "../../librbr/librbr/include/core/rewards/reward_exception.h"
+#include "../../librbr/librbr/include/core/policy/policy_exception.h"
+
+#include <iostream>
+
+#include <math.h>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+
+#include <chrono>
+
+LPBVIMOMDP::LPBVIMOMDP() : LPBVI()
+{
+	mixedBeliefToRecord.location = 0;
+}
+
+LPBVIMOMDP::LPBVIMOMDP(POMDPPBVIExpansionRule expansionRule, unsigned int updateIterations,
+		unsigned int expansionIterations) : LPBVI(expansionRule, updateIterations, expansionIterations)
+{
+	mixedBeliefToRecord.location = 0;
+}
+
+LPBVIMOMDP::~LPBVIMOMDP()
+{ }
+
+void LPBVIMOMDP::set_locations(const std::vector<std::vector<State *> > &newLocations)
+{
+	locations = newLocations;
+}
+
+const std::vector<std::vector<State *> > &LPBVIMOMDP::get_locations() const
+{
+	return locations;
+}
+
+LPBVIMixedPolicy **LPBVIMOMDP::solve_mixed(LPOMDP *lpomdp)
+{
+	// The session performs the same validation as solve, but nothing is kept between solves.
+	LPBVISession session(this, lpomdp);
+
+	solveStart = std::chrono::high_resolution_clock::now();
+
+	std::vector<float> &delta = session.get_slack();
+	FactoredRewards *R = session.get_rewards();
+	Horizon *h = session.get_horizon();
+
+	create_mixed_model(session.get_states(), session.get_actions(), session.get_observations(),
+			session.get_state_transitions(), session.get_observation_transitions(), R, h);
+
+	unsigned int k = R->get_num_rewards();
+
+	// The final set of policies, from the last completed expansion.
+	LPBVIMixedPolicy **policy = nullptr;
+
+	// Initialize the set of belief points to be the initial set, each converted to its location.
+	mixedB.clear();
+	for (BeliefState *b : initialB) {
+		mixedB.push_back(create_mixed_belief(b));
+	}
+
+	std::cout << "Initial Num Belief Points: " << initialB.size() << std::endl; std::cout.flush();
+
+	if (beliefToRecord != nullptr) {
+		mixedBeliefToRecord = create_mixed_belief(beliefToRecord);
+		recordedValues.clear();
+		recordedValues.resize(k);
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::cout << "Starting (Mixed Observability)...\n"; std::cout.flush();
+
+	// Whether the time limit passed or the solve was cancelled.
+	bool stopped = false;
+
+	for (unsigned int e = 0; e < expansions; e++) {
+		std::cout << "Expansion " << (e + 1) << std::endl;
+
+		// All actions are available to start, and are restricted by each value function in turn.
+		std::vector<std::vector<Action *> > Ai(mixedB.size(), mixedActions);
+
+		double deltaB = compute_mixed_belief_density();
+
+		LPBVIMixedPolicy **expansionPolicy = new LPBVIMixedPolicy*[k];
+		for (unsigned int i = 0; i < k; i++) {
+			expansionPolicy[i] = nullptr;
+		}
+
+		for (unsigned int i = 0; i < k; i++) {
+			std::cout << "  R[" << i << "]" << std::endl; std::cout.flush();
+
+			expansionPolicy[i] = create_mixed_policy(i, compute_objective_mixed(h, i, Ai, stopped));
+
+			// If there is already a consistent policy, then this expansion's partial one is discarded.
+			if (stopped && policy != nullptr) {
+				break;
+			}
+
+			// Restrict the set of actions available to each belief point in the next i+1 value function.
+			if (i < k - 1) {
+				double eta = compute_slack(dynamic_cast<SARewards *>(R->get(i)), h, delta[i], deltaB);
+
+				execute_in_parallel(mixedB.size(), [&](unsigned int worker, unsigned int first, unsigned int last) {
+					for (unsigned int j = first; j < last; j++) {
+						expansionPolicy[i]->get(mixedB[j], eta, Ai[j]);
+					}
+				});
+			}
+		}
+
+		if (stopped && policy != nullptr) {
+			for (unsigned int i = 0; i < k; i++) {
+				delete expansionPolicy[i];
+			}
+			delete [] expansionPolicy;
+			break;
+		}
+
+		// This expansion is complete, so its policy replaces the last one.
+		if (policy != nullptr) {
+			for (unsigned int i = 0; i < k; i++) {
+				delete policy[i];
+			}
+			delete [] policy;
+		}
+		policy = expansionPolicy;
+
+		if (stopped || is_stop_requested()) {
+			break;
+		}
+
+		if (e < expansions - 1) {
+			if (rule == POMDPPBVIExpansionRule::NONE) {
+				break;
+			}
+			expand_mixed_belief_points(policy[k - 1]);
+		}
+	}
+
+	// Handle the trivial case in which there were no expansions.
+	if (policy == nullptr) {
+		policy = new LPBVIMixedPolicy*[k];
+		for (unsigned int i = 0; i < k; i++) {
+			policy[i] = new LPBVIMixedPolicy(locations, 0.0);
+		}
+	}
+
+	std::cout << "Complete LPBVI (Mixed Observability) with " << mixedB.size() << " belief points." << std::endl;
+	std::cout.flush();
+
+	// After the main loop is complete, end timing. Also, output the result of the computation time.
+	auto end = std::chrono::high_resolution_clock::now();
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+	std::cout << "Total Elapsed Time (Mixed Observability Version): " << ((double)elapsed.count() / 1000.0) << std::endl; std::cout.flush();
+
+	return policy;
+}
+
+PolicyAlphaVectors **LPBVIMOMDP::solve_infinite_horizon(StatesMap *S, ActionsMap *A,
+		ObservationsMap *Z, StateTransitions *T, ObservationTransitions *O,
+		FactoredRewards *R, Horizon *h, std::vector<float> &delta)
+{
+	// Note: A PolicyAlphaVectors object would value the alpha vectors of every other location as zero at a
+	// belief point, so the mixed policy cannot be represented by one.
+	throw PolicyException();
+}
+
+void LPBVIMOMDP::create_mixed_model(StatesMap *S, ActionsMap *A, ObservationsMap *Z, StateTransitions *T,
+		ObservationTransitions *O, FactoredRewards *R, Horizon *h)
+{
+	unsigned int k = R->get_num_rewards();
+
+	std::vector<SARewards *> Rs;
+	for (unsigned int i = 0; i < k; i++) {
+		SARewards *Ri = dynamic_cast<SARewards *>(R->get(i));
+		if (Ri == nullptr) {
+			throw RewardException();
+		}
+		Rs.push_back(Ri);
+	}
+
+	// The locations must partition the states.
+	stateLocations.clear();
+	unsigned int numStates = 0;
+	for (unsigned int x = 0; x < locations.size(); x++) {
+		for (unsigned int y = 0; y < locations[x].size(); y++) {
+			if (!stateLocations.insert(std::make_pair(locations[x][y], std::make_pair(x, y))).second) {
+				throw StateException();
+			}
+			numStates++;
+		}
+	}
+	if (numStates != S->get_num_states()) {
+		throw StateException();
+	}
+	for (auto s : *S) {
+		if (stateLocations.find(resolve(s)) == stateLocations.end()) {
+			throw StateException();
+		}
+	}
+
+	// The actions and observations in a fixed order, so that the random streams select the same ones.
+	mixedActions.clear();
+	for (auto a : *A) {
+		mixedActions.push_back(resolve(a));
+	}
+	std::sort(mixedActions.begin(), mixedActions.end(), [](Action *a1, Action *a2) {
+		return a1->hash_value() < a2->hash_value();
+	});
+
+	mixedActionIndexes.clear();
+	for (unsigned int a = 0; a < mixedActions.size(); a++) {
+		mixedActionIndexes[mixedActions[a]] = a;
+	}
+
+	mixedObservations.clear();
+	for (auto z : *Z) {
+		mixedObservations.push_back(resolve(z));
+	}
+	std::sort(mixedObservations.begin(), mixedObservations.end(), [](Observation *z1, Observation *z2) {
+		return z1->hash_value() < z2->hash_value();
+	});
+
+	unsigned int numActions = mixedActions.size();
+	unsigned int z = mixedObservations.size();
+
+	mixedTransitions.clear();
+	mixedTransitions.resize(locations.size() * numActions);
+
+	mixedRewards.clear();
+	mixedRewards.resize(k, std::vector<std::vector<double> >(locations.size()));
+
+	// Each worker only writes the model of its own partition of locations.
+	execute_in_parallel(locations.size(), [&](unsigned int worker, unsigned int first, unsigned int last) {
+		std::vector<State *> successors;
+
+		for (unsigned int x = first; x < last; x++) {
+			unsigned int m = locations[x].size();
+
+			for (unsigned int i = 0; i < k; i++) {
+				mixedRewards[i][x].resize((size_t)numActions * m);
+				for (unsigned int a = 0; a < numActions; a++) {
+					for (unsigned int y = 0; y < m; y++) {
+						mixedRewards[i][x][a * m + y] = Rs[i]->get(locations[x][y], mixedActions[a]);
+					}
+				}
+			}
+
+			for (unsigned int a = 0; a < numActions; a++) {
+				std::vector<LPBVIMixedTransition> &next = mixedTransitions[x * numActions + a];
+
+				for (unsigned int y = 0; y < m; y++) {
+					successors.clear();
+					T->successors(S, locations[x][y], mixedActions[a], successors);
+
+					for (State *sp : successors) {
+						double probability = T->get(locations[x][y], mixedActions[a], sp);
+						if (probability <= 0.0) {
+							continue;
+						}
+
+						const std::pair<unsigned int, unsigned int> &location = stateLocations.at(sp);
+						unsigned int mp = locations[location.first].size();
+
+						auto transition = std::find_if(next.begin(), next.end(), [&](const LPBVIMixedTransition &t) {
+							return t.location == location.first;
+						});
+
+						if (transition == next.end()) {
+							LPBVIMixedTransition t;
+							t.location = location.first;
+							t.transitions.resize((size_t)m * mp, 0.0);
+							t.observations.resize((size_t)mp * z);
+							for (unsigned int yp = 0; yp < mp; yp++) {
+								for (unsigned int o = 0; o < z; o++) {
+									t.observations[yp * z + o] = O->get(mixedActions[a],
+											locations[location.first][yp], mixedObservations[o]);
+								}
+							}
+							next.push_back(t);
+							transition = next.end() - 1;
+						}
+
+						transition->transitions[y * mp + location.second] = probability;
+					}
+				}
+			}
+		}
+	});
+}
+
+LPBVIMixedBelief LPBVIMOMDP::create_mixed_belief(const BeliefState *b) const
+{
+	LPBVIMixedBelief result;
+	result.location = 0;
+
+	bool found = false;
+
+	for (const auto &state : stateLocations) {
+		double probability = b->get(state.first);
+		if (probability <= 0.0) {
+			continue;
+		}
+
+		if (!found) {
+			result.location = state.second.first;
+			result.hidden.assign(locations[result.location].size(), 0.0);
+			found = true;
+		} else if (result.location != state.second.first) {
+			throw PolicyException();
+		}
+
+		result.hidden[state.second.second] = probability;
+	}
+
+	if (!found) {
+		throw PolicyException();
+	}
+
+	return result;
+}
+
+std::vector<LPBVIMixedAlphaVector> LPBVIMOMDP::compute_objective_mixed(Horizon *h, unsigned int i,
+		const std::vector<std::vector<Action *> > &Ai, bool &stopped)
+{
+	unsigned int r = mixedB.size();
+
+	// The belief points do not change location, so the alpha vectors of each location are always the same slots.
+	std::vector<std::vector<unsigned int> > gammaLocations(locations.size());
+	for (unsigned int j = 0; j < r; j++) {
+		gammaLocations[mixedB[j].location].push_back(j);
+	}
+
+	std::vector<LPBVIMixedAlphaVector> gamma[2];
+	bool current = false;
+
+	for (unsigned int j = 0; j < r; j++) {
+		LPBVIMixedAlphaVector zeroAlphaVector;
+		zeroAlphaVector.action = nullptr;
+		zeroAlphaVector.values.assign(mixedB[j].hidden.size(), 0.0);
+		gamma[!current].push_back(zeroAlphaVector);
+	}
+
+	for (unsigned int u = 0; u < updates; u++) {
+		// Check for a stop at each update boundary, always allowing one update so that Gamma is usable.
+		if (u > 0 && (stopped || is_stop_requested())) {
+			if (!stopped) {
+				std::cout << "Stopping early." << std::endl; std::cout.flush();
+			}
+			stopped = true;
+			break;
+		}
+
+		gamma[current].resize(r);
+
+		// Each worker computes a contiguous partition of the belief points, and only writes to that partition's
+		// slots of the next Gamma.
+		execute_in_parallel(r, [&](unsigned int worker, unsigned int first, unsigned int last) {
+			for (unsigned int j = first; j < last; j++) {
+				gamma[current][j] = update_mixed_belief_point(h, i, Ai[j], gamma[!current], gammaLocations, j);
+			}
+		});
+
+		record_mixed_value(i, gamma[current]);
+
+		current = !current;
+	}
+
+	return gamma[!current];
+}
+
+LPBVIMixedAlphaVector LPBVIMOMDP::update_mixed_belief_point(Horizon *h, unsigned int i,
+		const std::vector<Action *> &actions, const std::vector<LPBVIMixedAlphaVector> &gammaPrevious,
+		const std::vector<std::vector<unsigned int> > &gammaLocations, unsigned int beliefIndex) const
+{
+	const LPBVIMixedBelief &b = mixedB[beliefIndex];
+
+	unsigned int x = b.location;
+	unsigned int m = b.hidden.size();
+	unsigned int numActions = mixedActions.size();
+	unsigned int z = mixedObservations.size();
+	double discount = h->get_discount_factor();
+
+	LPBVIMixedAlphaVector maxAlphaB;
+	maxAlphaB.action = nullptr;
+	maxAlphaB.values.assign(m, 0.0);
+	double maxAlphaDotBeta = std::numeric_limits<double>::lowest();
+
+	std::vector<double> tau;
+
+	for (Action *action : actions) {
+		unsigned int a = mixedActionIndexes.at(action);
+
+		LPBVIMixedAlphaVector alpha;
+		alpha.action = action;
+		alpha.values.assign(mixedRewards[i][x].begin() + a * m, mixedRewards[i][x].begin() + (a + 1) * m);
+
+		for (const LPBVIMixedTransition &transition : mixedTransitions[x * numActions + a]) {
+			unsigned int mp = locations[transition.location].size();
+			const std::vector<unsigned int> &candidates = gammaLocations[transition.location];
+
+			tau.assign(mp, 0.0);
+
+			for (unsigned int o = 0; o < z; o++) {
+				// The unnormalized belief over the successor location's hidden values after observing o.
+				for (unsigned int yp = 0; yp < mp; yp++) {
+					tau[yp] = 0.0;
+					for (unsigned int y = 0; y < m; y++) {
+						tau[yp] += b.hidden[y] * transition.transitions[y * mp + yp];
+					}
+					tau[yp] *= transition.observations[yp * z + o];
+				}
+
+				// Only the alpha vectors of the successor location are maximized over; without any, its value is that
+				// of the initial zero alpha vectors, so every location starts from the same Gamma.
+				const std::vector<double> *alphaStar = nullptr;
+				double maxValue = std::numeric_limits<double>::lowest();
+				for (unsigned int c : candidates) {
+					double value = 0.0;
+					for (unsigned int yp = 0; yp < mp; yp++) {
+						value += tau[yp] * gammaPrevious[c].values[yp];
+					}
+					if (value > maxValue) {
+						maxValue = value;
+						alphaStar = &gammaPrevious[c].values;
+					}
+				}
+
+				for (unsigned int y = 0; y < m; y++) {
+					double value = 0.0;
+					for (unsigned int yp = 0; yp < mp; yp++) {
+						double probability = transition.transitions[y * mp + yp] * transition.observations[yp * z + o];
+						value += probability * (alphaStar != nullptr ? (*alphaStar)[yp] : 0.0);
+					}
+					alpha.values[y] += discount * value;
+				}
+			}
+		}
+
+		double alphaDotBeta = 0.0;
+		for (unsigned int y = 0; y < m; y++) {
+			alphaDotBeta += alpha.values[y] * b.hidden[y];
+		}
+
+		if (maxAlphaB.action == nullptr || alphaDotBeta > maxAlphaDotBeta) {
+			maxAlphaB = alpha;
+			maxAlphaDotBeta = alphaDotBeta;
+		}
+	}
+
+	return maxAlphaB;
+}
+
+LPBVIMixedPolicy *LPBVIMOMDP::create_mixed_policy(unsigned int i, const std::vector<LPBVIMixedAlphaVector> &gamma) const
+{
+	std::vector<std::vector<LPBVIMixedAlphaVector> > gammaLocations(locations.size());
+	for (unsigned int j = 0; j < gamma.size(); j++) {
+		gammaLocations[mixedB[j].location].push_back(gamma[j]);
+	}
+
+	LPBVIMixedPolicy *policy = new LPBVIMixedPolicy(locations, 0.0);
+	for (unsigned int x = 0; x < locations.size(); x++) {
+		if (!gammaLocations[x].empty()) {
+			policy->set(x, gammaLocations[x]);
+		}
+	}
+
+	return policy;
+}
+
+double LPBVIMOMDP::compute_mixed_belief_density() const
+{
+	double density = 0.0;
+
+	for (const LPBVIMixedBelief &bPrime : mixedB) {
+		for (const LPBVIMixedBelief &b : mixedB) {
+			// Belief points at different locations share no states, so each state differs by its own probability.
+			if (b.location != bPrime.location) {
+				for (double probability : b.hidden) {
+					density = std::max(density, probability);
+				}
+				for (double probability : bPrime.hidden) {
+					density = std::max(density, probability);
+				}
+				continue;
+			}
+
+			for (unsigned int y = 0; y < b.hidden.size(); y++) {
+				density = std::max(density, std::fabs(b.hidden[y] - bPrime.hidden[y]));
+			}
+		}
+	}
+
+	return density;
+}
+
+void LPBVIMOMDP::expand_mixed_belief_points(const LPBVIMixedPolicy *policy)
+{
+	switch (rule) {
+	case POMDPPBVIExpansionRule::NONE:
+		return;
+	case POMDPPBVIExpansionRule::RANDOM_BELIEF_SELECTION:
+	case POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_RANDOM_ACTION:
+	case POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_EXPLORATORY_ACTION:
+		break;
+	case POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_GREEDY_ACTION:
+		if (policy == nullptr) {
+			throw PolicyException();
+		}
+		break;
+	default:
+		throw PolicyException();
+		break;
+	};
+
+	if (mixedActions.empty() || mixedObservations.empty() || locations.empty()) {
+		return;
+	}
+
+	// Each candidate only writes its own slots (bytes, not std::vector<bool>, which would share them between
+	// threads), so the merge below is in the order of the candidates.
+	std::vector<LPBVIMixedBelief> successors(mixedB.size());
+	std::vector<unsigned char> failed(mixedB.size(), true);
+
+	execute_in_parallel(mixedB.size(), [&](unsigned int worker, unsigned int first, unsigned int last) {
+		LPBVIMixedBelief successor;
+
+		for (unsigned int j = first; j < last; j++) {
+			std::mt19937 generator = create_expansion_generator(j);
+
+			if (rule == POMDPPBVIExpansionRule::RANDOM_BELIEF_SELECTION) {
+				// A random location, and a uniformly random distribution over its hidden values.
+				std::uniform_int_distribution<unsigned int> randomLocation(0, locations.size() - 1);
+				std::exponential_distribution<double> exponential(1.0);
+
+				successors[j].location = randomLocation(generator);
+				successors[j].hidden.resize(locations[successors[j].location].size());
+
+				double normalizer = 0.0;
+				for (double &probability : successors[j].hidden) {
+					probability = exponential(generator);
+					normalizer += probability;
+				}
+				if (normalizer <= 0.0) {
+					continue;
+				}
+				for (double &probability : successors[j].hidden) {
+					probability /= normalizer;
+				}
+
+				failed[j] = false;
+
+			} else if (rule == POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_RANDOM_ACTION) {
+				std::uniform_int_distribution<unsigned int> randomAction(0, mixedActions.size() - 1);
+				failed[j] = simulate_mixed_belief(mixedB[j], randomAction(generator), generator, successors[j]);
+
+			} else if (rule == POMDPPBVIExpansionRule::STOCHASTIC_SIMULATION_GREEDY_ACTION) {
+				// Since the policy was computed with the actions restricted by each of the previous value
+				// functions, this is the lexicographically greedy action.
+				Action *action = policy->get(mixedB[j]);
+				if (action == nullptr) {
+					continue;
+				}
+				failed[j] = simulate_mixed_belief(mixedB[j], mixedActionIndexes.at(action), generator, successors[j]);
+
+			} else {
+				double maxDistance = 0.0;
+
+				// Simulate each action, and keep the successor which is farthest from its nearest candidate.
+				for (unsigned int a = 0; a < mixedActions.size(); a++) {
+					if (simulate_mixed_belief(mixedB[j], a, generator, successor)) {
+						continue;
+					}
+
+					double minDistance = std::numeric_limits<double>::max();
+					for (const LPBVIMixedBelief &candidate : mixedB) {
+						minDistance = std::min(minDistance, compute_mixed_distance(successor, candidate));
+					}
+
+					if (failed[j] || minDistance > maxDistance) {
+						maxDistance = minDistance;
+						successors[j] = successor;
+						failed[j] = false;
+					}
+				}
+			}
+		}
+	});
+
+	for (unsigned int j = 0; j < successors.size(); j++) {
+		if (!failed[j]) {
+			mixedB.push_back(successors[j]);
+		}
+	}
+}
+
+bool LPBVIMOMDP::simulate_mixed_belief(const LPBVIMixedBelief &b, unsigned int action, std::mt19937 &generator,
+		LPBVIMixedBelief &result) const
+{
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+	unsigned int m = b.hidden.size();
+	unsigned int z = mixedObservations.size();
+
+	const std::vector<LPBVIMixedTransition> &next = mixedTransitions[b.location * mixedActions.size() + action];
+
+	result.hidden.clear();
+
+	if (m == 0 || next.empty()) {
+		return true;
+	}
+
+	// Randomly select a hidden value following the belief.
+	double target = uniform(generator);
+	double current = 0.0;
+	unsigned int y = m - 1;
+	for (unsigned int yi = 0; yi < m; yi++) {
+		current += b.hidden[yi];
+		if (current >= target) {
+			y = yi;
+			break;
+		}
+	}
+
+	// Randomly select a successor location and hidden value following the state transitions.
+	target = uniform(generator);
+	current = 0.0;
+	const LPBVIMixedTransition *transition = nullptr;
+	unsigned int yp = 0;
+	for (const LPBVIMixedTransition &t : next) {
+		unsigned int mp = locations[t.location].size();
+		for (unsigned int ypi = 0; ypi < mp; ypi++) {
+			double probability = t.transitions[y * mp + ypi];
+			if (probability <= 0.0) {
+				continue;
+			}
+			transition = &t;
+			yp = ypi;
+			current += probability;
+			if (current >= target) {
+				break;
+			}
+		}
+		if (current >= target) {
+			break;
+		}
+	}
+	if (transition == nullptr) {
+		return true;
+	}
+
+	unsigned int mp = locations[transition->location].size();
+
+	// Randomly select an observation following the observation transitions.
+	target = uniform(generator);
+	current = 0.0;
+	int observation = -1;
+	for (unsigned int o = 0; o < z; o++) {
+		double probability = transition->observations[yp * z + o];
+		if (probability <= 0.0) {
+			continue;
+		}
+		observation = o;
+		current += probability;
+		if (current >= target) {
+			break;
+		}
+	}
+	if (observation < 0) {
+		return true;
+	}
+
+	// Compute the belief update over only the hidden values of the successor location.
+	result.location = transition->location;
+	result.hidden.assign(mp, 0.0);
+
+	double normalizer = 0.0;
+	for (unsigned int ypi = 0; ypi < mp; ypi++) {
+		for (unsigned int yi = 0; yi < m; yi++) {
+			result.hidden[ypi] += b.hidden[yi] * transition->transitions[yi * mp + ypi];
+		}
+		result.hidden[ypi] *= transition->observations[ypi * z + observation];
+		normalizer += result.hidden[ypi];
+	}
+
+	if (normalizer <= 0.0) {
+		result.hidden.clear();
+		return true;
+	}
+
+	for (double &probability : result.hidden) {
+		probability /= normalizer;
+	}
+
+	return false;
+}
+
+double LPBVIMOMDP::compute_mixed_distance(const LPBVIMixedBelief &b1, const LPBVIMixedBelief &b2) const
+{
+	double distance = 0.0;
+
+	if (b1.location != b2.location) {
+		for (double probability : b1.hidden) {
+			distance += std::fabs(probability);
+		}
+		for (double probability : b2.hidden) {
+			distance += std::fabs(probability);
+		}
+		return distance;
+	}
+
+	for (unsigned int y = 0; y < b1.hidden.size(); y++) {
+		distance += std::fabs(b1.hidden[y] - b2.hidden[y]);
+	}
+
+	return distance;
+}
+
+void LPBVIMOMDP::record_mixed_value(unsigned int i, const std::vector<LPBVIMixedAlphaVector> &gamma)
+{
+	if (beliefToRecord == nullptr) {
+		return;
+	}
+
+	double maxRecordedValue = std::numeric_limits<double>::lowest();
+	bool found = false;
+
+	for (unsigned int j = 0; j < gamma.size(); j++) {
+		if (mixedB[j].location != mixedBeliefToRecord.location) {
+			continue;
+		}
+
+		double recordedValue = 0.0;
+		for (unsigned int y = 0; y < mixedBeliefToRecord.hidden.size(); y++) {
+			recordedValue += gamma[j].values[y] * mixedBeliefToRecord.hidden[y];
+		}
+		maxRecordedValue = std::max(maxRecordedValue, recordedValue);
+		found = true;
+	}
+
+	if (!found) {
+		maxRecordedValue = 0.0;
+	}
+
+	recordedValues[i].push_back(maxRecordedValue);
+}
+
+std::mt19937 LPBVIMOMDP::create_expansion_generator(unsigned int candidate) const
+{
+	std::seed_seq sequence{expansionSeed, (unsigned int)mixedB.size(), candidate};
+	return std::mt19937(sequence);
+}
@@ -0,0 +1,424 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <unistd.h>
+
+#include "../include/lpbvi_planner.h"
+#include "../include/lpomdp_sparse_state_transitions.h"
+
+#include "../lpbvi_cuda/lpbvi_cuda.h"
+
+#include "../../librbr/librbr/include/core/states/indexed_state.h"
+#include "../../librbr/librbr/include/core/actions/indexed_action.h"
+#include "../../librbr/librbr/include/core/observations/indexed_observation.h"
+
+#include "../../librbr/librbr/include/core/observation_transitions/observation_transitions_array.h"
+#include "../../librbr/librbr/include/core/rewards/sa_rewards_array.h"
+
+#include "../../librbr/librbr/include/core/core_exception.h"
+#include "../../librbr/librbr/include/core/states/state_exception.h"
+#include "../../librbr/librbr/include/core/actions/action_exception.h"
+#include "../../librbr/librbr/include/core/observations/observation_exception.h"
+#include "../../librbr/librbr/include/core/state_transitions/state_transition_exception.h"
+#include "../../librbr/librbr/include/core/observation_transitions/observation_transition_exception.h"
+#include "../../librbr/librbr/include/core/rewards/reward_exception.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include <limits>
+
+// The rough rates of multiply-adds per second of one host thread and of a device, and the factor by which
+// each multiply-add of the sparse solver is slower due to its hash lookups of the alpha vectors.
+#define LPBVI_PLANNER_HOST_RATE 1.0e9
+#define LPBVI_PLANNER_DEVICE_RATE 1.0e11
+#define LPBVI_PLANNER_SPARSE_FACTOR 4.0
+
+// The bytes of one entry of a PolicyAlphaVector or a sparse belief point, including the hash table's overhead.
+#define LPBVI_PLANNER_MAP_ENTRY_BYTES 48
+
+// The fraction of the available memory which a solve may use, leaving room for everything else.
+#define LPBVI_PLANNER_MEMORY_FRACTION 0.8
+
+LPBVIPlanner::LPBVIPlanner()
+{
+	hostMemory = 0;
+	deviceMemory = 0;
+	device = true;
+	numThreads = 0;
+}
+
+LPBVIPlanner::~LPBVIPlanner()
+{ }
+
+void LPBVIPlanner::set_host_memory(unsigned long long bytes)
+{
+	hostMemory = bytes;
+}
+
+void LPBVIPlanner::set_device_memory(unsigned long long bytes)
+{
+	deviceMemory = bytes;
+}
+
+void LPBVIPlanner::device_mode(bool value)
+{
+	device = value;
+}
+
+void LPBVIPlanner::set_num_threads(unsigned int threads)
+{
+	numThreads = threads;
+}
+
+LPBVIPlan LPBVIPlanner::plan(LPOMDP *lpomdp, const std::vector<BeliefState *> &initialB, unsigned int expansions)
+{
+	LPBVIPlan result;
+	measure(lpomdp, initialB, expansions, result.statistics);
+	estimate(result.statistics, result);
+
+	const LPBVIModelStatistics &statistics = result.statistics;
+
+	result.threads = numThreads;
+	if (result.threads == 0) {
+		result.threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// The memory limits default to what is available right now.
+	unsigned long long hostLimit = hostMemory;
+	if (hostLimit == 0) {
+		hostLimit = (unsigned long long)sysconf(_SC_AVPHYS_PAGES) * (unsigned long long)sysconf(_SC_PAGESIZE);
+		hostLimit = (unsigned long long)(hostLimit * LPBVI_PLANNER_MEMORY_FRACTION);
+	}
+
+	unsigned long long deviceLimit = 0;
+	if (device) {
+		deviceLimit = deviceMemory;
+		if (deviceLimit == 0) {
+			unsigned long long deviceFree = 0;
+			unsigned long long deviceTotal = 0;
+			if (lpbvi_get_device_memory(deviceFree, deviceTotal) == 0) {
+				deviceLimit = (unsigned long long)(deviceFree * LPBVI_PLANNER_MEMORY_FRACTION);
+			}
+		}
+	}
+
+	// The multi-threaded solver splits the belief points among its threads, so more threads do not help.
+	unsigned int sparseThreads = std::max(1u, std::min(result.threads, statistics.beliefs));
+
+	double sparseTime = result.sparseCost / (sparseThreads * LPBVI_PLANNER_HOST_RATE);
+	double hostTime = result.denseCost / (result.threads * LPBVI_PLANNER_HOST_RATE);
+	double deviceTime = result.denseCost / LPBVI_PLANNER_DEVICE_RATE;
+
+	std::ostringstream reason;
+
+	// The sparse solver is always possible, so it is the default.
+	result.engine = LPBVIEngine::MULTI_THREADED;
+	double bestTime = sparseTime;
+
+	if (!statistics.dense) {
+		reason << "the model does not have dense arrays with indexed states, actions, and observations";
+	} else if (result.denseBytes > hostLimit) {
+		reason << "the dense arrays (" << (result.denseBytes >> 20) << " MB) do not fit in host memory ("
+				<< (hostLimit >> 20) << " MB)";
+	} else {
+		if (hostTime < bestTime) {
+			result.engine = LPBVIEngine::CUDA_HOST;
+			bestTime = hostTime;
+		}
+
+		if (deviceLimit > 0 && result.denseBytes <= deviceLimit && deviceTime < bestTime) {
+			result.engine = LPBVIEngine::CUDA_DEVICE;
+			bestTime = deviceTime;
+		}
+
+		reason << "it has the lowest estimated time of an update (" << bestTime << " s)";
+		if (deviceLimit == 0) {
+			reason << " without a device";
+		} else if (result.denseBytes > deviceLimit) {
+			reason << "; the dense arrays (" << (result.denseBytes >> 20) << " MB) do not fit on the device ("
+					<< (deviceLimit >> 20) << " MB)";
+		}
+	}
+
+	if (result.engine == LPBVIEngine::MULTI_THREADED) {
+		result.threads = sparseThreads;
+		result.denseModel = false;
+		result.denseBeliefs = false;
+		result.singlePrecision = false;
+
+		if (result.sparseBytes > hostLimit) {
+			reason << "; warning: the sparse representation (" << (result.sparseBytes >> 20)
+					<< " MB) may not fit in host memory either";
+		}
+	} else {
+		result.denseModel = true;
+		result.denseBeliefs = true;
+		result.singlePrecision = true;
+	}
+
+	result.maxNonZeroBeliefStates = statistics.maxNonZeroBeliefStates;
+	result.maxSuccessorStates = statistics.maxSuccessorStates;
+	result.reason = reason.str();
+
+	std::cout << "Planner: n = " << statistics.n << ", m = " << statistics.m << ", z = " << statistics.z <<
+			", k = " << statistics.k << ", r = " << statistics.initialBeliefs << " (at most " << statistics.beliefs <<
+			" after expansions)." << std::endl;
+	std::cout << "Planner: Non-zeros of T = " << statistics.nonZeroT << ", O = " << statistics.nonZeroO <<
+			", R = " << statistics.nonZeroR << "; max successors = " << statistics.maxSuccessorStates <<
+			", max non-zero belief states = " << statistics.maxNonZeroBeliefStates << "." << std::endl;
+	std::cout << "Planner: Dense " << (result.denseBytes >> 20) << " MB and " << result.denseCost <<
+			" multiply-adds per update; sparse " << (result.sparseBytes >> 20) << " MB and " << result.sparseCost <<
+			"." << std::endl;
+	std::cout << "Planner: Chose " << (result.engine == LPBVIEngine::CUDA_DEVICE ? "LPBVICuda (device)" :
+			(result.engine == LPBVIEngine::CUDA_HOST ? "LPBVICuda (host)" : "LPBVI")) << " with " <<
+			result.threads << " threads, since " << result.reason << "." << std::endl;
+	std::cout.flush();
+
+	return result;
+}
+
+LPBVI *LPBVIPlanner::create_solver(const LPBVIPlan &plan, POMDPPBVIExpansionRule expansionRule,
+		unsigned int updateIterations, unsigned int expansionIterations) const
+{
+	LPBVI *solver = nullptr;
+
+	if (plan.engine == LPBVIEngine::MULTI_THREADED) {
+		solver = new LPBVI(expansionRule, updateIterations, expansionIterations);
+	} else {
+		solver = new LPBVICuda(expansionRule, updateIterations, expansionIterations);
+	}
+
+	apply(plan, solver);
+
+	return solver;
+}
+
+bool LPBVIPlanner::apply(const LPBVIPlan &plan, LPBVI *solver) const
+{
+	if (solver == nullptr) {
+		return true;
+	}
+
+	LPBVICuda *cudaSolver = dynamic_cast<LPBVICuda *>(solver);
+
+	if (plan.engine == LPBVIEngine::MULTI_THREADED) {
+		if (cudaSolver != nullptr) {
+			return true;
+		}
+	} else {
+		if (cudaSolver == nullptr) {
+			return true;
+		}
+
+		cudaSolver->set_backend(plan.engine == LPBVIEngine::CUDA_HOST ? LPBVICudaBackend::HOST : LPBVICudaBackend::DEVICE);
+		cudaSolver->set_performance_variables(plan.maxNonZeroBeliefStates, plan.maxSuccessorStates);
+	}
+
+	solver->set_num_threads(plan.threads);
+
+	return false;
+}
+
+void LPBVIPlanner::measure(LPOMDP *lpomdp, const std::vector<BeliefState *> &initialB, unsigned int expansions,
+		LPBVIModelStatistics &result) const
+{
+	if (lpomdp == nullptr) {
+		throw CoreException();
+	}
+
+	StatesMap *S = dynamic_cast<StatesMap *>(lpomdp->get_states());
+	if (S == nullptr) {
+		throw StateException();
+	}
+
+	ActionsMap *A = dynamic_cast<ActionsMap *>(lpomdp->get_actions());
+	if (A == nullptr) {
+		throw ActionException();
+	}
+
+	ObservationsMap *Z = dynamic_cast<ObservationsMap *>(lpomdp->get_observations());
+	if (Z == nullptr) {
+		throw ObservationException();
+	}
+
+	StateTransitions *T = lpomdp->get_state_transitions();
+	if (T == nullptr) {
+		throw StateTransitionException();
+	}
+
+	ObservationTransitions *O = lpomdp->get_observation_transitions();
+	if (O == nullptr) {
+		throw ObservationTransitionException();
+	}
+
+	FactoredRewards *R = dynamic_cast<FactoredRewards *>(lpomdp->get_rewards());
+	if (R == nullptr) {
+		throw RewardException();
+	}
+
+	std::vector<SARewards *> Rs;
+	for (unsigned int i = 0; i < R->get_num_rewards(); i++) {
+		SARewards *Ri = dynamic_cast<SARewards *>(R->get(i));
+		if (Ri == nullptr) {
+			throw RewardException();
+		}
+		Rs.push_back(Ri);
+	}
+
+	result.n = S->get_num_states();
+	result.m = A->get_num_actions();
+	result.z = Z->get_num_observations();
+	result.k = R->get_num_rewards();
+
+	// LPBVICuda requires the dense arrays of O and R, and that the hash values of the states, actions, and
+	// observations are their indexes into them. Any T may be used, since only its successors are transferred.
+	result.dense = (dynamic_cast<ObservationTransitionsArray *>(O) != nullptr);
+	for (SARewards *Ri : Rs) {
+		result.dense = result.dense && (dynamic_cast<SARewardsArray *>(Ri) != nullptr);
+	}
+
+	std::vector<State *> states;
+	for (auto s : *S) {
+		states.push_back(resolve(s));
+		result.dense = result.dense && (dynamic_cast<IndexedState *>(states.back()) != nullptr);
+	}
+
+	std::vector<Action *> actions;
+	for (auto a : *A) {
+		actions.push_back(resolve(a));
+		result.dense = result.dense && (dynamic_cast<IndexedAction *>(actions.back()) != nullptr);
+	}
+
+	std::vector<Observation *> observations;
+	for (auto z : *Z) {
+		observations.push_back(resolve(z));
+		result.dense = result.dense && (dynamic_cast<IndexedObservation *>(observations.back()) != nullptr);
+	}
+
+	result.nonZeroT = 0;
+	result.nonZeroO = 0;
+	result.nonZeroR = 0;
+	result.maxSuccessorStates = 0;
+
+	std::vector<State *> successors;
+
+	// The sparse rows already know their non-zeros; otherwise, they are counted through T.
+	LPOMDPSparseStateTransitions *Tsparse = dynamic_cast<LPOMDPSparseStateTransitions *>(T);
+	if (Tsparse != nullptr) {
+		result.nonZeroT = Tsparse->get_num_entries();
+		result.maxSuccessorStates = Tsparse->get_max_successors();
+	}
+
+	for (State *s : states) {
+		for (Action *a : actions) {
+			if (Tsparse == nullptr) {
+				successors.clear();
+				T->successors(S, s, a, successors);
+
+				unsigned int count = 0;
+				for (State *sp : successors) {
+					if (T->get(s, a, sp) > 0.0) {
+						count++;
+					}
+				}
+
+				result.nonZeroT += count;
+				result.maxSuccessorStates = std::max(result.maxSuccessorStates, count);
+			}
+
+			for (Observation *z : observations) {
+				if (O->get(a, s, z) > 0.0) {
+					result.nonZeroO++;
+				}
+			}
+
+			for (SARewards *Ri : Rs) {
+				if (Ri->get(s, a) != 0.0) {
+					result.nonZeroR++;
+				}
+			}
+		}
+	}
+
+	result.maxInitialNonZeroBeliefStates = 0;
+	for (BeliefState *b : initialB) {
+		unsigned int count = 0;
+		for (State *s : states) {
+			if (b->get(s) > 0.0) {
+				count++;
+			}
+		}
+		result.maxInitialNonZeroBeliefStates = std::max(result.maxInitialNonZeroBeliefStates, count);
+	}
+
+	// Each expansion adds at most one successor of each belief point, whose non-zero states are at most the
+	// successors of the belief point's non-zero states.
+	result.initialBeliefs = initialB.size();
+	unsigned long long beliefs = initialB.size();
+	unsigned long long nonZeroBeliefStates = result.maxInitialNonZeroBeliefStates;
+	for (unsigned int e = 1; e < expansions; e++) {
+		beliefs = std::min(beliefs * 2, (unsigned long long)std::numeric_limits<unsigned int>::max());
+		nonZeroBeliefStates = std::min(nonZeroBeliefStates * std::max(1u, result.maxSuccessorStates),
+				(unsigned long long)result.n);
+	}
+	result.beliefs = (unsigned int)beliefs;
+	result.maxNonZeroBeliefStates = std::max(1u, (unsigned int)nonZeroBeliefStates);
+	result.maxSuccessorStates = std::max(1u, result.maxSuccessorStates);
+}
+
+void LPBVIPlanner::estimate(const LPBVIModelStatistics &statistics, LPBVIPlan &result) const
+{
+	double n = statistics.n;
+	double m = statistics.m;
+	double z = statistics.z;
+	double k = statistics.k;
+	double r = statistics.beliefs;
+	double nb = statistics.maxNonZeroBeliefStates;
+	double ns = statistics.maxSuccessorStates;
+
+	// The non-zero states of a successor of a belief point.
+	double nbs = std::min(n, nb * ns);
+
+	// Both keep a PolicyAlphaVector over all of the states for each belief point and value function.
+	double policyBytes = k * r * n * LPBVI_PLANNER_MAP_ENTRY_BYTES;
+
+	// LPBVICuda: the probabilities of the successor states of T, and the m-n-z and n-m arrays of O and each R;
+	// the r-n arrays of B and Gamma (on both sides); the r-m available actions; and the non-zero belief states
+	// and successor states.
+	result.denseBytes = (unsigned long long)(policyBytes + sizeof(float) * (n * m * ns + m * n * z + k * n * m +
+			3.0 * r * n + r) + r * m + sizeof(int) * (r * nb + n * m * ns));
+
+	// LPBVI: the sparse belief points and their successors for each action and observation in the belief
+	// cache; the two sets of alpha vectors of Gamma; and Gamma_{a, *} for each action and value function.
+	result.sparseBytes = (unsigned long long)(policyBytes + LPBVI_PLANNER_MAP_ENTRY_BYTES * (r * nb +
+			r * m * z * nbs + 2.0 * r * n + k * m * n));
+
+	// Both backups maximize over the r alpha vectors, for each belief point, action, and observation, with a
+	// product over the non-zero states of the successor; the dense kernel iterates over the non-zero belief
+	// states and each of their successors.
+	result.denseCost = r * m * (z * r * nb * ns + nb);
+	result.sparseCost = r * m * (z * r * nbs + nb) * LPBVI_PLANNER_SPARSE_FACTOR;
+}
@@ -0,0 +1,182 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/lpbvi_session.h"
+#include "../include/lpbvi.h"
+
+#include "../../librbr/librbr/include/core/core_exception.h"
+#include "../../librbr/librbr/include/core/states/state_exception.h"
+#include "../../librbr/librbr/include/core/actions/action_exception.h"
+#include "../../librbr/librbr/include/core/observations/observation_exception.h"
+#include "../../librbr/librbr/include/core/state_transitions/state_transition_exception.h"
+#include "../../librbr/librbr/include/core/observation_transitions/observation_transition_exception.h"
+#include "../../librbr/librbr/include/core/rewards/reward_exception.h"
+
+LPBVISession::LPBVISession(LPBVI *solver, LPOMDP *lpomdp)
+{
+	if (solver == nullptr || lpomdp == nullptr) {
+		throw CoreException();
+	}
+
+	this->solver = solver;
+	this->lpomdp = lpomdp;
+	gammaAStar = nullptr;
+
+	// Attempt to convert the states object into FiniteStates.
+	S = dynamic_cast<StatesMap *>(lpomdp->get_states());
+	if (S == nullptr) {
+		throw StateException();
+	}
+
+	// Attempt to convert the actions object into FiniteActions.
+	A = dynamic_cast<ActionsMap *>(lpomdp->get_actions());
+	if (A == nullptr) {
+		throw ActionException();
+	}
+
+	// Attempt to convert the observations object into FiniteObservations.
+	Z = dynamic_cast<ObservationsMap *>(lpomdp->get_observations());
+	if (Z == nullptr) {
+		throw ObservationException();
+	}
+
+	// Attempt to get the state transitions.
+	T = lpomdp->get_state_transitions();
+	if (T == nullptr) {
+		throw StateTransitionException();
+	}
+
+	// Attempt to get the observations transitions.
+	O = lpomdp->get_observation_transitions();
+	if (O == nullptr) {
+		throw ObservationTransitionException();
+	}
+
+	// Attempt to convert the rewards object into FactoredRewards.
+	R = dynamic_cast<FactoredRewards *>(lpomdp->get_rewards());
+	if (R == nullptr) {
+		throw RewardException();
+	}
+
+	// Obtain the horizon, which must be infinite.
+	h = lpomdp->get_horizon();
+	if (h->is_finite()) {
+		throw CoreException();
+	}
+}
+
+LPBVISession::~LPBVISession()
+{
+	invalidate();
+}
+
+PolicyAlphaVectors **LPBVISession::solve()
+{
+	return solver->solve(this);
+}
+
+PolicyAlphaVectors **LPBVISession::compute_value(PolicyAlphaVectors *policy)
+{
+	return solver->compute_value(this, policy);
+}
+
+void LPBVISession::invalidate()
+{
+	solver->release_session(this);
+}
+
+LPBVI *LPBVISession::get_solver() const
+{
+	return solver;
+}
+
+LPOMDP *LPBVISession::get_lpomdp() const
+{
+	return lpomdp;
+}
+
+StatesMap *LPBVISession::get_states() const
+{
+	return S;
+}
+
+ActionsMap *LPBVISession::get_actions() const
+{
+	return A;
+}
+
+ObservationsMap *LPBVISession::get_observations() const
+{
+	return Z;
+}
+
+StateTransitions *LPBVISession::get_state_transitions() const
+{
+	return T;
+}
+
+ObservationTransitions *LPBVISession::get_observation_transitions() const
+{
+	return O;
+}
+
+FactoredRewards *LPBVISession::get_rewards() const
+{
+	return R;
+}
+
+Horizon *LPBVISession::get_horizon() const
+{
+	return h;
+}
+
+std::vector<float> &LPBVISession::get_slack()
+{
+	// Handle the trivial case in which the slack variables were incorrectly defined.
+	if (lpomdp->get_slack().size() != R->get_num_rewards()) {
+		throw RewardException();
+	}
+	for (int i = 0; i < (int)lpomdp->get_slack().size(); i++) {
+		if (lpomdp->get_slack().at(i) < 0.0) {
+			throw RewardException();
+		}
+	}
+
+	return lpomdp->get_slack();
+}
+
+std::map<Action *, std::vector<PolicyAlphaVector *> > *LPBVISession::get_gamma_a_star() const
+{
+	return gammaAStar;
+}
+
+void LPBVISession::set_gamma_a_star(std::map<Action *, std::vector<PolicyAlphaVector *> > *newGammaAStar)
+{
+	gammaAStar = newGammaAStar;
+}
+
+std::unordered_map<Action *, LPBVIActionModel> &LPBVISession::get_action_models()
+{
+	return actionModels;
+}
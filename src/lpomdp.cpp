@@ -26,12 +26,20 @@
 
 #include "../../librbr/librbr/include/core/rewards/reward_exception.h"
 
+std::mutex LPOMDP::indexerMutex;
+
+std::atomic<unsigned long long> LPOMDP::nextIdentity(1);
+
 LPOMDP::LPOMDP()
-{ }
+{
+	identity = nextIdentity++;
+}
 
 LPOMDP::LPOMDP(States *S, Actions *A, Observations *Z, StateTransitions *T, ObservationTransitions *O,
 		FactoredRewards *R, Initial *s, Horizon *h, std::vector<float> *d) : POMDP(S, A, Z, T, O, R, h)
 {
+	identity = nextIdentity++;
+
 	for (float val : *d) {
 		delta.push_back(val);
 	}
@@ -63,3 +71,8 @@ std::vector<float> &LPOMDP::get_slack()
 {
 	return delta;
 }
+
+unsigned long long LPOMDP::get_identity() const
+{
+	return identity;
+}
@@ -0,0 +1,1348 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../include/lpomdp_cassandra.h"
+#include "../include/lpomdp_sparse_state_transitions.h"
+
+#include "../../librbr/librbr/include/core/states/states_map.h"
+#include "../../librbr/librbr/include/core/actions/actions_map.h"
+#include "../../librbr/librbr/include/core/observations/observations_map.h"
+#include "../../librbr/librbr/include/core/rewards/factored_weighted_rewards.h"
+#include "../../librbr/librbr/include/core/rewards/sa_rewards.h"
+#include "../../librbr/librbr/include/core/core_exception.h"
+
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <cmath>
+#include <functional>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+/**
+ * The number of chunks given to each thread, so that uneven chunks balance out.
+ */
+#define LPOMDP_CASSANDRA_CHUNKS_PER_THREAD 4
+
+/**
+ * The length of the longest number which is copied to the stack to be converted; longer ones are copied to the heap.
+ */
+#define LPOMDP_CASSANDRA_MAX_NUMBER_LENGTH 63
+
+/**
+ * The size of the buffer used to write a file; it is written out once it is this full.
+ */
+#define LPOMDP_CASSANDRA_BUFFER_SIZE (1 << 22)
+
+/**
+ * A streaming writer of a Cassandra format file, which formats the text into a large buffer.
+ */
+class LPOMDPCassandraWriter {
+public:
+	/**
+	 * The constructor of the LPOMDPCassandraWriter object, which opens the file.
+	 * @param	filename	The name of the file.
+	 */
+	LPOMDPCassandraWriter(std::string filename) : bytes(0) {
+		buffer.reserve(LPOMDP_CASSANDRA_BUFFER_SIZE + 256);
+		file.open(filename, std::ios::binary | std::ios::trunc);
+	}
+
+	/**
+	 * Write a string.
+	 * @param	text	The string.
+	 * @return	The writer.
+	 */
+	LPOMDPCassandraWriter &operator<<(const char *text) {
+		buffer.append(text);
+		return reserve();
+	}
+
+	/**
+	 * Write an unsigned integer.
+	 * @param	value	The integer.
+	 * @return	The writer.
+	 */
+	LPOMDPCassandraWriter &operator<<(unsigned int value) {
+		char digits[16];
+		char *p = digits + sizeof(digits);
+		do {
+			*(--p) = '0' + (value % 10);
+			value /= 10;
+		} while (value != 0);
+		buffer.append(p, digits + sizeof(digits) - p);
+		return reserve();
+	}
+
+	/**
+	 * Write a number.
+	 * @param	value	The number.
+	 * @return	The writer.
+	 */
+	LPOMDPCassandraWriter &operator<<(double value) {
+		char digits[32];
+		int length = std::snprintf(digits, sizeof(digits), "%.15g", value);
+		buffer.append(digits, length);
+		return reserve();
+	}
+
+	/**
+	 * Write a probability or reward, with the fewest digits which recover the float exactly.
+	 * @param	value	The number.
+	 * @return	The writer.
+	 */
+	LPOMDPCassandraWriter &operator<<(float value) {
+		char digits[32];
+		int length = 0;
+		for (int precision = 6; precision <= 9; precision++) {
+			length = std::snprintf(digits, sizeof(digits), "%.*g", precision, (double)value);
+			if (std::strtof(digits, nullptr) == value) {
+				break;
+			}
+		}
+		buffer.append(digits, length);
+		return reserve();
+	}
+
+	/**
+	 * Write out the rest of the buffer and close the file.
+	 * @return	Returns true if an error arose, and false otherwise.
+	 */
+	bool close() {
+		flush();
+		file.close();
+		return file.fail();
+	}
+
+	/**
+	 * The output file.
+	 */
+	std::ofstream file;
+
+	/**
+	 * The number of bytes written.
+	 */
+	unsigned long long bytes;
+
+private:
+	/**
+	 * Write out the buffer once it is full.
+	 * @return	The writer.
+	 */
+	LPOMDPCassandraWriter &reserve() {
+		if (buffer.size() >= LPOMDP_CASSANDRA_BUFFER_SIZE) {
+			flush();
+		}
+		return *this;
+	}
+
+	/**
+	 * Write out the buffer.
+	 */
+	void flush() {
+		file.write(buffer.data(), buffer.size());
+		bytes += buffer.size();
+		buffer.clear();
+	}
+
+	/**
+	 * The buffer of formatted text.
+	 */
+	std::string buffer;
+};
+
+/**
+ * Find the most common of the rows of a state, one for each action.
+ * @param	rows	The rows.
+ * @param	count	The number of rows equal to it. This will be modified.
+ * @return	The index of the first of the most common rows.
+ */
+template <typename T>
+static unsigned int find_common_row(const std::vector<T> &rows, unsigned int &count)
+{
+	unsigned int common = 0;
+	count = 0;
+
+	for (unsigned int i = 0; i < rows.size() && rows.size() - i > count; i++) {
+		unsigned int matches = (unsigned int)std::count(rows.begin() + i, rows.end(), rows[i]);
+		if (matches > count) {
+			common = i;
+			count = matches;
+		}
+	}
+
+	return common;
+}
+
+/**
+ * A token in the mapped file, which is either a ':' or a run of characters up to whitespace or a ':'.
+ */
+struct LPOMDPCassandraToken {
+	const char *begin;
+	const char *end;
+
+	/**
+	 * Check if the token is exactly a string.
+	 * @param	value	The string.
+	 * @return	Returns true if the token is the string, and false otherwise.
+	 */
+	bool is(const char *value) const {
+		const char *p = begin;
+		for (; p != end && *value != '\0'; p++, value++) {
+			if (*p != *value) {
+				return false;
+			}
+		}
+		return (p == end && *value == '\0');
+	}
+};
+
+/**
+ * The preamble of a file: the sizes, names, and the start distribution's tokens.
+ */
+struct LPOMDPCassandraPreamble {
+	double discount;
+	bool cost;
+	unsigned int n;
+	unsigned int m;
+	unsigned int z;
+	std::unordered_map<std::string, unsigned int> stateNames;
+	std::unordered_map<std::string, unsigned int> actionNames;
+	std::unordered_map<std::string, unsigned int> observationNames;
+};
+
+/**
+ * The entries parsed from one chunk, in file order, as (flat index, value) pairs. The index of a state
+ * transition is ((s * m + a) * n + sp), of an observation ((a * n + sp) * z + o), and of a reward (s * m + a).
+ */
+struct LPOMDPCassandraChunk {
+	const char *begin;
+	const char *end;
+	std::vector<std::pair<unsigned long long, float> > T;
+	std::vector<std::pair<unsigned long long, float> > O;
+	std::vector<std::pair<unsigned long long, float> > R;
+	unsigned long long numEntries;
+	const char *error;
+	std::string reason;
+};
+
+/**
+ * Read the next token, skipping whitespace and comments.
+ * @param	p		The current position. This will be modified.
+ * @param	end		The end of the text.
+ * @param	token	The token. This will be modified.
+ * @return	Returns true if there is no token left, and false otherwise.
+ */
+static bool next_token(const char *&p, const char *end, LPOMDPCassandraToken &token)
+{
+	while (p != end) {
+		if (*p == '#') {
+			while (p != end && *p != '\n') {
+				p++;
+			}
+		} else if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+			p++;
+		} else {
+			break;
+		}
+	}
+
+	if (p == end) {
+		return true;
+	}
+
+	token.begin = p;
+	if (*p == ':') {
+		p++;
+	} else {
+		while (p != end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' && *p != ':' && *p != '#') {
+			p++;
+		}
+	}
+	token.end = p;
+
+	return false;
+}
+
+/**
+ * Check if the next token is a ':', and read it if so.
+ * @param	p		The current position. This will be modified if the next token is a ':'.
+ * @param	end		The end of the text.
+ * @return	Returns true if the next token was a ':', and false otherwise.
+ */
+static bool next_colon(const char *&p, const char *end)
+{
+	const char *q = p;
+	LPOMDPCassandraToken token;
+	if (next_token(q, end, token) || !token.is(":")) {
+		return false;
+	}
+	p = q;
+	return true;
+}
+
+/**
+ * Parse a decimal number, with an optional sign, fraction and exponent. The token is only scanned
+ * here to check its syntax; it is converted by strtod, so that the value is correctly rounded.
+ * @param	token	The token.
+ * @param	value	The number. This will be modified.
+ * @return	Returns true if the token is not a number, and false otherwise.
+ */
+static bool parse_number(const LPOMDPCassandraToken &token, double &value)
+{
+	const char *p = token.begin;
+	if (p != token.end && (*p == '-' || *p == '+')) {
+		p++;
+	}
+
+	bool digits = false;
+	for (; p != token.end && *p >= '0' && *p <= '9'; p++) {
+		digits = true;
+	}
+	if (p != token.end && *p == '.') {
+		for (p++; p != token.end && *p >= '0' && *p <= '9'; p++) {
+			digits = true;
+		}
+	}
+	if (!digits) {
+		return true;
+	}
+
+	if (p != token.end && (*p == 'e' || *p == 'E')) {
+		p++;
+		if (p != token.end && (*p == '-' || *p == '+')) {
+			p++;
+		}
+		if (p == token.end || *p < '0' || *p > '9') {
+			return true;
+		}
+		for (; p != token.end && *p >= '0' && *p <= '9'; p++);
+	}
+	if (p != token.end) {
+		return true;
+	}
+
+	// The mapped file is not null-terminated after the token, so strtod is given a copy of it.
+	size_t length = token.end - token.begin;
+	char buffer[LPOMDP_CASSANDRA_MAX_NUMBER_LENGTH + 1];
+	if (length <= LPOMDP_CASSANDRA_MAX_NUMBER_LENGTH) {
+		std::copy(token.begin, token.end, buffer);
+		buffer[length] = '\0';
+		value = std::strtod(buffer, nullptr);
+	} else {
+		value = std::strtod(std::string(token.begin, token.end).c_str(), nullptr);
+	}
+	return false;
+}
+
+/**
+ * Parse a state, action or observation, which is a '*', an index, or a name.
+ * @param	token		The token.
+ * @param	count		The number of states, actions or observations.
+ * @param	names		The names, if they were given.
+ * @param	first		The first index referred to. This will be modified.
+ * @param	last		One past the last index referred to. This will be modified.
+ * @return	Returns true if the token does not refer to one, and false otherwise.
+ */
+static bool parse_index(const LPOMDPCassandraToken &token, unsigned int count,
+		const std::unordered_map<std::string, unsigned int> &names, unsigned int &first, unsigned int &last)
+{
+	if (token.is("*")) {
+		first = 0;
+		last = count;
+		return false;
+	}
+
+	if (names.empty()) {
+		unsigned long long index = 0;
+		if (token.begin == token.end) {
+			return true;
+		}
+		for (const char *p = token.begin; p != token.end; p++) {
+			if (*p < '0' || *p > '9') {
+				return true;
+			}
+			index = std::min(index * 10 + (*p - '0'), (unsigned long long)count);
+		}
+		if (index >= count) {
+			return true;
+		}
+		first = (unsigned int)index;
+	} else {
+		auto name = names.find(std::string(token.begin, token.end));
+		if (name == names.end()) {
+			return true;
+		}
+		first = name->second;
+	}
+
+	last = first + 1;
+	return false;
+}
+
+/**
+ * Parse a row or matrix of values following an entry: either "uniform", "identity" (square matrices only),
+ * or all of the values in row-major order.
+ * @param	p			The current position. This will be modified.
+ * @param	end			The end of the chunk.
+ * @param	rows		The number of rows.
+ * @param	columns		The number of columns.
+ * @param	values		The values. This will be modified.
+ * @param	reason		The reason it failed. This will be modified.
+ * @return	Returns true if an error arose, and false otherwise.
+ */
+static bool parse_values(const char *&p, const char *end, unsigned int rows, unsigned int columns,
+		std::vector<double> &values, std::string &reason)
+{
+	values.resize((size_t)rows * columns);
+
+	const char *q = p;
+	LPOMDPCassandraToken token;
+	if (next_token(q, end, token)) {
+		reason = "values are missing";
+		return true;
+	}
+
+	if (token.is("uniform")) {
+		std::fill(values.begin(), values.end(), 1.0 / columns);
+		p = q;
+		return false;
+	} else if (token.is("identity")) {
+		if (rows != columns) {
+			reason = "an identity is only valid for the state transitions";
+			return true;
+		}
+		std::fill(values.begin(), values.end(), 0.0);
+		for (unsigned int i = 0; i < rows; i++) {
+			values[(size_t)i * columns + i] = 1.0;
+		}
+		p = q;
+		return false;
+	}
+
+	for (double &value : values) {
+		if (next_token(p, end, token) || parse_number(token, value)) {
+			reason = "a value is missing or is not a number";
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Parse a T or O entry, which is "X: a : i : j p", "X: a : i" followed by a row, or "X: a" followed by a
+ * matrix, with wildcards. The entries are appended with index ((a * rows + i) * columns + j), or
+ * ((i * m + a) * columns + j) if the rows are the states and they precede the actions.
+ * @param	p				The current position, after the "X". This will be modified.
+ * @param	end				The end of the chunk.
+ * @param	preamble		The preamble.
+ * @param	rowNames		The names of the rows.
+ * @param	columns			The number of columns.
+ * @param	columnNames		The names of the columns.
+ * @param	stateMajor		True if the state (row) precedes the action in the index, and false otherwise.
+ * @param	result			The entries. This will be modified.
+ * @param	reason			The reason it failed. This will be modified.
+ * @return	Returns true if an error arose, and false otherwise.
+ */
+static bool parse_probabilities(const char *&p, const char *end, const LPOMDPCassandraPreamble &preamble,
+		const std::unordered_map<std::string, unsigned int> &rowNames, unsigned int columns,
+		const std::unordered_map<std::string, unsigned int> &columnNames, bool stateMajor,
+		std::vector<std::pair<unsigned long long, float> > &result, std::string &reason)
+{
+	unsigned long long n = preamble.n;
+	unsigned long long m = preamble.m;
+
+	auto flat = [&](unsigned long long a, unsigned long long i, unsigned long long j) {
+		return (stateMajor ? (i * m + a) : (a * n + i)) * columns + j;
+	};
+
+	LPOMDPCassandraToken token;
+	unsigned int aFirst = 0, aLast = 0, iFirst = 0, iLast = n, jFirst = 0, jLast = columns;
+
+	if (!next_colon(p, end) || next_token(p, end, token) ||
+			parse_index(token, preamble.m, preamble.actionNames, aFirst, aLast)) {
+		reason = "the action is invalid";
+		return true;
+	}
+
+	std::vector<double> values;
+
+	// The matrix form.
+	if (!next_colon(p, end)) {
+		if (parse_values(p, end, preamble.n, columns, values, reason)) {
+			return true;
+		}
+		for (unsigned int a = aFirst; a < aLast; a++) {
+			for (unsigned int i = 0; i < preamble.n; i++) {
+				for (unsigned int j = 0; j < columns; j++) {
+					result.push_back(std::make_pair(flat(a, i, j), (float)values[(size_t)i * columns + j]));
+				}
+			}
+		}
+		return false;
+	}
+
+	if (next_token(p, end, token) || parse_index(token, preamble.n, rowNames, iFirst, iLast)) {
+		reason = "the state is invalid";
+		return true;
+	}
+
+	// The row form.
+	if (!next_colon(p, end)) {
+		if (parse_values(p, end, 1, columns, values, reason)) {
+			return true;
+		}
+		for (unsigned int a = aFirst; a < aLast; a++) {
+			for (unsigned int i = iFirst; i < iLast; i++) {
+				for (unsigned int j = 0; j < columns; j++) {
+					result.push_back(std::make_pair(flat(a, i, j), (float)values[j]));
+				}
+			}
+		}
+		return false;
+	}
+
+	// The single entry form.
+	double value = 0.0;
+	if (next_token(p, end, token) || parse_index(token, columns, columnNames, jFirst, jLast)) {
+		reason = "the successor state or observation is invalid";
+		return true;
+	}
+	if (next_token(p, end, token) || parse_number(token, value)) {
+		reason = "the probability is missing or is not a number";
+		return true;
+	}
+	for (unsigned int a = aFirst; a < aLast; a++) {
+		for (unsigned int i = iFirst; i < iLast; i++) {
+			for (unsigned int j = jFirst; j < jLast; j++) {
+				result.push_back(std::make_pair(flat(a, i, j), (float)value));
+			}
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Parse an R entry, which must be "R: a : s : * : * r" with wildcards for a and s.
+ * @param	p				The current position, after the "R". This will be modified.
+ * @param	end				The end of the chunk.
+ * @param	preamble		The preamble.
+ * @param	result			The entries. This will be modified.
+ * @param	reason			The reason it failed. This will be modified.
+ * @return	Returns true if an error arose, and false otherwise.
+ */
+static bool parse_reward(const char *&p, const char *end, const LPOMDPCassandraPreamble &preamble,
+		std::vector<std::pair<unsigned long long, float> > &result, std::string &reason)
+{
+	LPOMDPCassandraToken token;
+	unsigned int aFirst = 0, aLast = 0, sFirst = 0, sLast = 0;
+
+	if (!next_colon(p, end) || next_token(p, end, token) ||
+			parse_index(token, preamble.m, preamble.actionNames, aFirst, aLast)) {
+		reason = "the action is invalid";
+		return true;
+	}
+	if (!next_colon(p, end) || next_token(p, end, token) ||
+			parse_index(token, preamble.n, preamble.stateNames, sFirst, sLast)) {
+		reason = "the state is invalid";
+		return true;
+	}
+
+	// Note: An LPOMDP has state-action rewards, so the successor state and observation must be wildcards.
+	for (unsigned int i = 0; i < 2; i++) {
+		if (!next_colon(p, end) || next_token(p, end, token) || !token.is("*")) {
+			reason = "only state-action rewards (R: a : s : * : * r) are supported";
+			return true;
+		}
+	}
+
+	double value = 0.0;
+	if (next_token(p, end, token) || parse_number(token, value)) {
+		reason = "the reward is missing or is not a number";
+		return true;
+	}
+	if (preamble.cost) {
+		value = -value;
+	}
+
+	for (unsigned int a = aFirst; a < aLast; a++) {
+		for (unsigned int s = sFirst; s < sLast; s++) {
+			result.push_back(std::make_pair((unsigned long long)s * preamble.m + a, (float)value));
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Parse all of the entries of a chunk, recording the position and reason of the first error.
+ * @param	chunk		The chunk. This will be modified.
+ * @param	preamble	The preamble.
+ */
+static void parse_chunk(LPOMDPCassandraChunk &chunk, const LPOMDPCassandraPreamble &preamble)
+{
+	const char *p = chunk.begin;
+	LPOMDPCassandraToken token;
+
+	chunk.numEntries = 0;
+	chunk.error = nullptr;
+
+	while (true) {
+		if (next_token(p, chunk.end, token)) {
+			break;
+		}
+		const char *start = token.begin;
+
+		bool failed = false;
+		if (token.is("T")) {
+			failed = parse_probabilities(p, chunk.end, preamble, preamble.stateNames, preamble.n,
+					preamble.stateNames, true, chunk.T, chunk.reason);
+		} else if (token.is("O")) {
+			failed = parse_probabilities(p, chunk.end, preamble, preamble.stateNames, preamble.z,
+					preamble.observationNames, false, chunk.O, chunk.reason);
+		} else if (token.is("R")) {
+			failed = parse_reward(p, chunk.end, preamble, chunk.R, chunk.reason);
+		} else {
+			chunk.reason = "expected a T, O or R entry";
+			failed = true;
+		}
+
+		if (failed) {
+			chunk.error = start;
+			return;
+		}
+
+		chunk.numEntries++;
+	}
+}
+
+/**
+ * Check if a line starts an entry, i.e., its first token is a 'T', 'O' or 'R' followed by a ':'.
+ * @param	p		The start of the line.
+ * @param	end		The end of the text.
+ * @return	Returns true if the line starts an entry, and false otherwise.
+ */
+static bool is_entry_line(const char *p, const char *end)
+{
+	while (p != end && (*p == ' ' || *p == '\t')) {
+		p++;
+	}
+	if (p == end || (*p != 'T' && *p != 'O' && *p != 'R')) {
+		return false;
+	}
+	for (p++; p != end && (*p == ' ' || *p == '\t'); p++) { }
+	return (p != end && *p == ':');
+}
+
+/**
+ * Find the start of the next line which starts an entry, at or after a position.
+ * @param	begin	The start of the text.
+ * @param	p		The position.
+ * @param	end		The end of the text.
+ * @return	The start of the line, or the end of the text if there is none.
+ */
+static const char *next_entry_line(const char *begin, const char *p, const char *end)
+{
+	// Move to the start of a line.
+	while (p != begin && p != end && *(p - 1) != '\n') {
+		p++;
+	}
+
+	while (p != end && !is_entry_line(p, end)) {
+		while (p != end && *p != '\n') {
+			p++;
+		}
+		if (p != end) {
+			p++;
+		}
+	}
+
+	return p;
+}
+
+/**
+ * Parse the preamble, i.e., the text before the first entry.
+ * @param	begin		The start of the text.
+ * @param	end			The end of the preamble.
+ * @param	preamble	The preamble. This will be modified.
+ * @param	start		The start distribution. This will be modified.
+ * @param	reason		The reason it failed. This will be modified.
+ * @return	Returns true if an error arose, and false otherwise.
+ */
+static bool parse_preamble(const char *begin, const char *end, LPOMDPCassandraPreamble &preamble,
+		std::vector<double> &start, std::string &reason)
+{
+	// The preamble is small, so its tokens are simply collected. A key is a token followed by a ':'
+	// (or "start include" / "start exclude" followed by a ':'), and its values are the tokens up to the next key.
+	std::vector<std::string> tokens;
+	LPOMDPCassandraToken token;
+	for (const char *p = begin; !next_token(p, end, token); ) {
+		tokens.push_back(std::string(token.begin, token.end));
+	}
+
+	std::vector<std::pair<std::string, std::vector<std::string> > > keys;
+	for (size_t i = 0; i < tokens.size(); i++) {
+		if (i + 1 < tokens.size() && tokens[i + 1] == ":") {
+			keys.push_back(std::make_pair(tokens[i], std::vector<std::string>()));
+			i++;
+		} else if (i + 2 < tokens.size() && tokens[i] == "start" && tokens[i + 2] == ":") {
+			keys.push_back(std::make_pair("start " + tokens[i + 1], std::vector<std::string>()));
+			i += 2;
+		} else if (keys.empty()) {
+			reason = "the preamble must start with a key";
+			return true;
+		} else {
+			keys.back().second.push_back(tokens[i]);
+		}
+	}
+
+	auto parse_count = [&](const std::vector<std::string> &values, unsigned int &count,
+			std::unordered_map<std::string, unsigned int> &names) {
+		names.clear();
+		if (values.size() == 1 && values[0].find_first_not_of("0123456789") == std::string::npos) {
+			count = (unsigned int)std::stoul(values[0]);
+		} else {
+			count = (unsigned int)values.size();
+			for (unsigned int i = 0; i < count; i++) {
+				names[values[i]] = i;
+			}
+		}
+		return (count == 0);
+	};
+
+	preamble.discount = 1.0;
+	preamble.cost = false;
+	preamble.n = preamble.m = preamble.z = 0;
+
+	std::vector<std::pair<std::string, std::vector<std::string> > *> startKeys;
+
+	for (auto &key : keys) {
+		if (key.first == "discount") {
+			LPOMDPCassandraToken value;
+			if (key.second.size() != 1) {
+				reason = "the discount is invalid";
+				return true;
+			}
+			value.begin = key.second[0].data();
+			value.end = value.begin + key.second[0].size();
+			if (parse_number(value, preamble.discount)) {
+				reason = "the discount is invalid";
+				return true;
+			}
+		} else if (key.first == "values") {
+			if (key.second.size() != 1 || (key.second[0] != "reward" && key.second[0] != "cost")) {
+				reason = "the values must be either reward or cost";
+				return true;
+			}
+			preamble.cost = (key.second[0] == "cost");
+		} else if (key.first == "states") {
+			if (parse_count(key.second, preamble.n, preamble.stateNames)) {
+				reason = "the states are invalid";
+				return true;
+			}
+		} else if (key.first == "actions") {
+			if (parse_count(key.second, preamble.m, preamble.actionNames)) {
+				reason = "the actions are invalid";
+				return true;
+			}
+		} else if (key.first == "observations") {
+			if (parse_count(key.second, preamble.z, preamble.observationNames)) {
+				reason = "the observations are invalid";
+				return true;
+			}
+		} else if (key.first == "start" || key.first == "start include" || key.first == "start exclude") {
+			startKeys.push_back(&key);
+		} else {
+			reason = "the key '" + key.first + "' is not supported";
+			return true;
+		}
+	}
+
+	if (preamble.n == 0 || preamble.m == 0 || preamble.z == 0) {
+		reason = "the states, actions and observations must be given";
+		return true;
+	}
+
+	// The start distribution is uniform unless given.
+	start.assign(preamble.n, 1.0 / preamble.n);
+
+	for (auto key : startKeys) {
+		std::vector<unsigned int> indexes;
+		std::vector<double> probabilities;
+
+		for (std::string &value : key->second) {
+			LPOMDPCassandraToken valueToken;
+			valueToken.begin = value.data();
+			valueToken.end = value.data() + value.size();
+
+			unsigned int first = 0, last = 0;
+			double probability = 0.0;
+			if (key->first == "start" && key->second.size() == preamble.n && !parse_number(valueToken, probability)) {
+				probabilities.push_back(probability);
+			} else if (key->first == "start" && value == "uniform") {
+				probabilities.assign(preamble.n, 1.0 / preamble.n);
+			} else if (!parse_index(valueToken, preamble.n, preamble.stateNames, first, last) && first + 1 == last) {
+				indexes.push_back(first);
+			} else {
+				reason = "the start distribution is invalid";
+				return true;
+			}
+		}
+
+		if (key->first == "start" && probabilities.size() == preamble.n) {
+			start = probabilities;
+			continue;
+		} else if (key->first == "start" && indexes.size() != 1) {
+			reason = "the start distribution is invalid";
+			return true;
+		}
+
+		// The include (or single state) and exclude forms are uniform over the states they refer to.
+		std::vector<bool> included(preamble.n, (key->first == "start exclude"));
+		for (unsigned int s : indexes) {
+			included[s] = (key->first != "start exclude");
+		}
+
+		unsigned int count = (unsigned int)std::count(included.begin(), included.end(), true);
+		if (count == 0) {
+			reason = "the start distribution is empty";
+			return true;
+		}
+		for (unsigned int s = 0; s < preamble.n; s++) {
+			start[s] = (included[s] ? 1.0 / count : 0.0);
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Execute work over [0, size) in parallel on a number of threads, each with a contiguous range.
+ * @param	size			The size of the range.
+ * @param	numThreads		The number of threads.
+ * @param	work			The work, given the [first, last) range of a thread.
+ */
+static void execute_in_parallel(unsigned int size, unsigned int numThreads,
+		const std::function<void (unsigned int first, unsigned int last)> &work)
+{
+	unsigned int workers = std::max(1u, std::min(numThreads, size));
+
+	// The single worker case simply runs on the calling thread.
+	if (workers == 1) {
+		work(0, size);
+		return;
+	}
+
+	std::vector<std::thread> workerThreads;
+	for (unsigned int w = 0; w < workers; w++) {
+		unsigned int first = (unsigned int)((unsigned long)w * size / workers);
+		unsigned int last = (unsigned int)((unsigned long)(w + 1) * size / workers);
+		workerThreads.push_back(std::thread(work, first, last));
+	}
+
+	for (std::thread &thread : workerThreads) {
+		thread.join();
+	}
+}
+
+LPOMDPCassandra::LPOMDPCassandra(std::string filename, unsigned int numThreads)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	if (numThreads == 0) {
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	int file = open(filename.c_str(), O_RDONLY);
+	if (file < 0) {
+		std::cerr << "Failed to open the POMDP file '" << filename << "'." << std::endl;
+		throw CoreException();
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size == 0) {
+		std::cerr << "Failed to read the POMDP file '" << filename << "'." << std::endl;
+		close(file);
+		throw CoreException();
+	}
+	parsedBytes = (size_t)status.st_size;
+
+	void *memory = mmap(nullptr, parsedBytes, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (memory == MAP_FAILED) {
+		std::cerr << "Failed to map the POMDP file '" << filename << "'." << std::endl;
+		throw CoreException();
+	}
+	madvise(memory, parsedBytes, MADV_SEQUENTIAL);
+
+	const char *begin = (const char *)memory;
+	const char *end = begin + parsedBytes;
+
+	auto fail = [&](const char *position, std::string reason) {
+		std::cerr << "Failed to load the POMDP file '" << filename << "'";
+		if (position != nullptr) {
+			std::cerr << " at line " << (std::count(begin, position, '\n') + 1);
+		}
+		std::cerr << ": " << reason << "." << std::endl;
+		munmap(memory, parsedBytes);
+		throw CoreException();
+	};
+
+	// The preamble is parsed first, since the entries depend on its sizes and names.
+	LPOMDPCassandraPreamble preamble;
+	std::string reason;
+	const char *body = next_entry_line(begin, begin, end);
+	if (parse_preamble(begin, body, preamble, start, reason)) {
+		fail(nullptr, reason);
+	}
+
+	unsigned long long n = preamble.n;
+	unsigned long long m = preamble.m;
+	unsigned long long z = preamble.z;
+
+	// Split the entries into chunks, each starting at an entry, so that the values following an entry
+	// are never separated from it. Each chunk is then tokenized and parsed independently.
+	unsigned int numChunks = numThreads * LPOMDP_CASSANDRA_CHUNKS_PER_THREAD;
+	std::vector<LPOMDPCassandraChunk> chunks(numChunks);
+	const char *previous = body;
+	for (unsigned int i = 0; i < numChunks; i++) {
+		chunks[i].begin = previous;
+		if (i + 1 < numChunks) {
+			previous = std::max(previous, next_entry_line(begin, body + (size_t)(end - body) * (i + 1) / numChunks, end));
+		} else {
+			previous = end;
+		}
+		chunks[i].end = previous;
+	}
+
+	execute_in_parallel(numChunks, numThreads, [&](unsigned int first, unsigned int last) {
+		for (unsigned int i = first; i < last; i++) {
+			parse_chunk(chunks[i], preamble);
+		}
+	});
+
+	unsigned long long numEntries = 0;
+	for (LPOMDPCassandraChunk &chunk : chunks) {
+		if (chunk.error != nullptr) {
+			fail(chunk.error, chunk.reason);
+		}
+		numEntries += chunk.numEntries;
+	}
+
+	munmap(memory, parsedBytes);
+
+	// Apply the observations and rewards in file order, so that later entries override earlier ones.
+	observationProbabilities.assign(m * n * z, 0.0f);
+	rewardValues.assign(n * m, 0.0f);
+	for (LPOMDPCassandraChunk &chunk : chunks) {
+		for (auto &entry : chunk.O) {
+			observationProbabilities[entry.first] = entry.second;
+		}
+		for (auto &entry : chunk.R) {
+			rewardValues[entry.first] = entry.second;
+		}
+		chunk.O.clear();
+		chunk.O.shrink_to_fit();
+		chunk.R.clear();
+		chunk.R.shrink_to_fit();
+	}
+
+	// The state transitions are sorted by (s, a, sp) while keeping file order among equal ones; the last
+	// of those wins. Only the non-zero ones are kept in the rows.
+	std::vector<std::pair<unsigned long long, float> > entries;
+	for (LPOMDPCassandraChunk &chunk : chunks) {
+		entries.insert(entries.end(), chunk.T.begin(), chunk.T.end());
+		chunk.T.clear();
+		chunk.T.shrink_to_fit();
+	}
+	std::stable_sort(entries.begin(), entries.end(), [](const std::pair<unsigned long long, float> &a,
+			const std::pair<unsigned long long, float> &b) {
+		return a.first < b.first;
+	});
+
+	std::vector<unsigned long long> rowOffsets(n * m + 1, 0);
+	std::vector<LPOMDPMappedTransition> transitions;
+	for (size_t i = 0; i < entries.size(); i++) {
+		if ((i + 1 < entries.size() && entries[i + 1].first == entries[i].first) || entries[i].second == 0.0f) {
+			continue;
+		}
+
+		LPOMDPMappedTransition transition;
+		transition.successor = (unsigned int)(entries[i].first % n);
+		transition.probability = entries[i].second;
+		transitions.push_back(transition);
+
+		rowOffsets[entries[i].first / n + 1]++;
+	}
+	for (size_t row = 0; row < n * m; row++) {
+		rowOffsets[row + 1] += rowOffsets[row];
+	}
+
+	// Create the model over the arrays, which are not modified from here on.
+	{
+		std::lock_guard<std::mutex> lock(indexerMutex);
+
+		states = new StatesMap();
+		StatesMap *S = dynamic_cast<StatesMap *>(states);
+		for (unsigned int i = 0; i < n; i++) {
+			orderedStates.push_back(new LPOMDPMappedState(i));
+			S->add(orderedStates.back());
+		}
+
+		actions = new ActionsMap();
+		ActionsMap *A = dynamic_cast<ActionsMap *>(actions);
+		for (unsigned int i = 0; i < m; i++) {
+			A->add(new LPOMDPMappedAction(i));
+		}
+
+		observations = new ObservationsMap();
+		ObservationsMap *Z = dynamic_cast<ObservationsMap *>(observations);
+		for (unsigned int i = 0; i < z; i++) {
+			Z->add(new LPOMDPMappedObservation(i));
+		}
+	}
+
+	unsigned long long numTransitions = transitions.size();
+	stateTransitions = new LPOMDPSparseStateTransitions(orderedStates, m, rowOffsets, transitions);
+	observationTransitions = new LPOMDPMappedObservationTransitions(n, z, observationProbabilities.data());
+
+	auto bounds = std::minmax_element(rewardValues.begin(), rewardValues.end());
+	rewards = new FactoredWeightedRewards();
+	FactoredWeightedRewards *R = dynamic_cast<FactoredWeightedRewards *>(rewards);
+	R->add_factor(new LPOMDPMappedRewards(m, rewardValues.data(), *bounds.first, *bounds.second));
+
+	horizon = new Horizon(preamble.discount);
+
+	delta.push_back(0.0f);
+
+	parseTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	std::cout << "Loaded the POMDP file '" << filename << "': " << n << " states, " << m << " actions, " << z <<
+			" observations, " << numTransitions << " transitions." << std::endl;
+	std::cout << "Parsed " << numEntries << " entries (" << (parsedBytes / 1048576.0) << " MB) in " << parseTime <<
+			" seconds with " << numThreads << " threads: " << (parsedBytes / 1048576.0 / std::max(parseTime, 1e-9)) <<
+			" MB/s." << std::endl; std::cout.flush();
+}
+
+LPOMDPCassandra::~LPOMDPCassandra()
+{ }
+
+const std::vector<double> &LPOMDPCassandra::get_start() const
+{
+	return start;
+}
+
+size_t LPOMDPCassandra::get_parsed_bytes() const
+{
+	return parsedBytes;
+}
+
+double LPOMDPCassandra::get_parse_time() const
+{
+	return parseTime;
+}
+
+bool LPOMDPCassandra::save(LPOMDP *lpomdp, const BeliefState *start, std::string filename, unsigned int factor)
+{
+	StatesMap *S = dynamic_cast<StatesMap *>(lpomdp->get_states());
+	ActionsMap *A = dynamic_cast<ActionsMap *>(lpomdp->get_actions());
+	ObservationsMap *Z = dynamic_cast<ObservationsMap *>(lpomdp->get_observations());
+	StateTransitions *T = lpomdp->get_state_transitions();
+	ObservationTransitions *O = lpomdp->get_observation_transitions();
+	FactoredRewards *R = lpomdp->get_rewards();
+	Horizon *h = lpomdp->get_horizon();
+
+	if (S == nullptr || A == nullptr || Z == nullptr || T == nullptr || O == nullptr || R == nullptr || h == nullptr) {
+		std::cerr << "Failed to save the POMDP file: it must have indexed states, actions and observations." << std::endl;
+		return true;
+	}
+
+	unsigned int n = S->get_num_states();
+	unsigned int m = A->get_num_actions();
+	unsigned int z = Z->get_num_observations();
+
+	SARewards *Ri = nullptr;
+	if (factor < R->get_num_rewards()) {
+		Ri = dynamic_cast<SARewards *>(R->get(factor));
+	}
+	if (Ri == nullptr) {
+		std::cerr << "Failed to save the POMDP file: the reward factor must be a state-action reward." << std::endl;
+		return true;
+	}
+
+	// The states, actions and observations by their index, which is their hash value.
+	std::vector<State *> states(n);
+	std::vector<Action *> actions(m);
+	std::vector<Observation *> observations(z);
+
+	try {
+		for (unsigned int i = 0; i < n; i++) {
+			states[i] = S->get(i);
+		}
+		for (unsigned int i = 0; i < m; i++) {
+			actions[i] = A->get(i);
+		}
+		for (unsigned int i = 0; i < z; i++) {
+			observations[i] = Z->get(i);
+		}
+	} catch (const std::out_of_range &err) {
+		std::cerr << "Failed to save the POMDP file: the states, actions and observations must be indexed from 0." << std::endl;
+		return true;
+	}
+
+	// As with compiled models, write to a temporary file then rename it, so no reader sees a partial file.
+	std::string temporaryFilename = filename + ".tmp";
+
+	LPOMDPCassandraWriter writer(temporaryFilename);
+	if (!writer.file.is_open()) {
+		std::cerr << "Failed to open the POMDP file '" << temporaryFilename << "'." << std::endl;
+		return true;
+	}
+
+	writer << "discount: " << h->get_discount_factor() << "\n";
+	writer << "values: reward\n";
+	writer << "states: " << n << "\n";
+	writer << "actions: " << m << "\n";
+	writer << "observations: " << z << "\n";
+
+	// A start distribution which is uniform over some states is written as the states it includes.
+	if (start != nullptr) {
+		std::vector<double> probabilities(n);
+		std::vector<unsigned int> included;
+		for (unsigned int s = 0; s < n; s++) {
+			probabilities[s] = start->get(states[s]);
+			if (probabilities[s] > 0.0) {
+				included.push_back(s);
+			}
+		}
+
+		bool uniform = !included.empty();
+		for (unsigned int s : included) {
+			uniform = uniform && (probabilities[s] == probabilities[included[0]]);
+		}
+
+		if (uniform) {
+			writer << "start include:\n";
+			for (unsigned int s : included) {
+				writer << s << " ";
+			}
+		} else {
+			writer << "start:\n";
+			for (unsigned int s = 0; s < n; s++) {
+				writer << probabilities[s] << " ";
+			}
+		}
+		writer << "\n";
+	}
+	writer << "\n";
+
+	unsigned long long numEntries = 0;
+
+	// Write a row of a state for either all actions ("*") or one of them.
+	auto write_action = [&](const char *entry, unsigned int a, bool all) -> LPOMDPCassandraWriter & {
+		writer << entry << ": ";
+		if (all) {
+			writer << "*";
+		} else {
+			writer << a;
+		}
+		numEntries++;
+		return writer;
+	};
+
+	// The state transitions, as rows of sorted (successor, probability) pairs.
+	std::vector<std::vector<std::pair<unsigned int, float> > > rowsT(m);
+	std::vector<std::vector<std::pair<unsigned int, float> > > overridesT(m);
+	std::vector<State *> successors;
+
+	for (unsigned int s = 0; s < n; s++) {
+		for (unsigned int a = 0; a < m; a++) {
+			rowsT[a].clear();
+			successors.clear();
+			T->successors(S, states[s], actions[a], successors);
+			for (State *sp : successors) {
+				float p = (float)T->get(states[s], actions[a], sp);
+				if (p != 0.0f) {
+					rowsT[a].push_back(std::make_pair((unsigned int)sp->hash_value(), p));
+				}
+			}
+			std::sort(rowsT[a].begin(), rowsT[a].end());
+		}
+
+		unsigned int count = 0;
+		unsigned int common = find_common_row(rowsT, count);
+
+		// The most common row is written once for all actions ("*") only if no action would need a zero to
+		// remove one of its successors, and if it and the other actions' differing entries are strictly fewer
+		// than all of the rows' entries. Otherwise, each action's entries are written on their own.
+		bool shared = true;
+		size_t sharedEntries = rowsT[common].size();
+		size_t sparseEntries = 0;
+
+		for (unsigned int a = 0; a < m && shared; a++) {
+			sparseEntries += rowsT[a].size();
+
+			overridesT[a].clear();
+			std::set_difference(rowsT[a].begin(), rowsT[a].end(), rowsT[common].begin(), rowsT[common].end(),
+					std::back_inserter(overridesT[a]));
+			sharedEntries += overridesT[a].size();
+
+			for (auto &entry : rowsT[common]) {
+				auto match = std::lower_bound(rowsT[a].begin(), rowsT[a].end(), std::make_pair(entry.first, -1.0f));
+				if (match == rowsT[a].end() || match->first != entry.first) {
+					shared = false;
+					break;
+				}
+			}
+		}
+		shared = shared && (sharedEntries < sparseEntries);
+
+		if (shared) {
+			for (auto &entry : rowsT[common]) {
+				write_action("T", 0, true) << " : " << s << " : " << entry.first << " " << entry.second << "\n";
+			}
+		}
+
+		for (unsigned int a = 0; a < m; a++) {
+			for (auto &entry : (shared ? overridesT[a] : rowsT[a])) {
+				write_action("T", a, false) << " : " << s << " : " << entry.first << " " << entry.second << "\n";
+			}
+		}
+	}
+	writer << "\n";
+
+	// The observations, as full rows (which replace any earlier row), skipping the rows which are all zero. As
+	// above, a shared row is only used if no action's row which differs from it is all zero, and if it and
+	// the differing rows are strictly fewer than the rows which are not all zero.
+	std::vector<std::vector<float> > rowsO(m, std::vector<float>(z));
+
+	for (unsigned int sp = 0; sp < n; sp++) {
+		for (unsigned int a = 0; a < m; a++) {
+			for (unsigned int o = 0; o < z; o++) {
+				rowsO[a][o] = (float)O->get(actions[a], states[sp], observations[o]);
+			}
+		}
+
+		unsigned int count = 0;
+		unsigned int common = find_common_row(rowsO, count);
+
+		bool shared = true;
+		unsigned int sharedRows = 1;
+		unsigned int sparseRows = 0;
+
+		for (unsigned int a = 0; a < m; a++) {
+			bool zero = (std::count(rowsO[a].begin(), rowsO[a].end(), 0.0f) == z);
+			if (!zero) {
+				sparseRows++;
+			}
+			if (rowsO[a] != rowsO[common]) {
+				sharedRows++;
+				shared = shared && !zero;
+			}
+		}
+		shared = shared && (sharedRows < sparseRows);
+
+		if (shared) {
+			write_action("O", 0, true) << " : " << sp << "\n";
+			for (float p : rowsO[common]) {
+				writer << p << " ";
+			}
+			writer << "\n";
+		}
+
+		for (unsigned int a = 0; a < m; a++) {
+			if ((shared && rowsO[a] == rowsO[common]) || (!shared && std::count(rowsO[a].begin(), rowsO[a].end(), 0.0f) == z)) {
+				continue;
+			}
+			write_action("O", a, false) << " : " << sp << "\n";
+			for (float p : rowsO[a]) {
+				writer << p << " ";
+			}
+			writer << "\n";
+		}
+	}
+	writer << "\n";
+
+	// The rewards, in the same way, skipping the zeros.
+	std::vector<float> rowR(m);
+
+	for (unsigned int s = 0; s < n; s++) {
+		for (unsigned int a = 0; a < m; a++) {
+			rowR[a] = (float)Ri->get(states[s], actions[a]);
+		}
+
+		unsigned int count = 0;
+		unsigned int common = find_common_row(rowR, count);
+
+		bool shared = true;
+		unsigned int sharedEntries = 1;
+		unsigned int sparseEntries = 0;
+
+		for (unsigned int a = 0; a < m; a++) {
+			if (rowR[a] != 0.0f) {
+				sparseEntries++;
+			}
+			if (rowR[a] != rowR[common]) {
+				sharedEntries++;
+				shared = shared && (rowR[a] != 0.0f);
+			}
+		}
+		shared = shared && (sharedEntries < sparseEntries);
+
+		if (shared) {
+			write_action("R", 0, true) << " : " << s << " : * : * " << rowR[common] << "\n";
+		}
+
+		for (unsigned int a = 0; a < m; a++) {
+			if ((shared && rowR[a] == rowR[common]) || (!shared && rowR[a] == 0.0f)) {
+				continue;
+			}
+			write_action("R", a, false) << " : " << s << " : * : * " << rowR[a] << "\n";
+		}
+	}
+
+	if (writer.close() || std::rename(temporaryFilename.c_str(), filename.c_str()) != 0) {
+		std::cerr << "Failed to write the POMDP file '" << filename << "'." << std::endl;
+		std::remove(temporaryFilename.c_str());
+		return true;
+	}
+
+	std::cout << "Saved the POMDP file '" << filename << "': " << writer.bytes << " bytes, " <<
+			numEntries << " entries." << std::endl; std::cout.flush();
+
+	return false;
+}
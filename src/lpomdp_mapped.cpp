@@ -0,0 +1,718 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../include/lpomdp_mapped.h"
+#include "../include/lpomdp_sparse_state_transitions.h"
+
+#include "../../librbr/librbr/include/core/states/states_map.h"
+#include "../../librbr/librbr/include/core/actions/actions_map.h"
+#include "../../librbr/librbr/include/core/observations/observations_map.h"
+#include "../../librbr/librbr/include/core/rewards/factored_weighted_rewards.h"
+#include "../../librbr/librbr/include/core/rewards/reward_exception.h"
+#include "../../librbr/librbr/include/core/state_transitions/state_transition_exception.h"
+#include "../../librbr/librbr/include/core/observation_transitions/observation_transition_exception.h"
+#include "../../librbr/librbr/include/core/core_exception.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+/**
+ * The magic bytes at the start and end of a compiled model file, which include the format's version.
+ */
+#define LPOMDP_MAPPED_MAGIC "LPOMDPM1"
+#define LPOMDP_MAPPED_MAGIC_SIZE 8
+
+/**
+ * The version of the compiled model format, and the value which detects a file of the other byte order.
+ */
+#define LPOMDP_MAPPED_VERSION 1
+#define LPOMDP_MAPPED_BYTE_ORDER 0x01020304
+
+/**
+ * The size of the buffer used to write a compiled model file.
+ */
+#define LPOMDP_MAPPED_BUFFER_SIZE (1 << 22)
+
+/**
+ * The header at the start of a compiled model file.
+ */
+struct LPOMDPMappedHeader {
+	char magic[LPOMDP_MAPPED_MAGIC_SIZE];
+	unsigned int version;
+	unsigned int byteOrder;
+	unsigned int n;
+	unsigned int m;
+	unsigned int z;
+	unsigned int k;
+	unsigned int numWeights;
+	unsigned int numSlack;
+	double discount;
+};
+
+/**
+ * The trailer at the end of a compiled model file, with the offset of each section.
+ */
+struct LPOMDPMappedTrailer {
+	unsigned long long weights;
+	unsigned long long slack;
+	unsigned long long states;
+	unsigned long long successors;
+	unsigned long long goals;
+	unsigned long long groupOffsets;
+	unsigned long long groupMembers;
+	unsigned long long entries;
+	unsigned long long rowOffsets;
+	unsigned long long observations;
+	unsigned long long rewards;
+	unsigned long long rewardBounds;
+	unsigned long long numEntries;
+	unsigned int numGoals;
+	unsigned int numGroups;
+	unsigned int numGroupMembers;
+	unsigned int padding;
+	char magic[LPOMDP_MAPPED_MAGIC_SIZE];
+};
+
+/**
+ * A streaming writer of a compiled model file, which keeps track of the offset of the next byte.
+ */
+class LPOMDPMappedWriter {
+public:
+	/**
+	 * The constructor of the LPOMDPMappedWriter object, which opens the file with a large buffer.
+	 * @param	filename	The name of the file.
+	 */
+	LPOMDPMappedWriter(std::string filename) : buffer(LPOMDP_MAPPED_BUFFER_SIZE), position(0) {
+		file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+		file.open(filename, std::ios::binary | std::ios::trunc);
+	}
+
+	/**
+	 * Write raw bytes.
+	 * @param	data	The bytes.
+	 * @param	bytes	The number of bytes.
+	 */
+	void write(const void *data, size_t bytes) {
+		file.write((const char *)data, bytes);
+		position += bytes;
+	}
+
+	/**
+	 * Write an array, after padding to its alignment.
+	 * @param	values	The array.
+	 * @return	The offset of the array.
+	 */
+	template <typename T>
+	unsigned long long write_array(const std::vector<T> &values) {
+		align();
+		unsigned long long offset = position;
+		write(values.data(), values.size() * sizeof(T));
+		return offset;
+	}
+
+	/**
+	 * Pad with zeros to a multiple of 8 bytes.
+	 */
+	void align() {
+		static const char zeros[8] = { 0 };
+		write(zeros, (8 - position % 8) % 8);
+	}
+
+	/**
+	 * The output file.
+	 */
+	std::ofstream file;
+
+	/**
+	 * The buffer of the output file.
+	 */
+	std::vector<char> buffer;
+
+	/**
+	 * The offset of the next byte.
+	 */
+	unsigned long long position;
+};
+
+LPOMDPMappedState::LPOMDPMappedState(unsigned int stateIndex)
+{
+	index = stateIndex;
+}
+
+LPOMDPMappedAction::LPOMDPMappedAction(unsigned int actionIndex)
+{
+	index = actionIndex;
+}
+
+LPOMDPMappedObservation::LPOMDPMappedObservation(unsigned int observationIndex)
+{
+	index = observationIndex;
+}
+
+LPOMDPMappedObservationTransitions::LPOMDPMappedObservationTransitions(unsigned int n, unsigned int z, const float *O) :
+		n(n), z(z), O(O)
+{ }
+
+LPOMDPMappedObservationTransitions::~LPOMDPMappedObservationTransitions()
+{ }
+
+void LPOMDPMappedObservationTransitions::set(const Action *a, const State *sp, const Observation *z, double p)
+{
+	throw ObservationTransitionException();
+}
+
+double LPOMDPMappedObservationTransitions::get(const Action *a, const State *sp, const Observation *observation) const
+{
+	return O[((size_t)a->hash_value() * n + sp->hash_value()) * z + observation->hash_value()];
+}
+
+const float *LPOMDPMappedObservationTransitions::get_observation_transitions() const
+{
+	return O;
+}
+
+LPOMDPMappedRewards::LPOMDPMappedRewards(unsigned int m, const float *R, double minReward, double maxReward) :
+		m(m), R(R), minReward(minReward), maxReward(maxReward)
+{ }
+
+LPOMDPMappedRewards::~LPOMDPMappedRewards()
+{ }
+
+void LPOMDPMappedRewards::set(const State *s, const Action *a, double r)
+{
+	throw RewardException();
+}
+
+double LPOMDPMappedRewards::get(const State *s, const Action *a) const
+{
+	return R[(size_t)s->hash_value() * m + a->hash_value()];
+}
+
+double LPOMDPMappedRewards::get_min() const
+{
+	return minReward;
+}
+
+double LPOMDPMappedRewards::get_max() const
+{
+	return maxReward;
+}
+
+const float *LPOMDPMappedRewards::get_rewards() const
+{
+	return R;
+}
+
+LPOMDPMapped::LPOMDPMapped(std::string filename)
+{
+	memory = nullptr;
+	size = 0;
+	m = 0;
+	stateInfo = nullptr;
+	successorStates = nullptr;
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		std::cerr << "Failed to open the compiled model file '" << filename << "'." << std::endl;
+		throw CoreException();
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(LPOMDPMappedHeader) + sizeof(LPOMDPMappedTrailer)) {
+		close(fd);
+		std::cerr << "Failed to load the compiled model file '" << filename << "': it is too small." << std::endl;
+		throw CoreException();
+	}
+
+	// Note: The map is shared and read-only, so every process which maps the same file uses the same pages.
+	size = (size_t)status.st_size;
+	memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (memory == MAP_FAILED) {
+		memory = nullptr;
+		std::cerr << "Failed to map the compiled model file '" << filename << "'." << std::endl;
+		throw CoreException();
+	}
+
+	const char *base = (const char *)memory;
+	const LPOMDPMappedHeader *header = (const LPOMDPMappedHeader *)base;
+	const LPOMDPMappedTrailer *trailer = (const LPOMDPMappedTrailer *)(base + size - sizeof(LPOMDPMappedTrailer));
+
+	auto fail = [&](std::string reason) {
+		std::cerr << "Failed to load the compiled model file '" << filename << "': " << reason << "." << std::endl;
+		munmap(memory, size);
+		memory = nullptr;
+		throw CoreException();
+	};
+
+	if (memcmp(header->magic, LPOMDP_MAPPED_MAGIC, LPOMDP_MAPPED_MAGIC_SIZE) != 0 ||
+			memcmp(trailer->magic, LPOMDP_MAPPED_MAGIC, LPOMDP_MAPPED_MAGIC_SIZE) != 0) {
+		fail("it is not a compiled model, or it is truncated");
+	}
+	if (header->version != LPOMDP_MAPPED_VERSION) {
+		fail("its version is not supported");
+	}
+	if (header->byteOrder != LPOMDP_MAPPED_BYTE_ORDER) {
+		fail("it was written with the other byte order");
+	}
+
+	size_t n = header->n;
+	size_t z = header->z;
+	size_t k = header->k;
+	m = header->m;
+
+	// Every section must be aligned and lie before the trailer.
+	size_t end = size - sizeof(LPOMDPMappedTrailer);
+	auto section = [&](unsigned long long offset, size_t bytes) {
+		if (offset % 8 != 0 || offset > end || bytes > end - offset) {
+			fail("a section is out of bounds");
+		}
+		return (const void *)(base + offset);
+	};
+
+	const double *weights = (const double *)section(trailer->weights, header->numWeights * sizeof(double));
+	const float *slack = (const float *)section(trailer->slack, header->numSlack * sizeof(float));
+	stateInfo = (const LPOMDPMappedStateInfo *)section(trailer->states, n * sizeof(LPOMDPMappedStateInfo));
+	successorStates = (const unsigned int *)section(trailer->successors, n * m * sizeof(unsigned int));
+	const unsigned int *goals = (const unsigned int *)section(trailer->goals, trailer->numGoals * sizeof(unsigned int));
+	const unsigned int *groupOffsets = (const unsigned int *)section(trailer->groupOffsets,
+			(trailer->numGroups + 1) * sizeof(unsigned int));
+	const unsigned int *groupMembers = (const unsigned int *)section(trailer->groupMembers,
+			trailer->numGroupMembers * sizeof(unsigned int));
+	const LPOMDPMappedTransition *entries = (const LPOMDPMappedTransition *)section(trailer->entries,
+			trailer->numEntries * sizeof(LPOMDPMappedTransition));
+	const unsigned long long *rowOffsets = (const unsigned long long *)section(trailer->rowOffsets,
+			(n * m + 1) * sizeof(unsigned long long));
+	const float *observationProbabilities = (const float *)section(trailer->observations, m * n * z * sizeof(float));
+	const float *rewardValues = (const float *)section(trailer->rewards, k * n * m * sizeof(float));
+	const double *rewardBounds = (const double *)section(trailer->rewardBounds, k * 2 * sizeof(double));
+
+	if (rowOffsets[0] != 0 || rowOffsets[n * m] != trailer->numEntries || groupOffsets[0] != 0 ||
+			groupOffsets[trailer->numGroups] != trailer->numGroupMembers) {
+		fail("its rows are inconsistent");
+	}
+
+	// Every index is checked once here, so that none is checked again when the model is used in place.
+	for (size_t i = 0; i < n * m; i++) {
+		if (rowOffsets[i] > rowOffsets[i + 1]) {
+			fail("its rows are inconsistent");
+		}
+		if (successorStates[i] >= n) {
+			fail("a successor is not a state");
+		}
+	}
+	for (unsigned long long i = 0; i < trailer->numEntries; i++) {
+		if (entries[i].successor >= n) {
+			fail("a transition is not to a state");
+		}
+	}
+	for (unsigned int i = 0; i < trailer->numGroups; i++) {
+		if (groupOffsets[i] > groupOffsets[i + 1]) {
+			fail("its rows are inconsistent");
+		}
+	}
+	for (unsigned int i = 0; i < trailer->numGoals; i++) {
+		if (goals[i] >= n) {
+			fail("a goal is not a state");
+		}
+	}
+	for (unsigned int i = 0; i < trailer->numGroupMembers; i++) {
+		if (groupMembers[i] >= n) {
+			fail("a tiredness state is not a state");
+		}
+	}
+
+	// Only the state, action and observation objects are created; everything else is used in place.
+	{
+		std::lock_guard<std::mutex> lock(indexerMutex);
+
+		states = new StatesMap();
+		StatesMap *S = dynamic_cast<StatesMap *>(states);
+		for (unsigned int i = 0; i < n; i++) {
+			orderedStates.push_back(new LPOMDPMappedState(i));
+			S->add(orderedStates.back());
+		}
+
+		actions = new ActionsMap();
+		ActionsMap *A = dynamic_cast<ActionsMap *>(actions);
+		for (unsigned int i = 0; i < m; i++) {
+			A->add(new LPOMDPMappedAction(i));
+		}
+
+		observations = new ObservationsMap();
+		ObservationsMap *Z = dynamic_cast<ObservationsMap *>(observations);
+		for (unsigned int i = 0; i < z; i++) {
+			Z->add(new LPOMDPMappedObservation(i));
+		}
+	}
+
+	stateTransitions = new LPOMDPSparseStateTransitions(orderedStates, m, rowOffsets, entries);
+	observationTransitions = new LPOMDPMappedObservationTransitions(n, z, observationProbabilities);
+
+	rewards = new FactoredWeightedRewards();
+	FactoredWeightedRewards *R = dynamic_cast<FactoredWeightedRewards *>(rewards);
+	for (unsigned int i = 0; i < k; i++) {
+		R->add_factor(new LPOMDPMappedRewards(m, rewardValues + i * n * m, rewardBounds[2 * i + 0], rewardBounds[2 * i + 1]));
+	}
+	if (header->numWeights > 0) {
+		R->set_weights(std::vector<double>(weights, weights + header->numWeights));
+	}
+
+	horizon = new Horizon(header->discount);
+
+	delta.assign(slack, slack + header->numSlack);
+
+	for (unsigned int i = 0; i < trailer->numGoals; i++) {
+		goalStates.push_back(orderedStates[goals[i]]);
+	}
+
+	for (unsigned int i = 0; i < trailer->numGroups; i++) {
+		tirednessStates.push_back(std::vector<State *>());
+		for (unsigned int j = groupOffsets[i]; j < groupOffsets[i + 1]; j++) {
+			tirednessStates.back().push_back(orderedStates[groupMembers[j]]);
+		}
+	}
+
+	std::cout << "Mapped the compiled model: " << n << " states, " << m << " actions, " << z << " observations, " <<
+			trailer->numEntries << " transitions." << std::endl; std::cout.flush();
+}
+
+LPOMDPMapped::~LPOMDPMapped()
+{
+	// Note: The transitions and rewards only refer to the mapped memory; they do not access it when freed.
+	if (memory != nullptr) {
+		munmap(memory, size);
+	}
+}
+
+bool LPOMDPMapped::save(LPOMDP *lpomdp, const LPOMDPMappedMetadata &metadata, std::string filename)
+{
+	StatesMap *S = dynamic_cast<StatesMap *>(lpomdp->get_states());
+	ActionsMap *A = dynamic_cast<ActionsMap *>(lpomdp->get_actions());
+	ObservationsMap *Z = dynamic_cast<ObservationsMap *>(lpomdp->get_observations());
+	StateTransitions *T = lpomdp->get_state_transitions();
+	ObservationTransitions *O = lpomdp->get_observation_transitions();
+	FactoredRewards *R = lpomdp->get_rewards();
+	Horizon *h = lpomdp->get_horizon();
+
+	if (S == nullptr || A == nullptr || Z == nullptr || T == nullptr || O == nullptr || h == nullptr) {
+		std::cerr << "Failed to compile the model: it must have indexed states, actions and observations." << std::endl;
+		return true;
+	}
+
+	unsigned int n = S->get_num_states();
+	unsigned int m = A->get_num_actions();
+	unsigned int z = Z->get_num_observations();
+	unsigned int k = R->get_num_rewards();
+
+	if (metadata.states.size() != n || metadata.successors.size() != (size_t)n * m) {
+		std::cerr << "Failed to compile the model: the metadata does not match the states and actions." << std::endl;
+		return true;
+	}
+
+	// The states, actions and observations by their index, which is their hash value.
+	std::vector<State *> states(n);
+	std::vector<Action *> actions(m);
+	std::vector<Observation *> observations(z);
+	std::vector<SARewards *> factors(k);
+
+	try {
+		for (unsigned int i = 0; i < n; i++) {
+			states[i] = S->get(i);
+		}
+		for (unsigned int i = 0; i < m; i++) {
+			actions[i] = A->get(i);
+		}
+		for (unsigned int i = 0; i < z; i++) {
+			observations[i] = Z->get(i);
+		}
+	} catch (const std::out_of_range &err) {
+		std::cerr << "Failed to compile the model: the states, actions and observations must be indexed from 0." << std::endl;
+		return true;
+	}
+
+	for (unsigned int i = 0; i < k; i++) {
+		factors[i] = dynamic_cast<SARewards *>(R->get(i));
+		if (factors[i] == nullptr) {
+			std::cerr << "Failed to compile the model: the rewards must be state-action rewards." << std::endl;
+			return true;
+		}
+	}
+
+	std::vector<double> weights;
+	FactoredWeightedRewards *Rweighted = dynamic_cast<FactoredWeightedRewards *>(R);
+	if (Rweighted != nullptr) {
+		weights = Rweighted->get_weights();
+	}
+
+	// The file is written to a temporary file then renamed, so that processes which still map the
+	// previous file keep it, and no process maps a partially written one.
+	std::string temporaryFilename = filename + ".tmp";
+
+	LPOMDPMappedWriter writer(temporaryFilename);
+	if (!writer.file.is_open()) {
+		std::cerr << "Failed to open the compiled model file '" << temporaryFilename << "'." << std::endl;
+		return true;
+	}
+
+	LPOMDPMappedHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, LPOMDP_MAPPED_MAGIC, LPOMDP_MAPPED_MAGIC_SIZE);
+	header.version = LPOMDP_MAPPED_VERSION;
+	header.byteOrder = LPOMDP_MAPPED_BYTE_ORDER;
+	header.n = n;
+	header.m = m;
+	header.z = z;
+	header.k = k;
+	header.numWeights = weights.size();
+	header.numSlack = lpomdp->get_slack().size();
+	header.discount = h->get_discount_factor();
+	writer.write(&header, sizeof(header));
+
+	LPOMDPMappedTrailer trailer;
+	memset(&trailer, 0, sizeof(trailer));
+
+	trailer.weights = writer.write_array(weights);
+	trailer.slack = writer.write_array(lpomdp->get_slack());
+	trailer.states = writer.write_array(metadata.states);
+	trailer.successors = writer.write_array(metadata.successors);
+	trailer.goals = writer.write_array(metadata.goals);
+
+	std::vector<unsigned int> groupOffsets(1, 0);
+	std::vector<unsigned int> groupMembers;
+	for (const std::vector<unsigned int> &group : metadata.tirednessStates) {
+		groupMembers.insert(groupMembers.end(), group.begin(), group.end());
+		groupOffsets.push_back(groupMembers.size());
+	}
+	trailer.groupOffsets = writer.write_array(groupOffsets);
+	trailer.groupMembers = writer.write_array(groupMembers);
+	trailer.numGoals = metadata.goals.size();
+	trailer.numGroups = metadata.tirednessStates.size();
+	trailer.numGroupMembers = groupMembers.size();
+
+	// The entries of each row are streamed as they are found; the row offsets follow them.
+	std::vector<unsigned long long> rowOffsets(1, 0);
+	rowOffsets.reserve((size_t)n * m + 1);
+
+	writer.align();
+	trailer.entries = writer.position;
+
+	std::vector<State *> successors;
+	for (unsigned int s = 0; s < n; s++) {
+		for (unsigned int a = 0; a < m; a++) {
+			successors.clear();
+			T->successors(S, states[s], actions[a], successors);
+
+			for (State *sp : successors) {
+				LPOMDPMappedTransition entry;
+				entry.successor = sp->hash_value();
+				entry.probability = (float)T->get(states[s], actions[a], sp);
+				if (entry.probability > 0.0f) {
+					writer.write(&entry, sizeof(entry));
+					trailer.numEntries++;
+				}
+			}
+
+			rowOffsets.push_back(trailer.numEntries);
+		}
+	}
+
+	trailer.rowOffsets = writer.write_array(rowOffsets);
+
+	std::vector<float> row;
+
+	writer.align();
+	trailer.observations = writer.position;
+	row.resize(z);
+	for (unsigned int a = 0; a < m; a++) {
+		for (unsigned int sp = 0; sp < n; sp++) {
+			for (unsigned int i = 0; i < z; i++) {
+				row[i] = (float)O->get(actions[a], states[sp], observations[i]);
+			}
+			writer.write(row.data(), z * sizeof(float));
+		}
+	}
+
+	writer.align();
+	trailer.rewards = writer.position;
+	row.resize(m);
+	std::vector<double> rewardBounds;
+	for (unsigned int i = 0; i < k; i++) {
+		for (unsigned int s = 0; s < n; s++) {
+			for (unsigned int a = 0; a < m; a++) {
+				row[a] = (float)factors[i]->get(states[s], actions[a]);
+			}
+			writer.write(row.data(), m * sizeof(float));
+		}
+		rewardBounds.push_back(factors[i]->get_min());
+		rewardBounds.push_back(factors[i]->get_max());
+	}
+
+	trailer.rewardBounds = writer.write_array(rewardBounds);
+
+	writer.align();
+	memcpy(trailer.magic, LPOMDP_MAPPED_MAGIC, LPOMDP_MAPPED_MAGIC_SIZE);
+	writer.write(&trailer, sizeof(trailer));
+
+	writer.file.close();
+	if (writer.file.fail() || std::rename(temporaryFilename.c_str(), filename.c_str()) != 0) {
+		std::cerr << "Failed to write the compiled model file '" << filename << "'." << std::endl;
+		std::remove(temporaryFilename.c_str());
+		return true;
+	}
+
+	std::cout << "Compiled the model to '" << filename << "': " << writer.position << " bytes, " <<
+			trailer.numEntries << " transitions." << std::endl; std::cout.flush();
+
+	return false;
+}
+
+const LPOMDPMappedStateInfo &LPOMDPMapped::get_state_info(unsigned int state) const
+{
+	return stateInfo[state];
+}
+
+unsigned int LPOMDPMapped::get_successor(unsigned int state, unsigned int action) const
+{
+	return successorStates[(size_t)state * m + action];
+}
+
+const std::vector<State *> &LPOMDPMapped::get_goal_states() const
+{
+	return goalStates;
+}
+
+const std::vector<std::vector<State *> > &LPOMDPMapped::get_tiredness_states() const
+{
+	return tirednessStates;
+}
+
+State *LPOMDPMapped::get_initial_state(std::string initial1, std::string initial2)
+{
+	unsigned long long initialNodeUID1 = 0;
+	unsigned long long initialNodeUID2 = 0;
+
+	try {
+		initialNodeUID1 = std::stoull(initial1);
+		initialNodeUID2 = std::stoull(initial2);
+	} catch (std::exception &err) {
+		throw CoreException();
+	}
+
+	for (unsigned int s = 0; s < orderedStates.size(); s++) {
+		if ((stateInfo[s].current == initialNodeUID1 && stateInfo[s].previous == initialNodeUID2) ||
+				(stateInfo[s].current == initialNodeUID2 && stateInfo[s].previous == initialNodeUID1)) {
+			return orderedStates[s];
+		}
+	}
+
+	throw CoreException();
+}
+
+bool LPOMDPMapped::save_policy(PolicyAlphaVectors **policy, unsigned int k, std::string filename)
+{
+	std::ofstream file(filename);
+	if (!file.is_open()) {
+		return true;
+	}
+
+	for (unsigned int s = 0; s < orderedStates.size(); s++) {
+		BeliefState b;
+		b.set(orderedStates[s], 1.0);
+
+		if (write_policy_row(file, policy, k, b, s)) {
+			return true;
+		}
+	}
+
+	file.close();
+
+	return false;
+}
+
+bool LPOMDPMapped::save_policy(PolicyAlphaVectors **policy, unsigned int k, double tirednessBelief, std::string filename)
+{
+	std::ofstream file(filename);
+	if (!file.is_open()) {
+		return true;
+	}
+
+	for (const std::vector<State *> &tirednessStateElements : tirednessStates) {
+		// As in LOSMPOMDP, write one row for each state of the pair, with the tired one having the
+		// probability "tirednessBelief" for the first and the opposite for the second.
+		bool firstTired = (stateInfo[tirednessStateElements[0]->hash_value()].tiredness > 0);
+
+		for (unsigned int e = 0; e < 2; e++) {
+			double tired = (e == 0) ? tirednessBelief : 1.0 - tirednessBelief;
+
+			BeliefState b;
+			b.set(tirednessStateElements[0], firstTired ? tired : 1.0 - tired);
+			b.set(tirednessStateElements[1], firstTired ? 1.0 - tired : tired);
+
+			if (write_policy_row(file, policy, k, b, tirednessStateElements[e]->hash_value())) {
+				return true;
+			}
+		}
+	}
+
+	file.close();
+
+	return false;
+}
+
+bool LPOMDPMapped::write_policy_row(std::ofstream &file, PolicyAlphaVectors **policy, unsigned int k,
+		BeliefState &b, unsigned int state)
+{
+	Action *a = policy[k - 1]->get(&b);
+	if (a == nullptr) {
+		return true;
+	}
+
+	const LPOMDPMappedStateInfo &info = stateInfo[state];
+	const LPOMDPMappedStateInfo &successor = stateInfo[get_successor(state, a->hash_value())];
+
+	file << info.currentStep << ",";
+	file << info.current << ",";
+	file << (unsigned int)info.tiredness << ",";
+	file << (unsigned int)info.autonomy << ",";
+	file << successor.previousStep << ",";
+	file << (unsigned int)successor.autonomy << ",";
+	for (unsigned int i = 0; i < k; i++) {
+		file << policy[i]->compute_value(&b);
+		if (i != k - 1) {
+			file << ",";
+		}
+	}
+	file << std::endl;
+
+	return false;
+}
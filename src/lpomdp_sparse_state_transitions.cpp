@@ -0,0 +1,127 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Hollins Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "../include/lpomdp_sparse_state_transitions.h"
+
+#include "../../librbr/librbr/include/core/state_transitions/state_transition_exception.h"
+
+#include <algorithm>
+
+LPOMDPSparseStateTransitions::LPOMDPSparseStateTransitions(const std::vector<State *> &states, unsigned int m,
+		std::vector<unsigned long long> &rowOffsets, std::vector<LPOMDPMappedTransition> &entries) :
+		states(states), m(m), maxSuccessors(0)
+{
+	size_t rows = states.size() * m;
+	if (rowOffsets.size() != rows + 1 || rowOffsets[0] != 0 || rowOffsets[rows] != entries.size()) {
+		throw StateTransitionException();
+	}
+
+	ownedRowOffsets.swap(rowOffsets);
+	ownedEntries.swap(entries);
+
+	this->rowOffsets = ownedRowOffsets.data();
+	this->entries = ownedEntries.data();
+
+	find_max_successors();
+}
+
+LPOMDPSparseStateTransitions::LPOMDPSparseStateTransitions(const std::vector<State *> &states, unsigned int m,
+		const unsigned long long *rowOffsets, const LPOMDPMappedTransition *entries) :
+		states(states), m(m), rowOffsets(rowOffsets), entries(entries), maxSuccessors(0)
+{
+	find_max_successors();
+}
+
+LPOMDPSparseStateTransitions::~LPOMDPSparseStateTransitions()
+{ }
+
+void LPOMDPSparseStateTransitions::set(const State *s, const Action *a, const State *sp, double p)
+{
+	throw StateTransitionException();
+}
+
+double LPOMDPSparseStateTransitions::get(const State *s, const Action *a, const State *sp) const
+{
+	size_t row = (size_t)s->hash_value() * m + a->hash_value();
+	for (unsigned long long i = rowOffsets[row]; i < rowOffsets[row + 1]; i++) {
+		if (entries[i].successor == sp->hash_value()) {
+			return entries[i].probability;
+		}
+	}
+	return 0.0;
+}
+
+void LPOMDPSparseStateTransitions::successors(const States *S, const State *s, const Action *a,
+		std::vector<State *> &result) const
+{
+	size_t row = (size_t)s->hash_value() * m + a->hash_value();
+	for (unsigned long long i = rowOffsets[row]; i < rowOffsets[row + 1]; i++) {
+		result.push_back(states[entries[i].successor]);
+	}
+}
+
+const LPOMDPMappedTransition *LPOMDPSparseStateTransitions::get_row(unsigned int s, unsigned int a, unsigned int &count) const
+{
+	size_t row = (size_t)s * m + a;
+	count = (unsigned int)(rowOffsets[row + 1] - rowOffsets[row]);
+	return entries + rowOffsets[row];
+}
+
+const unsigned long long *LPOMDPSparseStateTransitions::get_row_offsets() const
+{
+	return rowOffsets;
+}
+
+const LPOMDPMappedTransition *LPOMDPSparseStateTransitions::get_entries() const
+{
+	return entries;
+}
+
+unsigned long long LPOMDPSparseStateTransitions::get_num_entries() const
+{
+	return rowOffsets[states.size() * m];
+}
+
+unsigned int LPOMDPSparseStateTransitions::get_max_successors() const
+{
+	return maxSuccessors;
+}
+
+unsigned int LPOMDPSparseStateTransitions::get_num_states() const
+{
+	return states.size();
+}
+
+unsigned int LPOMDPSparseStateTransitions::get_num_actions() const
+{
+	return m;
+}
+
+void LPOMDPSparseStateTransitions::find_max_successors()
+{
+	maxSuccessors = 0;
+	for (size_t row = 0; row < states.size() * m; row++) {
+		maxSuccessors = std::max(maxSuccessors, (unsigned int)(rowOffsets[row + 1] - rowOffsets[row]));
+	}
+}
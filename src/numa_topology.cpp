@@ -0,0 +1,215 @@
+/**
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2015 Kyle Wray, University of Massachusetts
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy of
+ *  this software and associated documentation files (the "Software"), to deal in
+ *  the Software without restriction, including without limitation the rights to
+ *  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ *  the Software, and to permit persons to whom the Software is furnished to do so,
+ *  subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ *  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ *  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ *  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+
+#include "../include/numa_topology.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+// These mirror the values in the kernel's mempolicy.h, so that libnuma is not required.
+#define NUMA_MPOL_BIND 2
+#define NUMA_MPOL_INTERLEAVE 3
+#define NUMA_MPOL_MF_MOVE (1 << 1)
+
+#define NUMA_SYSFS_NODE_PATH "/sys/devices/system/node"
+
+NUMATopology::NUMATopology()
+{
+	DIR *directory = opendir(NUMA_SYSFS_NODE_PATH);
+	if (directory != nullptr) {
+		struct dirent *entry = nullptr;
+		while ((entry = readdir(directory)) != nullptr) {
+			std::string name(entry->d_name);
+			if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+					!std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+				continue;
+			}
+			nodeIDs.push_back(std::stoul(name.substr(4)));
+		}
+		closedir(directory);
+	}
+
+	// Keep the nodes in order of their identifiers, so that worker assignments are stable.
+	std::sort(nodeIDs.begin(), nodeIDs.end());
+
+	for (unsigned int id : nodeIDs) {
+		std::vector<int> cpus;
+
+		std::ifstream file(std::string(NUMA_SYSFS_NODE_PATH) + "/node" + std::to_string(id) + "/cpulist");
+		std::string cpuList;
+		if (file.is_open() && std::getline(file, cpuList)) {
+			parse_cpu_list(cpuList, cpus);
+		}
+
+		nodeCPUs.push_back(cpus);
+	}
+
+	// Without sysfs, behave as a single node with unknown CPUs.
+	if (nodeIDs.empty()) {
+		nodeIDs.push_back(0);
+		nodeCPUs.push_back(std::vector<int>());
+	}
+}
+
+NUMATopology::~NUMATopology()
+{ }
+
+unsigned int NUMATopology::get_num_nodes() const
+{
+	return nodeIDs.size();
+}
+
+const std::vector<int> &NUMATopology::get_cpus(unsigned int node) const
+{
+	return nodeCPUs.at(node);
+}
+
+unsigned int NUMATopology::get_worker_node(unsigned int worker, unsigned int numWorkers) const
+{
+	if (numWorkers == 0) {
+		return 0;
+	}
+	return (unsigned int)((unsigned long)worker * get_num_nodes() / numWorkers);
+}
+
+bool NUMATopology::pin_current_thread(unsigned int node) const
+{
+	const std::vector<int> &cpus = nodeCPUs.at(node);
+	if (cpus.empty()) {
+		return true;
+	}
+
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	for (int cpu : cpus) {
+		CPU_SET(cpu, &cpuSet);
+	}
+
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) != 0;
+}
+
+bool NUMATopology::interleave(const void *address, size_t length) const
+{
+	std::vector<unsigned int> nodes;
+	for (unsigned int i = 0; i < get_num_nodes(); i++) {
+		nodes.push_back(i);
+	}
+	return apply_policy(address, length, NUMA_MPOL_INTERLEAVE, nodes);
+}
+
+bool NUMATopology::bind(const void *address, size_t length, unsigned int node) const
+{
+	return apply_policy(address, length, NUMA_MPOL_BIND, std::vector<unsigned int>(1, node));
+}
+
+void NUMATopology::get_counters(std::vector<NUMACounters> &counters) const
+{
+	counters.clear();
+
+	for (unsigned int id : nodeIDs) {
+		NUMACounters c = {0, 0, 0, 0};
+
+		std::ifstream file(std::string(NUMA_SYSFS_NODE_PATH) + "/node" + std::to_string(id) + "/numastat");
+		std::string key;
+		unsigned long value = 0;
+		while (file.is_open() && file >> key >> value) {
+			if (key == "numa_hit") {
+				c.numaHit = value;
+			} else if (key == "numa_miss") {
+				c.numaMiss = value;
+			} else if (key == "local_node") {
+				c.localNode = value;
+			} else if (key == "other_node") {
+				c.otherNode = value;
+			}
+		}
+
+		counters.push_back(c);
+	}
+}
+
+void NUMATopology::parse_cpu_list(const std::string &cpuList, std::vector<int> &cpus) const
+{
+	std::stringstream stream(cpuList);
+	std::string range;
+
+	while (std::getline(stream, range, ',')) {
+		if (range.empty()) {
+			continue;
+		}
+
+		try {
+			size_t dash = range.find('-');
+			if (dash == std::string::npos) {
+				cpus.push_back(std::stoi(range));
+			} else {
+				int first = std::stoi(range.substr(0, dash));
+				int last = std::stoi(range.substr(dash + 1));
+				for (int cpu = first; cpu <= last; cpu++) {
+					cpus.push_back(cpu);
+				}
+			}
+		} catch (std::exception &err) {
+			// Malformed entries are ignored; the node simply has fewer known CPUs.
+		}
+	}
+}
+
+bool NUMATopology::apply_policy(const void *address, size_t length, int mode,
+		const std::vector<unsigned int> &nodes) const
+{
+#ifdef SYS_mbind
+	if (address == nullptr || length == 0 || nodeCPUs.size() < 2) {
+		return true;
+	}
+
+	// The nodemask is over sysfs node identifiers, not node indexes.
+	unsigned int maxID = nodeIDs.back();
+	const unsigned int bitsPerWord = 8 * sizeof(unsigned long);
+	std::vector<unsigned long> mask(maxID / bitsPerWord + 1, 0);
+	for (unsigned int node : nodes) {
+		unsigned int id = nodeIDs.at(node);
+		mask[id / bitsPerWord] |= (1UL << (id % bitsPerWord));
+	}
+
+	// The policy must start on a page boundary, so extend the region to cover whole pages.
+	unsigned long pageSize = (unsigned long)sysconf(_SC_PAGESIZE);
+	unsigned long start = (unsigned long)address & ~(pageSize - 1);
+	unsigned long end = (unsigned long)address + length;
+
+	long result = syscall(SYS_mbind, start, end - start, mode, mask.data(),
+			mask.size() * bitsPerWord + 1, NUMA_MPOL_MF_MOVE);
+
+	return result != 0;
+#else
+	return true;
+#endif
+}